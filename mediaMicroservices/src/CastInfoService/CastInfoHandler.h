@@ -67,14 +67,8 @@ void CastInfoHandler::WriteCastInfo(
     const std::string &intro,
     const std::map<std::string, std::string> &carrier) {
   // Initialize a span
-  TextMapReader reader(carrier);
   std::map<std::string, std::string> writer_text_map;
-  TextMapWriter writer(writer_text_map);
-  auto parent_span = opentracing::Tracer::Global()->Extract(reader);
-  auto span = opentracing::Tracer::Global()->StartSpan(
-      "WriteCastInfo",
-      { opentracing::ChildOf(parent_span->get()) });
-  opentracing::Tracer::Global()->Inject(span->context(), writer);
+  auto span = StartSpanFromCarrier("WriteCastInfo", carrier, &writer_text_map);
 
   LOG(info) << "REQUEST to write cast info (cast_info_id=" << cast_info_id << ", name=" << name << ", gender=" << gender << ")";
 
@@ -132,8 +126,7 @@ void CastInfoHandler::WriteCastInfo(
     }
   
     bson_error_t error;
-    auto insert_span = opentracing::Tracer::Global()->StartSpan(
-        "MongoInsertCastInfo", { opentracing::ChildOf(&span->context()) });
+    auto insert_span = StartChildSpan("MongoInsertCastInfo", span->context());
     bool plotinsert = mongoc_collection_insert_one (
         collection, new_doc, nullptr, nullptr, &error);
     insert_span->Finish();
@@ -166,14 +159,8 @@ void CastInfoHandler::ReadCastInfo(
     const std::map<std::string, std::string> &carrier) {
 
   // Initialize a span
-  TextMapReader reader(carrier);
   std::map<std::string, std::string> writer_text_map;
-  TextMapWriter writer(writer_text_map);
-  auto parent_span = opentracing::Tracer::Global()->Extract(reader);
-  auto span = opentracing::Tracer::Global()->StartSpan(
-      "ReadCastInfo",
-      { opentracing::ChildOf(parent_span->get()) });
-  opentracing::Tracer::Global()->Inject(span->context(), writer);
+  auto span = StartSpanFromCarrier("ReadCastInfo", carrier, &writer_text_map);
 
   LOG(info) << "REQUEST to write cast info (#cast_info_ids=" << cast_info_ids.size() << ")";
 
@@ -228,8 +215,7 @@ void CastInfoHandler::ReadCastInfo(
   char *return_value;
   size_t return_value_length;
   uint32_t flags;
-  auto get_span = opentracing::Tracer::Global()->StartSpan(
-      "MmcMgetCastInfo", { opentracing::ChildOf(&span->context()) });
+  auto get_span = StartChildSpan("MmcMgetCastInfo", span->context());
   while (true) {
     return_value = memcached_fetch(memcached_client, return_key,
         &return_key_length, &return_value_length, &flags, &memcached_rc);
@@ -276,8 +262,7 @@ void CastInfoHandler::ReadCastInfo(
       // --------------------------------------------------
       // ------------------ COUCHDB READ ------------------
       // --------------------------------------------------
-      auto find_span = opentracing::Tracer::Global()->StartSpan(
-        "CouchDBFindCastInfo", { opentracing::ChildOf(&span->context()) });
+      auto find_span = StartChildSpan("CouchDBFindCastInfo", span->context());
 
       for (auto id : cast_info_ids_not_cached) {
         const std::string id_str = std::to_string(id);
@@ -343,8 +328,7 @@ void CastInfoHandler::ReadCastInfo(
           collection, query, nullptr, nullptr);
       const bson_t *doc;
   
-      auto find_span = opentracing::Tracer::Global()->StartSpan(
-          "MongoFindCastInfo", {opentracing::ChildOf(&span->context())});
+      auto find_span = StartChildSpan("MongoFindCastInfo", span->context());
   
       while (true) {
         bool found = mongoc_cursor_next(cursor, &doc);
@@ -395,8 +379,7 @@ void CastInfoHandler::ReadCastInfo(
         se.message = "Failed to pop a client from memcached pool";
         throw se;
       }
-      auto set_span = opentracing::Tracer::Global()->StartSpan(
-          "MmcSetCastInfo", {opentracing::ChildOf(&span->context())});
+      auto set_span = StartChildSpan("MmcSetCastInfo", span->context());
       for (auto & it : cast_info_json_map) {
         std::string id_str = std::to_string(it.first);
         _rc = memcached_set(
@@ -4,7 +4,11 @@
 #include <vector>
 #include <mutex>
 #include <condition_variable>
-#include <deque>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <functional>
+#include <algorithm>
 #include <chrono>
 #include <string>
 
@@ -12,11 +16,27 @@
 
 namespace media_service {
 
+struct ClientPoolStats {
+  uint64_t pops;
+  uint64_t waits;
+  uint64_t wait_us;
+  uint64_t timeouts;
+  uint64_t steals;
+  uint64_t created;
+  uint64_t removed;
+  int curr_pool_size;
+};
+
+// Idle clients are kept in per-core shards plus a global overflow stack.
+// All of them are Treiber stacks over one preallocated node array, so
+// Pop()/Push() never take a lock unless the pool is exhausted and the caller
+// has to wait for a client to be returned.
 template<class TClient>
 class ClientPool {
  public:
   ClientPool(const std::string &client_type, const std::string &addr,
-      int port, int min_size, int max_size, int timeout_ms);
+      int port, int min_size, int max_size, int timeout_ms,
+      int stats_interval_ms = 0);
   ~ClientPool();
 
   ClientPool(const ClientPool&) = delete;
@@ -29,118 +49,356 @@ class ClientPool {
   void Push(TClient *, int);
   void Remove(TClient *);
 
+  ClientPoolStats GetStats() const;
+
  private:
-  std::deque<TClient *> _pool;
+  static constexpr uint32_t kNilNode = 0xFFFFFFFF;
+
+  struct Node {
+    TClient *client;
+    std::atomic<uint32_t> next;
+  };
+
+  // Padded to a cache line so neighbouring shards do not false-share.
+  struct Shard {
+    std::atomic<uint64_t> head;
+    std::atomic<int> size;
+    char padding[64 - sizeof(std::atomic<uint64_t>) - sizeof(std::atomic<int>)];
+  };
+
+  void _PushNode(std::atomic<uint64_t> *head, uint32_t idx);
+  uint32_t _PopNode(std::atomic<uint64_t> *head);
+  void _PushIdle(TClient *client);
+  TClient *_TryAcquire();
+  bool _TryReserve();
+  void _NotifyWaiters();
+  size_t _ShardIndex() const;
+  // Logs GetStats() every stats_interval_ms until the pool is destroyed.
+  void _LogStats(int stats_interval_ms);
+
   std::string _addr;
   std::string _client_type;
   int _port;
   int _min_pool_size{};
   int _max_pool_size{};
-  int _curr_pool_size{};
   int _timeout_ms;
+
+  size_t _num_shards;
+  int _shard_capacity;
+  std::unique_ptr<Node[]> _nodes;
+  std::unique_ptr<Shard[]> _shards;
+  std::atomic<uint64_t> _free_nodes;
+  std::atomic<uint64_t> _overflow;
+  std::atomic<int> _curr_pool_size;
+
+  // Only used on the slow path when every client is checked out.
   std::mutex _mtx;
   std::condition_variable _cv;
+  std::atomic<int> _num_waiters;
 
+  std::atomic<uint64_t> _pops;
+  std::atomic<uint64_t> _waits;
+  std::atomic<uint64_t> _wait_us;
+  std::atomic<uint64_t> _timeouts;
+  std::atomic<uint64_t> _steals;
+  std::atomic<uint64_t> _created;
+  std::atomic<uint64_t> _removed;
+
+  std::thread _stats_thread;
+  std::mutex _stats_mtx;
+  std::condition_variable _stats_cv;
+  bool _stats_stopping;
 };
 
 template<class TClient>
 ClientPool<TClient>::ClientPool(const std::string &client_type,
     const std::string &addr, int port, int min_pool_size,
-    int max_pool_size, int timeout_ms) {
+    int max_pool_size, int timeout_ms, int stats_interval_ms) {
   _addr = addr;
   _port = port;
   _min_pool_size = min_pool_size;
-  _max_pool_size = max_pool_size;
+  _max_pool_size = std::max(max_pool_size, 1);
   _timeout_ms = timeout_ms;
   _client_type = client_type;
 
-  for (int i = 0; i < min_pool_size; ++i) {
+  _num_shards = std::max(std::thread::hardware_concurrency(), 1u);
+  _shard_capacity = std::max(_max_pool_size / static_cast<int>(_num_shards), 1);
+  _shards.reset(new Shard[_num_shards]);
+  for (size_t i = 0; i < _num_shards; ++i) {
+    _shards[i].head.store(kNilNode);
+    _shards[i].size.store(0);
+  }
+
+  // One node per client that can ever exist, so an idle client always finds
+  // a free node to sit in.
+  _nodes.reset(new Node[_max_pool_size]);
+  _free_nodes.store(kNilNode);
+  _overflow.store(kNilNode);
+  for (uint32_t i = 0; i < static_cast<uint32_t>(_max_pool_size); ++i) {
+    _nodes[i].client = nullptr;
+    _PushNode(&_free_nodes, i);
+  }
+
+  _num_waiters.store(0);
+  _pops.store(0);
+  _waits.store(0);
+  _wait_us.store(0);
+  _timeouts.store(0);
+  _steals.store(0);
+  _created.store(0);
+  _removed.store(0);
+
+  _curr_pool_size.store(0);
+  for (int i = 0; i < min_pool_size && i < _max_pool_size; ++i) {
     TClient *client = new TClient(addr, port);
-    _pool.emplace_back(client);
+    _curr_pool_size++;
+    _created++;
+    uint32_t idx = _PopNode(&_free_nodes);
+    _nodes[idx].client = client;
+    _PushNode(&_overflow, idx);
+  }
+
+  _stats_stopping = false;
+  if (stats_interval_ms > 0) {
+    _stats_thread =
+        std::thread(&ClientPool::_LogStats, this, stats_interval_ms);
   }
-  _curr_pool_size = min_pool_size;
 }
 
 template<class TClient>
 ClientPool<TClient>::~ClientPool() {
-  while (!_pool.empty()) {
-    delete _pool.front();
-    _pool.pop_front();
+  if (_stats_thread.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(_stats_mtx);
+      _stats_stopping = true;
+    }
+    _stats_cv.notify_one();
+    _stats_thread.join();
+  }
+  uint32_t idx;
+  for (size_t i = 0; i < _num_shards; ++i) {
+    while ((idx = _PopNode(&_shards[i].head)) != kNilNode) {
+      delete _nodes[idx].client;
+    }
+  }
+  while ((idx = _PopNode(&_overflow)) != kNilNode) {
+    delete _nodes[idx].client;
+  }
+}
+
+template<class TClient>
+void ClientPool<TClient>::_PushNode(std::atomic<uint64_t> *head, uint32_t idx) {
+  // The upper 32 bits of a head are a version tag to avoid ABA.
+  uint64_t old_head = head->load(std::memory_order_relaxed);
+  uint64_t new_head;
+  do {
+    _nodes[idx].next.store(static_cast<uint32_t>(old_head),
+                           std::memory_order_relaxed);
+    new_head = (((old_head >> 32) + 1) << 32) | idx;
+  } while (!head->compare_exchange_weak(old_head, new_head,
+      std::memory_order_release, std::memory_order_relaxed));
+}
+
+template<class TClient>
+uint32_t ClientPool<TClient>::_PopNode(std::atomic<uint64_t> *head) {
+  uint64_t old_head = head->load(std::memory_order_acquire);
+  while (true) {
+    uint32_t idx = static_cast<uint32_t>(old_head);
+    if (idx == kNilNode) {
+      return kNilNode;
+    }
+    uint32_t next = _nodes[idx].next.load(std::memory_order_relaxed);
+    uint64_t new_head = (((old_head >> 32) + 1) << 32) | next;
+    if (head->compare_exchange_weak(old_head, new_head,
+        std::memory_order_acq_rel, std::memory_order_acquire)) {
+      return idx;
+    }
+  }
+}
+
+template<class TClient>
+size_t ClientPool<TClient>::_ShardIndex() const {
+  static thread_local size_t thread_hash =
+      std::hash<std::thread::id>()(std::this_thread::get_id());
+  return thread_hash % _num_shards;
+}
+
+template<class TClient>
+void ClientPool<TClient>::_PushIdle(TClient *client) {
+  uint32_t idx = _PopNode(&_free_nodes);
+  _nodes[idx].client = client;
+  Shard &shard = _shards[_ShardIndex()];
+  if (shard.size.load(std::memory_order_relaxed) < _shard_capacity) {
+    shard.size.fetch_add(1, std::memory_order_relaxed);
+    _PushNode(&shard.head, idx);
+  } else {
+    _PushNode(&_overflow, idx);
+  }
+}
+
+template<class TClient>
+TClient * ClientPool<TClient>::_TryAcquire() {
+  size_t local = _ShardIndex();
+  uint32_t idx = _PopNode(&_shards[local].head);
+  if (idx != kNilNode) {
+    _shards[local].size.fetch_sub(1, std::memory_order_relaxed);
+  } else {
+    idx = _PopNode(&_overflow);
+  }
+  if (idx == kNilNode) {
+    for (size_t i = 1; i < _num_shards; ++i) {
+      Shard &victim = _shards[(local + i) % _num_shards];
+      idx = _PopNode(&victim.head);
+      if (idx != kNilNode) {
+        victim.size.fetch_sub(1, std::memory_order_relaxed);
+        _steals.fetch_add(1, std::memory_order_relaxed);
+        break;
+      }
+    }
+  }
+  if (idx == kNilNode) {
+    return nullptr;
+  }
+  TClient *client = _nodes[idx].client;
+  _PushNode(&_free_nodes, idx);
+  return client;
+}
+
+template<class TClient>
+bool ClientPool<TClient>::_TryReserve() {
+  int curr = _curr_pool_size.load(std::memory_order_relaxed);
+  while (curr < _max_pool_size) {
+    if (_curr_pool_size.compare_exchange_weak(curr, curr + 1)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+template<class TClient>
+void ClientPool<TClient>::_NotifyWaiters() {
+  if (_num_waiters.load() > 0) {
+    // Taking the lock guarantees a waiter that registered itself is already
+    // blocked in wait_until and will not miss this notification.
+    std::unique_lock<std::mutex> cv_lock(_mtx);
+    cv_lock.unlock();
+    _cv.notify_one();
   }
 }
 
 template<class TClient>
 TClient * ClientPool<TClient>::Pop() {
-  TClient * client = nullptr;
-  std::unique_lock<std::mutex> cv_lock(_mtx); {
-    while (_pool.size() == 0) {
-      // Create a new a client if current pool size is less than
-      // the max pool size.
-      if (_curr_pool_size < _max_pool_size) {
-        try {
-          client = new TClient(_addr, _port);
-          _curr_pool_size++;
+  _pops.fetch_add(1, std::memory_order_relaxed);
+  TClient * client = _TryAcquire();
+  bool reserved = false;
+  if (!client) {
+    reserved = _TryReserve();
+  }
+
+  if (!client && !reserved) {
+    // Pool is exhausted, wait until a client is pushed back or removed.
+    auto start_time = std::chrono::steady_clock::now();
+    auto wait_time = start_time + std::chrono::milliseconds(_timeout_ms);
+    _waits.fetch_add(1, std::memory_order_relaxed);
+    {
+      std::unique_lock<std::mutex> cv_lock(_mtx);
+      _num_waiters++;
+      while (!(client = _TryAcquire()) && !(reserved = _TryReserve())) {
+        if (_cv.wait_until(cv_lock, wait_time) == std::cv_status::timeout) {
+          client = _TryAcquire();
+          if (!client) {
+            reserved = _TryReserve();
+          }
           break;
-        } catch (...) {
-          cv_lock.unlock();
-          return nullptr;
-        }
-      } else {
-        auto wait_time = std::chrono::system_clock::now() +
-            std::chrono::milliseconds(_timeout_ms);
-        bool wait_success = _cv.wait_until(cv_lock, wait_time,
-            [this] { return _pool.size() > 0; });
-        if (!wait_success) {
-          LOG(warning) << "ClientPool pop timeout";
-          cv_lock.unlock();
-          return nullptr;
         }
       }
+      _num_waiters--;
+    } // cv_lock(_mtx)
+    _wait_us.fetch_add(
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start_time).count(),
+        std::memory_order_relaxed);
+    if (!client && !reserved) {
+      _timeouts.fetch_add(1, std::memory_order_relaxed);
+      LOG(warning) << "ClientPool pop timeout";
+      LOG(info) << _curr_pool_size.load() << " " << _max_pool_size;
+      return nullptr;
     }
-    if (!client){
-      client = _pool.front();
-      _pool.pop_front();
-    }
-
-  } // cv_lock(_mtx)
-  cv_lock.unlock();
+  }
 
-  if (client) {
+  if (!client) {
     try {
-      client->Connect();
+      client = new TClient(_addr, _port);
     } catch (...) {
-      LOG(error) << "Failed to connect " + _client_type;
-      _pool.push_back(client);
-      throw;
-    }    
+      _curr_pool_size--;
+      _NotifyWaiters();
+      return nullptr;
+    }
+    _created.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  try {
+    client->Connect();
+  } catch (...) {
+    LOG(error) << "Failed to connect " + _client_type;
+    _PushIdle(client);
+    _NotifyWaiters();
+    throw;
   }
   return client;
 }
 
 template<class TClient>
 void ClientPool<TClient>::Push(TClient *client) {
-  std::unique_lock<std::mutex> cv_lock(_mtx);
   client->KeepAlive();
-  _pool.push_back(client);
-  cv_lock.unlock();
-  _cv.notify_one();
+  _PushIdle(client);
+  _NotifyWaiters();
 }
 
 template<class TClient>
 void ClientPool<TClient>::Push(TClient *client, int timeout_ms) {
-  std::unique_lock<std::mutex> cv_lock(_mtx);
   client->KeepAlive(timeout_ms);
-  _pool.push_back(client);
-  cv_lock.unlock();
-  _cv.notify_one();
+  _PushIdle(client);
+  _NotifyWaiters();
 }
 
 template<class TClient>
 void ClientPool<TClient>::Remove(TClient *client) {
-  std::unique_lock<std::mutex> lock(_mtx);
   delete client;
   _curr_pool_size--;
-  lock.unlock();
+  _removed.fetch_add(1, std::memory_order_relaxed);
+  _NotifyWaiters();
+}
+
+template<class TClient>
+ClientPoolStats ClientPool<TClient>::GetStats() const {
+  ClientPoolStats stats;
+  stats.pops = _pops.load(std::memory_order_relaxed);
+  stats.waits = _waits.load(std::memory_order_relaxed);
+  stats.wait_us = _wait_us.load(std::memory_order_relaxed);
+  stats.timeouts = _timeouts.load(std::memory_order_relaxed);
+  stats.steals = _steals.load(std::memory_order_relaxed);
+  stats.created = _created.load(std::memory_order_relaxed);
+  stats.removed = _removed.load(std::memory_order_relaxed);
+  stats.curr_pool_size = _curr_pool_size.load(std::memory_order_relaxed);
+  return stats;
+}
+
+template<class TClient>
+void ClientPool<TClient>::_LogStats(int stats_interval_ms) {
+  std::unique_lock<std::mutex> lock(_stats_mtx);
+  while (!_stats_cv.wait_for(lock,
+                             std::chrono::milliseconds(stats_interval_ms),
+                             [this]() { return _stats_stopping; })) {
+    ClientPoolStats stats = GetStats();
+    double avg_wait_us =
+        stats.waits > 0 ? static_cast<double>(stats.wait_us) / stats.waits : 0;
+    LOG(info) << _client_type << " client pool stats: pops=" << stats.pops
+              << " waits=" << stats.waits << " avg_wait_us=" << avg_wait_us
+              << " timeouts=" << stats.timeouts << " steals=" << stats.steals
+              << " created=" << stats.created << " removed=" << stats.removed
+              << " size=" << stats.curr_pool_size;
+  }
 }
 
 } // namespace media_service
@@ -262,14 +262,8 @@ void ComposeReviewHandler::UploadMovieId(
     const std::map<std::string, std::string> & carrier) {
 
   // Initialize a span
-  TextMapReader reader(carrier);
   std::map<std::string, std::string> writer_text_map;
-  TextMapWriter writer(writer_text_map);
-  auto parent_span = opentracing::Tracer::Global()->Extract(reader);
-  auto span = opentracing::Tracer::Global()->StartSpan(
-      "UploadMovieId",
-      { opentracing::ChildOf(parent_span->get()) });
-  opentracing::Tracer::Global()->Inject(span->context(), writer);
+  auto span = StartSpanFromCarrier("UploadMovieId", carrier, &writer_text_map);
 
   memcached_return_t memcached_rc;
   std::string key_counter = std::to_string(req_id) + ":counter";
@@ -370,14 +364,8 @@ void ComposeReviewHandler::UploadUserId(
     const std::map<std::string, std::string> & carrier) {
 
   // Initialize a span
-  TextMapReader reader(carrier);
   std::map<std::string, std::string> writer_text_map;
-  TextMapWriter writer(writer_text_map);
-  auto parent_span = opentracing::Tracer::Global()->Extract(reader);
-  auto span = opentracing::Tracer::Global()->StartSpan(
-      "UploadUserId",
-      { opentracing::ChildOf(parent_span->get()) });
-  opentracing::Tracer::Global()->Inject(span->context(), writer);
+  auto span = StartSpanFromCarrier("UploadUserId", carrier, &writer_text_map);
 
   memcached_return_t memcached_rc;
   std::string key_counter = std::to_string(req_id) + ":counter";
@@ -480,14 +468,8 @@ void ComposeReviewHandler::UploadUniqueId(
     const std::map<std::string, std::string> & carrier) {
 
   // Initialize a span
-  TextMapReader reader(carrier);
   std::map<std::string, std::string> writer_text_map;
-  TextMapWriter writer(writer_text_map);
-  auto parent_span = opentracing::Tracer::Global()->Extract(reader);
-  auto span = opentracing::Tracer::Global()->StartSpan(
-      "UploadUniqueId",
-      { opentracing::ChildOf(parent_span->get()) });
-  opentracing::Tracer::Global()->Inject(span->context(), writer);
+  auto span = StartSpanFromCarrier("UploadUniqueId", carrier, &writer_text_map);
 
   memcached_return_t memcached_rc;
   std::string key_counter = std::to_string(req_id) + ":counter";
@@ -592,14 +574,8 @@ void ComposeReviewHandler::UploadText(
     const std::map<std::string, std::string> & carrier) {
 
   // Initialize a span
-  TextMapReader reader(carrier);
   std::map<std::string, std::string> writer_text_map;
-  TextMapWriter writer(writer_text_map);
-  auto parent_span = opentracing::Tracer::Global()->Extract(reader);
-  auto span = opentracing::Tracer::Global()->StartSpan(
-      "UploadText",
-      { opentracing::ChildOf(parent_span->get()) });
-  opentracing::Tracer::Global()->Inject(span->context(), writer);
+  auto span = StartSpanFromCarrier("UploadText", carrier, &writer_text_map);
 
   memcached_return_t memcached_rc;
   std::string key_counter = std::to_string(req_id) + ":counter";
@@ -698,14 +674,8 @@ void ComposeReviewHandler::UploadRating(
     int64_t req_id, int32_t rating, const std::map<std::string, std::string> & carrier) {
 
   // Initialize a span
-  TextMapReader reader(carrier);
   std::map<std::string, std::string> writer_text_map;
-  TextMapWriter writer(writer_text_map);
-  auto parent_span = opentracing::Tracer::Global()->Extract(reader);
-  auto span = opentracing::Tracer::Global()->StartSpan(
-      "UploadRating",
-      { opentracing::ChildOf(parent_span->get()) });
-  opentracing::Tracer::Global()->Inject(span->context(), writer);
+  auto span = StartSpanFromCarrier("UploadRating", carrier, &writer_text_map);
 
   memcached_return_t memcached_rc;
   std::string key_counter = std::to_string(req_id) + ":counter";
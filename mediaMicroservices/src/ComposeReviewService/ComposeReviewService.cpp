@@ -41,12 +41,19 @@ int main(int argc, char *argv[]) {
   std::string movie_review_addr = config_json["movie-review-service"]["addr"];
   int movie_review_port = config_json["movie-review-service"]["port"];
 
+  // Interval at which each client pool logs its counters, 0 disables it.
+  int client_pool_stats_interval_ms =
+      config_json.value("client-pool", json::object())
+          .value("stats_interval_ms", 0);
   ClientPool<ThriftClient<ReviewStorageServiceClient>> compose_client_pool(
-      "compose-review-service", review_storage_addr, review_storage_port, 0, 128, 1000);
+      "compose-review-service", review_storage_addr, review_storage_port, 0, 128, 1000,
+      client_pool_stats_interval_ms);
   ClientPool<ThriftClient<UserReviewServiceClient>> user_client_pool(
-      "user-review-service", user_review_addr, user_review_port, 0, 128, 1000);
+      "user-review-service", user_review_addr, user_review_port, 0, 128, 1000,
+      client_pool_stats_interval_ms);
   ClientPool<ThriftClient<MovieReviewServiceClient>> movie_client_pool(
-      "movie-review-service", movie_review_addr, movie_review_port, 0, 128, 1000);
+      "movie-review-service", movie_review_addr, movie_review_port, 0, 128, 1000,
+      client_pool_stats_interval_ms);
 
 
   std::string mmc_addr = config_json["compose-review-memcached"]["addr"];
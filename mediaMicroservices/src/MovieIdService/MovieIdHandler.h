@@ -98,14 +98,8 @@ void MovieIdHandler::UploadMovieId(
     const std::map<std::string, std::string> & carrier) {
 
   // Initialize a span
-  TextMapReader reader(carrier);
   std::map<std::string, std::string> writer_text_map;
-  TextMapWriter writer(writer_text_map);
-  auto parent_span = opentracing::Tracer::Global()->Extract(reader);
-  auto span = opentracing::Tracer::Global()->StartSpan(
-      "UploadMovieId",
-      { opentracing::ChildOf(parent_span->get()) });
-  opentracing::Tracer::Global()->Inject(span->context(), writer);
+  auto span = StartSpanFromCarrier("UploadMovieId", carrier, &writer_text_map);
 
   LOG(info) << "REQUEST to upload movie id (title=" << title << ", rating=" << rating << ")";
 
@@ -124,8 +118,7 @@ void MovieIdHandler::UploadMovieId(
   uint32_t memcached_flags;
   // Look for the movie id from memcached
 
-  auto get_span = opentracing::Tracer::Global()->StartSpan(
-      "MmcGetMovieId", { opentracing::ChildOf(&span->context()) });
+  auto get_span = StartChildSpan("MmcGetMovieId", span->context());
 
   char* movie_id_mmc = memcached_get(
       memcached_client,
@@ -159,8 +152,7 @@ void MovieIdHandler::UploadMovieId(
       // --------------------------------------------------
       // ----------------- READ @ COUCHDB -----------------
       // --------------------------------------------------
-      auto get_span = opentracing::Tracer::Global()->StartSpan(
-          "CouchDBGetMovieId", { opentracing::ChildOf(&span->context()) });
+      auto get_span = StartChildSpan("CouchDBGetMovieId", span->context());
   
       const std::string url = _couchdb_url + title;
       std::string resp;
@@ -193,8 +185,7 @@ void MovieIdHandler::UploadMovieId(
       // --------------------------------------------------
       // ----------------- READ @ DYNAMODB ----------------
       // --------------------------------------------------
-      auto get_span = opentracing::Tracer::Global()->StartSpan(
-          "DynamoGetMovieId", { opentracing::ChildOf(&span->context()) });
+      auto get_span = StartChildSpan("DynamoGetMovieId", span->context());
   
       Aws::DynamoDB::Model::GetItemRequest get_req;
       get_req.SetTableName(_dynamo_table_name);
@@ -246,8 +237,7 @@ void MovieIdHandler::UploadMovieId(
       // --------------------------------------------------
       // ---------------- READ @ POSTGRESQL ---------------
       // --------------------------------------------------
-      auto get_span = opentracing::Tracer::Global()->StartSpan(
-          "PostgreSQLGetMovieId", { opentracing::ChildOf(&span->context()) });
+      auto get_span = StartChildSpan("PostgreSQLGetMovieId", span->context());
 
       try {
         pqxx::connection conn(_postgres_url);
@@ -285,8 +275,7 @@ void MovieIdHandler::UploadMovieId(
   set_future = std::async(std::launch::async, [&]() {
     memcached_client = memcached_pool_pop(
         _memcached_client_pool, true, &memcached_rc);
-    auto set_span = opentracing::Tracer::Global()->StartSpan(
-        "MmcSetMovieId", { opentracing::ChildOf(&span->context()) });
+    auto set_span = StartChildSpan("MmcSetMovieId", span->context());
     // Upload the movie id to memcached
     memcached_rc = memcached_set(
         memcached_client,
@@ -362,14 +351,8 @@ void MovieIdHandler::ReadMovieId(
     const std::map<std::string, std::string> & carrier) {
 
   // Initialize a span
-  TextMapReader reader(carrier);
   std::map<std::string, std::string> writer_text_map;
-  TextMapWriter writer(writer_text_map);
-  auto parent_span = opentracing::Tracer::Global()->Extract(reader);
-  auto span = opentracing::Tracer::Global()->StartSpan(
-      "UploadMovieId",
-      { opentracing::ChildOf(parent_span->get()) });
-  opentracing::Tracer::Global()->Inject(span->context(), writer);
+  auto span = StartSpanFromCarrier("UploadMovieId", carrier, &writer_text_map);
 
   LOG(info) << "REQUEST to upload movie id (title=" << title << ")";
 
@@ -388,8 +371,7 @@ void MovieIdHandler::ReadMovieId(
   uint32_t memcached_flags;
   // Look for the movie id from memcached
 
-  auto get_span = opentracing::Tracer::Global()->StartSpan(
-      "MmcGetMovieId", { opentracing::ChildOf(&span->context()) });
+  auto get_span = StartChildSpan("MmcGetMovieId", span->context());
 
   char* movie_id_mmc = memcached_get(
       memcached_client,
@@ -423,8 +405,7 @@ void MovieIdHandler::ReadMovieId(
       // --------------------------------------------------
       // ----------------- READ @ COUCHDB -----------------
       // --------------------------------------------------
-      auto get_span = opentracing::Tracer::Global()->StartSpan(
-          "CouchDBGetMovieId", { opentracing::ChildOf(&span->context()) });
+      auto get_span = StartChildSpan("CouchDBGetMovieId", span->context());
   
       const std::string url = _couchdb_url + title;
       std::string resp;
@@ -457,8 +438,7 @@ void MovieIdHandler::ReadMovieId(
       // --------------------------------------------------
       // ----------------- READ @ DYNAMODB ----------------
       // --------------------------------------------------
-      auto get_span = opentracing::Tracer::Global()->StartSpan(
-          "DynamoGetMovieId", { opentracing::ChildOf(&span->context()) });
+      auto get_span = StartChildSpan("DynamoGetMovieId", span->context());
   
       Aws::DynamoDB::Model::GetItemRequest get_req;
       get_req.SetTableName(_dynamo_table_name);
@@ -510,8 +490,7 @@ void MovieIdHandler::ReadMovieId(
       // --------------------------------------------------
       // ---------------- READ @ POSTGRESQL ---------------
       // --------------------------------------------------
-      auto get_span = opentracing::Tracer::Global()->StartSpan(
-          "PostgreSQLGetMovieId", { opentracing::ChildOf(&span->context()) });
+      auto get_span = StartChildSpan("PostgreSQLGetMovieId", span->context());
 
       try {
         pqxx::connection conn(_postgres_url);
@@ -547,8 +526,7 @@ void MovieIdHandler::ReadMovieId(
   set_future = std::async(std::launch::async, [&]() {
     memcached_client = memcached_pool_pop(
         _memcached_client_pool, true, &memcached_rc);
-    auto set_span = opentracing::Tracer::Global()->StartSpan(
-        "MmcSetMovieId", { opentracing::ChildOf(&span->context()) });
+    auto set_span = StartChildSpan("MmcSetMovieId", span->context());
     // Upload the movie id to memcached
     memcached_rc = memcached_set(
         memcached_client,
@@ -586,14 +564,9 @@ void MovieIdHandler::RegisterMovieId (
     const std::map<std::string, std::string> & carrier) {
 
   // Initialize a span
-  TextMapReader reader(carrier);
   std::map<std::string, std::string> writer_text_map;
-  TextMapWriter writer(writer_text_map);
-  auto parent_span = opentracing::Tracer::Global()->Extract(reader);
-  auto span = opentracing::Tracer::Global()->StartSpan(
-      "RegisterMovieId",
-      { opentracing::ChildOf(parent_span->get()) });
-  opentracing::Tracer::Global()->Inject(span->context(), writer);
+  auto span = StartSpanFromCarrier(
+      "RegisterMovieId", carrier, &writer_text_map);
 
   LOG(info) << "REQUEST to register movie id (title=" << title << ", movie_id=" << movie_id << ")";
 
@@ -84,10 +84,16 @@ int main(int argc, char *argv[]) {
     return EXIT_FAILURE;
   }
 
+  // Interval at which each client pool logs its counters, 0 disables it.
+  int client_pool_stats_interval_ms =
+      config_json.value("client-pool", json::object())
+          .value("stats_interval_ms", 0);
   ClientPool<ThriftClient<ComposeReviewServiceClient>> compose_client_pool(
-      "compose-review-client", compose_addr, compose_port, 0, 128, 1000);
+      "compose-review-client", compose_addr, compose_port, 0, 128, 1000,
+      client_pool_stats_interval_ms);
   ClientPool<ThriftClient<RatingServiceClient>> rating_client_pool(
-      "rating-client", rating_addr, rating_port, 0, 128, 1000);
+      "rating-client", rating_addr, rating_port, 0, 128, 1000,
+      client_pool_stats_interval_ms);
 
   mongoc_client_t *mongodb_client = mongoc_client_pool_pop(mongodb_client_pool);
   if (!mongodb_client) {
@@ -68,14 +68,8 @@ void MovieInfoHandler::WriteMovieInfo(
     int32_t num_rating,
     const std::map<std::string, std::string> &carrier) {
   // Initialize a span
-  TextMapReader reader(carrier);
   std::map<std::string, std::string> writer_text_map;
-  TextMapWriter writer(writer_text_map);
-  auto parent_span = opentracing::Tracer::Global()->Extract(reader);
-  auto span = opentracing::Tracer::Global()->StartSpan(
-      "WriteMovieInfo",
-      { opentracing::ChildOf(parent_span->get()) });
-  opentracing::Tracer::Global()->Inject(span->context(), writer);
+  auto span = StartSpanFromCarrier("WriteMovieInfo", carrier, &writer_text_map);
 
   json new_doc;
   new_doc["_id"] = movie_id;
@@ -118,14 +112,8 @@ void MovieInfoHandler::ReadMovieInfo(
     const std::map<std::string, std::string> &carrier) {
 
   // Initialize a span
-  TextMapReader reader(carrier);
   std::map<std::string, std::string> writer_text_map;
-  TextMapWriter writer(writer_text_map);
-  auto parent_span = opentracing::Tracer::Global()->Extract(reader);
-  auto span = opentracing::Tracer::Global()->StartSpan(
-      "ReadMovieInfo",
-      { opentracing::ChildOf(parent_span->get()) });
-  opentracing::Tracer::Global()->Inject(span->context(), writer);
+  auto span = StartSpanFromCarrier("ReadMovieInfo", carrier, &writer_text_map);
 
    LOG(info) << "REQUEST to read movie info (movie_id=" << movie_id << ")";
   
@@ -141,8 +129,7 @@ void MovieInfoHandler::ReadMovieInfo(
 
   size_t movie_info_mmc_size;
   uint32_t memcached_flags;
-  auto get_span = opentracing::Tracer::Global()->StartSpan(
-      "MmcGetMovieInfo", { opentracing::ChildOf(&span->context()) });
+  auto get_span = StartChildSpan("MmcGetMovieInfo", span->context());
   char *movie_info_mmc = memcached_get(
       memcached_client,
       movie_id.c_str(),
@@ -239,8 +226,7 @@ void MovieInfoHandler::ReadMovieInfo(
       se.message = "Failed to pop a client from memcached pool";
       throw se;
     }
-    auto set_span = opentracing::Tracer::Global()->StartSpan(
-      "MmcSetMovieInfo", { opentracing::ChildOf(&span->context()) });
+    auto set_span = StartChildSpan("MmcSetMovieInfo", span->context());
 
     std::string movie_info_str = movie_info_json.dump();
 
@@ -269,14 +255,8 @@ void MovieInfoHandler::UpdateRating(
     int32_t sum_uncommitted_rating, int32_t num_uncommitted_rating,
     const std::map<std::string, std::string> & carrier) {
   // Initialize a span
-  TextMapReader reader(carrier);
   std::map<std::string, std::string> writer_text_map;
-  TextMapWriter writer(writer_text_map);
-  auto parent_span = opentracing::Tracer::Global()->Extract(reader);
-  auto span = opentracing::Tracer::Global()->StartSpan(
-      "UpdateRating",
-      { opentracing::ChildOf(parent_span->get()) });
-  opentracing::Tracer::Global()->Inject(span->context(), writer);
+  auto span = StartSpanFromCarrier("UpdateRating", carrier, &writer_text_map);
 
   bson_t *query = bson_new();
   BSON_APPEND_UTF8(query, "movie_id", movie_id.c_str());
@@ -298,8 +278,7 @@ void MovieInfoHandler::UpdateRating(
     mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
     throw se;
   }
-  auto find_span = opentracing::Tracer::Global()->StartSpan(
-      "MongoFindMovieInfo", {opentracing::ChildOf(&span->context())});
+  auto find_span = StartChildSpan("MongoFindMovieInfo", span->context());
   mongoc_cursor_t *cursor = mongoc_collection_find_with_opts(
       collection, query, nullptr, nullptr);
   const bson_t *doc;
@@ -326,8 +305,7 @@ void MovieInfoHandler::UpdateRating(
           "num_rating", BCON_INT32(num_rating), "}");
       bson_error_t error;
       bson_t reply;
-      auto update_span = opentracing::Tracer::Global()->StartSpan(
-          "MongoUpdateRating", {opentracing::ChildOf(&span->context())});
+      auto update_span = StartChildSpan("MongoUpdateRating", span->context());
       bool updated = mongoc_collection_find_and_modify(
           collection,
           query,
@@ -356,8 +334,7 @@ void MovieInfoHandler::UpdateRating(
     }
   }
 
-  auto delete_span = opentracing::Tracer::Global()->StartSpan(
-      "MmcDelete", {opentracing::ChildOf(&span->context())});
+  auto delete_span = StartChildSpan("MmcDelete", span->context());
   memcached_return_t memcached_rc;
   memcached_st *memcached_client = memcached_pool_pop(
       _memcached_client_pool, true, &memcached_rc);
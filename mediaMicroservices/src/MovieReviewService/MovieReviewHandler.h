@@ -57,14 +57,9 @@ void MovieReviewHandler::UploadMovieReview(
     const std::map<std::string, std::string> & carrier) {
 
   // Initialize a span
-  TextMapReader reader(carrier);
   std::map<std::string, std::string> writer_text_map;
-  TextMapWriter writer(writer_text_map);
-  auto parent_span = opentracing::Tracer::Global()->Extract(reader);
-  auto span = opentracing::Tracer::Global()->StartSpan(
-      "UploadMovieReview",
-      { opentracing::ChildOf(parent_span->get()) });
-  opentracing::Tracer::Global()->Inject(span->context(), writer);
+  auto span = StartSpanFromCarrier(
+      "UploadMovieReview", carrier, &writer_text_map);
 
   LOG(info) << "request to upload movie review (movie_id=" << movie_id << ", review_id=" << review_id << ")";
 
@@ -87,8 +82,7 @@ void MovieReviewHandler::UploadMovieReview(
     throw se;
   }
   auto redis_client = redis_client_wrapper->GetClient();
-  auto redis_span = opentracing::Tracer::Global()->StartSpan(
-      "RedisUpdate", {opentracing::ChildOf(&span->context())});
+  auto redis_span = StartChildSpan("RedisUpdate", span->context());
   auto num_reviews = redis_client->zcard(movie_id);
   redis_client->sync_commit();
   auto num_reviews_reply = num_reviews.get();
@@ -113,14 +107,9 @@ void MovieReviewHandler::ReadMovieReviews(
     const std::map<std::string, std::string> & carrier) {
   
   // Initialize a span
-  TextMapReader reader(carrier);
   std::map<std::string, std::string> writer_text_map;
-  TextMapWriter writer(writer_text_map);
-  auto parent_span = opentracing::Tracer::Global()->Extract(reader);
-  auto span = opentracing::Tracer::Global()->StartSpan(
-      "ReadMovieReviews",
-      { opentracing::ChildOf(parent_span->get()) });
-  opentracing::Tracer::Global()->Inject(span->context(), writer);
+  auto span = StartSpanFromCarrier(
+      "ReadMovieReviews", carrier, &writer_text_map);
 
   LOG(info) << "REQUEST to read movie reviews (movie_id=" << movie_id << ", start=" << start << ", stop=" << stop << ")";
 
@@ -136,8 +125,7 @@ void MovieReviewHandler::ReadMovieReviews(
     throw se;
   }
   auto redis_client = redis_client_wrapper->GetClient();
-  auto redis_span = opentracing::Tracer::Global()->StartSpan(
-      "RedisFind", {opentracing::ChildOf(&span->context())});
+  auto redis_span = StartChildSpan("RedisFind", span->context());
   auto review_ids_future = redis_client->zrevrange(movie_id, start, stop - 1);
   redis_client->commit();
   redis_span->Finish();
@@ -207,8 +195,7 @@ void MovieReviewHandler::ReadMovieReviews(
       throw se;
     }
     redis_client = redis_client_wrapper->GetClient();
-    auto redis_update_span = opentracing::Tracer::Global()->StartSpan(
-        "RedisUpdate", {opentracing::ChildOf(&span->context())});
+    auto redis_update_span = StartChildSpan("RedisUpdate", span->context());
     redis_client->del(std::vector<std::string>{movie_id});
     std::vector<std::string> options{"NX"};
     zadd_reply_future = redis_client->zadd(
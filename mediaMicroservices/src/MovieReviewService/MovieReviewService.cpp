@@ -44,11 +44,17 @@ int main(int argc, char *argv[]) {
 
   mongoc_client_pool_t *mongodb_client_pool =
       init_mongodb_client_pool(config_json, "movie-review", 128);
+  // Interval at which each client pool logs its counters, 0 disables it.
+  int client_pool_stats_interval_ms =
+      config_json.value("client-pool", json::object())
+          .value("stats_interval_ms", 0);
   ClientPool<RedisClient> redis_client_pool("movie-review-redis",
-                                            redis_addr, redis_port, 0, 128, 1000);
+                                            redis_addr, redis_port, 0, 128, 1000,
+                                            client_pool_stats_interval_ms);
   ClientPool<ThriftClient<ReviewStorageServiceClient>>
       review_storage_client_pool("review-storage-client", review_storage_addr,
-                               review_storage_port, 0, 128, 1000);
+                               review_storage_port, 0, 128, 1000,
+                               client_pool_stats_interval_ms);
 
   if (mongodb_client_pool == nullptr) {
     return EXIT_FAILURE;
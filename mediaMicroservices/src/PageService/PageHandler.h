@@ -14,6 +14,7 @@
 #include "../tracing.h"
 #include "../ClientPool.h"
 #include "../ThriftClient.h"
+#include "../PendingReply.h"
 
 
 namespace media_service {
@@ -56,120 +57,127 @@ void PageHandler::ReadPage(
     const std::map<std::string, std::string> &carrier) {
 
   // Initialize a span
-  TextMapReader reader(carrier);
   std::map<std::string, std::string> writer_text_map;
-  TextMapWriter writer(writer_text_map);
-  auto parent_span = opentracing::Tracer::Global()->Extract(reader);
-  auto span = opentracing::Tracer::Global()->StartSpan(
-      "ReadPage",
-      { opentracing::ChildOf(parent_span->get()) });
-  opentracing::Tracer::Global()->Inject(span->context(), writer);
+  auto span = StartSpanFromCarrier("ReadPage", carrier, &writer_text_map);
 
   LOG(info) << "REQUEST to read page (movie_id=" << movie_id << ", review_start=" << review_start << ", review_stop=" << review_stop << ")";
 
+  // Requests are written from this thread and the replies are read when the
+  // futures are waited on, so the fan-out needs no extra threads.
   std::future<std::vector<Review>> movie_review_future;
   std::future<MovieInfo> movie_info_future;
   std::future<std::vector<CastInfo>> cast_info_future;
   std::future<std::string> plot_future;
 
-  movie_info_future = std::async(std::launch::async, [&](){
-    MovieInfo _reture_movie_info;
-    auto movie_info_client_wrapper = _movie_info_client_pool->Pop();
-    if (!movie_info_client_wrapper) {
-      ServiceException se;
-      se.errorCode = ErrorCode::SE_THRIFT_CONN_ERROR;
-      se.message = "Failed to connected to movie-info-service";
-      throw se;
-    }
-    auto movie_info_client = movie_info_client_wrapper->GetClient();
-    try {
-      movie_info_client->ReadMovieInfo(_reture_movie_info,
-          req_id, movie_id, writer_text_map);
-    } catch (...) {
-      _movie_info_client_pool->Push(movie_info_client_wrapper);
-      LOG(error) << "Failed to read movie_info to movie-info-service";
-      throw;
-    }
-    _movie_info_client_pool->Push(movie_info_client_wrapper);
-    return _reture_movie_info;
-  });
-
-  movie_review_future = std::async(std::launch::async, [&](){
-    std::vector<Review> _return_movie_reviews;
-    auto movie_review_client_wrapper = _movie_review_client_pool->Pop();
-    if (!movie_review_client_wrapper) {
-      ServiceException se;
-      se.errorCode = ErrorCode::SE_THRIFT_CONN_ERROR;
-      se.message = "Failed to connected to movie-review-service";
-      throw se;
-    }
-    auto movie_review_client = movie_review_client_wrapper->GetClient();
-    try {
-      movie_review_client->ReadMovieReviews(_return_movie_reviews,
-          req_id, movie_id, review_start, review_stop, writer_text_map);
-    } catch (...) {
-      _movie_review_client_pool->Push(movie_review_client_wrapper);
-      LOG(error) << "Failed to read reviews to movie-review-service";
-      throw;
-    }
-    _movie_review_client_pool->Push(movie_review_client_wrapper);
-    return _return_movie_reviews;
-  });
+  auto movie_info_client_wrapper = _movie_info_client_pool->Pop();
+  if (!movie_info_client_wrapper) {
+    ServiceException se;
+    se.errorCode = ErrorCode::SE_THRIFT_CONN_ERROR;
+    se.message = "Failed to connected to movie-info-service";
+    throw se;
+  }
+  try {
+    movie_info_future = SendRequest<MovieInfo>(
+        _movie_info_client_pool, movie_info_client_wrapper,
+        [&](MovieInfoServiceClient *movie_info_client) {
+          movie_info_client->send_ReadMovieInfo(
+              req_id, movie_id, writer_text_map);
+        },
+        [](MovieInfoServiceClient *movie_info_client) {
+          MovieInfo _reture_movie_info;
+          movie_info_client->recv_ReadMovieInfo(_reture_movie_info);
+          return _reture_movie_info;
+        });
+  } catch (...) {
+    LOG(error) << "Failed to read movie_info to movie-info-service";
+    throw;
+  }
+
+  auto movie_review_client_wrapper = _movie_review_client_pool->Pop();
+  if (!movie_review_client_wrapper) {
+    ServiceException se;
+    se.errorCode = ErrorCode::SE_THRIFT_CONN_ERROR;
+    se.message = "Failed to connected to movie-review-service";
+    throw se;
+  }
+  try {
+    movie_review_future = SendRequest<std::vector<Review>>(
+        _movie_review_client_pool, movie_review_client_wrapper,
+        [&](MovieReviewServiceClient *movie_review_client) {
+          movie_review_client->send_ReadMovieReviews(
+              req_id, movie_id, review_start, review_stop,
+              writer_text_map);
+        },
+        [](MovieReviewServiceClient *movie_review_client) {
+          std::vector<Review> _return_movie_reviews;
+          movie_review_client->recv_ReadMovieReviews(
+              _return_movie_reviews);
+          return _return_movie_reviews;
+        });
+  } catch (...) {
+    LOG(error) << "Failed to read reviews to movie-review-service";
+    throw;
+  }
 
   try {
     _return.movie_info = movie_info_future.get();
   } catch (...) {
+    LOG(error) << "Failed to read movie_info to movie-info-service";
     throw;
   }
-  
+
   std::vector<int64_t> cast_info_ids;
   for (auto &cast : _return.movie_info.casts) {
     cast_info_ids.emplace_back(cast.cast_info_id);
   }
 
-  cast_info_future = std::async(std::launch::async, [&](){
-    std::vector<CastInfo> _return_cast_infos;
-    auto cast_info_client_wrapper = _cast_info_client_pool->Pop();
-    if (!cast_info_client_wrapper) {
-      ServiceException se;
-      se.errorCode = ErrorCode::SE_THRIFT_CONN_ERROR;
-      se.message = "Failed to connected to cast-info-service";
-      throw se;
-    }
-    auto cast_info_client = cast_info_client_wrapper->GetClient();
-    try {
-      cast_info_client->ReadCastInfo(_return_cast_infos, req_id,
-          cast_info_ids, writer_text_map);
-    } catch (...) {
-      _cast_info_client_pool->Push(cast_info_client_wrapper);
-      LOG(error) << "Failed to read cast-info to cast-info-service";
-      throw;
-    }
-    _cast_info_client_pool->Push(cast_info_client_wrapper);
-    return _return_cast_infos;
-  });
-
-  plot_future = std::async(std::launch::async, [&](){
-    std::string _return_plot;
-    auto plot_client_wrapper = _plot_client_pool->Pop();
-    if (!plot_client_wrapper) {
-      ServiceException se;
-      se.errorCode = ErrorCode::SE_THRIFT_CONN_ERROR;
-      se.message = "Failed to connected to plot-service";
-      throw se;
-    }
-    auto plot_client = plot_client_wrapper->GetClient();
-    try {
-      plot_client->ReadPlot(_return_plot, req_id, _return.movie_info.plot_id,
-          writer_text_map);
-    } catch (...) {
-      _plot_client_pool->Push(plot_client_wrapper);
-      LOG(error) << "Failed to read plot to plot-service";
-      throw;
-    }
-    _plot_client_pool->Push(plot_client_wrapper);
-    return _return_plot;
-  });
+  auto cast_info_client_wrapper = _cast_info_client_pool->Pop();
+  if (!cast_info_client_wrapper) {
+    ServiceException se;
+    se.errorCode = ErrorCode::SE_THRIFT_CONN_ERROR;
+    se.message = "Failed to connected to cast-info-service";
+    throw se;
+  }
+  try {
+    cast_info_future = SendRequest<std::vector<CastInfo>>(
+        _cast_info_client_pool, cast_info_client_wrapper,
+        [&](CastInfoServiceClient *cast_info_client) {
+          cast_info_client->send_ReadCastInfo(
+              req_id, cast_info_ids, writer_text_map);
+        },
+        [](CastInfoServiceClient *cast_info_client) {
+          std::vector<CastInfo> _return_cast_infos;
+          cast_info_client->recv_ReadCastInfo(_return_cast_infos);
+          return _return_cast_infos;
+        });
+  } catch (...) {
+    LOG(error) << "Failed to read cast-info to cast-info-service";
+    throw;
+  }
+
+  auto plot_client_wrapper = _plot_client_pool->Pop();
+  if (!plot_client_wrapper) {
+    ServiceException se;
+    se.errorCode = ErrorCode::SE_THRIFT_CONN_ERROR;
+    se.message = "Failed to connected to plot-service";
+    throw se;
+  }
+  try {
+    plot_future = SendRequest<std::string>(
+        _plot_client_pool, plot_client_wrapper,
+        [&](PlotServiceClient *plot_client) {
+          plot_client->send_ReadPlot(
+              req_id, _return.movie_info.plot_id, writer_text_map);
+        },
+        [](PlotServiceClient *plot_client) {
+          std::string _return_plot;
+          plot_client->recv_ReadPlot(_return_plot);
+          return _return_plot;
+        });
+  } catch (...) {
+    LOG(error) << "Failed to read plot to plot-service";
+    throw;
+  }
 
   try {
     _return.reviews = movie_review_future.get();
@@ -39,17 +39,25 @@ int main(int argc, char *argv[]) {
   std::string plot_addr = config_json["plot-service"]["addr"];
   int plot_port = config_json["plot-service"]["port"];
 
+  // Interval at which each client pool logs its counters, 0 disables it.
+  int client_pool_stats_interval_ms =
+      config_json.value("client-pool", json::object())
+          .value("stats_interval_ms", 0);
   ClientPool<ThriftClient<MovieInfoServiceClient>>
       movie_info_client_pool("movie-info-client", movie_info_addr,
-                             movie_info_port, 0, 128, 1000);
+                             movie_info_port, 0, 128, 1000,
+                             client_pool_stats_interval_ms);
   ClientPool<ThriftClient<CastInfoServiceClient>>
       cast_info_client_pool("cast-info-client", cast_info_addr,
-                            cast_info_port, 0, 128, 1000);
+                            cast_info_port, 0, 128, 1000,
+                            client_pool_stats_interval_ms);
   ClientPool<ThriftClient<MovieReviewServiceClient>>
       movie_review_client_pool("movie-review-client", movie_review_addr,
-                               movie_review_port, 0, 128, 1000);
+                               movie_review_port, 0, 128, 1000,
+                               client_pool_stats_interval_ms);
   ClientPool<ThriftClient<PlotServiceClient>>
-      plot_client_pool("plot-client", plot_addr, plot_port, 0, 128, 1000);
+      plot_client_pool("plot-client", plot_addr, plot_port, 0, 128, 1000,
+                       client_pool_stats_interval_ms);
 
   TThreadedServer server(
       std::make_shared<PageServiceProcessor>(
@@ -54,14 +54,8 @@ void PlotHandler::ReadPlot(
     const std::map<std::string, std::string> & carrier) {
 
   // Initialize a span
-  TextMapReader reader(carrier);
   std::map<std::string, std::string> writer_text_map;
-  TextMapWriter writer(writer_text_map);
-  auto parent_span = opentracing::Tracer::Global()->Extract(reader);
-  auto span = opentracing::Tracer::Global()->StartSpan(
-      "ReadPlot",
-      { opentracing::ChildOf(parent_span->get()) });
-  opentracing::Tracer::Global()->Inject(span->context(), writer);
+  auto span = StartSpanFromCarrier("ReadPlot", carrier, &writer_text_map);
 
   memcached_return_t memcached_rc;
   memcached_st *memcached_client = memcached_pool_pop(
@@ -77,8 +71,7 @@ void PlotHandler::ReadPlot(
   uint32_t memcached_flags;
 
   // Look for the movie id from memcached
-  auto get_span = opentracing::Tracer::Global()->StartSpan(
-      "MmcGetPlot", { opentracing::ChildOf(&span->context()) });
+  auto get_span = StartChildSpan("MmcGetPlot", span->context());
   auto plot_id_str = std::to_string(plot_id);
 
   char* plot_mmc = memcached_get(
@@ -129,8 +122,7 @@ void PlotHandler::ReadPlot(
 
 
     // Upload the plot to memcached
-    auto set_span = opentracing::Tracer::Global()->StartSpan(
-        "MmcSetPlot", { opentracing::ChildOf(&span->context()) });
+    auto set_span = StartChildSpan("MmcSetPlot", span->context());
     memcached_rc = memcached_set(
         memcached_client,
         plot_id_str.c_str(),
@@ -157,14 +149,8 @@ void PlotHandler::WritePlot(
     const std::string &plot,
     const std::map<std::string, std::string> &carrier) {
   // Initialize a span
-  TextMapReader reader(carrier);
   std::map<std::string, std::string> writer_text_map;
-  TextMapWriter writer(writer_text_map);
-  auto parent_span = opentracing::Tracer::Global()->Extract(reader);
-  auto span = opentracing::Tracer::Global()->StartSpan(
-      "WritePlot",
-      { opentracing::ChildOf(parent_span->get()) });
-  opentracing::Tracer::Global()->Inject(span->context(), writer);
+  auto span = StartSpanFromCarrier("WritePlot", carrier, &writer_text_map);
 
   LOG(info) << "REQUEST to write plot (plot_id=" << plot_id << ", plot=" << plot.c_str() << ")";
 
@@ -43,14 +43,8 @@ void RatingHandler::UploadRating(
     const std::map<std::string, std::string> & carrier) {
 
   // Initialize a span
-  TextMapReader reader(carrier);
   std::map<std::string, std::string> writer_text_map;
-  TextMapWriter writer(writer_text_map);
-  auto parent_span = opentracing::Tracer::Global()->Extract(reader);
-  auto span = opentracing::Tracer::Global()->StartSpan(
-      "UploadRating",
-      { opentracing::ChildOf(parent_span->get()) });
-  opentracing::Tracer::Global()->Inject(span->context(), writer);
+  auto span = StartSpanFromCarrier("UploadRating", carrier, &writer_text_map);
 
   std::future<void> upload_future;
   std::future<void> redis_future;
@@ -83,8 +77,7 @@ void RatingHandler::UploadRating(
       throw se;
     }
     auto redis_client = redis_client_wrapper->GetClient();
-    auto redis_span = opentracing::Tracer::Global()->StartSpan(
-        "RedisInsert", {opentracing::ChildOf(&span->context())});
+    auto redis_span = StartChildSpan("RedisInsert", span->context());
     redis_client->incrby(movie_id + ":uncommit_sum", rating);
     redis_client->incr(movie_id + ":uncommit_num");
     redis_client->sync_commit();
@@ -50,14 +50,8 @@ void ReviewStorageHandler::StoreReview(
     const std::map<std::string, std::string> & carrier) {
 
   // Initialize a span
-  TextMapReader reader(carrier);
   std::map<std::string, std::string> writer_text_map;
-  TextMapWriter writer(writer_text_map);
-  auto parent_span = opentracing::Tracer::Global()->Extract(reader);
-  auto span = opentracing::Tracer::Global()->StartSpan(
-      "StoreReview",
-      { opentracing::ChildOf(parent_span->get()) });
-  opentracing::Tracer::Global()->Inject(span->context(), writer);
+  auto span = StartSpanFromCarrier("StoreReview", carrier, &writer_text_map);
 
   LOG(info) << "request to store review (movie_id=" << review.movie_id.c_str() << ", review_id=" << review.review_id << ")";
 
@@ -74,8 +68,7 @@ void ReviewStorageHandler::StoreReview(
   new_doc["req_id"]   = review.req_id;
   std::string url = _couchdb_url + doc_id;
 
-  auto insert_span = opentracing::Tracer::Global()->StartSpan(
-      "CouchDBPutReview", { opentracing::ChildOf(&span->context()) });
+  auto insert_span = StartChildSpan("CouchDBPutReview", span->context());
 
   try {
     couchdb_put(url, new_doc.dump());
@@ -101,14 +94,8 @@ void ReviewStorageHandler::ReadReviews(
     const std::map<std::string, std::string> &carrier) {
 
   // Initialize a span
-  TextMapReader reader(carrier);
   std::map<std::string, std::string> writer_text_map;
-  TextMapWriter writer(writer_text_map);
-  auto parent_span = opentracing::Tracer::Global()->Extract(reader);
-  auto span = opentracing::Tracer::Global()->StartSpan(
-      "ReadReviews",
-      { opentracing::ChildOf(parent_span->get()) });
-  opentracing::Tracer::Global()->Inject(span->context(), writer);
+  auto span = StartSpanFromCarrier("ReadReviews", carrier, &writer_text_map);
 
   LOG(info) << "REQUEST to read reviews (number of review IDs=" << review_ids.size() << ")";
 
@@ -164,8 +151,7 @@ void ReviewStorageHandler::ReadReviews(
   char *return_value;
   size_t return_value_length;
   uint32_t flags;
-  auto get_span = opentracing::Tracer::Global()->StartSpan(
-      "MemcachedMget", { opentracing::ChildOf(&span->context()) });
+  auto get_span = StartChildSpan("MemcachedMget", span->context());
 
   while (true) {
     return_value =
@@ -222,8 +208,7 @@ void ReviewStorageHandler::ReadReviews(
 
     const std::string url = _couchdb_url + "_all_docs?include_docs=true";
 
-    auto find_span = opentracing::Tracer::Global()->StartSpan(
-        "CouchBulkGetReviews", { opentracing::ChildOf(&span->context()) });
+    auto find_span = StartChildSpan("CouchBulkGetReviews", span->context());
 
     std::string resp;
     try {
@@ -276,8 +261,7 @@ void ReviewStorageHandler::ReadReviews(
         LOG(error) << "failed to pop a client from memcached pool";
         ServiceException se; se.errorCode = ErrorCode::SE_MEMCACHED_ERROR; se.message = "failed to pop a client from memcached pool"; throw se;
       }
-      auto set_span = opentracing::Tracer::Global()->StartSpan(
-          "MmcSetReview", { opentracing::ChildOf(&span->context()) });
+      auto set_span = StartChildSpan("MmcSetReview", span->context());
 
       for (auto &it : review_json_map) {
         std::string id_str = std::to_string(it.first);
@@ -4,7 +4,6 @@
 #include <string>
 #include <thread>
 #include <iostream>
-#include <boost/log/trivial.hpp>
 
 #include <thrift/protocol/TBinaryProtocol.h>
 #include <thrift/transport/TSocket.h>
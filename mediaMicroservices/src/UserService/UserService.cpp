@@ -54,8 +54,13 @@ int main(int argc, char *argv[]) {
 
   std::mutex thread_lock;
 
+  // Interval at which each client pool logs its counters, 0 disables it.
+  int client_pool_stats_interval_ms =
+      config_json.value("client-pool", json::object())
+          .value("stats_interval_ms", 0);
   ClientPool<ThriftClient<ComposeReviewServiceClient>> compose_client_pool(
-      "compose-review-client", compose_addr, compose_port, 0, 128, 1000);
+      "compose-review-client", compose_addr, compose_port, 0, 128, 1000,
+      client_pool_stats_interval_ms);
 
   TThreadedServer server(
       std::make_shared<UserServiceProcessor>(
@@ -1,29 +1,278 @@
 #ifndef MEDIA_MICROSERVICES_LOGGER_H
 #define MEDIA_MICROSERVICES_LOGGER_H
 
-#include <boost/log/trivial.hpp>
-#include <boost/log/utility/setup/console.hpp>
-#include <boost/log/utility/setup/common_attributes.hpp>
-
-#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <memory>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <thread>
 
 namespace media_service {
-#define __FILENAME__ \
-    (strrchr(__FILE__, '/') ? strrchr(__FILE__, '/') + 1 : __FILE__)
-#define LOG(severity) \
-    BOOST_LOG_TRIVIAL(severity) << "(" << __FILENAME__ << ":" \
-    << __LINE__ << ":" << __FUNCTION__ << ") "
+
+enum class LogLevel { trace, debug, info, warning, error, fatal };
+
+// LOG(severity) << ... checks the level before anything is formatted, so a
+// filtered-out record costs one relaxed load. Records are formatted into a
+// buffer on the stack and handed to AsyncLogger, which never blocks the
+// caller.
+#define LOG(severity)                                                       \
+  !media_service::AsyncLogger::Enabled(                                     \
+      media_service::LogLevel::severity)                                    \
+      ? (void)0                                                             \
+      : media_service::LogVoidify() &                                       \
+            media_service::LogRecord(media_service::LogLevel::severity,     \
+                                     __FILE__, __LINE__, __FUNCTION__)      \
+                .stream()
+
+#define LOG_MESSAGE_SIZE 472
+#define LOG_RING_SIZE 4096
+
+// A record as it is queued: the file and function are string literals, and
+// the timestamp is only formatted by the drain thread.
+struct LogEntry {
+  std::chrono::system_clock::time_point timestamp;
+  const char *file;
+  const char *function;
+  int line;
+  LogLevel level;
+  uint16_t length;
+  char message[LOG_MESSAGE_SIZE];
+};
+
+// Bounded multi-producer queue of log entries (Vyukov's ring with per-slot
+// sequence numbers) drained to stderr by a background thread. When the ring
+// is full, records are dropped and counted rather than waited for. Until
+// Start() is called, records are written synchronously.
+class AsyncLogger {
+ public:
+  static bool Enabled(LogLevel level) {
+    return static_cast<int>(level) >= _level.load(std::memory_order_relaxed);
+  }
+  static void SetLevel(LogLevel level) {
+    _level.store(static_cast<int>(level), std::memory_order_relaxed);
+  }
+  static AsyncLogger &Get() {
+    static AsyncLogger *logger = new AsyncLogger();
+    return *logger;
+  }
+
+  void Start();
+  void Push(const LogEntry &entry);
+  // Waits until the entries pushed so far are written, for at most
+  // timeout_ms.
+  void Flush(int timeout_ms);
+
+ private:
+  struct Slot {
+    std::atomic<uint64_t> sequence;
+    LogEntry entry;
+  };
+
+  static std::atomic<int> _level;
+  std::unique_ptr<Slot[]> _slots;
+  // The producers' and the drain thread's positions sit on separate cache
+  // lines.
+  std::atomic<uint64_t> _enqueue_pos;
+  char _padding[64];
+  std::atomic<uint64_t> _dequeue_pos;
+  std::atomic<uint64_t> _dropped;
+  std::atomic<bool> _started;
+
+  AsyncLogger();
+  bool _Drain(char *buffer, size_t buffer_size);
+  static size_t _Format(const LogEntry &entry, char *out, size_t size);
+};
+
+std::atomic<int> AsyncLogger::_level(static_cast<int>(LogLevel::debug));
+
+AsyncLogger::AsyncLogger()
+    : _slots(new Slot[LOG_RING_SIZE]), _enqueue_pos(0), _dequeue_pos(0),
+      _dropped(0), _started(false) {
+  for (uint64_t i = 0; i < LOG_RING_SIZE; ++i) {
+    _slots[i].sequence.store(i, std::memory_order_relaxed);
+  }
+}
+
+void AsyncLogger::Push(const LogEntry &entry) {
+  if (!_started.load(std::memory_order_acquire)) {
+    char line[LOG_MESSAGE_SIZE + 256];
+    size_t length = _Format(entry, line, sizeof(line));
+    fwrite(line, 1, length, stderr);
+    return;
+  }
+  uint64_t pos = _enqueue_pos.load(std::memory_order_relaxed);
+  Slot *slot;
+  while (true) {
+    slot = &_slots[pos & (LOG_RING_SIZE - 1)];
+    uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+    int64_t diff = static_cast<int64_t>(sequence - pos);
+    if (diff == 0) {
+      if (_enqueue_pos.compare_exchange_weak(pos, pos + 1,
+                                             std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (diff < 0) {
+      _dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    } else {
+      pos = _enqueue_pos.load(std::memory_order_relaxed);
+    }
+  }
+  LogEntry &queued = slot->entry;
+  queued.timestamp = entry.timestamp;
+  queued.file = entry.file;
+  queued.function = entry.function;
+  queued.line = entry.line;
+  queued.level = entry.level;
+  queued.length = entry.length;
+  memcpy(queued.message, entry.message, entry.length);
+  slot->sequence.store(pos + 1, std::memory_order_release);
+}
+
+// Writes the entries that are ready; returns false if there were none.
+bool AsyncLogger::_Drain(char *buffer, size_t buffer_size) {
+  size_t used = 0;
+  bool drained = false;
+  uint64_t pos = _dequeue_pos.load(std::memory_order_relaxed);
+  while (true) {
+    Slot *slot = &_slots[pos & (LOG_RING_SIZE - 1)];
+    if (slot->sequence.load(std::memory_order_acquire) != pos + 1) {
+      break;
+    }
+    if (buffer_size - used < LOG_MESSAGE_SIZE + 256) {
+      fwrite(buffer, 1, used, stderr);
+      used = 0;
+    }
+    used += _Format(slot->entry, buffer + used, buffer_size - used);
+    slot->sequence.store(pos + LOG_RING_SIZE, std::memory_order_release);
+    _dequeue_pos.store(++pos, std::memory_order_release);
+    drained = true;
+  }
+  if (used) {
+    fwrite(buffer, 1, used, stderr);
+  }
+  uint64_t dropped = _dropped.exchange(0, std::memory_order_relaxed);
+  if (dropped) {
+    fprintf(stderr, "<warning>: dropped %lu log records\n",
+            static_cast<unsigned long>(dropped));
+  }
+  if (used || dropped) {
+    fflush(stderr);
+  }
+  return drained;
+}
+
+void AsyncLogger::Start() {
+  if (_started.exchange(true)) {
+    return;
+  }
+  std::thread([this]() {
+    std::unique_ptr<char[]> buffer(new char[1 << 16]);
+    while (true) {
+      if (!_Drain(buffer.get(), 1 << 16)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    }
+  }).detach();
+  std::atexit([]() { AsyncLogger::Get().Flush(1000); });
+}
+
+void AsyncLogger::Flush(int timeout_ms) {
+  if (!_started.load(std::memory_order_acquire)) {
+    return;
+  }
+  uint64_t target = _enqueue_pos.load(std::memory_order_acquire);
+  auto deadline = std::chrono::steady_clock::now() +
+      std::chrono::milliseconds(timeout_ms);
+  while (_dequeue_pos.load(std::memory_order_acquire) < target &&
+         std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
+// Formats entry as the line the boost console sink used to write:
+// [2021-01-01 00:00:00.000000] <info>: (file.cpp:42:Function) message
+size_t AsyncLogger::_Format(const LogEntry &entry, char *out, size_t size) {
+  static const char *level_names[] = {"trace",   "debug", "info",
+                                      "warning", "error", "fatal"};
+  auto since_epoch = entry.timestamp.time_since_epoch();
+  time_t seconds =
+      std::chrono::duration_cast<std::chrono::seconds>(since_epoch).count();
+  long micros = std::chrono::duration_cast<std::chrono::microseconds>(
+      since_epoch).count() % 1000000;
+  struct tm local_time;
+  localtime_r(&seconds, &local_time);
+  size_t used = strftime(out, size, "[%Y-%m-%d %H:%M:%S", &local_time);
+  const char *file = strrchr(entry.file, '/');
+  file = file ? file + 1 : entry.file;
+  used += snprintf(out + used, size - used, ".%06ld] <%s>: (%s:%d:%s) ",
+                   micros, level_names[static_cast<int>(entry.level)], file,
+                   entry.line, entry.function);
+  used = std::min(used, size - 1);
+  if (used + entry.length + 1 < size) {
+    memcpy(out + used, entry.message, entry.length);
+    used += entry.length;
+    out[used++] = '\n';
+  }
+  return used;
+}
+
+// Stream buffer over the message of a LogEntry; output past its end is
+// silently truncated.
+class LogStreamBuf : public std::streambuf {
+ public:
+  LogStreamBuf(char *buffer, size_t size) { setp(buffer, buffer + size); }
+  size_t Length() const { return pptr() - pbase(); }
+
+ protected:
+  int_type overflow(int_type ch) override { return ch; }
+};
+
+class LogRecord {
+ public:
+  LogRecord(LogLevel level, const char *file, int line, const char *function)
+      : _buf(_entry.message, LOG_MESSAGE_SIZE), _stream(&_buf) {
+    _entry.timestamp = std::chrono::system_clock::now();
+    _entry.file = file;
+    _entry.function = function;
+    _entry.line = line;
+    _entry.level = level;
+  }
+  ~LogRecord() {
+    _entry.length = static_cast<uint16_t>(_buf.Length());
+    AsyncLogger &logger = AsyncLogger::Get();
+    logger.Push(_entry);
+    if (_entry.level == LogLevel::fatal) {
+      // Fatal records are usually followed by exit().
+      logger.Flush(1000);
+    }
+  }
+  std::ostream &stream() { return _stream; }
+
+ private:
+  LogEntry _entry;
+  LogStreamBuf _buf;
+  std::ostream _stream;
+};
+
+// Gives the stream expression of LOG the type void, to match the other
+// branch of its conditional.
+struct LogVoidify {
+  void operator&(std::ostream &) {}
+};
 
 void init_logger() {
-  boost::log::register_simple_formatter_factory
-      <boost::log::trivial::severity_level, char>("Severity");
-  boost::log::add_common_attributes();
-  boost::log::add_console_log(
-      std::cerr, boost::log::keywords::format =
-          "[%TimeStamp%] <%Severity%>: %Message%");
-  boost::log::core::get()->set_filter (
-      boost::log::trivial::severity >= boost::log::trivial::debug
-  );
+  AsyncLogger::SetLevel(LogLevel::debug);
+  AsyncLogger::Get().Start();
 }
 
 
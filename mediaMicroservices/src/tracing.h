@@ -7,7 +7,10 @@
 #include <yaml-cpp/yaml.h>
 #include <jaegertracing/Tracer.h>
 
+#include <opentracing/noop.h>
 #include <opentracing/propagation.h>
+#include <cstdlib>
+#include <memory>
 #include <string>
 #include <map>
 
@@ -49,15 +52,181 @@ class TextMapWriter : public opentracing::TextMapWriter {
   std::map<std::string, std::string>& _text_map;
 };
 
+// Header holding the jaeger span context in a carrier:
+// {trace-id}:{span-id}:{parent-span-id}:{flags}, sampled when flags & 1.
+#define TRACE_CONTEXT_HEADER "uber-trace-id"
+
+// Context of a span that is not recorded. It only keeps the trace header it
+// came with, so that the calls made under it carry the unsampled decision
+// downstream instead of letting the next service sample a new trace.
+class UnsampledSpanContext : public opentracing::SpanContext {
+ public:
+  explicit UnsampledSpanContext(std::string trace_header)
+      : _trace_header(std::move(trace_header)) {}
+
+  void ForeachBaggageItem(
+      std::function<bool(const std::string &, const std::string &)>)
+  const override {}
+  std::unique_ptr<opentracing::SpanContext> Clone() const noexcept override {
+    return std::unique_ptr<opentracing::SpanContext>(
+        new UnsampledSpanContext(_trace_header));
+  }
+
+  const std::string &TraceHeader() const { return _trace_header; }
+
+ private:
+  std::string _trace_header;
+};
+
+// Span handed out instead of a tracer span when nothing would be recorded:
+// it reads no clock, keeps no tags and is never reported.
+class UnsampledSpan : public opentracing::Span {
+ public:
+  explicit UnsampledSpan(std::string trace_header)
+      : _context(std::move(trace_header)) {}
+
+  void FinishWithOptions(
+      const opentracing::FinishSpanOptions &) noexcept override {}
+  void SetOperationName(string_view) noexcept override {}
+  void SetTag(string_view, const opentracing::Value &) noexcept override {}
+  void SetBaggageItem(string_view, string_view) noexcept override {}
+  std::string BaggageItem(string_view) const noexcept override { return {}; }
+  void Log(std::initializer_list<std::pair<string_view, opentracing::Value>>)
+      noexcept override {}
+  const opentracing::SpanContext &context() const noexcept override {
+    return _context;
+  }
+  const opentracing::Tracer &tracer() const noexcept override {
+    static auto noop_tracer = opentracing::MakeNoopTracer();
+    return *noop_tracer;
+  }
+
+ private:
+  UnsampledSpanContext _context;
+};
+
+// Deletes the spans handed out by the facade. With DISABLE_TRACING every span
+// is the static one from DisabledSpan(), which is never deleted.
+struct SpanDeleter {
+  void operator()(opentracing::Span *span) const {
+#ifndef DISABLE_TRACING
+    delete span;
+#endif
+  }
+};
+
+using SpanPtr = std::unique_ptr<opentracing::Span, SpanDeleter>;
+
+#ifdef DISABLE_TRACING
+// The span returned for every span when tracing is compiled out. It keeps
+// no state, so all threads can share it.
+opentracing::Span *DisabledSpan() {
+  static UnsampledSpan span{std::string()};
+  return &span;
+}
+#endif
+
+// Returns true if the carrier holds a jaeger span context whose sampled flag
+// is clear. A missing or unparsable header returns false and leaves the
+// decision to the tracer.
+bool IsUnsampledCarrier(const std::map<std::string, std::string> &carrier) {
+  auto it = carrier.find(TRACE_CONTEXT_HEADER);
+  if (it == carrier.end()) {
+    return false;
+  }
+  const std::string &header = it->second;
+  size_t pos = header.rfind(':');
+  size_t encoded_pos = header.rfind("%3A");
+  if (encoded_pos != std::string::npos &&
+      (pos == std::string::npos || encoded_pos > pos)) {
+    pos = encoded_pos + 2;
+  }
+  if (pos == std::string::npos || pos + 1 >= header.size()) {
+    return false;
+  }
+  char *end;
+  unsigned long flags = std::strtoul(header.c_str() + pos + 1, &end, 16);
+  return *end == '\0' && !(flags & 1);
+}
+
+// Starts a span child of the span context in carrier, such as the span of
+// an RPC handler, and fills writer_text_map, unless it is null, with the
+// carrier of the calls made under it. When the caller's trace is not sampled
+// no span is created or serialised: the returned span records nothing and
+// the carrier is passed through. Building with DISABLE_TRACING returns the
+// shared DisabledSpan() and leaves writer_text_map alone.
+SpanPtr StartSpanFromCarrier(
+    string_view operation_name,
+    const std::map<std::string, std::string> &carrier,
+    std::map<std::string, std::string> *writer_text_map) {
+#ifdef DISABLE_TRACING
+  return SpanPtr(DisabledSpan());
+#else
+  if (IsUnsampledCarrier(carrier)) {
+    if (writer_text_map) {
+      *writer_text_map = carrier;
+    }
+    return SpanPtr(
+        new UnsampledSpan(carrier.find(TRACE_CONTEXT_HEADER)->second));
+  }
+  auto tracer = opentracing::Tracer::Global();
+  TextMapReader reader(carrier);
+  auto parent_span = tracer->Extract(reader);
+  auto span = tracer->StartSpan(
+      operation_name, {opentracing::ChildOf(parent_span->get())});
+  if (writer_text_map) {
+    TextMapWriter writer(*writer_text_map);
+    tracer->Inject(span->context(), writer);
+  }
+  return SpanPtr(span.release());
+#endif
+}
+
+// Starts a span child of parent; children of unsampled spans are unsampled.
+SpanPtr StartChildSpan(
+    string_view operation_name, const opentracing::SpanContext &parent) {
+#ifdef DISABLE_TRACING
+  return SpanPtr(DisabledSpan());
+#else
+  auto unsampled = dynamic_cast<const UnsampledSpanContext *>(&parent);
+  if (unsampled) {
+    return SpanPtr(new UnsampledSpan(unsampled->TraceHeader()));
+  }
+  return SpanPtr(opentracing::Tracer::Global()
+                     ->StartSpan(operation_name,
+                                 {opentracing::ChildOf(&parent)})
+                     .release());
+#endif
+}
+
+// Writes into writer_text_map the carrier of a call made under span.
+void InjectSpan(const opentracing::Span &span,
+                std::map<std::string, std::string> *writer_text_map) {
+#ifndef DISABLE_TRACING
+  auto unsampled =
+      dynamic_cast<const UnsampledSpanContext *>(&span.context());
+  if (unsampled) {
+    if (!unsampled->TraceHeader().empty()) {
+      (*writer_text_map)[TRACE_CONTEXT_HEADER] = unsampled->TraceHeader();
+    }
+    return;
+  }
+  TextMapWriter writer(*writer_text_map);
+  opentracing::Tracer::Global()->Inject(span.context(), writer);
+#endif
+}
+
 void SetUpTracer(
     const std::string &config_file_path,
     const std::string &service) {
+#ifndef DISABLE_TRACING
   auto configYAML = YAML::LoadFile(config_file_path);
   auto config = jaegertracing::Config::parse(configYAML);
   auto tracer = jaegertracing::Tracer::make(
       service, config, jaegertracing::logging::consoleLogger());
   opentracing::Tracer::InitGlobal(
       std::static_pointer_cast<opentracing::Tracer>(tracer));
+#endif
 }
 
 
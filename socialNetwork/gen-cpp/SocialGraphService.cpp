@@ -1940,6 +1940,748 @@ uint32_t SocialGraphService_InsertUser_presult::read(::apache::thrift::protocol:
   return xfer;
 }
 
+SocialGraphService_GetFollowersBatch_args::~SocialGraphService_GetFollowersBatch_args() throw() {
+}
+
+
+uint32_t SocialGraphService_GetFollowersBatch_args::read(::apache::thrift::protocol::TProtocol* iprot) {
+
+  ::apache::thrift::protocol::TInputRecursionTracker tracker(*iprot);
+  uint32_t xfer = 0;
+  std::string fname;
+  ::apache::thrift::protocol::TType ftype;
+  int16_t fid;
+
+  xfer += iprot->readStructBegin(fname);
+
+  using ::apache::thrift::protocol::TProtocolException;
+
+
+  while (true)
+  {
+    xfer += iprot->readFieldBegin(fname, ftype, fid);
+    if (ftype == ::apache::thrift::protocol::T_STOP) {
+      break;
+    }
+    switch (fid)
+    {
+      case 1:
+        if (ftype == ::apache::thrift::protocol::T_I64) {
+          xfer += iprot->readI64(this->req_id);
+          this->__isset.req_id = true;
+        } else {
+          xfer += iprot->skip(ftype);
+        }
+        break;
+      case 2:
+        if (ftype == ::apache::thrift::protocol::T_LIST) {
+          {
+            this->user_ids.clear();
+            uint32_t _size456;
+            ::apache::thrift::protocol::TType _etype457;
+            xfer += iprot->readListBegin(_etype457, _size456);
+            this->user_ids.resize(_size456);
+            uint32_t _i458;
+            for (_i458 = 0; _i458 < _size456; ++_i458)
+            {
+              xfer += iprot->readI64(this->user_ids[_i458]);
+            }
+            xfer += iprot->readListEnd();
+          }
+          this->__isset.user_ids = true;
+        } else {
+          xfer += iprot->skip(ftype);
+        }
+        break;
+      case 3:
+        if (ftype == ::apache::thrift::protocol::T_MAP) {
+          {
+            this->carrier.clear();
+            uint32_t _size459;
+            ::apache::thrift::protocol::TType _ktype460;
+            ::apache::thrift::protocol::TType _vtype461;
+            xfer += iprot->readMapBegin(_ktype460, _vtype461, _size459);
+            uint32_t _i462;
+            for (_i462 = 0; _i462 < _size459; ++_i462)
+            {
+              std::string _key463;
+              xfer += iprot->readString(_key463);
+              std::string& _val464 = this->carrier[_key463];
+              xfer += iprot->readString(_val464);
+            }
+            xfer += iprot->readMapEnd();
+          }
+          this->__isset.carrier = true;
+        } else {
+          xfer += iprot->skip(ftype);
+        }
+        break;
+      default:
+        xfer += iprot->skip(ftype);
+        break;
+    }
+    xfer += iprot->readFieldEnd();
+  }
+
+  xfer += iprot->readStructEnd();
+
+  return xfer;
+}
+
+uint32_t SocialGraphService_GetFollowersBatch_args::write(::apache::thrift::protocol::TProtocol* oprot) const {
+  uint32_t xfer = 0;
+  ::apache::thrift::protocol::TOutputRecursionTracker tracker(*oprot);
+  xfer += oprot->writeStructBegin("SocialGraphService_GetFollowersBatch_args");
+
+  xfer += oprot->writeFieldBegin("req_id", ::apache::thrift::protocol::T_I64, 1);
+  xfer += oprot->writeI64(this->req_id);
+  xfer += oprot->writeFieldEnd();
+
+  xfer += oprot->writeFieldBegin("user_ids", ::apache::thrift::protocol::T_LIST, 2);
+  {
+    xfer += oprot->writeListBegin(::apache::thrift::protocol::T_I64, static_cast<uint32_t>(this->user_ids.size()));
+    std::vector<int64_t> ::const_iterator _iter465;
+    for (_iter465 = this->user_ids.begin(); _iter465 != this->user_ids.end(); ++_iter465)
+    {
+      xfer += oprot->writeI64((*_iter465));
+    }
+    xfer += oprot->writeListEnd();
+  }
+  xfer += oprot->writeFieldEnd();
+
+  xfer += oprot->writeFieldBegin("carrier", ::apache::thrift::protocol::T_MAP, 3);
+  {
+    xfer += oprot->writeMapBegin(::apache::thrift::protocol::T_STRING, ::apache::thrift::protocol::T_STRING, static_cast<uint32_t>(this->carrier.size()));
+    std::map<std::string, std::string> ::const_iterator _iter466;
+    for (_iter466 = this->carrier.begin(); _iter466 != this->carrier.end(); ++_iter466)
+    {
+      xfer += oprot->writeString(_iter466->first);
+      xfer += oprot->writeString(_iter466->second);
+    }
+    xfer += oprot->writeMapEnd();
+  }
+  xfer += oprot->writeFieldEnd();
+
+  xfer += oprot->writeFieldStop();
+  xfer += oprot->writeStructEnd();
+  return xfer;
+}
+
+
+SocialGraphService_GetFollowersBatch_pargs::~SocialGraphService_GetFollowersBatch_pargs() throw() {
+}
+
+
+uint32_t SocialGraphService_GetFollowersBatch_pargs::write(::apache::thrift::protocol::TProtocol* oprot) const {
+  uint32_t xfer = 0;
+  ::apache::thrift::protocol::TOutputRecursionTracker tracker(*oprot);
+  xfer += oprot->writeStructBegin("SocialGraphService_GetFollowersBatch_pargs");
+
+  xfer += oprot->writeFieldBegin("req_id", ::apache::thrift::protocol::T_I64, 1);
+  xfer += oprot->writeI64((*(this->req_id)));
+  xfer += oprot->writeFieldEnd();
+
+  xfer += oprot->writeFieldBegin("user_ids", ::apache::thrift::protocol::T_LIST, 2);
+  {
+    xfer += oprot->writeListBegin(::apache::thrift::protocol::T_I64, static_cast<uint32_t>((*(this->user_ids)).size()));
+    std::vector<int64_t> ::const_iterator _iter467;
+    for (_iter467 = (*(this->user_ids)).begin(); _iter467 != (*(this->user_ids)).end(); ++_iter467)
+    {
+      xfer += oprot->writeI64((*_iter467));
+    }
+    xfer += oprot->writeListEnd();
+  }
+  xfer += oprot->writeFieldEnd();
+
+  xfer += oprot->writeFieldBegin("carrier", ::apache::thrift::protocol::T_MAP, 3);
+  {
+    xfer += oprot->writeMapBegin(::apache::thrift::protocol::T_STRING, ::apache::thrift::protocol::T_STRING, static_cast<uint32_t>((*(this->carrier)).size()));
+    std::map<std::string, std::string> ::const_iterator _iter468;
+    for (_iter468 = (*(this->carrier)).begin(); _iter468 != (*(this->carrier)).end(); ++_iter468)
+    {
+      xfer += oprot->writeString(_iter468->first);
+      xfer += oprot->writeString(_iter468->second);
+    }
+    xfer += oprot->writeMapEnd();
+  }
+  xfer += oprot->writeFieldEnd();
+
+  xfer += oprot->writeFieldStop();
+  xfer += oprot->writeStructEnd();
+  return xfer;
+}
+
+
+SocialGraphService_GetFollowersBatch_result::~SocialGraphService_GetFollowersBatch_result() throw() {
+}
+
+
+uint32_t SocialGraphService_GetFollowersBatch_result::read(::apache::thrift::protocol::TProtocol* iprot) {
+
+  ::apache::thrift::protocol::TInputRecursionTracker tracker(*iprot);
+  uint32_t xfer = 0;
+  std::string fname;
+  ::apache::thrift::protocol::TType ftype;
+  int16_t fid;
+
+  xfer += iprot->readStructBegin(fname);
+
+  using ::apache::thrift::protocol::TProtocolException;
+
+
+  while (true)
+  {
+    xfer += iprot->readFieldBegin(fname, ftype, fid);
+    if (ftype == ::apache::thrift::protocol::T_STOP) {
+      break;
+    }
+    switch (fid)
+    {
+      case 0:
+        if (ftype == ::apache::thrift::protocol::T_MAP) {
+          {
+            this->success.clear();
+            uint32_t _size469;
+            ::apache::thrift::protocol::TType _ktype470;
+            ::apache::thrift::protocol::TType _vtype471;
+            xfer += iprot->readMapBegin(_ktype470, _vtype471, _size469);
+            uint32_t _i472;
+            for (_i472 = 0; _i472 < _size469; ++_i472)
+            {
+              int64_t _key473;
+              xfer += iprot->readI64(_key473);
+              std::vector<int64_t> & _val474 = this->success[_key473];
+              {
+                _val474.clear();
+                uint32_t _size475;
+                ::apache::thrift::protocol::TType _etype476;
+                xfer += iprot->readListBegin(_etype476, _size475);
+                _val474.resize(_size475);
+                uint32_t _i477;
+                for (_i477 = 0; _i477 < _size475; ++_i477)
+                {
+                  xfer += iprot->readI64(_val474[_i477]);
+                }
+                xfer += iprot->readListEnd();
+              }
+            }
+            xfer += iprot->readMapEnd();
+          }
+          this->__isset.success = true;
+        } else {
+          xfer += iprot->skip(ftype);
+        }
+        break;
+      case 1:
+        if (ftype == ::apache::thrift::protocol::T_STRUCT) {
+          xfer += this->se.read(iprot);
+          this->__isset.se = true;
+        } else {
+          xfer += iprot->skip(ftype);
+        }
+        break;
+      default:
+        xfer += iprot->skip(ftype);
+        break;
+    }
+    xfer += iprot->readFieldEnd();
+  }
+
+  xfer += iprot->readStructEnd();
+
+  return xfer;
+}
+
+uint32_t SocialGraphService_GetFollowersBatch_result::write(::apache::thrift::protocol::TProtocol* oprot) const {
+
+  uint32_t xfer = 0;
+
+  xfer += oprot->writeStructBegin("SocialGraphService_GetFollowersBatch_result");
+
+  if (this->__isset.success) {
+    xfer += oprot->writeFieldBegin("success", ::apache::thrift::protocol::T_MAP, 0);
+    {
+      xfer += oprot->writeMapBegin(::apache::thrift::protocol::T_I64, ::apache::thrift::protocol::T_LIST, static_cast<uint32_t>(this->success.size()));
+      std::map<int64_t, std::vector<int64_t> > ::const_iterator _iter478;
+      for (_iter478 = this->success.begin(); _iter478 != this->success.end(); ++_iter478)
+      {
+        xfer += oprot->writeI64(_iter478->first);
+        {
+          xfer += oprot->writeListBegin(::apache::thrift::protocol::T_I64, static_cast<uint32_t>(_iter478->second.size()));
+          std::vector<int64_t> ::const_iterator _iter479;
+          for (_iter479 = _iter478->second.begin(); _iter479 != _iter478->second.end(); ++_iter479)
+          {
+            xfer += oprot->writeI64((*_iter479));
+          }
+          xfer += oprot->writeListEnd();
+        }
+      }
+      xfer += oprot->writeMapEnd();
+    }
+    xfer += oprot->writeFieldEnd();
+  } else if (this->__isset.se) {
+    xfer += oprot->writeFieldBegin("se", ::apache::thrift::protocol::T_STRUCT, 1);
+    xfer += this->se.write(oprot);
+    xfer += oprot->writeFieldEnd();
+  }
+  xfer += oprot->writeFieldStop();
+  xfer += oprot->writeStructEnd();
+  return xfer;
+}
+
+
+SocialGraphService_GetFollowersBatch_presult::~SocialGraphService_GetFollowersBatch_presult() throw() {
+}
+
+
+uint32_t SocialGraphService_GetFollowersBatch_presult::read(::apache::thrift::protocol::TProtocol* iprot) {
+
+  ::apache::thrift::protocol::TInputRecursionTracker tracker(*iprot);
+  uint32_t xfer = 0;
+  std::string fname;
+  ::apache::thrift::protocol::TType ftype;
+  int16_t fid;
+
+  xfer += iprot->readStructBegin(fname);
+
+  using ::apache::thrift::protocol::TProtocolException;
+
+
+  while (true)
+  {
+    xfer += iprot->readFieldBegin(fname, ftype, fid);
+    if (ftype == ::apache::thrift::protocol::T_STOP) {
+      break;
+    }
+    switch (fid)
+    {
+      case 0:
+        if (ftype == ::apache::thrift::protocol::T_MAP) {
+          {
+            (*(this->success)).clear();
+            uint32_t _size480;
+            ::apache::thrift::protocol::TType _ktype481;
+            ::apache::thrift::protocol::TType _vtype482;
+            xfer += iprot->readMapBegin(_ktype481, _vtype482, _size480);
+            uint32_t _i483;
+            for (_i483 = 0; _i483 < _size480; ++_i483)
+            {
+              int64_t _key484;
+              xfer += iprot->readI64(_key484);
+              std::vector<int64_t> & _val485 = (*(this->success))[_key484];
+              {
+                _val485.clear();
+                uint32_t _size486;
+                ::apache::thrift::protocol::TType _etype487;
+                xfer += iprot->readListBegin(_etype487, _size486);
+                _val485.resize(_size486);
+                uint32_t _i488;
+                for (_i488 = 0; _i488 < _size486; ++_i488)
+                {
+                  xfer += iprot->readI64(_val485[_i488]);
+                }
+                xfer += iprot->readListEnd();
+              }
+            }
+            xfer += iprot->readMapEnd();
+          }
+          this->__isset.success = true;
+        } else {
+          xfer += iprot->skip(ftype);
+        }
+        break;
+      case 1:
+        if (ftype == ::apache::thrift::protocol::T_STRUCT) {
+          xfer += this->se.read(iprot);
+          this->__isset.se = true;
+        } else {
+          xfer += iprot->skip(ftype);
+        }
+        break;
+      default:
+        xfer += iprot->skip(ftype);
+        break;
+    }
+    xfer += iprot->readFieldEnd();
+  }
+
+  xfer += iprot->readStructEnd();
+
+  return xfer;
+}
+
+
+SocialGraphService_GetFolloweesBatch_args::~SocialGraphService_GetFolloweesBatch_args() throw() {
+}
+
+
+uint32_t SocialGraphService_GetFolloweesBatch_args::read(::apache::thrift::protocol::TProtocol* iprot) {
+
+  ::apache::thrift::protocol::TInputRecursionTracker tracker(*iprot);
+  uint32_t xfer = 0;
+  std::string fname;
+  ::apache::thrift::protocol::TType ftype;
+  int16_t fid;
+
+  xfer += iprot->readStructBegin(fname);
+
+  using ::apache::thrift::protocol::TProtocolException;
+
+
+  while (true)
+  {
+    xfer += iprot->readFieldBegin(fname, ftype, fid);
+    if (ftype == ::apache::thrift::protocol::T_STOP) {
+      break;
+    }
+    switch (fid)
+    {
+      case 1:
+        if (ftype == ::apache::thrift::protocol::T_I64) {
+          xfer += iprot->readI64(this->req_id);
+          this->__isset.req_id = true;
+        } else {
+          xfer += iprot->skip(ftype);
+        }
+        break;
+      case 2:
+        if (ftype == ::apache::thrift::protocol::T_LIST) {
+          {
+            this->user_ids.clear();
+            uint32_t _size489;
+            ::apache::thrift::protocol::TType _etype490;
+            xfer += iprot->readListBegin(_etype490, _size489);
+            this->user_ids.resize(_size489);
+            uint32_t _i491;
+            for (_i491 = 0; _i491 < _size489; ++_i491)
+            {
+              xfer += iprot->readI64(this->user_ids[_i491]);
+            }
+            xfer += iprot->readListEnd();
+          }
+          this->__isset.user_ids = true;
+        } else {
+          xfer += iprot->skip(ftype);
+        }
+        break;
+      case 3:
+        if (ftype == ::apache::thrift::protocol::T_MAP) {
+          {
+            this->carrier.clear();
+            uint32_t _size492;
+            ::apache::thrift::protocol::TType _ktype493;
+            ::apache::thrift::protocol::TType _vtype494;
+            xfer += iprot->readMapBegin(_ktype493, _vtype494, _size492);
+            uint32_t _i495;
+            for (_i495 = 0; _i495 < _size492; ++_i495)
+            {
+              std::string _key496;
+              xfer += iprot->readString(_key496);
+              std::string& _val497 = this->carrier[_key496];
+              xfer += iprot->readString(_val497);
+            }
+            xfer += iprot->readMapEnd();
+          }
+          this->__isset.carrier = true;
+        } else {
+          xfer += iprot->skip(ftype);
+        }
+        break;
+      default:
+        xfer += iprot->skip(ftype);
+        break;
+    }
+    xfer += iprot->readFieldEnd();
+  }
+
+  xfer += iprot->readStructEnd();
+
+  return xfer;
+}
+
+uint32_t SocialGraphService_GetFolloweesBatch_args::write(::apache::thrift::protocol::TProtocol* oprot) const {
+  uint32_t xfer = 0;
+  ::apache::thrift::protocol::TOutputRecursionTracker tracker(*oprot);
+  xfer += oprot->writeStructBegin("SocialGraphService_GetFolloweesBatch_args");
+
+  xfer += oprot->writeFieldBegin("req_id", ::apache::thrift::protocol::T_I64, 1);
+  xfer += oprot->writeI64(this->req_id);
+  xfer += oprot->writeFieldEnd();
+
+  xfer += oprot->writeFieldBegin("user_ids", ::apache::thrift::protocol::T_LIST, 2);
+  {
+    xfer += oprot->writeListBegin(::apache::thrift::protocol::T_I64, static_cast<uint32_t>(this->user_ids.size()));
+    std::vector<int64_t> ::const_iterator _iter498;
+    for (_iter498 = this->user_ids.begin(); _iter498 != this->user_ids.end(); ++_iter498)
+    {
+      xfer += oprot->writeI64((*_iter498));
+    }
+    xfer += oprot->writeListEnd();
+  }
+  xfer += oprot->writeFieldEnd();
+
+  xfer += oprot->writeFieldBegin("carrier", ::apache::thrift::protocol::T_MAP, 3);
+  {
+    xfer += oprot->writeMapBegin(::apache::thrift::protocol::T_STRING, ::apache::thrift::protocol::T_STRING, static_cast<uint32_t>(this->carrier.size()));
+    std::map<std::string, std::string> ::const_iterator _iter499;
+    for (_iter499 = this->carrier.begin(); _iter499 != this->carrier.end(); ++_iter499)
+    {
+      xfer += oprot->writeString(_iter499->first);
+      xfer += oprot->writeString(_iter499->second);
+    }
+    xfer += oprot->writeMapEnd();
+  }
+  xfer += oprot->writeFieldEnd();
+
+  xfer += oprot->writeFieldStop();
+  xfer += oprot->writeStructEnd();
+  return xfer;
+}
+
+
+SocialGraphService_GetFolloweesBatch_pargs::~SocialGraphService_GetFolloweesBatch_pargs() throw() {
+}
+
+
+uint32_t SocialGraphService_GetFolloweesBatch_pargs::write(::apache::thrift::protocol::TProtocol* oprot) const {
+  uint32_t xfer = 0;
+  ::apache::thrift::protocol::TOutputRecursionTracker tracker(*oprot);
+  xfer += oprot->writeStructBegin("SocialGraphService_GetFolloweesBatch_pargs");
+
+  xfer += oprot->writeFieldBegin("req_id", ::apache::thrift::protocol::T_I64, 1);
+  xfer += oprot->writeI64((*(this->req_id)));
+  xfer += oprot->writeFieldEnd();
+
+  xfer += oprot->writeFieldBegin("user_ids", ::apache::thrift::protocol::T_LIST, 2);
+  {
+    xfer += oprot->writeListBegin(::apache::thrift::protocol::T_I64, static_cast<uint32_t>((*(this->user_ids)).size()));
+    std::vector<int64_t> ::const_iterator _iter500;
+    for (_iter500 = (*(this->user_ids)).begin(); _iter500 != (*(this->user_ids)).end(); ++_iter500)
+    {
+      xfer += oprot->writeI64((*_iter500));
+    }
+    xfer += oprot->writeListEnd();
+  }
+  xfer += oprot->writeFieldEnd();
+
+  xfer += oprot->writeFieldBegin("carrier", ::apache::thrift::protocol::T_MAP, 3);
+  {
+    xfer += oprot->writeMapBegin(::apache::thrift::protocol::T_STRING, ::apache::thrift::protocol::T_STRING, static_cast<uint32_t>((*(this->carrier)).size()));
+    std::map<std::string, std::string> ::const_iterator _iter501;
+    for (_iter501 = (*(this->carrier)).begin(); _iter501 != (*(this->carrier)).end(); ++_iter501)
+    {
+      xfer += oprot->writeString(_iter501->first);
+      xfer += oprot->writeString(_iter501->second);
+    }
+    xfer += oprot->writeMapEnd();
+  }
+  xfer += oprot->writeFieldEnd();
+
+  xfer += oprot->writeFieldStop();
+  xfer += oprot->writeStructEnd();
+  return xfer;
+}
+
+
+SocialGraphService_GetFolloweesBatch_result::~SocialGraphService_GetFolloweesBatch_result() throw() {
+}
+
+
+uint32_t SocialGraphService_GetFolloweesBatch_result::read(::apache::thrift::protocol::TProtocol* iprot) {
+
+  ::apache::thrift::protocol::TInputRecursionTracker tracker(*iprot);
+  uint32_t xfer = 0;
+  std::string fname;
+  ::apache::thrift::protocol::TType ftype;
+  int16_t fid;
+
+  xfer += iprot->readStructBegin(fname);
+
+  using ::apache::thrift::protocol::TProtocolException;
+
+
+  while (true)
+  {
+    xfer += iprot->readFieldBegin(fname, ftype, fid);
+    if (ftype == ::apache::thrift::protocol::T_STOP) {
+      break;
+    }
+    switch (fid)
+    {
+      case 0:
+        if (ftype == ::apache::thrift::protocol::T_MAP) {
+          {
+            this->success.clear();
+            uint32_t _size502;
+            ::apache::thrift::protocol::TType _ktype503;
+            ::apache::thrift::protocol::TType _vtype504;
+            xfer += iprot->readMapBegin(_ktype503, _vtype504, _size502);
+            uint32_t _i505;
+            for (_i505 = 0; _i505 < _size502; ++_i505)
+            {
+              int64_t _key506;
+              xfer += iprot->readI64(_key506);
+              std::vector<int64_t> & _val507 = this->success[_key506];
+              {
+                _val507.clear();
+                uint32_t _size508;
+                ::apache::thrift::protocol::TType _etype509;
+                xfer += iprot->readListBegin(_etype509, _size508);
+                _val507.resize(_size508);
+                uint32_t _i510;
+                for (_i510 = 0; _i510 < _size508; ++_i510)
+                {
+                  xfer += iprot->readI64(_val507[_i510]);
+                }
+                xfer += iprot->readListEnd();
+              }
+            }
+            xfer += iprot->readMapEnd();
+          }
+          this->__isset.success = true;
+        } else {
+          xfer += iprot->skip(ftype);
+        }
+        break;
+      case 1:
+        if (ftype == ::apache::thrift::protocol::T_STRUCT) {
+          xfer += this->se.read(iprot);
+          this->__isset.se = true;
+        } else {
+          xfer += iprot->skip(ftype);
+        }
+        break;
+      default:
+        xfer += iprot->skip(ftype);
+        break;
+    }
+    xfer += iprot->readFieldEnd();
+  }
+
+  xfer += iprot->readStructEnd();
+
+  return xfer;
+}
+
+uint32_t SocialGraphService_GetFolloweesBatch_result::write(::apache::thrift::protocol::TProtocol* oprot) const {
+
+  uint32_t xfer = 0;
+
+  xfer += oprot->writeStructBegin("SocialGraphService_GetFolloweesBatch_result");
+
+  if (this->__isset.success) {
+    xfer += oprot->writeFieldBegin("success", ::apache::thrift::protocol::T_MAP, 0);
+    {
+      xfer += oprot->writeMapBegin(::apache::thrift::protocol::T_I64, ::apache::thrift::protocol::T_LIST, static_cast<uint32_t>(this->success.size()));
+      std::map<int64_t, std::vector<int64_t> > ::const_iterator _iter511;
+      for (_iter511 = this->success.begin(); _iter511 != this->success.end(); ++_iter511)
+      {
+        xfer += oprot->writeI64(_iter511->first);
+        {
+          xfer += oprot->writeListBegin(::apache::thrift::protocol::T_I64, static_cast<uint32_t>(_iter511->second.size()));
+          std::vector<int64_t> ::const_iterator _iter512;
+          for (_iter512 = _iter511->second.begin(); _iter512 != _iter511->second.end(); ++_iter512)
+          {
+            xfer += oprot->writeI64((*_iter512));
+          }
+          xfer += oprot->writeListEnd();
+        }
+      }
+      xfer += oprot->writeMapEnd();
+    }
+    xfer += oprot->writeFieldEnd();
+  } else if (this->__isset.se) {
+    xfer += oprot->writeFieldBegin("se", ::apache::thrift::protocol::T_STRUCT, 1);
+    xfer += this->se.write(oprot);
+    xfer += oprot->writeFieldEnd();
+  }
+  xfer += oprot->writeFieldStop();
+  xfer += oprot->writeStructEnd();
+  return xfer;
+}
+
+
+SocialGraphService_GetFolloweesBatch_presult::~SocialGraphService_GetFolloweesBatch_presult() throw() {
+}
+
+
+uint32_t SocialGraphService_GetFolloweesBatch_presult::read(::apache::thrift::protocol::TProtocol* iprot) {
+
+  ::apache::thrift::protocol::TInputRecursionTracker tracker(*iprot);
+  uint32_t xfer = 0;
+  std::string fname;
+  ::apache::thrift::protocol::TType ftype;
+  int16_t fid;
+
+  xfer += iprot->readStructBegin(fname);
+
+  using ::apache::thrift::protocol::TProtocolException;
+
+
+  while (true)
+  {
+    xfer += iprot->readFieldBegin(fname, ftype, fid);
+    if (ftype == ::apache::thrift::protocol::T_STOP) {
+      break;
+    }
+    switch (fid)
+    {
+      case 0:
+        if (ftype == ::apache::thrift::protocol::T_MAP) {
+          {
+            (*(this->success)).clear();
+            uint32_t _size513;
+            ::apache::thrift::protocol::TType _ktype514;
+            ::apache::thrift::protocol::TType _vtype515;
+            xfer += iprot->readMapBegin(_ktype514, _vtype515, _size513);
+            uint32_t _i516;
+            for (_i516 = 0; _i516 < _size513; ++_i516)
+            {
+              int64_t _key517;
+              xfer += iprot->readI64(_key517);
+              std::vector<int64_t> & _val518 = (*(this->success))[_key517];
+              {
+                _val518.clear();
+                uint32_t _size519;
+                ::apache::thrift::protocol::TType _etype520;
+                xfer += iprot->readListBegin(_etype520, _size519);
+                _val518.resize(_size519);
+                uint32_t _i521;
+                for (_i521 = 0; _i521 < _size519; ++_i521)
+                {
+                  xfer += iprot->readI64(_val518[_i521]);
+                }
+                xfer += iprot->readListEnd();
+              }
+            }
+            xfer += iprot->readMapEnd();
+          }
+          this->__isset.success = true;
+        } else {
+          xfer += iprot->skip(ftype);
+        }
+        break;
+      case 1:
+        if (ftype == ::apache::thrift::protocol::T_STRUCT) {
+          xfer += this->se.read(iprot);
+          this->__isset.se = true;
+        } else {
+          xfer += iprot->skip(ftype);
+        }
+        break;
+      default:
+        xfer += iprot->skip(ftype);
+        break;
+    }
+    xfer += iprot->readFieldEnd();
+  }
+
+  xfer += iprot->readStructEnd();
+
+  return xfer;
+}
+
+
 void SocialGraphServiceClient::GetFollowers(std::vector<int64_t> & _return, const int64_t req_id, const int64_t user_id, const std::map<std::string, std::string> & carrier)
 {
   send_GetFollowers(req_id, user_id, carrier);
@@ -2315,7 +3057,128 @@ void SocialGraphServiceClient::send_InsertUser(const int64_t req_id, const int64
 
   SocialGraphService_InsertUser_pargs args;
   args.req_id = &req_id;
-  args.user_id = &user_id;
+  args.user_id = &user_id;
+  args.carrier = &carrier;
+  args.write(oprot_);
+
+  oprot_->writeMessageEnd();
+  oprot_->getTransport()->writeEnd();
+  oprot_->getTransport()->flush();
+}
+
+void SocialGraphServiceClient::recv_InsertUser()
+{
+
+  int32_t rseqid = 0;
+  std::string fname;
+  ::apache::thrift::protocol::TMessageType mtype;
+
+  iprot_->readMessageBegin(fname, mtype, rseqid);
+  if (mtype == ::apache::thrift::protocol::T_EXCEPTION) {
+    ::apache::thrift::TApplicationException x;
+    x.read(iprot_);
+    iprot_->readMessageEnd();
+    iprot_->getTransport()->readEnd();
+    throw x;
+  }
+  if (mtype != ::apache::thrift::protocol::T_REPLY) {
+    iprot_->skip(::apache::thrift::protocol::T_STRUCT);
+    iprot_->readMessageEnd();
+    iprot_->getTransport()->readEnd();
+  }
+  if (fname.compare("InsertUser") != 0) {
+    iprot_->skip(::apache::thrift::protocol::T_STRUCT);
+    iprot_->readMessageEnd();
+    iprot_->getTransport()->readEnd();
+  }
+  SocialGraphService_InsertUser_presult result;
+  result.read(iprot_);
+  iprot_->readMessageEnd();
+  iprot_->getTransport()->readEnd();
+
+  if (result.__isset.se) {
+    throw result.se;
+  }
+  return;
+}
+
+void SocialGraphServiceClient::GetFollowersBatch(std::map<int64_t, std::vector<int64_t> > & _return, const int64_t req_id, const std::vector<int64_t> & user_ids, const std::map<std::string, std::string> & carrier)
+{
+  send_GetFollowersBatch(req_id, user_ids, carrier);
+  recv_GetFollowersBatch(_return);
+}
+
+void SocialGraphServiceClient::send_GetFollowersBatch(const int64_t req_id, const std::vector<int64_t> & user_ids, const std::map<std::string, std::string> & carrier)
+{
+  int32_t cseqid = 0;
+  oprot_->writeMessageBegin("GetFollowersBatch", ::apache::thrift::protocol::T_CALL, cseqid);
+
+  SocialGraphService_GetFollowersBatch_pargs args;
+  args.req_id = &req_id;
+  args.user_ids = &user_ids;
+  args.carrier = &carrier;
+  args.write(oprot_);
+
+  oprot_->writeMessageEnd();
+  oprot_->getTransport()->writeEnd();
+  oprot_->getTransport()->flush();
+}
+
+void SocialGraphServiceClient::recv_GetFollowersBatch(std::map<int64_t, std::vector<int64_t> > & _return)
+{
+
+  int32_t rseqid = 0;
+  std::string fname;
+  ::apache::thrift::protocol::TMessageType mtype;
+
+  iprot_->readMessageBegin(fname, mtype, rseqid);
+  if (mtype == ::apache::thrift::protocol::T_EXCEPTION) {
+    ::apache::thrift::TApplicationException x;
+    x.read(iprot_);
+    iprot_->readMessageEnd();
+    iprot_->getTransport()->readEnd();
+    throw x;
+  }
+  if (mtype != ::apache::thrift::protocol::T_REPLY) {
+    iprot_->skip(::apache::thrift::protocol::T_STRUCT);
+    iprot_->readMessageEnd();
+    iprot_->getTransport()->readEnd();
+  }
+  if (fname.compare("GetFollowersBatch") != 0) {
+    iprot_->skip(::apache::thrift::protocol::T_STRUCT);
+    iprot_->readMessageEnd();
+    iprot_->getTransport()->readEnd();
+  }
+  SocialGraphService_GetFollowersBatch_presult result;
+  result.success = &_return;
+  result.read(iprot_);
+  iprot_->readMessageEnd();
+  iprot_->getTransport()->readEnd();
+
+  if (result.__isset.success) {
+    // _return pointer has now been filled
+    return;
+  }
+  if (result.__isset.se) {
+    throw result.se;
+  }
+  throw ::apache::thrift::TApplicationException(::apache::thrift::TApplicationException::MISSING_RESULT, "GetFollowersBatch failed: unknown result");
+}
+
+void SocialGraphServiceClient::GetFolloweesBatch(std::map<int64_t, std::vector<int64_t> > & _return, const int64_t req_id, const std::vector<int64_t> & user_ids, const std::map<std::string, std::string> & carrier)
+{
+  send_GetFolloweesBatch(req_id, user_ids, carrier);
+  recv_GetFolloweesBatch(_return);
+}
+
+void SocialGraphServiceClient::send_GetFolloweesBatch(const int64_t req_id, const std::vector<int64_t> & user_ids, const std::map<std::string, std::string> & carrier)
+{
+  int32_t cseqid = 0;
+  oprot_->writeMessageBegin("GetFolloweesBatch", ::apache::thrift::protocol::T_CALL, cseqid);
+
+  SocialGraphService_GetFolloweesBatch_pargs args;
+  args.req_id = &req_id;
+  args.user_ids = &user_ids;
   args.carrier = &carrier;
   args.write(oprot_);
 
@@ -2324,7 +3187,7 @@ void SocialGraphServiceClient::send_InsertUser(const int64_t req_id, const int64
   oprot_->getTransport()->flush();
 }
 
-void SocialGraphServiceClient::recv_InsertUser()
+void SocialGraphServiceClient::recv_GetFolloweesBatch(std::map<int64_t, std::vector<int64_t> > & _return)
 {
 
   int32_t rseqid = 0;
@@ -2344,20 +3207,25 @@ void SocialGraphServiceClient::recv_InsertUser()
     iprot_->readMessageEnd();
     iprot_->getTransport()->readEnd();
   }
-  if (fname.compare("InsertUser") != 0) {
+  if (fname.compare("GetFolloweesBatch") != 0) {
     iprot_->skip(::apache::thrift::protocol::T_STRUCT);
     iprot_->readMessageEnd();
     iprot_->getTransport()->readEnd();
   }
-  SocialGraphService_InsertUser_presult result;
+  SocialGraphService_GetFolloweesBatch_presult result;
+  result.success = &_return;
   result.read(iprot_);
   iprot_->readMessageEnd();
   iprot_->getTransport()->readEnd();
 
+  if (result.__isset.success) {
+    // _return pointer has now been filled
+    return;
+  }
   if (result.__isset.se) {
     throw result.se;
   }
-  return;
+  throw ::apache::thrift::TApplicationException(::apache::thrift::TApplicationException::MISSING_RESULT, "GetFolloweesBatch failed: unknown result");
 }
 
 bool SocialGraphServiceProcessor::dispatchCall(::apache::thrift::protocol::TProtocol* iprot, ::apache::thrift::protocol::TProtocol* oprot, const std::string& fname, int32_t seqid, void* callContext) {
@@ -2773,6 +3641,120 @@ void SocialGraphServiceProcessor::process_InsertUser(int32_t seqid, ::apache::th
   }
 }
 
+void SocialGraphServiceProcessor::process_GetFollowersBatch(int32_t seqid, ::apache::thrift::protocol::TProtocol* iprot, ::apache::thrift::protocol::TProtocol* oprot, void* callContext)
+{
+  void* ctx = NULL;
+  if (this->eventHandler_.get() != NULL) {
+    ctx = this->eventHandler_->getContext("SocialGraphService.GetFollowersBatch", callContext);
+  }
+  ::apache::thrift::TProcessorContextFreer freer(this->eventHandler_.get(), ctx, "SocialGraphService.GetFollowersBatch");
+
+  if (this->eventHandler_.get() != NULL) {
+    this->eventHandler_->preRead(ctx, "SocialGraphService.GetFollowersBatch");
+  }
+
+  SocialGraphService_GetFollowersBatch_args args;
+  args.read(iprot);
+  iprot->readMessageEnd();
+  uint32_t bytes = iprot->getTransport()->readEnd();
+
+  if (this->eventHandler_.get() != NULL) {
+    this->eventHandler_->postRead(ctx, "SocialGraphService.GetFollowersBatch", bytes);
+  }
+
+  SocialGraphService_GetFollowersBatch_result result;
+  try {
+    iface_->GetFollowersBatch(result.success, args.req_id, args.user_ids, args.carrier);
+    result.__isset.success = true;
+  } catch (ServiceException &se) {
+    result.se = se;
+    result.__isset.se = true;
+  } catch (const std::exception& e) {
+    if (this->eventHandler_.get() != NULL) {
+      this->eventHandler_->handlerError(ctx, "SocialGraphService.GetFollowersBatch");
+    }
+
+    ::apache::thrift::TApplicationException x(e.what());
+    oprot->writeMessageBegin("GetFollowersBatch", ::apache::thrift::protocol::T_EXCEPTION, seqid);
+    x.write(oprot);
+    oprot->writeMessageEnd();
+    oprot->getTransport()->writeEnd();
+    oprot->getTransport()->flush();
+    return;
+  }
+
+  if (this->eventHandler_.get() != NULL) {
+    this->eventHandler_->preWrite(ctx, "SocialGraphService.GetFollowersBatch");
+  }
+
+  oprot->writeMessageBegin("GetFollowersBatch", ::apache::thrift::protocol::T_REPLY, seqid);
+  result.write(oprot);
+  oprot->writeMessageEnd();
+  bytes = oprot->getTransport()->writeEnd();
+  oprot->getTransport()->flush();
+
+  if (this->eventHandler_.get() != NULL) {
+    this->eventHandler_->postWrite(ctx, "SocialGraphService.GetFollowersBatch", bytes);
+  }
+}
+
+void SocialGraphServiceProcessor::process_GetFolloweesBatch(int32_t seqid, ::apache::thrift::protocol::TProtocol* iprot, ::apache::thrift::protocol::TProtocol* oprot, void* callContext)
+{
+  void* ctx = NULL;
+  if (this->eventHandler_.get() != NULL) {
+    ctx = this->eventHandler_->getContext("SocialGraphService.GetFolloweesBatch", callContext);
+  }
+  ::apache::thrift::TProcessorContextFreer freer(this->eventHandler_.get(), ctx, "SocialGraphService.GetFolloweesBatch");
+
+  if (this->eventHandler_.get() != NULL) {
+    this->eventHandler_->preRead(ctx, "SocialGraphService.GetFolloweesBatch");
+  }
+
+  SocialGraphService_GetFolloweesBatch_args args;
+  args.read(iprot);
+  iprot->readMessageEnd();
+  uint32_t bytes = iprot->getTransport()->readEnd();
+
+  if (this->eventHandler_.get() != NULL) {
+    this->eventHandler_->postRead(ctx, "SocialGraphService.GetFolloweesBatch", bytes);
+  }
+
+  SocialGraphService_GetFolloweesBatch_result result;
+  try {
+    iface_->GetFolloweesBatch(result.success, args.req_id, args.user_ids, args.carrier);
+    result.__isset.success = true;
+  } catch (ServiceException &se) {
+    result.se = se;
+    result.__isset.se = true;
+  } catch (const std::exception& e) {
+    if (this->eventHandler_.get() != NULL) {
+      this->eventHandler_->handlerError(ctx, "SocialGraphService.GetFolloweesBatch");
+    }
+
+    ::apache::thrift::TApplicationException x(e.what());
+    oprot->writeMessageBegin("GetFolloweesBatch", ::apache::thrift::protocol::T_EXCEPTION, seqid);
+    x.write(oprot);
+    oprot->writeMessageEnd();
+    oprot->getTransport()->writeEnd();
+    oprot->getTransport()->flush();
+    return;
+  }
+
+  if (this->eventHandler_.get() != NULL) {
+    this->eventHandler_->preWrite(ctx, "SocialGraphService.GetFolloweesBatch");
+  }
+
+  oprot->writeMessageBegin("GetFolloweesBatch", ::apache::thrift::protocol::T_REPLY, seqid);
+  result.write(oprot);
+  oprot->writeMessageEnd();
+  bytes = oprot->getTransport()->writeEnd();
+  oprot->getTransport()->flush();
+
+  if (this->eventHandler_.get() != NULL) {
+    this->eventHandler_->postWrite(ctx, "SocialGraphService.GetFolloweesBatch", bytes);
+  }
+}
+
 ::apache::thrift::stdcxx::shared_ptr< ::apache::thrift::TProcessor > SocialGraphServiceProcessorFactory::getProcessor(const ::apache::thrift::TConnectionInfo& connInfo) {
   ::apache::thrift::ReleaseHandler< SocialGraphServiceIfFactory > cleanup(handlerFactory_);
   ::apache::thrift::stdcxx::shared_ptr< SocialGraphServiceIf > handler(handlerFactory_->getHandler(connInfo), cleanup);
@@ -3384,5 +4366,185 @@ void SocialGraphServiceConcurrentClient::recv_InsertUser(const int32_t seqid)
   } // end while(true)
 }
 
+void SocialGraphServiceConcurrentClient::GetFollowersBatch(std::map<int64_t, std::vector<int64_t> > & _return, const int64_t req_id, const std::vector<int64_t> & user_ids, const std::map<std::string, std::string> & carrier)
+{
+  int32_t seqid = send_GetFollowersBatch(req_id, user_ids, carrier);
+  recv_GetFollowersBatch(_return, seqid);
+}
+
+int32_t SocialGraphServiceConcurrentClient::send_GetFollowersBatch(const int64_t req_id, const std::vector<int64_t> & user_ids, const std::map<std::string, std::string> & carrier)
+{
+  int32_t cseqid = this->sync_.generateSeqId();
+  ::apache::thrift::async::TConcurrentSendSentry sentry(&this->sync_);
+  oprot_->writeMessageBegin("GetFollowersBatch", ::apache::thrift::protocol::T_CALL, cseqid);
+
+  SocialGraphService_GetFollowersBatch_pargs args;
+  args.req_id = &req_id;
+  args.user_ids = &user_ids;
+  args.carrier = &carrier;
+  args.write(oprot_);
+
+  oprot_->writeMessageEnd();
+  oprot_->getTransport()->writeEnd();
+  oprot_->getTransport()->flush();
+
+  sentry.commit();
+  return cseqid;
+}
+
+void SocialGraphServiceConcurrentClient::recv_GetFollowersBatch(std::map<int64_t, std::vector<int64_t> > & _return, const int32_t seqid)
+{
+
+  int32_t rseqid = 0;
+  std::string fname;
+  ::apache::thrift::protocol::TMessageType mtype;
+
+  // the read mutex gets dropped and reacquired as part of waitForWork()
+  // The destructor of this sentry wakes up other clients
+  ::apache::thrift::async::TConcurrentRecvSentry sentry(&this->sync_, seqid);
+
+  while(true) {
+    if(!this->sync_.getPending(fname, mtype, rseqid)) {
+      iprot_->readMessageBegin(fname, mtype, rseqid);
+    }
+    if(seqid == rseqid) {
+      if (mtype == ::apache::thrift::protocol::T_EXCEPTION) {
+        ::apache::thrift::TApplicationException x;
+        x.read(iprot_);
+        iprot_->readMessageEnd();
+        iprot_->getTransport()->readEnd();
+        sentry.commit();
+        throw x;
+      }
+      if (mtype != ::apache::thrift::protocol::T_REPLY) {
+        iprot_->skip(::apache::thrift::protocol::T_STRUCT);
+        iprot_->readMessageEnd();
+        iprot_->getTransport()->readEnd();
+      }
+      if (fname.compare("GetFollowersBatch") != 0) {
+        iprot_->skip(::apache::thrift::protocol::T_STRUCT);
+        iprot_->readMessageEnd();
+        iprot_->getTransport()->readEnd();
+
+        // in a bad state, don't commit
+        using ::apache::thrift::protocol::TProtocolException;
+        throw TProtocolException(TProtocolException::INVALID_DATA);
+      }
+      SocialGraphService_GetFollowersBatch_presult result;
+      result.success = &_return;
+      result.read(iprot_);
+      iprot_->readMessageEnd();
+      iprot_->getTransport()->readEnd();
+
+      if (result.__isset.success) {
+        // _return pointer has now been filled
+        sentry.commit();
+        return;
+      }
+      if (result.__isset.se) {
+        sentry.commit();
+        throw result.se;
+      }
+      // in a bad state, don't commit
+      throw ::apache::thrift::TApplicationException(::apache::thrift::TApplicationException::MISSING_RESULT, "GetFollowersBatch failed: unknown result");
+    }
+    // seqid != rseqid
+    this->sync_.updatePending(fname, mtype, rseqid);
+
+    // this will temporarily unlock the readMutex, and let other clients get work done
+    this->sync_.waitForWork(seqid);
+  } // end while(true)
+}
+
+void SocialGraphServiceConcurrentClient::GetFolloweesBatch(std::map<int64_t, std::vector<int64_t> > & _return, const int64_t req_id, const std::vector<int64_t> & user_ids, const std::map<std::string, std::string> & carrier)
+{
+  int32_t seqid = send_GetFolloweesBatch(req_id, user_ids, carrier);
+  recv_GetFolloweesBatch(_return, seqid);
+}
+
+int32_t SocialGraphServiceConcurrentClient::send_GetFolloweesBatch(const int64_t req_id, const std::vector<int64_t> & user_ids, const std::map<std::string, std::string> & carrier)
+{
+  int32_t cseqid = this->sync_.generateSeqId();
+  ::apache::thrift::async::TConcurrentSendSentry sentry(&this->sync_);
+  oprot_->writeMessageBegin("GetFolloweesBatch", ::apache::thrift::protocol::T_CALL, cseqid);
+
+  SocialGraphService_GetFolloweesBatch_pargs args;
+  args.req_id = &req_id;
+  args.user_ids = &user_ids;
+  args.carrier = &carrier;
+  args.write(oprot_);
+
+  oprot_->writeMessageEnd();
+  oprot_->getTransport()->writeEnd();
+  oprot_->getTransport()->flush();
+
+  sentry.commit();
+  return cseqid;
+}
+
+void SocialGraphServiceConcurrentClient::recv_GetFolloweesBatch(std::map<int64_t, std::vector<int64_t> > & _return, const int32_t seqid)
+{
+
+  int32_t rseqid = 0;
+  std::string fname;
+  ::apache::thrift::protocol::TMessageType mtype;
+
+  // the read mutex gets dropped and reacquired as part of waitForWork()
+  // The destructor of this sentry wakes up other clients
+  ::apache::thrift::async::TConcurrentRecvSentry sentry(&this->sync_, seqid);
+
+  while(true) {
+    if(!this->sync_.getPending(fname, mtype, rseqid)) {
+      iprot_->readMessageBegin(fname, mtype, rseqid);
+    }
+    if(seqid == rseqid) {
+      if (mtype == ::apache::thrift::protocol::T_EXCEPTION) {
+        ::apache::thrift::TApplicationException x;
+        x.read(iprot_);
+        iprot_->readMessageEnd();
+        iprot_->getTransport()->readEnd();
+        sentry.commit();
+        throw x;
+      }
+      if (mtype != ::apache::thrift::protocol::T_REPLY) {
+        iprot_->skip(::apache::thrift::protocol::T_STRUCT);
+        iprot_->readMessageEnd();
+        iprot_->getTransport()->readEnd();
+      }
+      if (fname.compare("GetFolloweesBatch") != 0) {
+        iprot_->skip(::apache::thrift::protocol::T_STRUCT);
+        iprot_->readMessageEnd();
+        iprot_->getTransport()->readEnd();
+
+        // in a bad state, don't commit
+        using ::apache::thrift::protocol::TProtocolException;
+        throw TProtocolException(TProtocolException::INVALID_DATA);
+      }
+      SocialGraphService_GetFolloweesBatch_presult result;
+      result.success = &_return;
+      result.read(iprot_);
+      iprot_->readMessageEnd();
+      iprot_->getTransport()->readEnd();
+
+      if (result.__isset.success) {
+        // _return pointer has now been filled
+        sentry.commit();
+        return;
+      }
+      if (result.__isset.se) {
+        sentry.commit();
+        throw result.se;
+      }
+      // in a bad state, don't commit
+      throw ::apache::thrift::TApplicationException(::apache::thrift::TApplicationException::MISSING_RESULT, "GetFolloweesBatch failed: unknown result");
+    }
+    // seqid != rseqid
+    this->sync_.updatePending(fname, mtype, rseqid);
+
+    // this will temporarily unlock the readMutex, and let other clients get work done
+    this->sync_.waitForWork(seqid);
+  } // end while(true)
+}
+
 } // namespace
 
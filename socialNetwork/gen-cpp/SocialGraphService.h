@@ -28,6 +28,8 @@ class SocialGraphServiceIf {
   virtual void FollowWithUsername(const int64_t req_id, const std::string& user_usernmae, const std::string& followee_username, const std::map<std::string, std::string> & carrier) = 0;
   virtual void UnfollowWithUsername(const int64_t req_id, const std::string& user_usernmae, const std::string& followee_username, const std::map<std::string, std::string> & carrier) = 0;
   virtual void InsertUser(const int64_t req_id, const int64_t user_id, const std::map<std::string, std::string> & carrier) = 0;
+  virtual void GetFollowersBatch(std::map<int64_t, std::vector<int64_t> > & _return, const int64_t req_id, const std::vector<int64_t> & user_ids, const std::map<std::string, std::string> & carrier) = 0;
+  virtual void GetFolloweesBatch(std::map<int64_t, std::vector<int64_t> > & _return, const int64_t req_id, const std::vector<int64_t> & user_ids, const std::map<std::string, std::string> & carrier) = 0;
 };
 
 class SocialGraphServiceIfFactory {
@@ -78,6 +80,12 @@ class SocialGraphServiceNull : virtual public SocialGraphServiceIf {
   void InsertUser(const int64_t /* req_id */, const int64_t /* user_id */, const std::map<std::string, std::string> & /* carrier */) {
     return;
   }
+  void GetFollowersBatch(std::map<int64_t, std::vector<int64_t> > & /* _return */, const int64_t /* req_id */, const std::vector<int64_t> & /* user_ids */, const std::map<std::string, std::string> & /* carrier */) {
+    return;
+  }
+  void GetFolloweesBatch(std::map<int64_t, std::vector<int64_t> > & /* _return */, const int64_t /* req_id */, const std::vector<int64_t> & /* user_ids */, const std::map<std::string, std::string> & /* carrier */) {
+    return;
+  }
 };
 
 typedef struct _SocialGraphService_GetFollowers_args__isset {
@@ -950,6 +958,258 @@ class SocialGraphService_InsertUser_presult {
 
 };
 
+typedef struct _SocialGraphService_GetFollowersBatch_args__isset {
+  _SocialGraphService_GetFollowersBatch_args__isset() : req_id(false), user_ids(false), carrier(false) {}
+  bool req_id :1;
+  bool user_ids :1;
+  bool carrier :1;
+} _SocialGraphService_GetFollowersBatch_args__isset;
+
+class SocialGraphService_GetFollowersBatch_args {
+ public:
+
+  SocialGraphService_GetFollowersBatch_args(const SocialGraphService_GetFollowersBatch_args&);
+  SocialGraphService_GetFollowersBatch_args& operator=(const SocialGraphService_GetFollowersBatch_args&);
+  SocialGraphService_GetFollowersBatch_args() : req_id(0) {
+  }
+
+  virtual ~SocialGraphService_GetFollowersBatch_args() throw();
+  int64_t req_id;
+  std::vector<int64_t>  user_ids;
+  std::map<std::string, std::string>  carrier;
+
+  _SocialGraphService_GetFollowersBatch_args__isset __isset;
+
+  void __set_req_id(const int64_t val);
+
+  void __set_user_ids(const std::vector<int64_t> & val);
+
+  void __set_carrier(const std::map<std::string, std::string> & val);
+
+  bool operator == (const SocialGraphService_GetFollowersBatch_args & rhs) const
+  {
+    if (!(req_id == rhs.req_id))
+      return false;
+    if (!(user_ids == rhs.user_ids))
+      return false;
+    if (!(carrier == rhs.carrier))
+      return false;
+    return true;
+  }
+  bool operator != (const SocialGraphService_GetFollowersBatch_args &rhs) const {
+    return !(*this == rhs);
+  }
+
+  bool operator < (const SocialGraphService_GetFollowersBatch_args & ) const;
+
+  uint32_t read(::apache::thrift::protocol::TProtocol* iprot);
+  uint32_t write(::apache::thrift::protocol::TProtocol* oprot) const;
+
+};
+
+
+class SocialGraphService_GetFollowersBatch_pargs {
+ public:
+
+
+  virtual ~SocialGraphService_GetFollowersBatch_pargs() throw();
+  const int64_t* req_id;
+  const std::vector<int64_t> * user_ids;
+  const std::map<std::string, std::string> * carrier;
+
+  uint32_t write(::apache::thrift::protocol::TProtocol* oprot) const;
+
+};
+
+typedef struct _SocialGraphService_GetFollowersBatch_result__isset {
+  _SocialGraphService_GetFollowersBatch_result__isset() : success(false), se(false) {}
+  bool success :1;
+  bool se :1;
+} _SocialGraphService_GetFollowersBatch_result__isset;
+
+class SocialGraphService_GetFollowersBatch_result {
+ public:
+
+  SocialGraphService_GetFollowersBatch_result(const SocialGraphService_GetFollowersBatch_result&);
+  SocialGraphService_GetFollowersBatch_result& operator=(const SocialGraphService_GetFollowersBatch_result&);
+  SocialGraphService_GetFollowersBatch_result() {
+  }
+
+  virtual ~SocialGraphService_GetFollowersBatch_result() throw();
+  std::map<int64_t, std::vector<int64_t> >  success;
+  ServiceException se;
+
+  _SocialGraphService_GetFollowersBatch_result__isset __isset;
+
+  void __set_success(const std::map<int64_t, std::vector<int64_t> > & val);
+
+  void __set_se(const ServiceException& val);
+
+  bool operator == (const SocialGraphService_GetFollowersBatch_result & rhs) const
+  {
+    if (!(success == rhs.success))
+      return false;
+    if (!(se == rhs.se))
+      return false;
+    return true;
+  }
+  bool operator != (const SocialGraphService_GetFollowersBatch_result &rhs) const {
+    return !(*this == rhs);
+  }
+
+  bool operator < (const SocialGraphService_GetFollowersBatch_result & ) const;
+
+  uint32_t read(::apache::thrift::protocol::TProtocol* iprot);
+  uint32_t write(::apache::thrift::protocol::TProtocol* oprot) const;
+
+};
+
+typedef struct _SocialGraphService_GetFollowersBatch_presult__isset {
+  _SocialGraphService_GetFollowersBatch_presult__isset() : success(false), se(false) {}
+  bool success :1;
+  bool se :1;
+} _SocialGraphService_GetFollowersBatch_presult__isset;
+
+class SocialGraphService_GetFollowersBatch_presult {
+ public:
+
+
+  virtual ~SocialGraphService_GetFollowersBatch_presult() throw();
+  std::map<int64_t, std::vector<int64_t> > * success;
+  ServiceException se;
+
+  _SocialGraphService_GetFollowersBatch_presult__isset __isset;
+
+  uint32_t read(::apache::thrift::protocol::TProtocol* iprot);
+
+};
+
+typedef struct _SocialGraphService_GetFolloweesBatch_args__isset {
+  _SocialGraphService_GetFolloweesBatch_args__isset() : req_id(false), user_ids(false), carrier(false) {}
+  bool req_id :1;
+  bool user_ids :1;
+  bool carrier :1;
+} _SocialGraphService_GetFolloweesBatch_args__isset;
+
+class SocialGraphService_GetFolloweesBatch_args {
+ public:
+
+  SocialGraphService_GetFolloweesBatch_args(const SocialGraphService_GetFolloweesBatch_args&);
+  SocialGraphService_GetFolloweesBatch_args& operator=(const SocialGraphService_GetFolloweesBatch_args&);
+  SocialGraphService_GetFolloweesBatch_args() : req_id(0) {
+  }
+
+  virtual ~SocialGraphService_GetFolloweesBatch_args() throw();
+  int64_t req_id;
+  std::vector<int64_t>  user_ids;
+  std::map<std::string, std::string>  carrier;
+
+  _SocialGraphService_GetFolloweesBatch_args__isset __isset;
+
+  void __set_req_id(const int64_t val);
+
+  void __set_user_ids(const std::vector<int64_t> & val);
+
+  void __set_carrier(const std::map<std::string, std::string> & val);
+
+  bool operator == (const SocialGraphService_GetFolloweesBatch_args & rhs) const
+  {
+    if (!(req_id == rhs.req_id))
+      return false;
+    if (!(user_ids == rhs.user_ids))
+      return false;
+    if (!(carrier == rhs.carrier))
+      return false;
+    return true;
+  }
+  bool operator != (const SocialGraphService_GetFolloweesBatch_args &rhs) const {
+    return !(*this == rhs);
+  }
+
+  bool operator < (const SocialGraphService_GetFolloweesBatch_args & ) const;
+
+  uint32_t read(::apache::thrift::protocol::TProtocol* iprot);
+  uint32_t write(::apache::thrift::protocol::TProtocol* oprot) const;
+
+};
+
+
+class SocialGraphService_GetFolloweesBatch_pargs {
+ public:
+
+
+  virtual ~SocialGraphService_GetFolloweesBatch_pargs() throw();
+  const int64_t* req_id;
+  const std::vector<int64_t> * user_ids;
+  const std::map<std::string, std::string> * carrier;
+
+  uint32_t write(::apache::thrift::protocol::TProtocol* oprot) const;
+
+};
+
+typedef struct _SocialGraphService_GetFolloweesBatch_result__isset {
+  _SocialGraphService_GetFolloweesBatch_result__isset() : success(false), se(false) {}
+  bool success :1;
+  bool se :1;
+} _SocialGraphService_GetFolloweesBatch_result__isset;
+
+class SocialGraphService_GetFolloweesBatch_result {
+ public:
+
+  SocialGraphService_GetFolloweesBatch_result(const SocialGraphService_GetFolloweesBatch_result&);
+  SocialGraphService_GetFolloweesBatch_result& operator=(const SocialGraphService_GetFolloweesBatch_result&);
+  SocialGraphService_GetFolloweesBatch_result() {
+  }
+
+  virtual ~SocialGraphService_GetFolloweesBatch_result() throw();
+  std::map<int64_t, std::vector<int64_t> >  success;
+  ServiceException se;
+
+  _SocialGraphService_GetFolloweesBatch_result__isset __isset;
+
+  void __set_success(const std::map<int64_t, std::vector<int64_t> > & val);
+
+  void __set_se(const ServiceException& val);
+
+  bool operator == (const SocialGraphService_GetFolloweesBatch_result & rhs) const
+  {
+    if (!(success == rhs.success))
+      return false;
+    if (!(se == rhs.se))
+      return false;
+    return true;
+  }
+  bool operator != (const SocialGraphService_GetFolloweesBatch_result &rhs) const {
+    return !(*this == rhs);
+  }
+
+  bool operator < (const SocialGraphService_GetFolloweesBatch_result & ) const;
+
+  uint32_t read(::apache::thrift::protocol::TProtocol* iprot);
+  uint32_t write(::apache::thrift::protocol::TProtocol* oprot) const;
+
+};
+
+typedef struct _SocialGraphService_GetFolloweesBatch_presult__isset {
+  _SocialGraphService_GetFolloweesBatch_presult__isset() : success(false), se(false) {}
+  bool success :1;
+  bool se :1;
+} _SocialGraphService_GetFolloweesBatch_presult__isset;
+
+class SocialGraphService_GetFolloweesBatch_presult {
+ public:
+
+
+  virtual ~SocialGraphService_GetFolloweesBatch_presult() throw();
+  std::map<int64_t, std::vector<int64_t> > * success;
+  ServiceException se;
+
+  _SocialGraphService_GetFolloweesBatch_presult__isset __isset;
+
+  uint32_t read(::apache::thrift::protocol::TProtocol* iprot);
+
+};
+
 class SocialGraphServiceClient : virtual public SocialGraphServiceIf {
  public:
   SocialGraphServiceClient(apache::thrift::stdcxx::shared_ptr< ::apache::thrift::protocol::TProtocol> prot) {
@@ -996,6 +1256,12 @@ class SocialGraphServiceClient : virtual public SocialGraphServiceIf {
   void InsertUser(const int64_t req_id, const int64_t user_id, const std::map<std::string, std::string> & carrier);
   void send_InsertUser(const int64_t req_id, const int64_t user_id, const std::map<std::string, std::string> & carrier);
   void recv_InsertUser();
+  void GetFollowersBatch(std::map<int64_t, std::vector<int64_t> > & _return, const int64_t req_id, const std::vector<int64_t> & user_ids, const std::map<std::string, std::string> & carrier);
+  void send_GetFollowersBatch(const int64_t req_id, const std::vector<int64_t> & user_ids, const std::map<std::string, std::string> & carrier);
+  void recv_GetFollowersBatch(std::map<int64_t, std::vector<int64_t> > & _return);
+  void GetFolloweesBatch(std::map<int64_t, std::vector<int64_t> > & _return, const int64_t req_id, const std::vector<int64_t> & user_ids, const std::map<std::string, std::string> & carrier);
+  void send_GetFolloweesBatch(const int64_t req_id, const std::vector<int64_t> & user_ids, const std::map<std::string, std::string> & carrier);
+  void recv_GetFolloweesBatch(std::map<int64_t, std::vector<int64_t> > & _return);
  protected:
   apache::thrift::stdcxx::shared_ptr< ::apache::thrift::protocol::TProtocol> piprot_;
   apache::thrift::stdcxx::shared_ptr< ::apache::thrift::protocol::TProtocol> poprot_;
@@ -1018,6 +1284,8 @@ class SocialGraphServiceProcessor : public ::apache::thrift::TDispatchProcessor
   void process_FollowWithUsername(int32_t seqid, ::apache::thrift::protocol::TProtocol* iprot, ::apache::thrift::protocol::TProtocol* oprot, void* callContext);
   void process_UnfollowWithUsername(int32_t seqid, ::apache::thrift::protocol::TProtocol* iprot, ::apache::thrift::protocol::TProtocol* oprot, void* callContext);
   void process_InsertUser(int32_t seqid, ::apache::thrift::protocol::TProtocol* iprot, ::apache::thrift::protocol::TProtocol* oprot, void* callContext);
+  void process_GetFollowersBatch(int32_t seqid, ::apache::thrift::protocol::TProtocol* iprot, ::apache::thrift::protocol::TProtocol* oprot, void* callContext);
+  void process_GetFolloweesBatch(int32_t seqid, ::apache::thrift::protocol::TProtocol* iprot, ::apache::thrift::protocol::TProtocol* oprot, void* callContext);
  public:
   SocialGraphServiceProcessor(::apache::thrift::stdcxx::shared_ptr<SocialGraphServiceIf> iface) :
     iface_(iface) {
@@ -1028,6 +1296,8 @@ class SocialGraphServiceProcessor : public ::apache::thrift::TDispatchProcessor
     processMap_["FollowWithUsername"] = &SocialGraphServiceProcessor::process_FollowWithUsername;
     processMap_["UnfollowWithUsername"] = &SocialGraphServiceProcessor::process_UnfollowWithUsername;
     processMap_["InsertUser"] = &SocialGraphServiceProcessor::process_InsertUser;
+    processMap_["GetFollowersBatch"] = &SocialGraphServiceProcessor::process_GetFollowersBatch;
+    processMap_["GetFolloweesBatch"] = &SocialGraphServiceProcessor::process_GetFolloweesBatch;
   }
 
   virtual ~SocialGraphServiceProcessor() {}
@@ -1121,6 +1391,26 @@ class SocialGraphServiceMultiface : virtual public SocialGraphServiceIf {
     ifaces_[i]->InsertUser(req_id, user_id, carrier);
   }
 
+  void GetFollowersBatch(std::map<int64_t, std::vector<int64_t> > & _return, const int64_t req_id, const std::vector<int64_t> & user_ids, const std::map<std::string, std::string> & carrier) {
+    size_t sz = ifaces_.size();
+    size_t i = 0;
+    for (; i < (sz - 1); ++i) {
+      ifaces_[i]->GetFollowersBatch(_return, req_id, user_ids, carrier);
+    }
+    ifaces_[i]->GetFollowersBatch(_return, req_id, user_ids, carrier);
+    return;
+  }
+
+  void GetFolloweesBatch(std::map<int64_t, std::vector<int64_t> > & _return, const int64_t req_id, const std::vector<int64_t> & user_ids, const std::map<std::string, std::string> & carrier) {
+    size_t sz = ifaces_.size();
+    size_t i = 0;
+    for (; i < (sz - 1); ++i) {
+      ifaces_[i]->GetFolloweesBatch(_return, req_id, user_ids, carrier);
+    }
+    ifaces_[i]->GetFolloweesBatch(_return, req_id, user_ids, carrier);
+    return;
+  }
+
 };
 
 // The 'concurrent' client is a thread safe client that correctly handles
@@ -1172,6 +1462,12 @@ class SocialGraphServiceConcurrentClient : virtual public SocialGraphServiceIf {
   void InsertUser(const int64_t req_id, const int64_t user_id, const std::map<std::string, std::string> & carrier);
   int32_t send_InsertUser(const int64_t req_id, const int64_t user_id, const std::map<std::string, std::string> & carrier);
   void recv_InsertUser(const int32_t seqid);
+  void GetFollowersBatch(std::map<int64_t, std::vector<int64_t> > & _return, const int64_t req_id, const std::vector<int64_t> & user_ids, const std::map<std::string, std::string> & carrier);
+  int32_t send_GetFollowersBatch(const int64_t req_id, const std::vector<int64_t> & user_ids, const std::map<std::string, std::string> & carrier);
+  void recv_GetFollowersBatch(std::map<int64_t, std::vector<int64_t> > & _return, const int32_t seqid);
+  void GetFolloweesBatch(std::map<int64_t, std::vector<int64_t> > & _return, const int64_t req_id, const std::vector<int64_t> & user_ids, const std::map<std::string, std::string> & carrier);
+  int32_t send_GetFolloweesBatch(const int64_t req_id, const std::vector<int64_t> & user_ids, const std::map<std::string, std::string> & carrier);
+  void recv_GetFolloweesBatch(std::map<int64_t, std::vector<int64_t> > & _return, const int32_t seqid);
  protected:
   apache::thrift::stdcxx::shared_ptr< ::apache::thrift::protocol::TProtocol> piprot_;
   apache::thrift::stdcxx::shared_ptr< ::apache::thrift::protocol::TProtocol> poprot_;
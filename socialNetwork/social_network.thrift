@@ -78,6 +78,13 @@ service UniqueIdService {
       2: PostType post_type,
       3: map<string, string> carrier
   ) throws (1: ServiceException se)
+
+  list<i64> ComposeUniqueIds (
+      1: i64 req_id,
+      2: PostType post_type,
+      3: i32 count,
+      4: map<string, string> carrier
+  ) throws (1: ServiceException se)
 }
 
 service TextService {
@@ -251,6 +258,18 @@ service SocialGraphService{
       2: i64 user_id,
       3: map<string, string> carrier
   ) throws (1: ServiceException se)
+
+  map<i64, list<i64>> GetFollowersBatch(
+      1: i64 req_id,
+      2: list<i64> user_ids,
+      3: map<string, string> carrier
+  ) throws (1: ServiceException se)
+
+  map<i64, list<i64>> GetFolloweesBatch(
+      1: i64 req_id,
+      2: list<i64> user_ids,
+      3: map<string, string> carrier
+  ) throws (1: ServiceException se)
 }
 
 service UserMentionService {
@@ -2,6 +2,9 @@
 #define SOCIAL_NETWORK_MICROSERVICES_SRC_AMQPLIBEVENTHANDLER_H_
 
 #include <functional>
+#include <list>
+#include <memory>
+#include <vector>
 #include <unistd.h>
 #include <amqpcpp.h>
 #include <event2/event.h>
@@ -56,10 +59,34 @@ class AmqpLibeventHandler {
     return is_running_;
   }
 
+  // Runs callback every interval_ms on the event loop thread, so it can use
+  // the connection and channels without locking. Must be called before
+  // Start().
+  void AddTimer(int interval_ms, std::function<void()> callback)
+  {
+    callbacks_.push_back(std::move(callback));
+    EventPtrT timer(event_new(evbase_.get(), -1, EV_PERSIST, OnTimer,
+                              &callbacks_.back()),
+                    event_free);
+    struct timeval interval;
+    interval.tv_sec = interval_ms / 1000;
+    interval.tv_usec = (interval_ms % 1000) * 1000;
+    event_add(timer.get(), &interval);
+    timers_.push_back(std::move(timer));
+  }
+
  private:
+  static void OnTimer(evutil_socket_t, short, void *arg)
+  {
+    (*static_cast<std::function<void()> *>(arg))();
+  }
+
   EventBasePtrT evbase_;
   LibEventHandler evhandler_;
   bool is_running_;
+  // Declared after evbase_ so the timer events are freed first.
+  std::list<std::function<void()>> callbacks_;
+  std::vector<EventPtrT> timers_;
 
 };
 
@@ -0,0 +1,313 @@
+// Compares the utils_bson.h decoders with the path they replaced. The post
+// benchmark builds a post document laid out as PostStorageHandler::StorePost
+// writes it and decodes it into a Post either with BsonToPost or, as
+// ReadPost used to, with bson_as_json(), json::parse() and PostFromJson().
+//
+// With --edges, the edges file of a social graph dataset such as
+// datasets/social-graph/socfb-Reed98/socfb-Reed98.edges is turned into the
+// social-graph documents SocialGraphLoader writes, and their followers
+// arrays are decoded either with ForEachTimestampedId or with the
+// bson_iter_find_descendant("followers.<i>.user_id") lookups GetFollowers
+// made before, which restart from the top of the document for every entry.
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include "../PostStorageService/PostCacheCodec.h"
+#include "../logger.h"
+#include "../utils_bson.h"
+
+using namespace social_network;
+
+using std::chrono::steady_clock;
+
+namespace {
+
+Post MakePost(int text_length, int num_entities) {
+  Post post;
+  post.post_id = 6820452125461553152;
+  post.req_id = 2936372158410477568;
+  post.timestamp = 1609459200000;
+  post.post_type = PostType::POST;
+  post.creator.user_id = 962;
+  post.creator.username = "username_962";
+  post.text = std::string(text_length, 'x');
+  for (int i = 0; i < num_entities; ++i) {
+    UserMention user_mention;
+    user_mention.user_id = 100 + i;
+    user_mention.username = "username_" + std::to_string(100 + i);
+    post.user_mentions.emplace_back(user_mention);
+    Url url;
+    url.shortened_url = "http://short-url/" + std::to_string(i) + "abcdefghi";
+    url.expanded_url = "http://expanded-url.com/" + std::string(48, 'u');
+    post.urls.emplace_back(url);
+    Media media;
+    media.media_id = 5460851548262309888 + i;
+    media.media_type = "png";
+    post.media.emplace_back(media);
+  }
+  return post;
+}
+
+// Same document layout as PostStorageHandler::StorePost.
+bson_t *PostToBson(const Post &post) {
+  bson_t *doc = bson_new();
+  BSON_APPEND_INT64(doc, "post_id", post.post_id);
+  BSON_APPEND_INT64(doc, "timestamp", post.timestamp);
+  BSON_APPEND_UTF8(doc, "text", post.text.c_str());
+  BSON_APPEND_INT64(doc, "req_id", post.req_id);
+  BSON_APPEND_INT32(doc, "post_type", post.post_type);
+
+  bson_t creator_doc;
+  BSON_APPEND_DOCUMENT_BEGIN(doc, "creator", &creator_doc);
+  BSON_APPEND_INT64(&creator_doc, "user_id", post.creator.user_id);
+  BSON_APPEND_UTF8(&creator_doc, "username", post.creator.username.c_str());
+  bson_append_document_end(doc, &creator_doc);
+
+  const char *key;
+  char buf[16];
+  bson_t list;
+  BSON_APPEND_ARRAY_BEGIN(doc, "urls", &list);
+  for (size_t i = 0; i < post.urls.size(); ++i) {
+    bson_uint32_to_string(i, &key, buf, sizeof buf);
+    bson_t item;
+    BSON_APPEND_DOCUMENT_BEGIN(&list, key, &item);
+    BSON_APPEND_UTF8(&item, "shortened_url",
+                     post.urls[i].shortened_url.c_str());
+    BSON_APPEND_UTF8(&item, "expanded_url", post.urls[i].expanded_url.c_str());
+    bson_append_document_end(&list, &item);
+  }
+  bson_append_array_end(doc, &list);
+
+  BSON_APPEND_ARRAY_BEGIN(doc, "user_mentions", &list);
+  for (size_t i = 0; i < post.user_mentions.size(); ++i) {
+    bson_uint32_to_string(i, &key, buf, sizeof buf);
+    bson_t item;
+    BSON_APPEND_DOCUMENT_BEGIN(&list, key, &item);
+    BSON_APPEND_INT64(&item, "user_id", post.user_mentions[i].user_id);
+    BSON_APPEND_UTF8(&item, "username",
+                     post.user_mentions[i].username.c_str());
+    bson_append_document_end(&list, &item);
+  }
+  bson_append_array_end(doc, &list);
+
+  BSON_APPEND_ARRAY_BEGIN(doc, "media", &list);
+  for (size_t i = 0; i < post.media.size(); ++i) {
+    bson_uint32_to_string(i, &key, buf, sizeof buf);
+    bson_t item;
+    BSON_APPEND_DOCUMENT_BEGIN(&list, key, &item);
+    BSON_APPEND_INT64(&item, "media_id", post.media[i].media_id);
+    BSON_APPEND_UTF8(&item, "media_type", post.media[i].media_type.c_str());
+    bson_append_document_end(&list, &item);
+  }
+  bson_append_array_end(doc, &list);
+  return doc;
+}
+
+template<class F>
+double NanosPerCall(int iterations, F call) {
+  auto start = steady_clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    call();
+  }
+  return std::chrono::duration<double, std::nano>(steady_clock::now() -
+                                                  start).count() /
+      iterations;
+}
+
+int BenchmarkPost(int iterations, int text_length, int num_entities) {
+  Post expected = MakePost(text_length, num_entities);
+  bson_t *doc = PostToBson(expected);
+
+  Post from_bson;
+  Post from_json;
+  char *text = bson_as_json(doc, nullptr);
+  PostFromJson(json::parse(text), &from_json);
+  bson_free(text);
+  if (!BsonToPost(doc, &from_bson) || !(from_bson == expected) ||
+      !(from_json == expected)) {
+    LOG(error) << "Decoded post does not match the stored one";
+    bson_destroy(doc);
+    return 1;
+  }
+
+  double bson_ns = NanosPerCall(iterations, [&]() {
+    Post post;
+    BsonToPost(doc, &post);
+  });
+  double json_ns = NanosPerCall(iterations, [&]() {
+    Post post;
+    char *text = bson_as_json(doc, nullptr);
+    PostFromJson(json::parse(text), &post);
+    bson_free(text);
+  });
+  printf("post of %u bytes, %d mentions/urls/media: BsonToPost %.0f ns, "
+         "bson_as_json + json::parse %.0f ns (%.1fx)\n",
+         doc->len, num_entities, bson_ns, json_ns, json_ns / bson_ns);
+  bson_destroy(doc);
+  return 0;
+}
+
+// One document per user, {user_id, followers: [{user_id, timestamp}]}, with
+// an edge in both directions for each line as SocialGraphLoader loads them.
+bool ReadGraphDocs(const std::string &path, std::vector<bson_t *> *docs,
+                   int64_t *num_entries, size_t *max_degree) {
+  FILE *file = fopen(path.c_str(), "r");
+  if (!file) {
+    LOG(error) << "Cannot open " << path;
+    return false;
+  }
+  std::vector<std::vector<int64_t>> followers;
+  int64_t user_0;
+  int64_t user_1;
+  while (fscanf(file, "%" SCNd64 " %" SCNd64, &user_0, &user_1) == 2) {
+    if (user_0 < 0 || user_1 < 0) {
+      continue;
+    }
+    int64_t max_id = std::max(user_0, user_1);
+    if (max_id >= static_cast<int64_t>(followers.size())) {
+      followers.resize(max_id + 1);
+    }
+    followers[user_0].emplace_back(user_1);
+    followers[user_1].emplace_back(user_0);
+  }
+  fclose(file);
+
+  int64_t timestamp = 1609459200000;
+  const char *key;
+  char buf[16];
+  *num_entries = 0;
+  *max_degree = 0;
+  for (size_t user_id = 0; user_id < followers.size(); ++user_id) {
+    bson_t *doc = bson_new();
+    BSON_APPEND_INT64(doc, "user_id", user_id);
+    bson_t list;
+    BSON_APPEND_ARRAY_BEGIN(doc, "followers", &list);
+    for (size_t i = 0; i < followers[user_id].size(); ++i) {
+      bson_uint32_to_string(i, &key, buf, sizeof buf);
+      bson_t item;
+      BSON_APPEND_DOCUMENT_BEGIN(&list, key, &item);
+      BSON_APPEND_INT64(&item, "user_id", followers[user_id][i]);
+      BSON_APPEND_INT64(&item, "timestamp", timestamp++);
+      bson_append_document_end(&list, &item);
+    }
+    bson_append_array_end(doc, &list);
+    docs->emplace_back(doc);
+    *num_entries += followers[user_id].size();
+    *max_degree = std::max(*max_degree, followers[user_id].size());
+  }
+  return true;
+}
+
+// The decoding GetFollowers did before ForEachTimestampedId.
+void DecodeWithDescendantLookups(const bson_t *doc,
+                                 std::vector<int64_t> *ids) {
+  bson_iter_t iter_0;
+  bson_iter_t iter_1;
+  bson_iter_t user_id_child;
+  bson_iter_t timestamp_child;
+  int index = 0;
+  bson_iter_init(&iter_0, doc);
+  bson_iter_init(&iter_1, doc);
+  while (bson_iter_find_descendant(
+             &iter_0,
+             ("followers." + std::to_string(index) + ".user_id").c_str(),
+             &user_id_child) &&
+         BSON_ITER_HOLDS_INT64(&user_id_child) &&
+         bson_iter_find_descendant(
+             &iter_1,
+             ("followers." + std::to_string(index) + ".timestamp").c_str(),
+             &timestamp_child) &&
+         BSON_ITER_HOLDS_INT64(&timestamp_child)) {
+    ids->emplace_back(bson_iter_int64(&user_id_child));
+    bson_iter_init(&iter_0, doc);
+    bson_iter_init(&iter_1, doc);
+    index++;
+  }
+}
+
+int BenchmarkEdges(const std::string &path, int rounds) {
+  std::vector<bson_t *> docs;
+  int64_t num_entries;
+  size_t max_degree;
+  if (!ReadGraphDocs(path, &docs, &num_entries, &max_degree)) {
+    return 1;
+  }
+
+  std::vector<int64_t> ids;
+  std::vector<int64_t> expected_ids;
+  for (auto doc : docs) {
+    ids.clear();
+    expected_ids.clear();
+    ForEachTimestampedId(doc, "followers", "user_id",
+                         [&](int64_t id, int64_t) { ids.emplace_back(id); });
+    DecodeWithDescendantLookups(doc, &expected_ids);
+    if (ids != expected_ids) {
+      LOG(error) << "Decoders disagree on a followers array";
+      return 1;
+    }
+  }
+
+  double single_pass_ns = NanosPerCall(rounds, [&]() {
+    for (auto doc : docs) {
+      ids.clear();
+      ForEachTimestampedId(doc, "followers", "user_id",
+                           [&](int64_t id, int64_t) { ids.emplace_back(id); });
+    }
+  });
+  double descendant_ns = NanosPerCall(rounds, [&]() {
+    for (auto doc : docs) {
+      ids.clear();
+      DecodeWithDescendantLookups(doc, &ids);
+    }
+  });
+  printf("%zu followers arrays, %" PRId64 " entries, max degree %zu: "
+         "ForEachTimestampedId %.2f ms, find_descendant %.2f ms (%.1fx)\n",
+         docs.size(), num_entries, max_degree, single_pass_ns / 1e6,
+         descendant_ns / 1e6, descendant_ns / single_pass_ns);
+  for (auto doc : docs) {
+    bson_destroy(doc);
+  }
+  return 0;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  namespace po = boost::program_options;
+  po::options_description desc("Options");
+  desc.add_options()
+      ("help", "produce help message")
+      ("iterations", po::value<int>()->default_value(200000),
+       "number of decodes to time")
+      ("text-length", po::value<int>()->default_value(256),
+       "length of the post text")
+      ("entities", po::value<int>()->default_value(2),
+       "number of user mentions, urls and media of the post")
+      ("edges", po::value<std::string>(),
+       "decode the followers arrays of this social graph edges file instead")
+      ("rounds", po::value<int>()->default_value(10),
+       "number of times every followers array is decoded");
+  po::variables_map vm;
+  po::store(po::parse_command_line(argc, argv, desc), vm);
+  po::notify(vm);
+  if (vm.count("help")) {
+    std::cout << desc << std::endl;
+    return 0;
+  }
+
+  init_logger();
+  if (vm.count("edges")) {
+    return BenchmarkEdges(vm["edges"].as<std::string>(),
+                          vm["rounds"].as<int>());
+  }
+  return BenchmarkPost(vm["iterations"].as<int>(),
+                       vm["text-length"].as<int>(),
+                       vm["entities"].as<int>());
+}
@@ -18,9 +18,13 @@
 #include "../../gen-cpp/UserTimelineService.h"
 #include "../../gen-cpp/social_network_types.h"
 #include "../ClientPool.h"
+#include "../Executor.h"
+#include "../PendingReply.h"
+#include "../RpcElision.h"
 #include "../ThriftClient.h"
 #include "../logger.h"
 #include "../tracing.h"
+#include "RabbitmqClient.h"
 
 namespace social_network {
 using json = nlohmann::json;
@@ -30,15 +34,21 @@ using std::chrono::system_clock;
 
 class ComposePostHandler : public ComposePostServiceIf {
  public:
-  ComposePostHandler(ClientPool<ThriftClient<PostStorageServiceClient>> *,
-                     ClientPool<ThriftClient<UserTimelineServiceClient>> *,
-                     ClientPool<ThriftClient<UserServiceClient>> *,
-                     ClientPool<ThriftClient<UniqueIdServiceClient>> *,
-                     ClientPool<ThriftClient<MediaServiceClient>> *,
-                     ClientPool<ThriftClient<TextServiceClient>> *,
-                     ClientPool<ThriftClient<HomeTimelineServiceClient>> *);
+  ComposePostHandler(
+      ClientPool<ThriftClient<PostStorageServiceClient>> *,
+      ClientPool<ThriftClient<UserTimelineServiceClient>> *,
+      ClientPool<ThriftClient<UserServiceClient>> *,
+      ClientPool<ThriftClient<UniqueIdServiceClient>> *,
+      ClientPool<ThriftClient<MediaServiceClient>> *,
+      ClientPool<ThriftClient<TextServiceClient>> *,
+      ClientPool<ThriftClient<HomeTimelineServiceClient>> *,
+      ClientPool<RabbitmqClient> *, Executor *);
   ~ComposePostHandler() override = default;
 
+  std::vector<const ElidedRpcCounter *> GetElidedRpcCounters() const {
+    return {&_compose_text_rpc, &_compose_media_rpc};
+  }
+
   void ComposePost(int64_t req_id, const std::string &username, int64_t user_id,
                    const std::string &text,
                    const std::vector<int64_t> &media_ids,
@@ -51,13 +61,22 @@ class ComposePostHandler : public ComposePostServiceIf {
   ClientPool<ThriftClient<UserTimelineServiceClient>>
       *_user_timeline_client_pool;
 
-  ClientPool<ThriftClient<UserServiceClient>> *_user_service_client_pool;
+  ClientPool<ThriftClient<UserServiceClient>>
+      *_user_service_client_pool;
   ClientPool<ThriftClient<UniqueIdServiceClient>>
       *_unique_id_service_client_pool;
-  ClientPool<ThriftClient<MediaServiceClient>> *_media_service_client_pool;
-  ClientPool<ThriftClient<TextServiceClient>> *_text_service_client_pool;
+  ClientPool<ThriftClient<MediaServiceClient>>
+      *_media_service_client_pool;
+  ClientPool<ThriftClient<TextServiceClient>>
+      *_text_service_client_pool;
   ClientPool<ThriftClient<HomeTimelineServiceClient>>
       *_home_timeline_client_pool;
+  // When set, home timeline fan-outs are queued for WriteHomeTimelineService
+  // instead of written through home-timeline-service before returning.
+  ClientPool<RabbitmqClient> *_rabbitmq_client_pool;
+  Executor *_executor;
+  ElidedRpcCounter _compose_text_rpc;
+  ElidedRpcCounter _compose_media_rpc;
 
   void _UploadUserTimelineHelper(
       int64_t req_id, int64_t post_id, int64_t user_id, int64_t timestamp,
@@ -71,17 +90,24 @@ class ComposePostHandler : public ComposePostServiceIf {
       const std::vector<int64_t> &user_mentions_id,
       const std::map<std::string, std::string> &carrier);
 
-  Creator _ComposeCreaterHelper(
+  void _PublishHomeTimelineHelper(
+      int64_t req_id, int64_t post_id, int64_t user_id, int64_t timestamp,
+      const std::vector<int64_t> &user_mentions_id,
+      const std::map<std::string, std::string> &carrier);
+
+  // The compose helpers send their request on a pooled connection and
+  // return a future for the reply.
+  std::future<Creator> _ComposeCreaterHelper(
       int64_t req_id, int64_t user_id, const std::string &username,
       const std::map<std::string, std::string> &carrier);
-  TextServiceReturn _ComposeTextHelper(
+  std::future<TextServiceReturn> _ComposeTextHelper(
       int64_t req_id, const std::string &text,
       const std::map<std::string, std::string> &carrier);
-  std::vector<Media> _ComposeMediaHelper(
+  std::future<std::vector<Media>> _ComposeMediaHelper(
       int64_t req_id, const std::vector<std::string> &media_types,
       const std::vector<int64_t> &media_ids,
       const std::map<std::string, std::string> &carrier);
-  int64_t _ComposeUniqueIdHelper(
+  std::future<int64_t> _ComposeUniqueIdHelper(
       int64_t req_id, PostType::type post_type,
       const std::map<std::string, std::string> &carrier);
 };
@@ -91,13 +117,18 @@ ComposePostHandler::ComposePostHandler(
         *post_storage_client_pool,
     ClientPool<social_network::ThriftClient<UserTimelineServiceClient>>
         *user_timeline_client_pool,
-    ClientPool<ThriftClient<UserServiceClient>> *user_service_client_pool,
+    ClientPool<ThriftClient<UserServiceClient>>
+        *user_service_client_pool,
     ClientPool<ThriftClient<UniqueIdServiceClient>>
         *unique_id_service_client_pool,
-    ClientPool<ThriftClient<MediaServiceClient>> *media_service_client_pool,
-    ClientPool<ThriftClient<TextServiceClient>> *text_service_client_pool,
+    ClientPool<ThriftClient<MediaServiceClient>>
+        *media_service_client_pool,
+    ClientPool<ThriftClient<TextServiceClient>>
+        *text_service_client_pool,
     ClientPool<ThriftClient<HomeTimelineServiceClient>>
-        *home_timeline_client_pool) {
+        *home_timeline_client_pool,
+    ClientPool<RabbitmqClient> *rabbitmq_client_pool, Executor *executor)
+    : _compose_text_rpc("compose-text"), _compose_media_rpc("compose-media") {
   _post_storage_client_pool = post_storage_client_pool;
   _user_timeline_client_pool = user_timeline_client_pool;
   _user_service_client_pool = user_service_client_pool;
@@ -105,18 +136,16 @@ ComposePostHandler::ComposePostHandler(
   _media_service_client_pool = media_service_client_pool;
   _text_service_client_pool = text_service_client_pool;
   _home_timeline_client_pool = home_timeline_client_pool;
+  _rabbitmq_client_pool = rabbitmq_client_pool;
+  _executor = executor;
 }
 
-Creator ComposePostHandler::_ComposeCreaterHelper(
+std::future<Creator> ComposePostHandler::_ComposeCreaterHelper(
     int64_t req_id, int64_t user_id, const std::string &username,
     const std::map<std::string, std::string> &carrier) {
-  TextMapReader reader(carrier);
-  auto parent_span = opentracing::Tracer::Global()->Extract(reader);
-  auto span = opentracing::Tracer::Global()->StartSpan(
-      "compose_creator_client", {opentracing::ChildOf(parent_span->get())});
   std::map<std::string, std::string> writer_text_map;
-  TextMapWriter writer(writer_text_map);
-  opentracing::Tracer::Global()->Inject(span->context(), writer);
+  std::shared_ptr<opentracing::Span> span = ShareSpan(StartSpanFromCarrier(
+      "compose_creator_client", carrier, &writer_text_map));
 
   auto user_client_wrapper = _user_service_client_pool->Pop();
   if (!user_client_wrapper) {
@@ -128,32 +157,46 @@ Creator ComposePostHandler::_ComposeCreaterHelper(
     throw se;
   }
 
-  auto user_client = user_client_wrapper->GetClient();
-  Creator _return_creator;
+  std::future<Creator> creator_future;
   try {
-    user_client->ComposeCreatorWithUserId(_return_creator, req_id, user_id,
-                                          username, writer_text_map);
+    creator_future = SendRequest<Creator>(
+        _user_service_client_pool, user_client_wrapper,
+        [&](UserServiceClient *user_client) {
+          user_client->send_ComposeCreatorWithUserId(
+              req_id, user_id, username, writer_text_map);
+        },
+        [span](UserServiceClient *user_client) {
+          Creator _return_creator;
+          try {
+            user_client->recv_ComposeCreatorWithUserId(_return_creator);
+          } catch (...) {
+            LOG(error) << "Failed to send compose-creator to user-service";
+            span->Finish();
+            throw;
+          }
+          span->Finish();
+          return _return_creator;
+        });
   } catch (...) {
     LOG(error) << "Failed to send compose-creator to user-service";
-    _user_service_client_pool->Remove(user_client_wrapper);
     span->Finish();
     throw;
   }
-  _user_service_client_pool->Keepalive(user_client_wrapper);
-  span->Finish();
-  return _return_creator;
+  return creator_future;
 }
 
-TextServiceReturn ComposePostHandler::_ComposeTextHelper(
+std::future<TextServiceReturn> ComposePostHandler::_ComposeTextHelper(
     int64_t req_id, const std::string &text,
     const std::map<std::string, std::string> &carrier) {
-  TextMapReader reader(carrier);
-  auto parent_span = opentracing::Tracer::Global()->Extract(reader);
-  auto span = opentracing::Tracer::Global()->StartSpan(
-      "compose_text_client", {opentracing::ChildOf(parent_span->get())});
+  // Empty text has no mentions or urls to resolve.
+  if (text.empty()) {
+    return LocalResult(&_compose_text_rpc, TextServiceReturn());
+  }
+  _compose_text_rpc.CountCall();
+
   std::map<std::string, std::string> writer_text_map;
-  TextMapWriter writer(writer_text_map);
-  opentracing::Tracer::Global()->Inject(span->context(), writer);
+  std::shared_ptr<opentracing::Span> span = ShareSpan(
+      StartSpanFromCarrier("compose_text_client", carrier, &writer_text_map));
 
   auto text_client_wrapper = _text_service_client_pool->Pop();
   if (!text_client_wrapper) {
@@ -161,37 +204,51 @@ TextServiceReturn ComposePostHandler::_ComposeTextHelper(
     se.errorCode = ErrorCode::SE_THRIFT_CONN_ERROR;
     se.message = "Failed to connect to text-service";
     LOG(error) << se.message;
-    ;
     span->Finish();
     throw se;
   }
 
-  auto text_client = text_client_wrapper->GetClient();
-  TextServiceReturn _return_text;
+  std::future<TextServiceReturn> text_future;
   try {
-    text_client->ComposeText(_return_text, req_id, text, writer_text_map);
+    text_future = SendRequest<TextServiceReturn>(
+        _text_service_client_pool, text_client_wrapper,
+        [&](TextServiceClient *text_client) {
+          text_client->send_ComposeText(req_id, text, writer_text_map);
+        },
+        [span](TextServiceClient *text_client) {
+          TextServiceReturn _return_text;
+          try {
+            text_client->recv_ComposeText(_return_text);
+          } catch (...) {
+            LOG(error) << "Failed to send compose-text to text-service";
+            span->Finish();
+            throw;
+          }
+          span->Finish();
+          return _return_text;
+        });
   } catch (...) {
     LOG(error) << "Failed to send compose-text to text-service";
-    _text_service_client_pool->Remove(text_client_wrapper);
     span->Finish();
     throw;
   }
-  _text_service_client_pool->Keepalive(text_client_wrapper);
-  span->Finish();
-  return _return_text;
+  return text_future;
 }
 
-std::vector<Media> ComposePostHandler::_ComposeMediaHelper(
+std::future<std::vector<Media>> ComposePostHandler::_ComposeMediaHelper(
     int64_t req_id, const std::vector<std::string> &media_types,
     const std::vector<int64_t> &media_ids,
     const std::map<std::string, std::string> &carrier) {
-  TextMapReader reader(carrier);
-  auto parent_span = opentracing::Tracer::Global()->Extract(reader);
-  auto span = opentracing::Tracer::Global()->StartSpan(
-      "compose_media_client", {opentracing::ChildOf(parent_span->get())});
+  // media-service only zips the two lists, so a post without media needs no
+  // call. Mismatched lists still go through to get the service's error.
+  if (media_types.empty() && media_ids.empty()) {
+    return LocalResult(&_compose_media_rpc, std::vector<Media>());
+  }
+  _compose_media_rpc.CountCall();
+
   std::map<std::string, std::string> writer_text_map;
-  TextMapWriter writer(writer_text_map);
-  opentracing::Tracer::Global()->Inject(span->context(), writer);
+  std::shared_ptr<opentracing::Span> span = ShareSpan(
+      StartSpanFromCarrier("compose_media_client", carrier, &writer_text_map));
 
   auto media_client_wrapper = _media_service_client_pool->Pop();
   if (!media_client_wrapper) {
@@ -199,37 +256,44 @@ std::vector<Media> ComposePostHandler::_ComposeMediaHelper(
     se.errorCode = ErrorCode::SE_THRIFT_CONN_ERROR;
     se.message = "Failed to connect to media-service";
     LOG(error) << se.message;
-    ;
     span->Finish();
     throw se;
   }
 
-  auto media_client = media_client_wrapper->GetClient();
-  std::vector<Media> _return_media;
+  std::future<std::vector<Media>> media_future;
   try {
-    media_client->ComposeMedia(_return_media, req_id, media_types, media_ids,
-                               writer_text_map);
+    media_future = SendRequest<std::vector<Media>>(
+        _media_service_client_pool, media_client_wrapper,
+        [&](MediaServiceClient *media_client) {
+          media_client->send_ComposeMedia(req_id, media_types,
+                                                 media_ids, writer_text_map);
+        },
+        [span](MediaServiceClient *media_client) {
+          std::vector<Media> _return_media;
+          try {
+            media_client->recv_ComposeMedia(_return_media);
+          } catch (...) {
+            LOG(error) << "Failed to send compose-media to media-service";
+            span->Finish();
+            throw;
+          }
+          span->Finish();
+          return _return_media;
+        });
   } catch (...) {
     LOG(error) << "Failed to send compose-media to media-service";
-    _media_service_client_pool->Remove(media_client_wrapper);
     span->Finish();
     throw;
   }
-  _media_service_client_pool->Keepalive(media_client_wrapper);
-  span->Finish();
-  return _return_media;
+  return media_future;
 }
 
-int64_t ComposePostHandler::_ComposeUniqueIdHelper(
+std::future<int64_t> ComposePostHandler::_ComposeUniqueIdHelper(
     int64_t req_id, const PostType::type post_type,
     const std::map<std::string, std::string> &carrier) {
-  TextMapReader reader(carrier);
-  auto parent_span = opentracing::Tracer::Global()->Extract(reader);
-  auto span = opentracing::Tracer::Global()->StartSpan(
-      "compose_unique_id_client", {opentracing::ChildOf(parent_span->get())});
   std::map<std::string, std::string> writer_text_map;
-  TextMapWriter writer(writer_text_map);
-  opentracing::Tracer::Global()->Inject(span->context(), writer);
+  std::shared_ptr<opentracing::Span> span = ShareSpan(StartSpanFromCarrier(
+      "compose_unique_id_client", carrier, &writer_text_map));
 
   auto unique_id_client_wrapper = _unique_id_service_client_pool->Pop();
   if (!unique_id_client_wrapper) {
@@ -241,32 +305,41 @@ int64_t ComposePostHandler::_ComposeUniqueIdHelper(
     throw se;
   }
 
-  auto unique_id_client = unique_id_client_wrapper->GetClient();
-  int64_t _return_unique_id;
+  std::future<int64_t> unique_id_future;
   try {
-    _return_unique_id =
-        unique_id_client->ComposeUniqueId(req_id, post_type, writer_text_map);
+    unique_id_future = SendRequest<int64_t>(
+        _unique_id_service_client_pool, unique_id_client_wrapper,
+        [&](UniqueIdServiceClient *unique_id_client) {
+          unique_id_client->send_ComposeUniqueId(req_id, post_type,
+                                                        writer_text_map);
+        },
+        [span](UniqueIdServiceClient *unique_id_client) {
+          int64_t _return_unique_id;
+          try {
+            _return_unique_id = unique_id_client->recv_ComposeUniqueId();
+          } catch (...) {
+            LOG(error) << "Failed to send compose-unique_id to "
+                          "unique_id-service";
+            span->Finish();
+            throw;
+          }
+          span->Finish();
+          return _return_unique_id;
+        });
   } catch (...) {
     LOG(error) << "Failed to send compose-unique_id to unique_id-service";
-    _unique_id_service_client_pool->Remove(unique_id_client_wrapper);
     span->Finish();
     throw;
   }
-  _unique_id_service_client_pool->Keepalive(unique_id_client_wrapper);
-  span->Finish();
-  return _return_unique_id;
+  return unique_id_future;
 }
 
 void ComposePostHandler::_UploadPostHelper(
     int64_t req_id, const Post &post,
     const std::map<std::string, std::string> &carrier) {
-  TextMapReader reader(carrier);
-  auto parent_span = opentracing::Tracer::Global()->Extract(reader);
-  auto span = opentracing::Tracer::Global()->StartSpan(
-      "store_post_client", {opentracing::ChildOf(parent_span->get())});
   std::map<std::string, std::string> writer_text_map;
-  TextMapWriter writer(writer_text_map);
-  opentracing::Tracer::Global()->Inject(span->context(), writer);
+  auto span = StartSpanFromCarrier(
+      "store_post_client", carrier, &writer_text_map);
 
   auto post_storage_client_wrapper = _post_storage_client_pool->Pop();
   if (!post_storage_client_wrapper) {
@@ -293,13 +366,9 @@ void ComposePostHandler::_UploadPostHelper(
 void ComposePostHandler::_UploadUserTimelineHelper(
     int64_t req_id, int64_t post_id, int64_t user_id, int64_t timestamp,
     const std::map<std::string, std::string> &carrier) {
-  TextMapReader reader(carrier);
-  auto parent_span = opentracing::Tracer::Global()->Extract(reader);
-  auto span = opentracing::Tracer::Global()->StartSpan(
-      "write_user_timeline_client", {opentracing::ChildOf(parent_span->get())});
   std::map<std::string, std::string> writer_text_map;
-  TextMapWriter writer(writer_text_map);
-  opentracing::Tracer::Global()->Inject(span->context(), writer);
+  auto span = StartSpanFromCarrier(
+      "write_user_timeline_client", carrier, &writer_text_map);
 
   auto user_timeline_client_wrapper = _user_timeline_client_pool->Pop();
   if (!user_timeline_client_wrapper) {
@@ -327,13 +396,9 @@ void ComposePostHandler::_UploadHomeTimelineHelper(
     int64_t req_id, int64_t post_id, int64_t user_id, int64_t timestamp,
     const std::vector<int64_t> &user_mentions_id,
     const std::map<std::string, std::string> &carrier) {
-  TextMapReader reader(carrier);
-  auto parent_span = opentracing::Tracer::Global()->Extract(reader);
-  auto span = opentracing::Tracer::Global()->StartSpan(
-      "write_home_timeline_client", {opentracing::ChildOf(parent_span->get())});
   std::map<std::string, std::string> writer_text_map;
-  TextMapWriter writer(writer_text_map);
-  opentracing::Tracer::Global()->Inject(span->context(), writer);
+  auto span = StartSpanFromCarrier(
+      "write_home_timeline_client", carrier, &writer_text_map);
 
   auto home_timeline_client_wrapper = _home_timeline_client_pool->Pop();
   if (!home_timeline_client_wrapper) {
@@ -358,31 +423,59 @@ void ComposePostHandler::_UploadHomeTimelineHelper(
   span->Finish();
 }
 
+void ComposePostHandler::_PublishHomeTimelineHelper(
+    int64_t req_id, int64_t post_id, int64_t user_id, int64_t timestamp,
+    const std::vector<int64_t> &user_mentions_id,
+    const std::map<std::string, std::string> &carrier) {
+  std::map<std::string, std::string> writer_text_map;
+  auto span = StartSpanFromCarrier(
+      "write_home_timeline_publish_client", carrier, &writer_text_map);
+
+  json msg_json;
+  msg_json["req_id"] = req_id;
+  msg_json["post_id"] = post_id;
+  msg_json["user_id"] = user_id;
+  msg_json["timestamp"] = timestamp;
+  msg_json["user_mentions_id"] = user_mentions_id;
+  msg_json["carrier"] = writer_text_map;
+
+  auto rabbitmq_client_wrapper = _rabbitmq_client_pool->Pop();
+  if (!rabbitmq_client_wrapper) {
+    ServiceException se;
+    se.errorCode = ErrorCode::SE_RABBITMQ_CONN_ERROR;
+    se.message = "Failed to connect to home-timeline-rabbitmq";
+    LOG(error) << se.message;
+    throw se;
+  }
+  try {
+    rabbitmq_client_wrapper->Publish(msg_json.dump());
+  } catch (...) {
+    _rabbitmq_client_pool->Remove(rabbitmq_client_wrapper);
+    LOG(error) << "Failed to publish home timeline update to rabbitmq";
+    throw;
+  }
+  _rabbitmq_client_pool->Keepalive(rabbitmq_client_wrapper);
+
+  span->Finish();
+}
+
 void ComposePostHandler::ComposePost(
     const int64_t req_id, const std::string &username, int64_t user_id,
     const std::string &text, const std::vector<int64_t> &media_ids,
     const std::vector<std::string> &media_types, const PostType::type post_type,
     const std::map<std::string, std::string> &carrier) {
-  TextMapReader reader(carrier);
-  auto parent_span = opentracing::Tracer::Global()->Extract(reader);
-  auto span = opentracing::Tracer::Global()->StartSpan(
-      "compose_post_server", {opentracing::ChildOf(parent_span->get())});
   std::map<std::string, std::string> writer_text_map;
-  TextMapWriter writer(writer_text_map);
-  opentracing::Tracer::Global()->Inject(span->context(), writer);
+  auto span = StartSpanFromCarrier(
+      "compose_post_server", carrier, &writer_text_map);
 
-  auto text_future =
-      std::async(std::launch::async, &ComposePostHandler::_ComposeTextHelper,
-                 this, req_id, text, writer_text_map);
+  // All four requests are in flight before the first reply is read.
+  auto text_future = _ComposeTextHelper(req_id, text, writer_text_map);
   auto creator_future =
-      std::async(std::launch::async, &ComposePostHandler::_ComposeCreaterHelper,
-                 this, req_id, user_id, username, writer_text_map);
+      _ComposeCreaterHelper(req_id, user_id, username, writer_text_map);
   auto media_future =
-      std::async(std::launch::async, &ComposePostHandler::_ComposeMediaHelper,
-                 this, req_id, media_types, media_ids, writer_text_map);
-  auto unique_id_future = std::async(
-      std::launch::async, &ComposePostHandler::_ComposeUniqueIdHelper, this,
-      req_id, post_type, writer_text_map);
+      _ComposeMediaHelper(req_id, media_types, media_ids, writer_text_map);
+  auto unique_id_future =
+      _ComposeUniqueIdHelper(req_id, post_type, writer_text_map);
 
   Post post;
   auto timestamp =
@@ -417,13 +510,16 @@ void ComposePostHandler::ComposePost(
   //Change _UploadUserTimelineHelper and _UploadHomeTimelineHelper to deferred.
   //To let them start execute after post_future.get() return.
   auto post_future =
-      std::async(std::launch::async, &ComposePostHandler::_UploadPostHelper,
-                 this, req_id, post, writer_text_map);
+      _executor->Submit(&ComposePostHandler::_UploadPostHelper, this, req_id,
+                        post, writer_text_map);
   auto user_timeline_future = std::async(
       std::launch::deferred, &ComposePostHandler::_UploadUserTimelineHelper, this,
       req_id, post.post_id, user_id, timestamp, writer_text_map);
+  auto home_timeline_helper =
+      _rabbitmq_client_pool ? &ComposePostHandler::_PublishHomeTimelineHelper
+                            : &ComposePostHandler::_UploadHomeTimelineHelper;
   auto home_timeline_future = std::async(
-      std::launch::deferred, &ComposePostHandler::_UploadHomeTimelineHelper, this,
+      std::launch::deferred, home_timeline_helper, this,
       req_id, post.post_id, user_id, timestamp, user_mention_ids,
       writer_text_map);
 
@@ -1,17 +1,9 @@
 #include <signal.h>
-#include <thrift/protocol/TBinaryProtocol.h>
-#include <thrift/server/TThreadedServer.h>
-#include <thrift/transport/TBufferTransports.h>
-#include <thrift/transport/TServerSocket.h>
 
 #include "../utils.h"
 #include "../utils_thrift.h"
 #include "ComposePostHandler.h"
 
-using apache::thrift::protocol::TBinaryProtocolFactory;
-using apache::thrift::server::TThreadedServer;
-using apache::thrift::transport::TFramedTransportFactory;
-using apache::thrift::transport::TServerSocket;
 using namespace social_network;
 
 void sigintHandler(int sig) { exit(EXIT_SUCCESS); }
@@ -97,16 +89,50 @@ int main(int argc, char *argv[]) {
       "unique-id-service-client", unique_id_addr, unique_id_port, 0,
       unique_id_conns, unique_id_timeout, unique_id_keepalive, config_json);
 
-  std::shared_ptr<TServerSocket> server_socket = get_server_socket(config_json, "0.0.0.0", port);
-  TThreadedServer server(
-      std::make_shared<ComposePostServiceProcessor>(
-          std::make_shared<ComposePostHandler>(
-              &post_storage_client_pool, &user_timeline_client_pool,
-              &user_client_pool, &unique_id_client_pool, &media_client_pool,
-              &text_client_pool, &home_timeline_client_pool)),
-      server_socket,
-      std::make_shared<TFramedTransportFactory>(),
-      std::make_shared<TBinaryProtocolFactory>());
+  // "rpc" writes home timelines through home-timeline-service before
+  // replying, "rabbitmq" queues them for WriteHomeTimelineService.
+  std::string home_timeline_fanout =
+      config_json["compose-post-service"].value("home_timeline_fanout", "rpc");
+  std::unique_ptr<ClientPool<RabbitmqClient>> rabbitmq_client_pool;
+  if (home_timeline_fanout == "rabbitmq") {
+    int rabbitmq_port = config_json["write-home-timeline-rabbitmq"]["port"];
+    std::string rabbitmq_addr =
+        config_json["write-home-timeline-rabbitmq"]["addr"];
+    int rabbitmq_conns =
+        config_json["write-home-timeline-rabbitmq"]["connections"];
+    int rabbitmq_timeout =
+        config_json["write-home-timeline-rabbitmq"]["timeout_ms"];
+    int rabbitmq_keepalive =
+        config_json["write-home-timeline-rabbitmq"]["keepalive_ms"];
+    rabbitmq_client_pool.reset(new ClientPool<RabbitmqClient>(
+        "rabbitmq-client", rabbitmq_addr, rabbitmq_port, 0, rabbitmq_conns,
+        rabbitmq_timeout, rabbitmq_keepalive, config_json));
+  } else if (home_timeline_fanout != "rpc") {
+    LOG(fatal) << "Unknown home_timeline_fanout " << home_timeline_fanout;
+    exit(EXIT_FAILURE);
+  }
+
+  int executor_threads =
+      config_json["compose-post-service"].value("executor_threads", 16);
+  int executor_max_pending =
+      config_json["compose-post-service"].value("executor_max_pending", 256);
+  Executor executor(executor_threads, executor_max_pending);
+
+  auto handler = std::make_shared<ComposePostHandler>(
+      &post_storage_client_pool, &user_timeline_client_pool, &user_client_pool,
+      &unique_id_client_pool, &media_client_pool, &text_client_pool,
+      &home_timeline_client_pool, rabbitmq_client_pool.get(), &executor);
+  int elided_rpc_stats_interval_ms = config_json["compose-post-service"].value(
+      "elided_rpc_stats_interval_ms", 0);
+  if (elided_rpc_stats_interval_ms > 0) {
+    start_elided_rpc_stats_logger("compose-post-service",
+                                  handler->GetElidedRpcCounters(),
+                                  elided_rpc_stats_interval_ms);
+  }
+
+  auto server = get_server(
+      config_json, "compose-post-service",
+      std::make_shared<ComposePostServiceProcessor>(handler), port);
   LOG(info) << "Starting the compose-post-service server ...";
-  server.serve();
+  server->serve();
 }
\ No newline at end of file
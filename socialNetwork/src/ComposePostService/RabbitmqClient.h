@@ -3,13 +3,21 @@
 
 #include <SimpleAmqpClient/SimpleAmqpClient.h>
 
+#include <chrono>
+#include <nlohmann/json.hpp>
+
 #include "../GenericClient.h"
 
 namespace social_network {
+using json = nlohmann::json;
 
+// Publisher side of the write-home-timeline queue consumed by
+// WriteHomeTimelineService.
 class RabbitmqClient : public GenericClient {
  public:
   RabbitmqClient(const std::string &addr, int port);
+  RabbitmqClient(const std::string &addr, int port, int keepalive_ms,
+                 const json &config_json);
   RabbitmqClient(const RabbitmqClient &) = delete;
   RabbitmqClient &operator=(const RabbitmqClient &) = delete;
   RabbitmqClient(RabbitmqClient &&) = default;
@@ -19,15 +27,15 @@ class RabbitmqClient : public GenericClient {
 
   void Connect() override;
   void Disconnect() override;
-  void KeepAlive() override;
-  void KeepAlive(int timeout_ms) override;
   bool IsConnected() override;
 
+  // Publishes a persistent message, so queued fan-outs survive a broker
+  // restart.
+  void Publish(const std::string &body);
+
   AmqpClient::Channel::ptr_t GetChannel();
 
  private:
-  std::string _addr;
-  int _port;
   AmqpClient::Channel::ptr_t _channel;
   bool _is_connected;
 };
@@ -39,36 +47,38 @@ RabbitmqClient::RabbitmqClient(const std::string &addr, int port) {
   _is_connected = false;
 }
 
+RabbitmqClient::RabbitmqClient(const std::string &addr, int port,
+                               int keepalive_ms, const json &config_json)
+    : RabbitmqClient(addr, port) {
+  _connect_timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
+                           std::chrono::system_clock::now().time_since_epoch())
+                           .count();
+  _keepalive_ms = keepalive_ms;
+}
+
 RabbitmqClient::~RabbitmqClient() { Disconnect(); }
 
 void RabbitmqClient::Connect() {
   if (!IsConnected()) {
-    try {
-      _channel->DeclareQueue("write-home-timeline", false, true, false, false);
-    } catch (...) {
-      throw;
-    }
+    // Same durable queue as the one declared by the consumers.
+    _channel->DeclareQueue("write-home-timeline", false, true, false, false);
     _is_connected = true;
   }
 }
 
 void RabbitmqClient::Disconnect() {
-  if (IsConnected()) {
-    try {
-      _channel->DeleteQueue("write-home-timeline");
-      _is_connected = false;
-    } catch (...) {
-      throw;
-    }
-  }
+  // The queue outlives publishers, it may still hold unconsumed fan-outs.
+  _is_connected = false;
 }
 
-void RabbitmqClient::KeepAlive() {}
-
-void RabbitmqClient::KeepAlive(int timeout_ms) {}
-
 bool RabbitmqClient::IsConnected() { return _is_connected; }
 
+void RabbitmqClient::Publish(const std::string &body) {
+  auto message = AmqpClient::BasicMessage::Create(body);
+  message->DeliveryMode(AmqpClient::BasicMessage::dm_persistent);
+  _channel->BasicPublish("", "write-home-timeline", message);
+}
+
 AmqpClient::Channel::ptr_t RabbitmqClient::GetChannel() { return _channel; }
 
 }  // namespace social_network
@@ -0,0 +1,217 @@
+#ifndef SOCIAL_NETWORK_MICROSERVICES_EXECUTOR_H
+#define SOCIAL_NETWORK_MICROSERVICES_EXECUTOR_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "logger.h"
+
+namespace social_network {
+
+struct ExecutorStats {
+  uint64_t submitted;
+  uint64_t inline_runs;
+  uint64_t steals;
+  int pending;
+};
+
+// Fixed set of worker threads shared by all handler calls of a service, used
+// in place of std::async(std::launch::async, ...) on the request path.
+// Each worker owns a task deque and steals from the others when it runs dry.
+// Once max_pending tasks are queued, Submit() runs the task in the calling
+// thread instead, which bounds the number of concurrently running tasks and
+// applies back-pressure to the server threads under overload. Tasks submitted
+// from a worker are also run inline, so a task can wait on the futures of
+// tasks it submits without deadlocking the pool.
+//
+// Like the futures returned by std::async(std::launch::async, ...), dropping
+// a future returned by Submit() blocks until the task has finished, so tasks
+// may capture the caller's locals by reference even if the caller unwinds
+// before calling get().
+class Executor {
+ public:
+  Executor(int num_threads, int max_pending);
+  ~Executor();
+
+  Executor(const Executor &) = delete;
+  Executor &operator=(const Executor &) = delete;
+
+  template<class F, class... Args>
+  std::future<typename std::result_of<F(Args...)>::type> Submit(
+      F &&f, Args &&... args);
+
+  ExecutorStats GetStats() const;
+
+ private:
+  template<class R>
+  struct TaskJoin {
+    std::future<R> future;
+    ~TaskJoin() {
+      if (future.valid()) {
+        future.wait();
+      }
+    }
+  };
+
+  struct WorkerQueue {
+    std::mutex mtx;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  void _WorkerLoop(size_t idx);
+  bool _TryPop(size_t idx, std::function<void()> *task);
+  void _Enqueue(std::function<void()> task);
+  static Executor *&_CurrentExecutor();
+
+  std::vector<std::thread> _threads;
+  std::unique_ptr<WorkerQueue[]> _queues;
+  size_t _num_threads;
+  int _max_pending;
+
+  std::mutex _sleep_mtx;
+  std::condition_variable _cv;
+  std::atomic<int> _pending;
+  std::atomic<size_t> _next_queue;
+  bool _stop;
+
+  std::atomic<uint64_t> _submitted;
+  std::atomic<uint64_t> _inline_runs;
+  std::atomic<uint64_t> _steals;
+};
+
+Executor::Executor(int num_threads, int max_pending) {
+  _num_threads = num_threads > 0 ? num_threads : 1;
+  _max_pending = max_pending;
+  _queues.reset(new WorkerQueue[_num_threads]);
+  _pending.store(0);
+  _next_queue.store(0);
+  _stop = false;
+  _submitted.store(0);
+  _inline_runs.store(0);
+  _steals.store(0);
+  for (size_t i = 0; i < _num_threads; ++i) {
+    _threads.emplace_back(&Executor::_WorkerLoop, this, i);
+  }
+}
+
+Executor::~Executor() {
+  {
+    std::unique_lock<std::mutex> lock(_sleep_mtx);
+    _stop = true;
+  }
+  _cv.notify_all();
+  for (auto &thread : _threads) {
+    thread.join();
+  }
+}
+
+Executor *&Executor::_CurrentExecutor() {
+  static thread_local Executor *current = nullptr;
+  return current;
+}
+
+template<class F, class... Args>
+std::future<typename std::result_of<F(Args...)>::type> Executor::Submit(
+    F &&f, Args &&... args) {
+  using R = typename std::result_of<F(Args...)>::type;
+  // Arguments are copied like std::async does, so callers may pass locals.
+  auto task = std::make_shared<std::packaged_task<R()>>(
+      std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+  std::future<R> future = task->get_future();
+  _submitted.fetch_add(1, std::memory_order_relaxed);
+
+  if (_CurrentExecutor() == this ||
+      (_max_pending > 0 && _pending.load() >= _max_pending)) {
+    _inline_runs.fetch_add(1, std::memory_order_relaxed);
+    (*task)();
+    return future;
+  }
+
+  _Enqueue([task]() { (*task)(); });
+  auto join = std::make_shared<TaskJoin<R>>();
+  join->future = std::move(future);
+  return std::async(std::launch::deferred,
+                    [join]() { return join->future.get(); });
+}
+
+void Executor::_Enqueue(std::function<void()> task) {
+  size_t idx = _next_queue.fetch_add(1, std::memory_order_relaxed) %
+      _num_threads;
+  {
+    std::lock_guard<std::mutex> lock(_queues[idx].mtx);
+    _queues[idx].tasks.emplace_back(std::move(task));
+  }
+  _pending++;
+  {
+    // Pairs with the predicate check in _WorkerLoop so the wakeup is not lost.
+    std::lock_guard<std::mutex> lock(_sleep_mtx);
+  }
+  _cv.notify_one();
+}
+
+bool Executor::_TryPop(size_t idx, std::function<void()> *task) {
+  {
+    std::lock_guard<std::mutex> lock(_queues[idx].mtx);
+    if (!_queues[idx].tasks.empty()) {
+      *task = std::move(_queues[idx].tasks.front());
+      _queues[idx].tasks.pop_front();
+      _pending--;
+      return true;
+    }
+  }
+  for (size_t i = 1; i < _num_threads; ++i) {
+    WorkerQueue &victim = _queues[(idx + i) % _num_threads];
+    std::unique_lock<std::mutex> lock(victim.mtx, std::try_to_lock);
+    if (lock.owns_lock() && !victim.tasks.empty()) {
+      *task = std::move(victim.tasks.back());
+      victim.tasks.pop_back();
+      _pending--;
+      _steals.fetch_add(1, std::memory_order_relaxed);
+      return true;
+    }
+  }
+  return false;
+}
+
+void Executor::_WorkerLoop(size_t idx) {
+  _CurrentExecutor() = this;
+  while (true) {
+    std::function<void()> task;
+    if (_TryPop(idx, &task)) {
+      try {
+        task();
+      } catch (...) {
+        // packaged_task stores exceptions in the future, this only guards
+        // the worker against a throwing destructor.
+        LOG(error) << "Executor task threw an exception";
+      }
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(_sleep_mtx);
+    _cv.wait(lock, [this] { return _stop || _pending.load() > 0; });
+    if (_stop && _pending.load() == 0) {
+      return;
+    }
+  }
+}
+
+ExecutorStats Executor::GetStats() const {
+  ExecutorStats stats;
+  stats.submitted = _submitted.load(std::memory_order_relaxed);
+  stats.inline_runs = _inline_runs.load(std::memory_order_relaxed);
+  stats.steals = _steals.load(std::memory_order_relaxed);
+  stats.pending = _pending.load(std::memory_order_relaxed);
+  return stats;
+}
+
+} // namespace social_network
+
+#endif //SOCIAL_NETWORK_MICROSERVICES_EXECUTOR_H
@@ -1,37 +1,96 @@
 #ifndef SOCIAL_NETWORK_MICROSERVICES_SRC_HOMETIMELINESERVICE_HOMETIMELINEHANDLER_H_
 #define SOCIAL_NETWORK_MICROSERVICES_SRC_HOMETIMELINESERVICE_HOMETIMELINEHANDLER_H_
 
+#include <bson/bson.h>
+#include <mongoc.h>
 #include <sw/redis++/redis++.h>
 
+#include <algorithm>
+#include <chrono>
 #include <future>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <queue>
 #include <string>
+#include <tuple>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "../../gen-cpp/HomeTimelineService.h"
 #include "../../gen-cpp/PostStorageService.h"
 #include "../../gen-cpp/SocialGraphService.h"
 #include "../ClientPool.h"
 #include "../ThriftClient.h"
+#include "../TimelineCodec.h"
 #include "../logger.h"
 #include "../tracing.h"
+#include "../utils_bson.h"
 
 using namespace sw::redis;
 namespace social_network {
+
+// k-way merge of timelines sorted by descending timestamp. Returns the post
+// ids at ranks [start_idx, stop_idx) of the merged timeline, counting a post
+// present in several timelines once.
+std::vector<int64_t> MergeTimelines(
+    const std::vector<TimelineEntries> &timelines, int start_idx,
+    int stop_idx) {
+  // (timestamp, timeline index, position in that timeline)
+  using Head = std::tuple<double, size_t, size_t>;
+  std::priority_queue<Head> heads;
+  for (size_t i = 0; i < timelines.size(); ++i) {
+    if (!timelines[i].empty()) {
+      heads.emplace(timelines[i][0].second, i, 0);
+    }
+  }
+
+  std::vector<int64_t> post_ids;
+  std::unordered_set<int64_t> seen;
+  int rank = 0;
+  while (!heads.empty() && rank < stop_idx) {
+    size_t timeline_idx = std::get<1>(heads.top());
+    size_t pos = std::get<2>(heads.top());
+    heads.pop();
+    int64_t post_id = timelines[timeline_idx][pos].first;
+    if (seen.insert(post_id).second) {
+      if (rank >= start_idx) {
+        post_ids.emplace_back(post_id);
+      }
+      rank++;
+    }
+    if (++pos < timelines[timeline_idx].size()) {
+      heads.emplace(timelines[timeline_idx][pos].second, timeline_idx, pos);
+    }
+  }
+  return post_ids;
+}
+
+// The end of the Redis copy of a home timeline: how many posts it keeps and
+// the timestamp of the oldest of them. Older posts are only in MongoDB.
+struct TimelineTail {
+  int length;
+  double oldest_score;
+};
+
 class HomeTimelineHandler : public HomeTimelineServiceIf {
  public:
-  HomeTimelineHandler(Redis *,
+  HomeTimelineHandler(Redis *, mongoc_client_pool_t *,
                       ClientPool<ThriftClient<PostStorageServiceClient>> *,
-                      ClientPool<ThriftClient<SocialGraphServiceClient>> *);
+                      ClientPool<ThriftClient<SocialGraphServiceClient>> *,
+                      int, int, int);
 
 
-  HomeTimelineHandler(Redis *,Redis *,
+  HomeTimelineHandler(Redis *,Redis *, mongoc_client_pool_t *,
       ClientPool<ThriftClient<PostStorageServiceClient>>*,
-      ClientPool<ThriftClient<SocialGraphServiceClient>>*);
+      ClientPool<ThriftClient<SocialGraphServiceClient>>*, int, int, int);
 
 
-  HomeTimelineHandler(RedisCluster *,
+  HomeTimelineHandler(RedisCluster *, mongoc_client_pool_t *,
                       ClientPool<ThriftClient<PostStorageServiceClient>> *,
-                      ClientPool<ThriftClient<SocialGraphServiceClient>> *);
+                      ClientPool<ThriftClient<SocialGraphServiceClient>> *,
+                      int, int, int);
   ~HomeTimelineHandler() override = default;
 
   bool IsRedisReplicationEnabled();
@@ -48,48 +107,108 @@ class HomeTimelineHandler : public HomeTimelineServiceIf {
      Redis *_redis_primary_pool;
      Redis *_redis_client_pool;
      RedisCluster *_redis_cluster_client_pool;
+     // user-timeline MongoDB store, read when a page lies past the trimmed
+     // home timeline. nullptr if timelines are not trimmed.
+     mongoc_client_pool_t *_user_timeline_mongodb_pool;
      ClientPool<ThriftClient<PostStorageServiceClient>> *_post_client_pool;
      ClientPool<ThriftClient<SocialGraphServiceClient>> *_social_graph_client_pool;
+     // Hybrid fan-out: posts of accounts with more followers than this are
+     // written once to the author's pull timeline instead of to every
+     // follower's home timeline, and ReadHomeTimeline merges the pull
+     // timelines of the followed authors into the pushed one. Authors stay in
+     // the pull author set once they crossed the threshold, so posts already
+     // in their pull timeline remain visible. 0 always pushes.
+     int _fanout_follower_threshold;
+     // Number of newest posts kept in each timeline ZSet, 0 for no limit.
+     int _max_timeline_length;
+     // The pull author set is read by every ReadHomeTimeline, so it is kept
+     // in process for _pull_authors_ttl_ms (0 reads it from Redis each
+     // time). A new pull author's posts can then take that long to show up
+     // in the home timelines of its followers.
+     int _pull_authors_ttl_ms;
+     std::mutex _pull_authors_mtx;
+     std::shared_ptr<const std::unordered_set<std::string>> _pull_authors;
+     std::chrono::steady_clock::time_point _pull_authors_expiry;
+
+     void _GetFollowees(int64_t req_id, int64_t user_id,
+                        const opentracing::SpanContext &parent,
+                        std::vector<int64_t> *followees_id);
+     void _ReadHybridTimeline(int64_t req_id, int64_t user_id, int start_idx,
+                              int stop_idx,
+                              const opentracing::SpanContext &parent,
+                              std::vector<int64_t> *post_ids,
+                              TimelineTail *tail);
+     void _ReadTimelineTail(int64_t user_id,
+                            const opentracing::SpanContext &parent,
+                            TimelineTail *tail);
+     void _ReadMongoTimeline(int64_t req_id, int64_t user_id,
+                             const TimelineTail &tail, int start_idx,
+                             int stop_idx,
+                             const opentracing::SpanContext &parent,
+                             std::vector<int64_t> *post_ids);
+     std::shared_ptr<const std::unordered_set<std::string>>
+     _GetCachedPullAuthors();
+     void _CachePullAuthors(
+         std::shared_ptr<const std::unordered_set<std::string>> pull_authors);
 };
 
 HomeTimelineHandler::HomeTimelineHandler(
-    Redis *redis_pool,
+    Redis *redis_pool, mongoc_client_pool_t *user_timeline_mongodb_pool,
     ClientPool<ThriftClient<PostStorageServiceClient>> *post_client_pool,
     ClientPool<ThriftClient<SocialGraphServiceClient>>
-        *social_graph_client_pool) {
+        *social_graph_client_pool,
+    int fanout_follower_threshold, int max_timeline_length,
+    int pull_authors_ttl_ms) {
     _redis_primary_pool = nullptr;
     _redis_replica_pool = nullptr;
     _redis_client_pool = redis_pool;
     _redis_cluster_client_pool = nullptr;
+    _user_timeline_mongodb_pool = user_timeline_mongodb_pool;
     _post_client_pool = post_client_pool;
     _social_graph_client_pool = social_graph_client_pool;
+    _fanout_follower_threshold = fanout_follower_threshold;
+    _max_timeline_length = max_timeline_length;
+    _pull_authors_ttl_ms = pull_authors_ttl_ms;
 }
 
 HomeTimelineHandler::HomeTimelineHandler(
-    RedisCluster *redis_pool,
+    RedisCluster *redis_pool, mongoc_client_pool_t *user_timeline_mongodb_pool,
     ClientPool<ThriftClient<PostStorageServiceClient>> *post_client_pool,
     ClientPool<ThriftClient<SocialGraphServiceClient>>
-        *social_graph_client_pool) {
+        *social_graph_client_pool,
+    int fanout_follower_threshold, int max_timeline_length,
+    int pull_authors_ttl_ms) {
     _redis_primary_pool = nullptr;
     _redis_replica_pool = nullptr;
     _redis_client_pool = nullptr;
     _redis_cluster_client_pool = redis_pool; 
+    _user_timeline_mongodb_pool = user_timeline_mongodb_pool;
     _post_client_pool = post_client_pool;
     _social_graph_client_pool = social_graph_client_pool;
+    _fanout_follower_threshold = fanout_follower_threshold;
+    _max_timeline_length = max_timeline_length;
+    _pull_authors_ttl_ms = pull_authors_ttl_ms;
 }
 
 HomeTimelineHandler::HomeTimelineHandler(
     Redis *redis_replica_pool,
     Redis *redis_primary_pool,
+    mongoc_client_pool_t *user_timeline_mongodb_pool,
     ClientPool<ThriftClient<PostStorageServiceClient>>* post_client_pool,
     ClientPool<ThriftClient<SocialGraphServiceClient>>
-    * social_graph_client_pool) {
+    * social_graph_client_pool,
+    int fanout_follower_threshold, int max_timeline_length,
+    int pull_authors_ttl_ms) {
     _redis_primary_pool = redis_primary_pool;
     _redis_replica_pool = redis_replica_pool;
     _redis_client_pool = nullptr;
     _redis_cluster_client_pool = nullptr;
+    _user_timeline_mongodb_pool = user_timeline_mongodb_pool;
     _post_client_pool = post_client_pool;
     _social_graph_client_pool = social_graph_client_pool;
+    _fanout_follower_threshold = fanout_follower_threshold;
+    _max_timeline_length = max_timeline_length;
+    _pull_authors_ttl_ms = pull_authors_ttl_ms;
 }
 
 bool HomeTimelineHandler::IsRedisReplicationEnabled() {
@@ -101,17 +220,13 @@ void HomeTimelineHandler::WriteHomeTimeline(
     const std::vector<int64_t> &user_mentions_id,
     const std::map<std::string, std::string> &carrier) {
   // Initialize a span
-  TextMapReader reader(carrier);
-  auto parent_span = opentracing::Tracer::Global()->Extract(reader);
-  auto span = opentracing::Tracer::Global()->StartSpan(
-      "write_home_timeline_server", {opentracing::ChildOf(parent_span->get())});
+  auto span = StartSpanFromCarrier(
+      "write_home_timeline_server", carrier, nullptr);
 
   // Find followers of the user
-  auto followers_span = opentracing::Tracer::Global()->StartSpan(
-      "get_followers_client", {opentracing::ChildOf(&span->context())});
+  auto followers_span = StartChildSpan("get_followers_client", span->context());
   std::map<std::string, std::string> writer_text_map;
-  TextMapWriter writer(writer_text_map);
-  opentracing::Tracer::Global()->Inject(followers_span->context(), writer);
+  InjectSpan(*followers_span, &writer_text_map);
 
   auto social_graph_client_wrapper = _social_graph_client_pool->Pop();
   if (!social_graph_client_wrapper) {
@@ -133,22 +248,56 @@ void HomeTimelineHandler::WriteHomeTimeline(
   _social_graph_client_pool->Keepalive(social_graph_client_wrapper);
   followers_span->Finish();
 
-  std::set<int64_t> followers_id_set(followers_id.begin(), followers_id.end());
-  followers_id_set.insert(user_mentions_id.begin(), user_mentions_id.end());
+  // Mentioned users are always pushed to, followers only if the author is
+  // below the fan-out threshold.
+  bool pull = _fanout_follower_threshold > 0 &&
+      followers_id.size() > static_cast<size_t>(_fanout_follower_threshold);
+  std::set<int64_t> followers_id_set(user_mentions_id.begin(),
+                                     user_mentions_id.end());
+  if (!pull) {
+    followers_id_set.insert(followers_id.begin(), followers_id.end());
+  }
+  std::vector<std::string> timeline_keys;
+  for (auto &follower_id : followers_id_set) {
+    timeline_keys.emplace_back(std::to_string(follower_id));
+  }
+  if (pull) {
+    timeline_keys.emplace_back(PullTimelineKey(user_id));
+  }
 
   // Update Redis ZSet
   // Zset key: follower_id, Zset value: post_id_str, Zset score: timestamp_str
-  auto redis_span = opentracing::Tracer::Global()->StartSpan(
-      "write_home_timeline_redis_update_client",
-      {opentracing::ChildOf(&span->context())});
-  std::string post_id_str = std::to_string(post_id);
+  auto redis_span = StartChildSpan(
+      "write_home_timeline_redis_update_client", span->context());
+  std::string post_member = EncodeTimelineMember(post_id);
+
+  // Register the author before writing its pull timeline, so readers never
+  // miss a post that is only in the pull timeline.
+  if (pull) {
+    try {
+      if (_redis_client_pool) {
+        _redis_client_pool->sadd(PULL_AUTHORS_KEY, std::to_string(user_id));
+      } else if (IsRedisReplicationEnabled()) {
+        _redis_primary_pool->sadd(PULL_AUTHORS_KEY, std::to_string(user_id));
+      } else {
+        _redis_cluster_client_pool->sadd(PULL_AUTHORS_KEY,
+                                         std::to_string(user_id));
+      }
+    } catch (const Error &err) {
+      LOG(error) << err.what();
+      throw err;
+    }
+  }
 
   {
     if (_redis_client_pool) {
       auto pipe = _redis_client_pool->pipeline(false);
-      for (auto &follower_id : followers_id_set) {
-        pipe.zadd(std::to_string(follower_id), post_id_str, timestamp,
+      for (auto &timeline_key : timeline_keys) {
+        pipe.zadd(timeline_key, post_member, timestamp,
                   UpdateType::NOT_EXIST);
+        if (_max_timeline_length > 0) {
+          pipe.zremrangebyrank(timeline_key, 0, -_max_timeline_length - 1);
+        }
       }
       try {
         auto replies = pipe.exec();
@@ -160,9 +309,13 @@ void HomeTimelineHandler::WriteHomeTimeline(
     
     else if (IsRedisReplicationEnabled()) {
         auto pipe = _redis_primary_pool->pipeline(false);
-        for (auto& follower_id : followers_id_set) {
-            pipe.zadd(std::to_string(follower_id), post_id_str, timestamp,
+        for (auto& timeline_key : timeline_keys) {
+            pipe.zadd(timeline_key, post_member, timestamp,
                 UpdateType::NOT_EXIST);
+            if (_max_timeline_length > 0) {
+                pipe.zremrangebyrank(timeline_key, 0,
+                                     -_max_timeline_length - 1);
+            }
         }
         try {
             auto replies = pipe.exec();
@@ -178,20 +331,26 @@ void HomeTimelineHandler::WriteHomeTimeline(
       std::map<std::shared_ptr<ConnectionPool>, std::shared_ptr<Pipeline>> pipe_map;
       auto *shards_pool = _redis_cluster_client_pool->get_shards_pool();
 
-      for (auto &follower_id : followers_id_set) {
-        auto conn = shards_pool->fetch(std::to_string(follower_id));
+      for (auto &timeline_key : timeline_keys) {
+        auto conn = shards_pool->fetch(timeline_key);
         auto pipe = pipe_map.find(conn);
         if(pipe == pipe_map.end()) {//Not found, create new pipeline and insert
-          auto new_pipe = std::make_shared<Pipeline>(_redis_cluster_client_pool->pipeline(std::to_string(follower_id), false));
+          auto new_pipe = std::make_shared<Pipeline>(_redis_cluster_client_pool->pipeline(timeline_key, false));
           pipe_map.insert(make_pair(conn, new_pipe));
           auto *_pipe = new_pipe.get();
-          _pipe->zadd(std::to_string(follower_id), post_id_str, timestamp,
+          _pipe->zadd(timeline_key, post_member, timestamp,
                   UpdateType::NOT_EXIST);
+          if (_max_timeline_length > 0) {
+            _pipe->zremrangebyrank(timeline_key, 0, -_max_timeline_length - 1);
+          }
         }else{//Found, use exist pipeline
           std::pair<std::shared_ptr<ConnectionPool>, std::shared_ptr<Pipeline>> found = *pipe;
           auto *_pipe = found.second.get();
-          _pipe->zadd(std::to_string(follower_id), post_id_str, timestamp,
+          _pipe->zadd(timeline_key, post_member, timestamp,
                   UpdateType::NOT_EXIST);
+          if (_max_timeline_length > 0) {
+            _pipe->zremrangebyrank(timeline_key, 0, -_max_timeline_length - 1);
+          }
         }
       }
       // LOG(info) <<"followers_id_set items:" << followers_id_set.size()<<"; pipeline items:" << pipe_map.size();
@@ -215,49 +374,73 @@ void HomeTimelineHandler::ReadHomeTimeline(
     std::vector<Post> &_return, int64_t req_id, int64_t user_id, int start_idx,
     int stop_idx, const std::map<std::string, std::string> &carrier) {
   // Initialize a span
-  TextMapReader reader(carrier);
   std::map<std::string, std::string> writer_text_map;
-  TextMapWriter writer(writer_text_map);
-  auto parent_span = opentracing::Tracer::Global()->Extract(reader);
-  auto span = opentracing::Tracer::Global()->StartSpan(
-      "read_home_timeline_server", {opentracing::ChildOf(parent_span->get())});
-  opentracing::Tracer::Global()->Inject(span->context(), writer);
+  auto span = StartSpanFromCarrier(
+      "read_home_timeline_server", carrier, &writer_text_map);
 
   if (stop_idx <= start_idx || start_idx < 0) {
     return;
   }
 
-  auto redis_span = opentracing::Tracer::Global()->StartSpan(
-      "read_home_timeline_redis_find_client",
-      {opentracing::ChildOf(&span->context())});
+  // Pages past the trimmed ZSets continue in the user-timeline store. Redis
+  // holds the whole page unless a read below finds the timeline shorter.
+  bool read_tail = _user_timeline_mongodb_pool && _max_timeline_length > 0 &&
+                   stop_idx > _max_timeline_length;
+  TimelineTail tail = {stop_idx, 0};
 
-  std::vector<std::string> post_ids_str;
-  try {
-    if (_redis_client_pool) {
-      _redis_client_pool->zrevrange(std::to_string(user_id), start_idx,
-                                    stop_idx - 1,
-                                    std::back_inserter(post_ids_str));
-    }
-    else if (IsRedisReplicationEnabled()) {
-        _redis_replica_pool->zrevrange(std::to_string(user_id), start_idx,
-                                       stop_idx - 1,
-                                       std::back_inserter(post_ids_str));
-    }
+  std::vector<int64_t> post_ids;
+  if (_fanout_follower_threshold > 0) {
+    _ReadHybridTimeline(req_id, user_id, start_idx, stop_idx, span->context(),
+                        &post_ids, read_tail ? &tail : nullptr);
+  } else {
+    auto redis_span = StartChildSpan(
+        "read_home_timeline_redis_find_client", span->context());
+
+    std::vector<std::string> post_ids_str;
+    try {
+      if (_redis_client_pool) {
+        _redis_client_pool->zrevrange(std::to_string(user_id), start_idx,
+                                      stop_idx - 1,
+                                      std::back_inserter(post_ids_str));
+      }
+      else if (IsRedisReplicationEnabled()) {
+          _redis_replica_pool->zrevrange(std::to_string(user_id), start_idx,
+                                         stop_idx - 1,
+                                         std::back_inserter(post_ids_str));
+      }
     
-    else {
-      _redis_cluster_client_pool->zrevrange(std::to_string(user_id), start_idx,
-                                            stop_idx - 1,
-                                            std::back_inserter(post_ids_str));
+      else {
+        _redis_cluster_client_pool->zrevrange(
+            std::to_string(user_id), start_idx, stop_idx - 1,
+            std::back_inserter(post_ids_str));
+      }
+    } catch (const Error &err) {
+      LOG(error) << err.what();
+      throw err;
+    }
+    redis_span->Finish();
+
+    DecodeTimelineMembers(post_ids_str, &post_ids);
+    if (read_tail &&
+        static_cast<int>(post_ids.size()) < stop_idx - start_idx) {
+      _ReadTimelineTail(user_id, span->context(), &tail);
     }
-  } catch (const Error &err) {
-    LOG(error) << err.what();
-    throw err;
   }
-  redis_span->Finish();
 
-  std::vector<int64_t> post_ids;
-  for (auto &post_id_str : post_ids_str) {
-    post_ids.emplace_back(std::stoul(post_id_str));
+  // MongoDB ranks count from the oldest post kept in Redis, which new posts
+  // do not move, so the two parts of a page neither overlap nor leave gaps.
+  if (read_tail && tail.length < stop_idx) {
+    std::vector<int64_t> mongo_post_ids;
+    _ReadMongoTimeline(req_id, user_id, tail,
+                       std::max(start_idx - tail.length, 0),
+                       stop_idx - tail.length, span->context(),
+                       &mongo_post_ids);
+    for (auto &post_id : mongo_post_ids) {
+      if (std::find(post_ids.begin(), post_ids.end(), post_id) ==
+          post_ids.end()) {
+        post_ids.emplace_back(post_id);
+      }
+    }
   }
 
   auto post_client_wrapper = _post_client_pool->Pop();
@@ -279,6 +462,298 @@ void HomeTimelineHandler::ReadHomeTimeline(
   span->Finish();
 }
 
+void HomeTimelineHandler::_GetFollowees(
+    int64_t req_id, int64_t user_id, const opentracing::SpanContext &parent,
+    std::vector<int64_t> *followees_id) {
+  auto followees_span = StartChildSpan("get_followees_client", parent);
+  std::map<std::string, std::string> writer_text_map;
+  InjectSpan(*followees_span, &writer_text_map);
+
+  auto social_graph_client_wrapper = _social_graph_client_pool->Pop();
+  if (!social_graph_client_wrapper) {
+    ServiceException se;
+    se.errorCode = ErrorCode::SE_THRIFT_CONN_ERROR;
+    se.message = "Failed to connect to social-graph-service";
+    throw se;
+  }
+  auto social_graph_client = social_graph_client_wrapper->GetClient();
+  try {
+    social_graph_client->GetFollowees(*followees_id, req_id, user_id,
+                                      writer_text_map);
+  } catch (...) {
+    LOG(error) << "Failed to get followees from social-network-service";
+    _social_graph_client_pool->Remove(social_graph_client_wrapper);
+    throw;
+  }
+  _social_graph_client_pool->Keepalive(social_graph_client_wrapper);
+  followees_span->Finish();
+}
+
+// Returns the cached pull author set, or nullptr if it has expired or
+// caching is off.
+std::shared_ptr<const std::unordered_set<std::string>>
+HomeTimelineHandler::_GetCachedPullAuthors() {
+  if (_pull_authors_ttl_ms <= 0) {
+    return nullptr;
+  }
+  std::lock_guard<std::mutex> lock(_pull_authors_mtx);
+  if (!_pull_authors ||
+      std::chrono::steady_clock::now() >= _pull_authors_expiry) {
+    return nullptr;
+  }
+  return _pull_authors;
+}
+
+void HomeTimelineHandler::_CachePullAuthors(
+    std::shared_ptr<const std::unordered_set<std::string>> pull_authors) {
+  if (_pull_authors_ttl_ms <= 0) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(_pull_authors_mtx);
+  _pull_authors = std::move(pull_authors);
+  _pull_authors_expiry = std::chrono::steady_clock::now() +
+      std::chrono::milliseconds(_pull_authors_ttl_ms);
+}
+
+void HomeTimelineHandler::_ReadHybridTimeline(
+    int64_t req_id, int64_t user_id, int start_idx, int stop_idx,
+    const opentracing::SpanContext &parent, std::vector<int64_t> *post_ids,
+    TimelineTail *tail) {
+  // Every timeline contributes at most its stop_idx newest posts to the
+  // merged ranks [start_idx, stop_idx).
+  std::vector<std::vector<std::pair<std::string, double>>> members(1);
+  auto pull_authors = _GetCachedPullAuthors();
+  std::unordered_set<std::string> fetched_pull_authors;
+  Redis *redis =
+      _redis_client_pool ? _redis_client_pool : _redis_replica_pool;
+
+  auto redis_span = StartChildSpan(
+      "read_home_timeline_redis_find_client", parent);
+  try {
+    if (redis) {
+      auto pipe = redis->pipeline(false);
+      pipe.zrevrange(std::to_string(user_id), 0, stop_idx - 1, true);
+      if (!pull_authors) {
+        pipe.smembers(PULL_AUTHORS_KEY);
+      }
+      auto replies = pipe.exec();
+      replies.get(0, std::back_inserter(members[0]));
+      if (!pull_authors) {
+        replies.get(1, std::inserter(fetched_pull_authors,
+                                     fetched_pull_authors.end()));
+      }
+    } else {
+      _redis_cluster_client_pool->zrevrange(
+          std::to_string(user_id), 0, stop_idx - 1,
+          std::back_inserter(members[0]));
+      if (!pull_authors) {
+        _redis_cluster_client_pool->smembers(
+            PULL_AUTHORS_KEY, std::inserter(fetched_pull_authors,
+                                            fetched_pull_authors.end()));
+      }
+    }
+  } catch (const Error &err) {
+    LOG(error) << err.what();
+    throw err;
+  }
+  if (!pull_authors) {
+    pull_authors = std::make_shared<const std::unordered_set<std::string>>(
+        std::move(fetched_pull_authors));
+    _CachePullAuthors(pull_authors);
+  }
+  redis_span->Finish();
+
+  // Only readers that follow at least one pull author pay for the followee
+  // lookup and the extra ZSet reads.
+  std::vector<std::string> pull_keys;
+  if (!pull_authors->empty()) {
+    std::vector<int64_t> followees_id;
+    _GetFollowees(req_id, user_id, parent, &followees_id);
+    for (auto &followee_id : followees_id) {
+      if (pull_authors->count(std::to_string(followee_id))) {
+        pull_keys.emplace_back(PullTimelineKey(followee_id));
+      }
+    }
+  }
+
+  if (!pull_keys.empty()) {
+    auto pull_span = StartChildSpan(
+        "read_home_timeline_redis_pull_client", parent);
+    members.resize(1 + pull_keys.size());
+    try {
+      if (redis) {
+        auto pipe = redis->pipeline(false);
+        for (auto &pull_key : pull_keys) {
+          pipe.zrevrange(pull_key, 0, stop_idx - 1, true);
+        }
+        auto replies = pipe.exec();
+        for (size_t i = 0; i < pull_keys.size(); ++i) {
+          replies.get(i, std::back_inserter(members[i + 1]));
+        }
+      } else {
+        // Pull timelines live on different slots, so they cannot share a
+        // cluster pipeline.
+        for (size_t i = 0; i < pull_keys.size(); ++i) {
+          _redis_cluster_client_pool->zrevrange(
+              pull_keys[i], 0, stop_idx - 1,
+              std::back_inserter(members[i + 1]));
+        }
+      }
+    } catch (const Error &err) {
+      LOG(error) << err.what();
+      throw err;
+    }
+    pull_span->Finish();
+  }
+
+  std::vector<TimelineEntries> timelines(members.size());
+  for (size_t i = 0; i < members.size(); ++i) {
+    DecodeTimelineEntries(members[i], &timelines[i]);
+  }
+
+  // If the merge is shorter than the page every timeline was read whole.
+  // Below the newest of their oldest posts some of them may have been
+  // trimmed, so those posts are left to MongoDB.
+  if (tail && static_cast<int>(MergeTimelines(timelines, 0, stop_idx).size()) <
+                  stop_idx) {
+    tail->oldest_score = 0;
+    for (auto &timeline : timelines) {
+      if (!timeline.empty()) {
+        tail->oldest_score =
+            std::max(tail->oldest_score, timeline.back().second);
+      }
+    }
+    for (auto &timeline : timelines) {
+      while (!timeline.empty() &&
+             timeline.back().second < tail->oldest_score) {
+        timeline.pop_back();
+      }
+    }
+    tail->length = MergeTimelines(timelines, 0, stop_idx).size();
+  }
+  *post_ids = MergeTimelines(timelines, start_idx, stop_idx);
+}
+
+void HomeTimelineHandler::_ReadTimelineTail(
+    int64_t user_id, const opentracing::SpanContext &parent,
+    TimelineTail *tail) {
+  std::string key = std::to_string(user_id);
+  Redis *redis =
+      _redis_client_pool ? _redis_client_pool : _redis_replica_pool;
+  long long length;
+  std::vector<std::pair<std::string, double>> oldest;
+
+  auto redis_span = StartChildSpan(
+      "read_home_timeline_redis_tail_client", parent);
+  try {
+    auto pipe = redis ? redis->pipeline(false)
+                      : _redis_cluster_client_pool->pipeline(key, false);
+    auto replies = pipe.zcard(key).zrange(key, 0, 0, true).exec();
+    length = replies.get<long long>(0);
+    replies.get(1, std::back_inserter(oldest));
+  } catch (const Error &err) {
+    LOG(error) << err.what();
+    throw err;
+  }
+  redis_span->Finish();
+
+  tail->length = static_cast<int>(length);
+  tail->oldest_score = oldest.empty() ? 0 : oldest[0].second;
+}
+
+// Reads ranks [start_idx, stop_idx) of the posts older than the tail of the
+// Redis timeline, or of all posts if Redis holds none.
+void HomeTimelineHandler::_ReadMongoTimeline(
+    int64_t req_id, int64_t user_id, const TimelineTail &tail, int start_idx,
+    int stop_idx, const opentracing::SpanContext &parent,
+    std::vector<int64_t> *post_ids) {
+  // The home timeline is the merge of the user timelines of the followees,
+  // whose documents keep posts newest first.
+  std::vector<int64_t> followees_id;
+  _GetFollowees(req_id, user_id, parent, &followees_id);
+  if (followees_id.empty()) {
+    return;
+  }
+
+  mongoc_client_t *mongodb_client =
+      mongoc_client_pool_pop(_user_timeline_mongodb_pool);
+  if (!mongodb_client) {
+    ServiceException se;
+    se.errorCode = ErrorCode::SE_MONGODB_ERROR;
+    se.message = "Failed to pop a client from MongoDB pool";
+    throw se;
+  }
+  auto collection = mongoc_client_get_collection(
+      mongodb_client, "user-timeline", "user-timeline");
+  if (!collection) {
+    ServiceException se;
+    se.errorCode = ErrorCode::SE_MONGODB_ERROR;
+    se.message = "Failed to create collection user-timeline from MongoDB";
+    mongoc_client_pool_push(_user_timeline_mongodb_pool, mongodb_client);
+    throw se;
+  }
+
+  bson_t *query = bson_new();
+  bson_t query_child;
+  bson_t query_user_id_list;
+  const char *key;
+  char buf[16];
+  BSON_APPEND_DOCUMENT_BEGIN(query, "user_id", &query_child);
+  BSON_APPEND_ARRAY_BEGIN(&query_child, "$in", &query_user_id_list);
+  uint32_t idx = 0;
+  for (auto &followee_id : followees_id) {
+    bson_uint32_to_string(idx, &key, buf, sizeof buf);
+    BSON_APPEND_INT64(&query_user_id_list, key, followee_id);
+    idx++;
+  }
+  bson_append_array_end(&query_child, &query_user_id_list);
+  bson_append_document_end(query, &query_child);
+  bson_t *opts;
+  if (tail.length > 0) {
+    opts = BCON_NEW(
+        "projection", "{", "posts", "{", "$slice", "[", "{", "$filter", "{",
+        "input", BCON_UTF8("$posts"), "cond", "{", "$lt", "[",
+        BCON_UTF8("$$this.timestamp"),
+        BCON_INT64(static_cast<int64_t>(tail.oldest_score)), "]", "}", "}",
+        "}", BCON_INT32(stop_idx), "]", "}", "}");
+  } else {
+    opts = BCON_NEW("projection", "{", "posts", "{", "$slice", "[",
+                    BCON_INT32(0), BCON_INT32(stop_idx), "]", "}", "}");
+  }
+
+  auto find_span = StartChildSpan("home_timeline_mongo_find_client", parent);
+  mongoc_cursor_t *cursor =
+      mongoc_collection_find_with_opts(collection, query, opts, nullptr);
+  std::vector<TimelineEntries> timelines;
+  const bson_t *doc;
+  while (mongoc_cursor_next(cursor, &doc)) {
+    timelines.emplace_back();
+    auto &timeline = timelines.back();
+    ForEachTimestampedId(doc, "posts", "post_id",
+                         [&](int64_t post_id, int64_t timestamp) {
+                           timeline.emplace_back(
+                               post_id, static_cast<double>(timestamp));
+                         });
+  }
+  bson_error_t error;
+  bool failed = mongoc_cursor_error(cursor, &error);
+  find_span->Finish();
+  bson_destroy(opts);
+  bson_destroy(query);
+  mongoc_cursor_destroy(cursor);
+  mongoc_collection_destroy(collection);
+  mongoc_client_pool_push(_user_timeline_mongodb_pool, mongodb_client);
+  if (failed) {
+    LOG(error) << error.message;
+    ServiceException se;
+    se.errorCode = ErrorCode::SE_MONGODB_ERROR;
+    se.message = error.message;
+    throw se;
+  }
+
+  *post_ids = MergeTimelines(timelines, start_idx, stop_idx);
+}
+
 }  // namespace social_network
 
 #endif  // SOCIAL_NETWORK_MICROSERVICES_SRC_HOMETIMELINESERVICE_HOMETIMELINEHANDLER_H_
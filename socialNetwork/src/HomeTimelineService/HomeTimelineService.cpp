@@ -1,8 +1,4 @@
 #include <signal.h>
-#include <thrift/protocol/TBinaryProtocol.h>
-#include <thrift/server/TThreadedServer.h>
-#include <thrift/transport/TBufferTransports.h>
-#include <thrift/transport/TServerSocket.h>
 
 #include <boost/program_options.hpp>
 
@@ -10,14 +6,11 @@
 #include "../logger.h"
 #include "../tracing.h"
 #include "../utils.h"
+#include "../utils_mongodb.h"
 #include "../utils_redis.h"
 #include "../utils_thrift.h"
 #include "HomeTimelineHandler.h"
 
-using apache::thrift::protocol::TBinaryProtocolFactory;
-using apache::thrift::server::TThreadedServer;
-using apache::thrift::transport::TFramedTransportFactory;
-using apache::thrift::transport::TServerSocket;
 using namespace social_network;
 
 void sigintHandler(int sig) { exit(EXIT_SUCCESS); }
@@ -62,6 +55,29 @@ int main(int argc, char *argv[]) {
 
   int redis_replica_config_flag = config_json["home-timeline-redis"]["use_replica"];
 
+  // Posts of accounts with more followers than this are pulled at read time
+  // instead of pushed to every follower, 0 always pushes.
+  int fanout_follower_threshold = config_json["home-timeline-service"].value(
+      "fanout_follower_threshold", 0);
+  // Readers reuse the pull author set fetched in the last
+  // pull_authors_ttl_ms, 0 fetches it on every read.
+  int pull_authors_ttl_ms = config_json["home-timeline-service"].value(
+      "pull_authors_ttl_ms", 1000);
+
+  // Timeline ZSets keep their newest max_timeline_length posts, 0 keeps all.
+  // Older pages are read from the user-timeline MongoDB store.
+  int max_timeline_length = config_json["home-timeline-service"].value(
+      "max_timeline_length", 0);
+  mongoc_client_pool_t *user_timeline_mongodb_pool = nullptr;
+  if (max_timeline_length > 0) {
+    int mongodb_conns = config_json["user-timeline-mongodb"]["connections"];
+    user_timeline_mongodb_pool = init_mongodb_client_pool(
+        config_json, "user-timeline", mongodb_conns);
+    if (user_timeline_mongodb_pool == nullptr) {
+      return EXIT_FAILURE;
+    }
+  }
+
   int post_storage_port = config_json["post-storage-service"]["port"];
   std::string post_storage_addr = config_json["post-storage-service"]["addr"];
   int post_storage_conns = config_json["post-storage-service"]["connections"];
@@ -91,25 +107,25 @@ int main(int argc, char *argv[]) {
       social_graph_conns, social_graph_timeout, social_graph_keepalive,
       config_json);
 
-  std::shared_ptr<TServerSocket> server_socket =
-      get_server_socket(config_json, "0.0.0.0", port);
-
 
   if (redis_replica_config_flag) {
           Redis redis_replica_client_pool = init_redis_replica_client_pool(config_json, "redis-replica");
           Redis redis_primary_client_pool = init_redis_replica_client_pool(config_json, "redis-primary");
 
-          TThreadedServer server(
+          auto server = get_server(
+              config_json, "home-timeline-service",
               std::make_shared<HomeTimelineServiceProcessor>(
                   std::make_shared<HomeTimelineHandler>(&redis_replica_client_pool,
                       &redis_primary_client_pool,
+                      user_timeline_mongodb_pool,
                       &post_storage_client_pool,
-                      &social_graph_client_pool)),
-              server_socket, std::make_shared<TFramedTransportFactory>(),
-              std::make_shared<TBinaryProtocolFactory>());
+                      &social_graph_client_pool,
+                      fanout_follower_threshold, max_timeline_length,
+                      pull_authors_ttl_ms)),
+              port);
 
           LOG(info) << "Starting the home-timeline-service server with replicated Redis support...";
-          server.serve();
+          server->serve();
 
       
   }
@@ -117,28 +133,36 @@ int main(int argc, char *argv[]) {
   else if (redis_cluster_flag || redis_cluster_config_flag) {
     RedisCluster redis_cluster_client_pool =
         init_redis_cluster_client_pool(config_json, "home-timeline");
-    TThreadedServer server(
+    auto server = get_server(
+        config_json, "home-timeline-service",
         std::make_shared<HomeTimelineServiceProcessor>(
             std::make_shared<HomeTimelineHandler>(&redis_cluster_client_pool,
+                                                  user_timeline_mongodb_pool,
                                                   &post_storage_client_pool,
-                                                  &social_graph_client_pool)),
-        server_socket, std::make_shared<TFramedTransportFactory>(),
-        std::make_shared<TBinaryProtocolFactory>());
+                                                  &social_graph_client_pool,
+                                                  fanout_follower_threshold,
+                                                  max_timeline_length,
+                                                  pull_authors_ttl_ms)),
+        port);
 
     LOG(info) << "Starting the home-timeline-service server with Redis Cluster support...";
-    server.serve();
+    server->serve();
   } else {
     Redis redis_client_pool =
         init_redis_client_pool(config_json, "home-timeline");
-    TThreadedServer server(
+    auto server = get_server(
+        config_json, "home-timeline-service",
         std::make_shared<HomeTimelineServiceProcessor>(
             std::make_shared<HomeTimelineHandler>(&redis_client_pool,
+                                                  user_timeline_mongodb_pool,
                                                   &post_storage_client_pool,
-                                                  &social_graph_client_pool)),
-        server_socket, std::make_shared<TFramedTransportFactory>(),
-        std::make_shared<TBinaryProtocolFactory>());
+                                                  &social_graph_client_pool,
+                                                  fanout_follower_threshold,
+                                                  max_timeline_length,
+                                                  pull_authors_ttl_ms)),
+        port);
 
     LOG(info) << "Starting the home-timeline-service server...";
-    server.serve();
+    server->serve();
   }
 }
\ No newline at end of file
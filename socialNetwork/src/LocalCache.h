@@ -0,0 +1,255 @@
+#ifndef SOCIAL_NETWORK_MICROSERVICES_LOCALCACHE_H
+#define SOCIAL_NETWORK_MICROSERVICES_LOCALCACHE_H
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "logger.h"
+
+namespace social_network {
+
+struct LocalCacheStats {
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t evictions;
+  uint64_t expirations;
+  int64_t entries;
+  int64_t bytes;
+};
+
+// In-process cache of immutable values shared through shared_ptr<const V>,
+// so a hit costs one hash lookup under a shard lock and no copy of the value.
+// The key space is split over independently locked shards and each shard
+// holds at most capacity_bytes / num_shards bytes, as reported by the caller
+// on Put(). Eviction is CLOCK: a hit sets the entry's reference bit and the
+// hand evicts the first entry whose bit is clear, clearing bits as it passes.
+// Entries older than ttl_ms are dropped on lookup or when the hand reaches
+// them; ttl_ms <= 0 disables expiry.
+template<class TKey, class TValue, class THash = std::hash<TKey>>
+class LocalCache {
+ public:
+  LocalCache(size_t capacity_bytes, int num_shards, int ttl_ms);
+
+  LocalCache(const LocalCache &) = delete;
+  LocalCache &operator=(const LocalCache &) = delete;
+
+  std::shared_ptr<const TValue> Get(const TKey &key);
+  void Put(const TKey &key, std::shared_ptr<const TValue> value, size_t bytes);
+
+  LocalCacheStats GetStats() const;
+
+ private:
+  struct Slot {
+    TKey key;
+    std::shared_ptr<const TValue> value;
+    size_t bytes;
+    int64_t expire_ms;
+    bool referenced;
+    bool used;
+  };
+
+  struct Shard {
+    std::mutex mtx;
+    std::unordered_map<TKey, size_t, THash> index;
+    std::vector<Slot> slots;
+    std::vector<size_t> free_slots;
+    size_t hand;
+    size_t bytes;
+  };
+
+  Shard &_GetShard(const TKey &key);
+  bool _EvictOne(Shard *shard, int64_t now_ms);
+  void _Erase(Shard *shard, size_t slot_idx);
+  static int64_t _NowMs();
+
+  std::unique_ptr<Shard[]> _shards;
+  size_t _num_shards;
+  size_t _shard_capacity;
+  int _ttl_ms;
+  THash _hash;
+
+  std::atomic<uint64_t> _hits;
+  std::atomic<uint64_t> _misses;
+  std::atomic<uint64_t> _evictions;
+  std::atomic<uint64_t> _expirations;
+  std::atomic<int64_t> _entries;
+  std::atomic<int64_t> _bytes;
+};
+
+template<class TKey, class TValue, class THash>
+LocalCache<TKey, TValue, THash>::LocalCache(size_t capacity_bytes,
+                                            int num_shards, int ttl_ms) {
+  _num_shards = num_shards > 0 ? num_shards : 1;
+  _shard_capacity = capacity_bytes / _num_shards;
+  _ttl_ms = ttl_ms;
+  _shards.reset(new Shard[_num_shards]);
+  for (size_t i = 0; i < _num_shards; ++i) {
+    _shards[i].hand = 0;
+    _shards[i].bytes = 0;
+  }
+  _hits.store(0);
+  _misses.store(0);
+  _evictions.store(0);
+  _expirations.store(0);
+  _entries.store(0);
+  _bytes.store(0);
+}
+
+template<class TKey, class TValue, class THash>
+int64_t LocalCache<TKey, TValue, THash>::_NowMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+template<class TKey, class TValue, class THash>
+typename LocalCache<TKey, TValue, THash>::Shard &
+LocalCache<TKey, TValue, THash>::_GetShard(const TKey &key) {
+  // Mix the hash so that identity hashes of sequential ids spread evenly.
+  uint64_t h = static_cast<uint64_t>(_hash(key)) * 0x9E3779B97F4A7C15ULL;
+  return _shards[(h >> 32) % _num_shards];
+}
+
+template<class TKey, class TValue, class THash>
+void LocalCache<TKey, TValue, THash>::_Erase(Shard *shard, size_t slot_idx) {
+  Slot &slot = shard->slots[slot_idx];
+  shard->index.erase(slot.key);
+  shard->bytes -= slot.bytes;
+  _bytes -= slot.bytes;
+  _entries--;
+  slot.value.reset();
+  slot.used = false;
+  shard->free_slots.emplace_back(slot_idx);
+}
+
+template<class TKey, class TValue, class THash>
+bool LocalCache<TKey, TValue, THash>::_EvictOne(Shard *shard,
+                                                int64_t now_ms) {
+  size_t num_slots = shard->slots.size();
+  // Two sweeps are enough: the first clears every reference bit it passes.
+  for (size_t i = 0; i < 2 * num_slots; ++i) {
+    size_t slot_idx = shard->hand;
+    shard->hand = (shard->hand + 1) % num_slots;
+    Slot &slot = shard->slots[slot_idx];
+    if (!slot.used) {
+      continue;
+    }
+    if (_ttl_ms > 0 && slot.expire_ms <= now_ms) {
+      _Erase(shard, slot_idx);
+      _expirations++;
+      return true;
+    }
+    if (slot.referenced) {
+      slot.referenced = false;
+      continue;
+    }
+    _Erase(shard, slot_idx);
+    _evictions++;
+    return true;
+  }
+  return false;
+}
+
+template<class TKey, class TValue, class THash>
+std::shared_ptr<const TValue> LocalCache<TKey, TValue, THash>::Get(
+    const TKey &key) {
+  Shard &shard = _GetShard(key);
+  std::lock_guard<std::mutex> lock(shard.mtx);
+  auto it = shard.index.find(key);
+  if (it == shard.index.end()) {
+    _misses++;
+    return nullptr;
+  }
+  Slot &slot = shard.slots[it->second];
+  if (_ttl_ms > 0 && slot.expire_ms <= _NowMs()) {
+    _Erase(&shard, it->second);
+    _expirations++;
+    _misses++;
+    return nullptr;
+  }
+  slot.referenced = true;
+  _hits++;
+  return slot.value;
+}
+
+template<class TKey, class TValue, class THash>
+void LocalCache<TKey, TValue, THash>::Put(
+    const TKey &key, std::shared_ptr<const TValue> value, size_t bytes) {
+  if (bytes > _shard_capacity) {
+    return;
+  }
+  int64_t now_ms = _NowMs();
+  Shard &shard = _GetShard(key);
+  std::lock_guard<std::mutex> lock(shard.mtx);
+
+  auto it = shard.index.find(key);
+  if (it != shard.index.end()) {
+    _Erase(&shard, it->second);
+  }
+  while (shard.bytes + bytes > _shard_capacity && _EvictOne(&shard, now_ms)) {
+  }
+
+  size_t slot_idx;
+  if (!shard.free_slots.empty()) {
+    slot_idx = shard.free_slots.back();
+    shard.free_slots.pop_back();
+  } else {
+    slot_idx = shard.slots.size();
+    shard.slots.emplace_back();
+  }
+  Slot &slot = shard.slots[slot_idx];
+  slot.key = key;
+  slot.value = std::move(value);
+  slot.bytes = bytes;
+  slot.expire_ms = now_ms + _ttl_ms;
+  // Entries start unreferenced so one-off reads are evicted before entries
+  // that were hit since the hand last passed.
+  slot.referenced = false;
+  slot.used = true;
+  shard.index.emplace(key, slot_idx);
+  shard.bytes += bytes;
+  _bytes += bytes;
+  _entries++;
+}
+
+template<class TKey, class TValue, class THash>
+LocalCacheStats LocalCache<TKey, TValue, THash>::GetStats() const {
+  LocalCacheStats stats;
+  stats.hits = _hits.load();
+  stats.misses = _misses.load();
+  stats.evictions = _evictions.load();
+  stats.expirations = _expirations.load();
+  stats.entries = _entries.load();
+  stats.bytes = _bytes.load();
+  return stats;
+}
+
+template<class TKey, class TValue, class THash>
+void start_local_cache_stats_logger(const std::string &cache_name,
+                                    LocalCache<TKey, TValue, THash> *cache,
+                                    int interval_ms) {
+  std::thread([cache_name, cache, interval_ms]() {
+    while (true) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(interval_ms));
+      LocalCacheStats stats = cache->GetStats();
+      uint64_t lookups = stats.hits + stats.misses;
+      double hit_ratio =
+          lookups > 0 ? static_cast<double>(stats.hits) / lookups : 0;
+      LOG(info) << cache_name << " cache stats: hits=" << stats.hits
+                << " misses=" << stats.misses << " hit_ratio=" << hit_ratio
+                << " evictions=" << stats.evictions
+                << " expirations=" << stats.expirations
+                << " entries=" << stats.entries << " bytes=" << stats.bytes;
+    }
+  }).detach();
+}
+
+} // namespace social_network
+
+#endif //SOCIAL_NETWORK_MICROSERVICES_LOCALCACHE_H
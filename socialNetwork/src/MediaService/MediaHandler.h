@@ -33,13 +33,9 @@ void MediaHandler::ComposeMedia(
     const std::vector<int64_t> &media_ids,
     const std::map<std::string, std::string> &carrier) {
   // Initialize a span
-  TextMapReader reader(carrier);
   std::map<std::string, std::string> writer_text_map;
-  TextMapWriter writer(writer_text_map);
-  auto parent_span = opentracing::Tracer::Global()->Extract(reader);
-  auto span = opentracing::Tracer::Global()->StartSpan(
-      "compose_media_server", {opentracing::ChildOf(parent_span->get())});
-  opentracing::Tracer::Global()->Inject(span->context(), writer);
+  auto span = StartSpanFromCarrier(
+      "compose_media_server", carrier, &writer_text_map);
 
   if (media_types.size() != media_ids.size()) {
     ServiceException se;
@@ -1,17 +1,9 @@
 #include <signal.h>
-#include <thrift/protocol/TBinaryProtocol.h>
-#include <thrift/server/TThreadedServer.h>
-#include <thrift/transport/TBufferTransports.h>
-#include <thrift/transport/TServerSocket.h>
 
 #include "../utils.h"
 #include "../utils_thrift.h"
 #include "MediaHandler.h"
 
-using apache::thrift::protocol::TBinaryProtocolFactory;
-using apache::thrift::server::TThreadedServer;
-using apache::thrift::transport::TFramedTransportFactory;
-using apache::thrift::transport::TServerSocket;
 using namespace social_network;
 
 void sigintHandler(int sig) { exit(EXIT_SUCCESS); }
@@ -26,14 +18,12 @@ int main(int argc, char *argv[]) {
   }
 
   int port = config_json["media-service"]["port"];
-  std::shared_ptr<TServerSocket> server_socket = get_server_socket(config_json, "0.0.0.0", port);
 
-  TThreadedServer server(
+  auto server = get_server(
+      config_json, "media-service",
       std::make_shared<MediaServiceProcessor>(std::make_shared<MediaHandler>()),
-      server_socket,
-      std::make_shared<TFramedTransportFactory>(),
-      std::make_shared<TBinaryProtocolFactory>());
+      port);
 
   LOG(info) << "Starting the media-service server...";
-  server.serve();
+  server->serve();
 }
@@ -0,0 +1,65 @@
+#ifndef SOCIAL_NETWORK_MICROSERVICES_PENDINGREPLY_H
+#define SOCIAL_NETWORK_MICROSERVICES_PENDINGREPLY_H
+
+#include <future>
+#include <memory>
+#include <utility>
+
+#include "ClientPool.h"
+
+namespace social_network {
+
+// Holds a pooled client whose reply has not been read yet. Thrift servers
+// answer one request per connection at a time, so the client goes back to
+// the pool only once the reply is read. If it never is, the connection is
+// removed rather than reused with the reply still queued on it.
+template<class TClient>
+class PendingReply {
+ public:
+  PendingReply(ClientPool<TClient> *pool, TClient *client)
+      : _pool(pool), _client(client) {}
+  ~PendingReply() {
+    if (_client) {
+      _pool->Remove(_client);
+    }
+  }
+
+  PendingReply(const PendingReply &) = delete;
+  PendingReply &operator=(const PendingReply &) = delete;
+
+  TClient *GetClient() const { return _client; }
+
+  void Release() {
+    _pool->Keepalive(_client);
+    _client = nullptr;
+  }
+
+ private:
+  ClientPool<TClient> *_pool;
+  TClient *_client;
+};
+
+// Calls send on client and returns a deferred future that calls recv, so a
+// handler can send all of its downstream requests before waiting on any
+// reply. The pool owns client again once this returns: it is kept if recv
+// succeeds and removed if send or recv throws or the future is dropped.
+template<class TReturn, class TClient, class TSend, class TRecv>
+std::future<TReturn> SendRequest(ClientPool<TClient> *pool, TClient *client,
+                                 TSend &&send, TRecv recv) {
+  auto pending = std::make_shared<PendingReply<TClient>>(pool, client);
+  send(client->GetClient());
+  return std::async(std::launch::deferred, [pending, recv]() mutable {
+    try {
+      TReturn result = recv(pending->GetClient()->GetClient());
+      pending->Release();
+      return result;
+    } catch (...) {
+      pending.reset();
+      throw;
+    }
+  });
+}
+
+} // namespace social_network
+
+#endif //SOCIAL_NETWORK_MICROSERVICES_PENDINGREPLY_H
@@ -0,0 +1,124 @@
+#ifndef SOCIAL_NETWORK_MICROSERVICES_SRC_POSTSTORAGESERVICE_POSTCACHECODEC_H_
+#define SOCIAL_NETWORK_MICROSERVICES_SRC_POSTSTORAGESERVICE_POSTCACHECODEC_H_
+
+#include <thrift/Thrift.h>
+#include <thrift/protocol/TCompactProtocol.h>
+#include <thrift/transport/TBufferTransports.h>
+
+#include <memory>
+#include <nlohmann/json.hpp>
+#include <string>
+
+#include "../../gen-cpp/social_network_types.h"
+#include "../logger.h"
+
+namespace social_network {
+using json = nlohmann::json;
+using apache::thrift::TException;
+using apache::thrift::protocol::TCompactProtocolT;
+using apache::thrift::transport::TMemoryBuffer;
+
+// Memcached values written by PostStorageService are a version byte followed
+// by the Post encoded with TCompactProtocol. Values written before the format
+// existed are the bson_as_json() text of the post document and always start
+// with '{', which never collides with a version byte.
+const uint8_t POST_CACHE_FORMAT_COMPACT_V1 = 0x01;
+
+void PostFromJson(const json &post_json, Post *post) {
+  post->req_id = post_json.at("req_id");
+  post->timestamp = post_json.at("timestamp");
+  post->post_id = post_json.at("post_id");
+  post->creator.user_id = post_json.at("creator").at("user_id");
+  post->creator.username = post_json.at("creator").at("username");
+  post->post_type = post_json.at("post_type");
+  post->text = post_json.at("text");
+  for (auto &item : post_json.at("media")) {
+    Media media;
+    media.media_id = item.at("media_id");
+    media.media_type = item.at("media_type");
+    post->media.emplace_back(media);
+  }
+  for (auto &item : post_json.at("user_mentions")) {
+    UserMention user_mention;
+    user_mention.username = item.at("username");
+    user_mention.user_id = item.at("user_id");
+    post->user_mentions.emplace_back(user_mention);
+  }
+  for (auto &item : post_json.at("urls")) {
+    Url url;
+    url.shortened_url = item.at("shortened_url");
+    url.expanded_url = item.at("expanded_url");
+    post->urls.emplace_back(url);
+  }
+}
+
+// Rough heap footprint of a decoded Post, used to bound the in-process cache.
+size_t ApproximatePostSize(const Post &post) {
+  size_t size = sizeof(Post) + post.text.capacity() +
+      post.creator.username.capacity();
+  size += post.user_mentions.capacity() * sizeof(UserMention);
+  for (auto &user_mention : post.user_mentions) {
+    size += user_mention.username.capacity();
+  }
+  size += post.media.capacity() * sizeof(Media);
+  for (auto &media : post.media) {
+    size += media.media_type.capacity();
+  }
+  size += post.urls.capacity() * sizeof(Url);
+  for (auto &url : post.urls) {
+    size += url.shortened_url.capacity() + url.expanded_url.capacity();
+  }
+  return size;
+}
+
+std::string EncodePostCacheValue(const Post &post) {
+  // The buffer keeps its capacity across calls, so steady-state encoding
+  // only allocates the returned string.
+  static thread_local auto buffer = std::make_shared<TMemoryBuffer>();
+  static thread_local TCompactProtocolT<TMemoryBuffer> protocol(buffer);
+  buffer->resetBuffer();
+  buffer->write(&POST_CACHE_FORMAT_COMPACT_V1, 1);
+  post.write(&protocol);
+
+  uint8_t *data;
+  uint32_t size;
+  buffer->getBuffer(&data, &size);
+  return std::string(reinterpret_cast<const char *>(data), size);
+}
+
+// Decodes a cached value into an empty Post. Returns false if the value is
+// not in a known format or is corrupted, in which case the caller should
+// treat it as a cache miss.
+bool DecodePostCacheValue(const char *value, size_t size, Post *post) {
+  if (size == 0) {
+    return false;
+  }
+  try {
+    if (value[0] == '{') {
+      PostFromJson(json::parse(value, value + size), post);
+      return true;
+    }
+    if (static_cast<uint8_t>(value[0]) != POST_CACHE_FORMAT_COMPACT_V1) {
+      LOG(warning) << "Unknown post cache format "
+                   << static_cast<int>(static_cast<uint8_t>(value[0]));
+      return false;
+    }
+    // Reads the value in place instead of copying it into the buffer.
+    static thread_local auto buffer = std::make_shared<TMemoryBuffer>();
+    static thread_local TCompactProtocolT<TMemoryBuffer> protocol(buffer);
+    buffer->resetBuffer(
+        reinterpret_cast<uint8_t *>(const_cast<char *>(value)) + 1,
+        static_cast<uint32_t>(size - 1), TMemoryBuffer::OBSERVE);
+    post->read(&protocol);
+    return true;
+  } catch (const TException &e) {
+    LOG(warning) << "Failed to decode cached post: " << e.what();
+  } catch (const json::exception &e) {
+    LOG(warning) << "Failed to decode cached post: " << e.what();
+  }
+  return false;
+}
+
+}  // namespace social_network
+
+#endif  // SOCIAL_NETWORK_MICROSERVICES_SRC_POSTSTORAGESERVICE_POSTCACHECODEC_H_
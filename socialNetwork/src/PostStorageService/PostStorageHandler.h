@@ -12,15 +12,22 @@
 #include <string>
 
 #include "../../gen-cpp/PostStorageService.h"
+#include "../Executor.h"
+#include "../LocalCache.h"
+#include "../SingleFlight.h"
 #include "../logger.h"
 #include "../tracing.h"
+#include "../utils_bson.h"
+#include "PostCacheCodec.h"
 
 namespace social_network {
 using json = nlohmann::json;
 
 class PostStorageHandler : public PostStorageServiceIf {
  public:
-  PostStorageHandler(memcached_pool_st *, mongoc_client_pool_t *);
+  PostStorageHandler(memcached_pool_st *, mongoc_client_pool_t *,
+                     Executor *, LocalCache<int64_t, Post> *,
+                     bool write_through_memcached, bool write_through_local);
   ~PostStorageHandler() override = default;
 
   void StorePost(int64_t req_id, const Post &post,
@@ -36,26 +43,80 @@ class PostStorageHandler : public PostStorageServiceIf {
  private:
   memcached_pool_st *_memcached_client_pool;
   mongoc_client_pool_t *_mongodb_client_pool;
+  Executor *_executor;
+  // Optional in-process cache in front of memcached, nullptr if disabled.
+  LocalCache<int64_t, Post> *_post_cache;
+  // Whether StorePost also populates memcached and the in-process cache, so
+  // the first read of a freshly composed post does not miss.
+  bool _write_through_memcached;
+  bool _write_through_local;
+
+  // MongoDB lookups of posts missing from the caches, keyed by post_id.
+  using PostFlight = SingleFlight<int64_t, Post>;
+  PostFlight _post_flight;
+
+  void _PutLocalCache(const Post &post);
+  void _WriteThroughMemcached(const Post &post,
+                              const opentracing::SpanContext &parent);
 };
 
 PostStorageHandler::PostStorageHandler(
     memcached_pool_st *memcached_client_pool,
-    mongoc_client_pool_t *mongodb_client_pool) {
+    mongoc_client_pool_t *mongodb_client_pool, Executor *executor,
+    LocalCache<int64_t, Post> *post_cache, bool write_through_memcached,
+    bool write_through_local) {
   _memcached_client_pool = memcached_client_pool;
   _mongodb_client_pool = mongodb_client_pool;
+  _executor = executor;
+  _post_cache = post_cache;
+  _write_through_memcached = write_through_memcached;
+  _write_through_local = write_through_local;
+}
+
+void PostStorageHandler::_PutLocalCache(const Post &post) {
+  if (_post_cache) {
+    _post_cache->Put(post.post_id, std::make_shared<const Post>(post),
+                     ApproximatePostSize(post));
+  }
+}
+
+void PostStorageHandler::_WriteThroughMemcached(
+    const Post &post, const opentracing::SpanContext &parent) {
+  memcached_return_t memcached_rc;
+  memcached_st *memcached_client =
+      memcached_pool_pop(_memcached_client_pool, true, &memcached_rc);
+  if (!memcached_client) {
+    // The post is already stored, readers fall back to MongoDB.
+    LOG(warning) << "Failed to pop a client from memcached pool";
+    return;
+  }
+  auto set_span = StartChildSpan("post_storage_mmc_set_client", parent);
+  std::string post_id_str = std::to_string(post.post_id);
+  std::string post_cache_value = EncodePostCacheValue(post);
+  // Sent with noreply so StorePost does not wait for memcached to answer.
+  // Pooled clients are shared by the read paths, which need replies, so the
+  // behavior is reset before the client goes back to the pool.
+  memcached_behavior_set(memcached_client, MEMCACHED_BEHAVIOR_NOREPLY, 1);
+  memcached_rc = memcached_set(
+      memcached_client, post_id_str.c_str(), post_id_str.length(),
+      post_cache_value.c_str(), post_cache_value.length(),
+      static_cast<time_t>(0), static_cast<uint32_t>(0));
+  memcached_behavior_set(memcached_client, MEMCACHED_BEHAVIOR_NOREPLY, 0);
+  if (memcached_failed(memcached_rc)) {
+    LOG(warning) << "Failed to write post through to Memcached: "
+                 << memcached_strerror(memcached_client, memcached_rc);
+  }
+  set_span->Finish();
+  memcached_pool_push(_memcached_client_pool, memcached_client);
 }
 
 void PostStorageHandler::StorePost(
     int64_t req_id, const social_network::Post &post,
     const std::map<std::string, std::string> &carrier) {
   // Initialize a span
-  TextMapReader reader(carrier);
   std::map<std::string, std::string> writer_text_map;
-  TextMapWriter writer(writer_text_map);
-  auto parent_span = opentracing::Tracer::Global()->Extract(reader);
-  auto span = opentracing::Tracer::Global()->StartSpan(
-      "store_post_server", {opentracing::ChildOf(parent_span->get())});
-  opentracing::Tracer::Global()->Inject(span->context(), writer);
+  auto span = StartSpanFromCarrier(
+      "store_post_server", carrier, &writer_text_map);
 
   mongoc_client_t *mongodb_client =
       mongoc_client_pool_pop(_mongodb_client_pool);
@@ -136,9 +197,8 @@ void PostStorageHandler::StorePost(
   bson_append_array_end(new_doc, &media_list);
 
   bson_error_t error;
-  auto insert_span = opentracing::Tracer::Global()->StartSpan(
-      "post_storage_mongo_insert_client",
-      {opentracing::ChildOf(&span->context())});
+  auto insert_span = StartChildSpan(
+      "post_storage_mongo_insert_client", span->context());
   bool inserted = mongoc_collection_insert_one(collection, new_doc, nullptr,
                                                nullptr, &error);
   insert_span->Finish();
@@ -158,6 +218,14 @@ void PostStorageHandler::StorePost(
   mongoc_collection_destroy(collection);
   mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
 
+  // Populate the caches only once the post is durable in MongoDB.
+  if (_write_through_local) {
+    _PutLocalCache(post);
+  }
+  if (_write_through_memcached) {
+    _WriteThroughMemcached(post, span->context());
+  }
+
   span->Finish();
 }
 
@@ -165,13 +233,18 @@ void PostStorageHandler::ReadPost(
     Post &_return, int64_t req_id, int64_t post_id,
     const std::map<std::string, std::string> &carrier) {
   // Initialize a span
-  TextMapReader reader(carrier);
   std::map<std::string, std::string> writer_text_map;
-  TextMapWriter writer(writer_text_map);
-  auto parent_span = opentracing::Tracer::Global()->Extract(reader);
-  auto span = opentracing::Tracer::Global()->StartSpan(
-      "read_post_server", {opentracing::ChildOf(parent_span->get())});
-  opentracing::Tracer::Global()->Inject(span->context(), writer);
+  auto span = StartSpanFromCarrier(
+      "read_post_server", carrier, &writer_text_map);
+
+  if (_post_cache) {
+    auto cached_post = _post_cache->Get(post_id);
+    if (cached_post) {
+      _return = *cached_post;
+      span->Finish();
+      return;
+    }
+  }
 
   std::string post_id_str = std::to_string(post_id);
 
@@ -187,8 +260,8 @@ void PostStorageHandler::ReadPost(
 
   size_t post_mmc_size;
   uint32_t memcached_flags;
-  auto get_span = opentracing::Tracer::Global()->StartSpan(
-      "post_storage_mmc_get_client", {opentracing::ChildOf(&span->context())});
+  auto get_span = StartChildSpan(
+      "post_storage_mmc_get_client", span->context());
   char *post_mmc =
       memcached_get(memcached_client, post_id_str.c_str(), post_id_str.length(),
                     &post_mmc_size, &memcached_flags, &memcached_rc);
@@ -202,124 +275,95 @@ void PostStorageHandler::ReadPost(
   memcached_pool_push(_memcached_client_pool, memcached_client);
   get_span->Finish();
 
+  Post cached_post;
+  bool cache_hit = false;
   if (post_mmc) {
-    LOG(debug) << "Get post " << post_id << " cache hit from Memcached";
-    json post_json =
-        json::parse(std::string(post_mmc, post_mmc + post_mmc_size));
-    _return.req_id = post_json["req_id"];
-    _return.timestamp = post_json["timestamp"];
-    _return.post_id = post_json["post_id"];
-    _return.creator.user_id = post_json["creator"]["user_id"];
-    _return.creator.username = post_json["creator"]["username"];
-    _return.post_type = post_json["post_type"];
-    _return.text = post_json["text"];
-    for (auto &item : post_json["media"]) {
-      Media media;
-      media.media_id = item["media_id"];
-      media.media_type = item["media_type"];
-      _return.media.emplace_back(media);
-    }
-    for (auto &item : post_json["user_mentions"]) {
-      UserMention user_mention;
-      user_mention.username = item["username"];
-      user_mention.user_id = item["user_id"];
-      _return.user_mentions.emplace_back(user_mention);
-    }
-    for (auto &item : post_json["urls"]) {
-      Url url;
-      url.shortened_url = item["shortened_url"];
-      url.expanded_url = item["expanded_url"];
-      _return.urls.emplace_back(url);
-    }
+    cache_hit = DecodePostCacheValue(post_mmc, post_mmc_size, &cached_post);
     free(post_mmc);
-  } else {
-    // If not cached in memcached
-    mongoc_client_t *mongodb_client =
-        mongoc_client_pool_pop(_mongodb_client_pool);
-    if (!mongodb_client) {
-      ServiceException se;
-      se.errorCode = ErrorCode::SE_MONGODB_ERROR;
-      se.message = "Failed to pop a client from MongoDB pool";
-      throw se;
-    }
+  }
 
-    auto collection =
-        mongoc_client_get_collection(mongodb_client, "post", "post");
-    if (!collection) {
-      ServiceException se;
-      se.errorCode = ErrorCode::SE_MONGODB_ERROR;
-      se.message = "Failed to create collection user from DB user";
-      mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
-      throw se;
-    }
+  if (cache_hit) {
+    LOG(debug) << "Get post " << post_id << " cache hit from Memcached";
+    _PutLocalCache(cached_post);
+    _return = std::move(cached_post);
+  } else {
+    // If not cached in memcached. Concurrent misses of the same post wait
+    // for a single MongoDB lookup and only its leader writes the post back.
+    bool leader;
+    _return = _post_flight.Do(post_id, [&]() -> Post {
+      Post post;
+      mongoc_client_t *mongodb_client =
+          mongoc_client_pool_pop(_mongodb_client_pool);
+      if (!mongodb_client) {
+        ServiceException se;
+        se.errorCode = ErrorCode::SE_MONGODB_ERROR;
+        se.message = "Failed to pop a client from MongoDB pool";
+        throw se;
+      }
 
-    bson_t *query = bson_new();
-    BSON_APPEND_INT64(query, "post_id", post_id);
-    auto find_span = opentracing::Tracer::Global()->StartSpan(
-        "post_storage_mongo_find_client",
-        {opentracing::ChildOf(&span->context())});
-    mongoc_cursor_t *cursor =
-        mongoc_collection_find_with_opts(collection, query, nullptr, nullptr);
-    const bson_t *doc;
-    bool found = mongoc_cursor_next(cursor, &doc);
-    find_span->Finish();
-    if (!found) {
-      bson_error_t error;
-      if (mongoc_cursor_error(cursor, &error)) {
-        LOG(warning) << error.message;
-        bson_destroy(query);
-        mongoc_cursor_destroy(cursor);
-        mongoc_collection_destroy(collection);
-        mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
+      auto collection =
+          mongoc_client_get_collection(mongodb_client, "post", "post");
+      if (!collection) {
         ServiceException se;
         se.errorCode = ErrorCode::SE_MONGODB_ERROR;
-        se.message = error.message;
+        se.message = "Failed to create collection user from DB user";
+        mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
         throw se;
+      }
+
+      bson_t *query = bson_new();
+      BSON_APPEND_INT64(query, "post_id", post_id);
+      auto find_span = StartChildSpan(
+          "post_storage_mongo_find_client", span->context());
+      mongoc_cursor_t *cursor = mongoc_collection_find_with_opts(
+          collection, query, nullptr, nullptr);
+      const bson_t *doc;
+      bool found = mongoc_cursor_next(cursor, &doc);
+      find_span->Finish();
+      if (!found) {
+        bson_error_t error;
+        if (mongoc_cursor_error(cursor, &error)) {
+          LOG(warning) << error.message;
+          bson_destroy(query);
+          mongoc_cursor_destroy(cursor);
+          mongoc_collection_destroy(collection);
+          mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
+          ServiceException se;
+          se.errorCode = ErrorCode::SE_MONGODB_ERROR;
+          se.message = error.message;
+          throw se;
+        } else {
+          LOG(warning) << "Post_id: " << post_id
+                       << " doesn't exist in MongoDB";
+          bson_destroy(query);
+          mongoc_cursor_destroy(cursor);
+          mongoc_collection_destroy(collection);
+          mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
+          ServiceException se;
+          se.errorCode = ErrorCode::SE_THRIFT_HANDLER_ERROR;
+          se.message = "Post_id: " + std::to_string(post_id) +
+                       " doesn't exist in MongoDB";
+          throw se;
+        }
       } else {
-        LOG(warning) << "Post_id: " << post_id << " doesn't exist in MongoDB";
+        LOG(debug) << "Post_id: " << post_id << " found in MongoDB";
+        bool decoded = BsonToPost(doc, &post);
         bson_destroy(query);
         mongoc_cursor_destroy(cursor);
         mongoc_collection_destroy(collection);
         mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
-        ServiceException se;
-        se.errorCode = ErrorCode::SE_THRIFT_HANDLER_ERROR;
-        se.message =
-            "Post_id: " + std::to_string(post_id) + " doesn't exist in MongoDB";
-        throw se;
-      }
-    } else {
-      LOG(debug) << "Post_id: " << post_id << " found in MongoDB";
-      auto post_json_char = bson_as_json(doc, nullptr);
-      json post_json = json::parse(post_json_char);
-      _return.req_id = post_json["req_id"];
-      _return.timestamp = post_json["timestamp"];
-      _return.post_id = post_json["post_id"];
-      _return.creator.user_id = post_json["creator"]["user_id"];
-      _return.creator.username = post_json["creator"]["username"];
-      _return.post_type = post_json["post_type"];
-      _return.text = post_json["text"];
-      for (auto &item : post_json["media"]) {
-        Media media;
-        media.media_id = item["media_id"];
-        media.media_type = item["media_type"];
-        _return.media.emplace_back(media);
-      }
-      for (auto &item : post_json["user_mentions"]) {
-        UserMention user_mention;
-        user_mention.username = item["username"];
-        user_mention.user_id = item["user_id"];
-        _return.user_mentions.emplace_back(user_mention);
-      }
-      for (auto &item : post_json["urls"]) {
-        Url url;
-        url.shortened_url = item["shortened_url"];
-        url.expanded_url = item["expanded_url"];
-        _return.urls.emplace_back(url);
+        if (!decoded) {
+          ServiceException se;
+          se.errorCode = ErrorCode::SE_MONGODB_ERROR;
+          se.message = "Attribute of MongoDB item is not complete";
+          throw se;
+        }
+        return post;
       }
-      bson_destroy(query);
-      mongoc_cursor_destroy(cursor);
-      mongoc_collection_destroy(collection);
-      mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
+    }, &leader);
+
+    if (leader) {
+      _PutLocalCache(_return);
 
       // upload post to memcached
       memcached_client =
@@ -330,20 +374,19 @@ void PostStorageHandler::ReadPost(
         se.message = "Failed to pop a client from memcached pool";
         throw se;
       }
-      auto set_span = opentracing::Tracer::Global()->StartSpan(
-          "post_storage_mmc_set_client",
-          {opentracing::ChildOf(&span->context())});
+      auto set_span = StartChildSpan(
+          "post_storage_mmc_set_client", span->context());
 
+      std::string post_cache_value = EncodePostCacheValue(_return);
       memcached_rc = memcached_set(
           memcached_client, post_id_str.c_str(), post_id_str.length(),
-          post_json_char, std::strlen(post_json_char), static_cast<time_t>(0),
-          static_cast<uint32_t>(0));
+          post_cache_value.c_str(), post_cache_value.length(),
+          static_cast<time_t>(0), static_cast<uint32_t>(0));
       if (memcached_rc != MEMCACHED_SUCCESS) {
         LOG(warning) << "Failed to set post to Memcached: "
                      << memcached_strerror(memcached_client, memcached_rc);
       }
       set_span->Finish();
-      bson_free(post_json_char);
       memcached_pool_push(_memcached_client_pool, memcached_client);
     }
   }
@@ -355,14 +398,9 @@ void PostStorageHandler::ReadPosts(
     const std::vector<int64_t> &post_ids,
     const std::map<std::string, std::string> &carrier) {
   // Initialize a span
-  TextMapReader reader(carrier);
   std::map<std::string, std::string> writer_text_map;
-  TextMapWriter writer(writer_text_map);
-  auto parent_span = opentracing::Tracer::Global()->Extract(reader);
-  auto span = opentracing::Tracer::Global()->StartSpan(
-      "post_storage_read_posts_server",
-      {opentracing::ChildOf(parent_span->get())});
-  opentracing::Tracer::Global()->Inject(span->context(), writer);
+  auto span = StartSpanFromCarrier(
+      "post_storage_read_posts_server", carrier, &writer_text_map);
 
   if (post_ids.empty()) {
     return;
@@ -377,208 +415,213 @@ void PostStorageHandler::ReadPosts(
     throw se;
   }
   std::map<int64_t, Post> return_map;
-  memcached_return_t memcached_rc;
-  auto memcached_client =
-      memcached_pool_pop(_memcached_client_pool, true, &memcached_rc);
-  if (!memcached_client) {
-    ServiceException se;
-    se.errorCode = ErrorCode::SE_MEMCACHED_ERROR;
-    se.message = "Failed to pop a client from memcached pool";
-    throw se;
-  }
-
-  char **keys;
-  size_t *key_sizes;
-  keys = new char *[post_ids.size()];
-  key_sizes = new size_t[post_ids.size()];
   int idx = 0;
-  for (auto &post_id : post_ids) {
-    std::string key_str = std::to_string(post_id);
-    keys[idx] = new char[key_str.length() + 1];
-    strcpy(keys[idx], key_str.c_str());
-    key_sizes[idx] = key_str.length();
-    idx++;
-  }
-  memcached_rc =
-      memcached_mget(memcached_client, keys, key_sizes, post_ids.size());
-  if (memcached_rc != MEMCACHED_SUCCESS) {
-    LOG(error) << "Cannot get post_ids of request " << req_id << ": "
-               << memcached_strerror(memcached_client, memcached_rc);
-    ServiceException se;
-    se.errorCode = ErrorCode::SE_MEMCACHED_ERROR;
-    se.message = memcached_strerror(memcached_client, memcached_rc);
-    memcached_pool_push(_memcached_client_pool, memcached_client);
-    throw se;
-  }
 
-  char return_key[MEMCACHED_MAX_KEY];
-  size_t return_key_length;
-  char *return_value;
-  size_t return_value_length;
-  uint32_t flags;
-  auto get_span = opentracing::Tracer::Global()->StartSpan(
-      "post_storage_mmc_mget_client", {opentracing::ChildOf(&span->context())});
-
-  while (true) {
-    return_value =
-        memcached_fetch(memcached_client, return_key, &return_key_length,
-                        &return_value_length, &flags, &memcached_rc);
-    if (return_value == nullptr) {
-      LOG(debug) << "Memcached mget finished";
-      break;
-    }
-    if (memcached_rc != MEMCACHED_SUCCESS) {
-      free(return_value);
-      memcached_quit(memcached_client);
-      memcached_pool_push(_memcached_client_pool, memcached_client);
-      LOG(error) << "Cannot get posts of request " << req_id;
-      ServiceException se;
-      se.errorCode = ErrorCode::SE_MEMCACHED_ERROR;
-      se.message = "Cannot get posts of request " + std::to_string(req_id);
-      throw se;
-    }
-    Post new_post;
-    json post_json = json::parse(
-        std::string(return_value, return_value + return_value_length));
-    new_post.req_id = post_json["req_id"];
-    new_post.timestamp = post_json["timestamp"];
-    new_post.post_id = post_json["post_id"];
-    new_post.creator.user_id = post_json["creator"]["user_id"];
-    new_post.creator.username = post_json["creator"]["username"];
-    new_post.post_type = post_json["post_type"];
-    new_post.text = post_json["text"];
-    for (auto &item : post_json["media"]) {
-      Media media;
-      media.media_id = item["media_id"];
-      media.media_type = item["media_type"];
-      new_post.media.emplace_back(media);
-    }
-    for (auto &item : post_json["user_mentions"]) {
-      UserMention user_mention;
-      user_mention.username = item["username"];
-      user_mention.user_id = item["user_id"];
-      new_post.user_mentions.emplace_back(user_mention);
-    }
-    for (auto &item : post_json["urls"]) {
-      Url url;
-      url.shortened_url = item["shortened_url"];
-      url.expanded_url = item["expanded_url"];
-      new_post.urls.emplace_back(url);
+  if (_post_cache) {
+    for (auto &post_id : post_ids) {
+      auto cached_post = _post_cache->Get(post_id);
+      if (cached_post) {
+        return_map.insert(std::make_pair(post_id, *cached_post));
+        post_ids_not_cached.erase(post_id);
+      }
     }
-    return_map.insert(std::make_pair(new_post.post_id, new_post));
-    post_ids_not_cached.erase(new_post.post_id);
-    free(return_value);
   }
-  get_span->Finish();
-  memcached_quit(memcached_client);
-  memcached_pool_push(_memcached_client_pool, memcached_client);
-  for (int i = 0; i < post_ids.size(); ++i) {
-    delete keys[i];
-  }
-  delete[] keys;
-  delete[] key_sizes;
-
-  std::vector<std::future<void>> set_futures;
-  std::map<int64_t, std::string> post_json_map;
 
-  // Find the rest in MongoDB
+  // Look up the rest in memcached
   if (!post_ids_not_cached.empty()) {
-    mongoc_client_t *mongodb_client =
-        mongoc_client_pool_pop(_mongodb_client_pool);
-    if (!mongodb_client) {
+    memcached_return_t memcached_rc;
+    auto memcached_client =
+        memcached_pool_pop(_memcached_client_pool, true, &memcached_rc);
+    if (!memcached_client) {
       ServiceException se;
-      se.errorCode = ErrorCode::SE_MONGODB_ERROR;
-      se.message = "Failed to pop a client from MongoDB pool";
+      se.errorCode = ErrorCode::SE_MEMCACHED_ERROR;
+      se.message = "Failed to pop a client from memcached pool";
       throw se;
     }
-    auto collection =
-        mongoc_client_get_collection(mongodb_client, "post", "post");
-    if (!collection) {
+
+    char **keys;
+    size_t *key_sizes;
+    keys = new char *[post_ids_not_cached.size()];
+    key_sizes = new size_t[post_ids_not_cached.size()];
+    idx = 0;
+    for (auto &post_id : post_ids_not_cached) {
+      std::string key_str = std::to_string(post_id);
+      keys[idx] = new char[key_str.length() + 1];
+      strcpy(keys[idx], key_str.c_str());
+      key_sizes[idx] = key_str.length();
+      idx++;
+    }
+    memcached_rc = memcached_mget(memcached_client, keys, key_sizes,
+                                  post_ids_not_cached.size());
+    if (memcached_rc != MEMCACHED_SUCCESS) {
+      LOG(error) << "Cannot get post_ids of request " << req_id << ": "
+                 << memcached_strerror(memcached_client, memcached_rc);
       ServiceException se;
-      se.errorCode = ErrorCode::SE_MONGODB_ERROR;
-      se.message = "Failed to create collection user from DB user";
-      mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
+      se.errorCode = ErrorCode::SE_MEMCACHED_ERROR;
+      se.message = memcached_strerror(memcached_client, memcached_rc);
+      memcached_pool_push(_memcached_client_pool, memcached_client);
       throw se;
     }
-    bson_t *query = bson_new();
-    bson_t query_child;
-    bson_t query_post_id_list;
-    const char *key;
-    idx = 0;
-    char buf[16];
 
-    BSON_APPEND_DOCUMENT_BEGIN(query, "post_id", &query_child);
-    BSON_APPEND_ARRAY_BEGIN(&query_child, "$in", &query_post_id_list);
-    for (auto &item : post_ids_not_cached) {
-      bson_uint32_to_string(idx, &key, buf, sizeof buf);
-      BSON_APPEND_INT64(&query_post_id_list, key, item);
-      idx++;
-    }
-    bson_append_array_end(&query_child, &query_post_id_list);
-    bson_append_document_end(query, &query_child);
-    mongoc_cursor_t *cursor =
-        mongoc_collection_find_with_opts(collection, query, nullptr, nullptr);
-    const bson_t *doc;
-
-    auto find_span = opentracing::Tracer::Global()->StartSpan(
-        "mongo_find_client", {opentracing::ChildOf(&span->context())});
+    char return_key[MEMCACHED_MAX_KEY];
+    size_t return_key_length;
+    char *return_value;
+    size_t return_value_length;
+    uint32_t flags;
+    auto get_span = StartChildSpan(
+        "post_storage_mmc_mget_client", span->context());
+
     while (true) {
-      bool found = mongoc_cursor_next(cursor, &doc);
-      if (!found) {
+      return_value =
+          memcached_fetch(memcached_client, return_key, &return_key_length,
+                          &return_value_length, &flags, &memcached_rc);
+      if (return_value == nullptr) {
+        LOG(debug) << "Memcached mget finished";
         break;
       }
+      if (memcached_rc != MEMCACHED_SUCCESS) {
+        free(return_value);
+        memcached_quit(memcached_client);
+        memcached_pool_push(_memcached_client_pool, memcached_client);
+        LOG(error) << "Cannot get posts of request " << req_id;
+        ServiceException se;
+        se.errorCode = ErrorCode::SE_MEMCACHED_ERROR;
+        se.message = "Cannot get posts of request " + std::to_string(req_id);
+        throw se;
+      }
       Post new_post;
-      char *post_json_char = bson_as_json(doc, nullptr);
-      json post_json = json::parse(post_json_char);
-      new_post.req_id = post_json["req_id"];
-      new_post.timestamp = post_json["timestamp"];
-      new_post.post_id = post_json["post_id"];
-      new_post.creator.user_id = post_json["creator"]["user_id"];
-      new_post.creator.username = post_json["creator"]["username"];
-      new_post.post_type = post_json["post_type"];
-      new_post.text = post_json["text"];
-      for (auto &item : post_json["media"]) {
-        Media media;
-        media.media_id = item["media_id"];
-        media.media_type = item["media_type"];
-        new_post.media.emplace_back(media);
+      // Values that fail to decode stay in post_ids_not_cached and are read
+      // from MongoDB and rewritten below.
+      if (DecodePostCacheValue(return_value, return_value_length, &new_post)) {
+        post_ids_not_cached.erase(new_post.post_id);
+        _PutLocalCache(new_post);
+        return_map.insert(
+            std::make_pair(new_post.post_id, std::move(new_post)));
       }
-      for (auto &item : post_json["user_mentions"]) {
-        UserMention user_mention;
-        user_mention.username = item["username"];
-        user_mention.user_id = item["user_id"];
-        new_post.user_mentions.emplace_back(user_mention);
+      free(return_value);
+    }
+    get_span->Finish();
+    memcached_quit(memcached_client);
+    memcached_pool_push(_memcached_client_pool, memcached_client);
+    for (int i = 0; i < idx; ++i) {
+      delete keys[i];
+    }
+    delete[] keys;
+    delete[] key_sizes;
+  }
+
+  std::vector<std::future<void>> set_futures;
+  std::map<int64_t, std::string> post_cache_map;
+
+  // Posts that a concurrent request is already loading from MongoDB are
+  // waited for instead of queried again. This request leads the lookup of
+  // the others and completes them all before waiting on anyone else.
+  std::map<int64_t, std::shared_ptr<PostFlight::Call>> led_calls;
+  std::map<int64_t, std::shared_ptr<PostFlight::Call>> joined_calls;
+  for (auto &post_id : post_ids_not_cached) {
+    bool leader;
+    auto call = _post_flight.Join(post_id, &leader);
+    if (leader) {
+      led_calls.emplace(post_id, call);
+    } else {
+      joined_calls.emplace(post_id, call);
+    }
+  }
+
+  // Find the rest in MongoDB
+  if (!led_calls.empty()) {
+    try {
+      mongoc_client_t *mongodb_client =
+          mongoc_client_pool_pop(_mongodb_client_pool);
+      if (!mongodb_client) {
+        ServiceException se;
+        se.errorCode = ErrorCode::SE_MONGODB_ERROR;
+        se.message = "Failed to pop a client from MongoDB pool";
+        throw se;
       }
-      for (auto &item : post_json["urls"]) {
-        Url url;
-        url.shortened_url = item["shortened_url"];
-        url.expanded_url = item["expanded_url"];
-        new_post.urls.emplace_back(url);
+      auto collection =
+          mongoc_client_get_collection(mongodb_client, "post", "post");
+      if (!collection) {
+        ServiceException se;
+        se.errorCode = ErrorCode::SE_MONGODB_ERROR;
+        se.message = "Failed to create collection user from DB user";
+        mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
+        throw se;
+      }
+      bson_t *query = bson_new();
+      bson_t query_child;
+      bson_t query_post_id_list;
+      const char *key;
+      idx = 0;
+      char buf[16];
+
+      BSON_APPEND_DOCUMENT_BEGIN(query, "post_id", &query_child);
+      BSON_APPEND_ARRAY_BEGIN(&query_child, "$in", &query_post_id_list);
+      for (auto &item : led_calls) {
+        bson_uint32_to_string(idx, &key, buf, sizeof buf);
+        BSON_APPEND_INT64(&query_post_id_list, key, item.first);
+        idx++;
+      }
+      bson_append_array_end(&query_child, &query_post_id_list);
+      bson_append_document_end(query, &query_child);
+      mongoc_cursor_t *cursor = mongoc_collection_find_with_opts(
+          collection, query, nullptr, nullptr);
+      const bson_t *doc;
+
+      auto find_span = StartChildSpan("mongo_find_client", span->context());
+      while (true) {
+        bool found = mongoc_cursor_next(cursor, &doc);
+        if (!found) {
+          break;
+        }
+        Post new_post;
+        if (!BsonToPost(doc, &new_post)) {
+          LOG(warning) << "Skip incomplete post document from MongoDB";
+          continue;
+        }
+        auto call_it = led_calls.find(new_post.post_id);
+        if (call_it != led_calls.end()) {
+          _post_flight.Finish(call_it->first, call_it->second, new_post);
+          led_calls.erase(call_it);
+        }
+        post_cache_map.insert(
+            {new_post.post_id, EncodePostCacheValue(new_post)});
+        _PutLocalCache(new_post);
+        return_map.insert({new_post.post_id, std::move(new_post)});
+      }
+      find_span->Finish();
+      bson_error_t error;
+      if (mongoc_cursor_error(cursor, &error)) {
+        LOG(warning) << error.message;
+        bson_destroy(query);
+        mongoc_cursor_destroy(cursor);
+        mongoc_collection_destroy(collection);
+        mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
+        ServiceException se;
+        se.errorCode = ErrorCode::SE_MONGODB_ERROR;
+        se.message = error.message;
+        throw se;
       }
-      post_json_map.insert({new_post.post_id, std::string(post_json_char)});
-      return_map.insert({new_post.post_id, new_post});
-      bson_free(post_json_char);
-    }
-    find_span->Finish();
-    bson_error_t error;
-    if (mongoc_cursor_error(cursor, &error)) {
-      LOG(warning) << error.message;
       bson_destroy(query);
       mongoc_cursor_destroy(cursor);
       mongoc_collection_destroy(collection);
       mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
+    } catch (...) {
+      for (auto &it : led_calls) {
+        _post_flight.Fail(it.first, it.second, std::current_exception());
+      }
+      throw;
+    }
+    for (auto &it : led_calls) {
       ServiceException se;
-      se.errorCode = ErrorCode::SE_MONGODB_ERROR;
-      se.message = error.message;
-      throw se;
+      se.errorCode = ErrorCode::SE_THRIFT_HANDLER_ERROR;
+      se.message = "Post_id: " + std::to_string(it.first) +
+                   " doesn't exist in MongoDB";
+      _post_flight.Fail(it.first, it.second, std::make_exception_ptr(se));
     }
-    bson_destroy(query);
-    mongoc_cursor_destroy(cursor);
-    mongoc_collection_destroy(collection);
-    mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
 
     // upload posts to memcached
-    set_futures.emplace_back(std::async(std::launch::async, [&]() {
+    set_futures.emplace_back(_executor->Submit([&]() {
       memcached_return_t _rc;
       auto _memcached_client =
           memcached_pool_pop(_memcached_client_pool, true, &_rc);
@@ -589,9 +632,8 @@ void PostStorageHandler::ReadPosts(
         se.message = "Failed to pop a client from memcached pool";
         throw se;
       }
-      auto set_span = opentracing::Tracer::Global()->StartSpan(
-          "mmc_set_client", {opentracing::ChildOf(&span->context())});
-      for (auto &it : post_json_map) {
+      auto set_span = StartChildSpan("mmc_set_client", span->context());
+      for (auto &it : post_cache_map) {
         std::string id_str = std::to_string(it.first);
         _rc = memcached_set(_memcached_client, id_str.c_str(), id_str.length(),
                             it.second.c_str(), it.second.length(),
@@ -602,6 +644,14 @@ void PostStorageHandler::ReadPosts(
     }));
   }
 
+  for (auto &it : joined_calls) {
+    try {
+      return_map.insert({it.first, it.second->future.get()});
+    } catch (...) {
+      LOG(warning) << "Concurrent read of post " << it.first << " failed";
+    }
+  }
+
   if (return_map.size() != post_ids.size()) {
     try {
       for (auto &it : set_futures) {
@@ -618,7 +668,7 @@ void PostStorageHandler::ReadPosts(
   }
 
   for (auto &post_id : post_ids) {
-    _return.emplace_back(return_map[post_id]);
+    _return.emplace_back(std::move(return_map[post_id]));
   }
 
   try {
@@ -1,8 +1,4 @@
 #include <signal.h>
-#include <thrift/protocol/TBinaryProtocol.h>
-#include <thrift/server/TThreadedServer.h>
-#include <thrift/transport/TBufferTransports.h>
-#include <thrift/transport/TServerSocket.h>
 
 #include "../utils.h"
 #include "../utils_memcached.h"
@@ -10,10 +6,6 @@
 #include "../utils_thrift.h"
 #include "PostStorageHandler.h"
 
-using apache::thrift::protocol::TBinaryProtocolFactory;
-using apache::thrift::server::TThreadedServer;
-using apache::thrift::transport::TFramedTransportFactory;
-using apache::thrift::transport::TServerSocket;
 using namespace social_network;
 
 static memcached_pool_st* memcached_client_pool;
@@ -69,15 +61,58 @@ int main(int argc, char* argv[]) {
     }
   }
   mongoc_client_pool_push(mongodb_client_pool, mongodb_client);
-  std::shared_ptr<TServerSocket> server_socket = get_server_socket(config_json, "0.0.0.0", port);
 
-  TThreadedServer server(std::make_shared<PostStorageServiceProcessor>(
-                             std::make_shared<PostStorageHandler>(
-                                 memcached_client_pool, mongodb_client_pool)),
-                         server_socket,
-                         std::make_shared<TFramedTransportFactory>(),
-                         std::make_shared<TBinaryProtocolFactory>());
+  int executor_threads =
+      config_json["post-storage-service"].value("executor_threads", 16);
+  int executor_max_pending =
+      config_json["post-storage-service"].value("executor_max_pending", 256);
+  Executor executor(executor_threads, executor_max_pending);
+
+  // In-process post cache in front of memcached, disabled when its size is 0.
+  const json &service_json = config_json["post-storage-service"];
+  int local_cache_size_mb = service_json.value("local_cache_size_mb", 0);
+  int local_cache_shards = service_json.value("local_cache_shards", 16);
+  int local_cache_ttl_ms = service_json.value("local_cache_ttl_ms", 60000);
+  int local_cache_stats_interval_ms =
+      service_json.value("local_cache_stats_interval_ms", 0);
+  std::unique_ptr<LocalCache<int64_t, Post>> post_cache;
+  if (local_cache_size_mb > 0) {
+    post_cache.reset(new LocalCache<int64_t, Post>(
+        static_cast<size_t>(local_cache_size_mb) << 20, local_cache_shards,
+        local_cache_ttl_ms));
+    if (local_cache_stats_interval_ms > 0) {
+      start_local_cache_stats_logger("post-storage", post_cache.get(),
+                                     local_cache_stats_interval_ms);
+    }
+    LOG(info) << "Using a " << local_cache_size_mb
+              << " MB in-process post cache";
+  }
+
+  // Write-through of stored posts: "none", "memcached", "local" or "all".
+  std::string write_through = service_json.value("write_through", "none");
+  if (write_through != "none" && write_through != "memcached" &&
+      write_through != "local" && write_through != "all") {
+    LOG(fatal) << "Unknown post write_through mode: " << write_through;
+    return EXIT_FAILURE;
+  }
+  bool write_through_memcached =
+      write_through == "memcached" || write_through == "all";
+  bool write_through_local =
+      write_through == "local" || write_through == "all";
+  if (write_through_local && !post_cache) {
+    LOG(warning) << "Post write_through to the local cache needs "
+                    "local_cache_size_mb > 0, ignoring it";
+  }
+
+  auto server = get_server(
+      config_json, "post-storage-service",
+      std::make_shared<PostStorageServiceProcessor>(
+          std::make_shared<PostStorageHandler>(
+              memcached_client_pool, mongodb_client_pool, &executor,
+              post_cache.get(), write_through_memcached,
+              write_through_local)),
+      port);
 
   LOG(info) << "Starting the post-storage-service server...";
-  server.serve();
+  server->serve();
 }
@@ -0,0 +1,75 @@
+#ifndef SOCIAL_NETWORK_MICROSERVICES_RPCELISION_H
+#define SOCIAL_NETWORK_MICROSERVICES_RPCELISION_H
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "logger.h"
+
+namespace social_network {
+
+struct ElidedRpcStats {
+  uint64_t calls;
+  uint64_t elided;
+};
+
+// Counts, for one downstream RPC of a handler, the calls that were sent and
+// the ones answered locally because their reply was known in advance, such
+// as an empty list in giving an empty list out.
+class ElidedRpcCounter {
+ public:
+  explicit ElidedRpcCounter(const std::string &rpc_name)
+      : _rpc_name(rpc_name), _calls(0), _elided(0) {}
+
+  const std::string &RpcName() const { return _rpc_name; }
+  void CountCall() { _calls.fetch_add(1, std::memory_order_relaxed); }
+  void CountElided() { _elided.fetch_add(1, std::memory_order_relaxed); }
+  ElidedRpcStats GetStats() const;
+
+ private:
+  std::string _rpc_name;
+  std::atomic<uint64_t> _calls;
+  std::atomic<uint64_t> _elided;
+};
+
+ElidedRpcStats ElidedRpcCounter::GetStats() const {
+  ElidedRpcStats stats;
+  stats.calls = _calls.load(std::memory_order_relaxed);
+  stats.elided = _elided.load(std::memory_order_relaxed);
+  return stats;
+}
+
+// Returns a ready future holding value, to stand in for the future of an
+// elided call.
+template<class T>
+std::future<T> LocalResult(ElidedRpcCounter *counter, T value) {
+  counter->CountElided();
+  std::promise<T> promise;
+  promise.set_value(std::move(value));
+  return promise.get_future();
+}
+
+void start_elided_rpc_stats_logger(
+    const std::string &service_name,
+    std::vector<const ElidedRpcCounter *> counters, int interval_ms) {
+  std::thread([service_name, counters, interval_ms]() {
+    while (true) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(interval_ms));
+      for (auto counter : counters) {
+        ElidedRpcStats stats = counter->GetStats();
+        LOG(info) << service_name << " " << counter->RpcName()
+                  << " rpc stats: calls=" << stats.calls
+                  << " elided=" << stats.elided;
+      }
+    }
+  }).detach();
+}
+
+}  // namespace social_network
+
+#endif  // SOCIAL_NETWORK_MICROSERVICES_RPCELISION_H
@@ -0,0 +1,126 @@
+#ifndef SOCIAL_NETWORK_MICROSERVICES_SINGLEFLIGHT_H
+#define SOCIAL_NETWORK_MICROSERVICES_SINGLEFLIGHT_H
+
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace social_network {
+
+// Coalesces concurrent backend fetches of the same cache key: the first
+// caller to miss becomes the leader and performs the fetch, callers missing
+// the same key while it is in flight wait for and share its result or its
+// exception. Once the leader finishes, the key is forgotten, so results are
+// never served from here after the fact.
+template<class TKey, class TValue, class THash = std::hash<TKey>>
+class SingleFlight {
+ public:
+  struct Call {
+    std::promise<TValue> promise;
+    std::shared_future<TValue> future;
+  };
+
+  SingleFlight() : _coalesced(0) {}
+
+  SingleFlight(const SingleFlight &) = delete;
+  SingleFlight &operator=(const SingleFlight &) = delete;
+
+  // Runs fetch() unless a fetch of key is already in flight, in which case
+  // waits for that one. *leader, if given, tells whether fetch() ran here,
+  // e.g. so that only the leader writes the result back to the cache.
+  template<class F>
+  TValue Do(const TKey &key, F &&fetch, bool *leader = nullptr);
+
+  // Lower level interface for callers that fetch many keys at once. Join()
+  // returns the in-flight call of key, creating it if there is none; when
+  // *leader is set, the caller must complete it with Finish() or Fail().
+  // Everyone else waits on call->future.
+  std::shared_ptr<Call> Join(const TKey &key, bool *leader);
+  void Finish(const TKey &key, const std::shared_ptr<Call> &call,
+              const TValue &value);
+  void Fail(const TKey &key, const std::shared_ptr<Call> &call,
+            std::exception_ptr error);
+
+  // Number of fetches avoided by waiting on another caller's fetch.
+  uint64_t GetCoalescedCount() const;
+
+ private:
+  void _Forget(const TKey &key);
+
+  std::mutex _mtx;
+  std::unordered_map<TKey, std::shared_ptr<Call>, THash> _calls;
+  std::atomic<uint64_t> _coalesced;
+};
+
+template<class TKey, class TValue, class THash>
+std::shared_ptr<typename SingleFlight<TKey, TValue, THash>::Call>
+SingleFlight<TKey, TValue, THash>::Join(const TKey &key, bool *leader) {
+  std::lock_guard<std::mutex> lock(_mtx);
+  auto it = _calls.find(key);
+  if (it != _calls.end()) {
+    *leader = false;
+    _coalesced++;
+    return it->second;
+  }
+  auto call = std::make_shared<Call>();
+  call->future = call->promise.get_future().share();
+  _calls.emplace(key, call);
+  *leader = true;
+  return call;
+}
+
+template<class TKey, class TValue, class THash>
+void SingleFlight<TKey, TValue, THash>::_Forget(const TKey &key) {
+  std::lock_guard<std::mutex> lock(_mtx);
+  _calls.erase(key);
+}
+
+template<class TKey, class TValue, class THash>
+void SingleFlight<TKey, TValue, THash>::Finish(
+    const TKey &key, const std::shared_ptr<Call> &call, const TValue &value) {
+  _Forget(key);
+  call->promise.set_value(value);
+}
+
+template<class TKey, class TValue, class THash>
+void SingleFlight<TKey, TValue, THash>::Fail(
+    const TKey &key, const std::shared_ptr<Call> &call,
+    std::exception_ptr error) {
+  _Forget(key);
+  call->promise.set_exception(error);
+}
+
+template<class TKey, class TValue, class THash>
+template<class F>
+TValue SingleFlight<TKey, TValue, THash>::Do(const TKey &key, F &&fetch,
+                                             bool *leader) {
+  bool is_leader;
+  auto call = Join(key, &is_leader);
+  if (leader) {
+    *leader = is_leader;
+  }
+  if (!is_leader) {
+    return call->future.get();
+  }
+  try {
+    TValue value = fetch();
+    Finish(key, call, value);
+    return value;
+  } catch (...) {
+    Fail(key, call, std::current_exception());
+    throw;
+  }
+}
+
+template<class TKey, class TValue, class THash>
+uint64_t SingleFlight<TKey, TValue, THash>::GetCoalescedCount() const {
+  return _coalesced.load();
+}
+
+} // namespace social_network
+
+#endif //SOCIAL_NETWORK_MICROSERVICES_SINGLEFLIGHT_H
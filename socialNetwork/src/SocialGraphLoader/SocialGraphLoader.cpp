@@ -0,0 +1,430 @@
+// Loads a social graph dataset (datasets/social-graph/<graph>/<graph>.nodes
+// and .edges) straight into the user and social-graph MongoDB databases and
+// the social-graph Redis, bypassing nginx and the services. It creates the
+// same records as scripts/init_social_graph.py: users 0..nodes-1 named
+// username_<id> with password password_<id>, and a follow edge in both
+// directions for each line of the edges file.
+//
+// The edges file is streamed once into per-user adjacency lists. Users are
+// then partitioned by user_id across threads; each thread writes its users
+// with unordered bulk inserts and its Redis ZSets with pipelines.
+
+#include <signal.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include "../../third_party/PicoSHA2/picosha2.h"
+#include "../utils.h"
+#include "../utils_mongodb.h"
+#include "../utils_redis.h"
+
+using json = nlohmann::json;
+using namespace social_network;
+
+using std::chrono::duration_cast;
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+using std::chrono::system_clock;
+
+namespace {
+
+struct Graph {
+  int64_t num_nodes = 0;
+  int64_t num_edges = 0;
+  std::vector<std::vector<int64_t>> followers;
+  std::vector<std::vector<int64_t>> followees;
+};
+
+bool ReadNodes(const std::string &path, int64_t *num_nodes) {
+  FILE *file = fopen(path.c_str(), "r");
+  if (!file) {
+    LOG(error) << "Cannot open " << path;
+    return false;
+  }
+  bool ok = fscanf(file, "%" SCNd64, num_nodes) == 1;
+  fclose(file);
+  if (!ok) {
+    LOG(error) << "Failed to read the number of nodes from " << path;
+  }
+  return ok;
+}
+
+bool ReadEdges(const std::string &path, Graph *graph) {
+  FILE *file = fopen(path.c_str(), "r");
+  if (!file) {
+    LOG(error) << "Cannot open " << path;
+    return false;
+  }
+  auto add_edge = [graph](int64_t user_id, int64_t followee_id) {
+    int64_t max_id = std::max(user_id, followee_id);
+    if (max_id >= static_cast<int64_t>(graph->followers.size())) {
+      graph->followers.resize(max_id + 1);
+      graph->followees.resize(max_id + 1);
+    }
+    graph->followees[user_id].emplace_back(followee_id);
+    graph->followers[followee_id].emplace_back(user_id);
+  };
+  int64_t user_0;
+  int64_t user_1;
+  while (fscanf(file, "%" SCNd64 " %" SCNd64, &user_0, &user_1) == 2) {
+    if (user_0 < 0 || user_1 < 0) {
+      continue;
+    }
+    add_edge(user_0, user_1);
+    add_edge(user_1, user_0);
+    graph->num_edges++;
+  }
+  fclose(file);
+
+  // Repeated edges would only be written once by Follow.
+  for (auto *lists : {&graph->followers, &graph->followees}) {
+    for (auto &list : *lists) {
+      std::sort(list.begin(), list.end());
+      list.erase(std::unique(list.begin(), list.end()), list.end());
+    }
+  }
+  int64_t num_users = graph->followers.size();
+  graph->num_nodes = std::max(graph->num_nodes, num_users);
+  graph->followers.resize(graph->num_nodes);
+  graph->followees.resize(graph->num_nodes);
+  return true;
+}
+
+std::string GenRandomString(std::mt19937 *gen, int len) {
+  static const std::string alphanum =
+      "0123456789"
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+      "abcdefghijklmnopqrstuvwxyz";
+  std::uniform_int_distribution<int> dist(
+      0, static_cast<int>(alphanum.length() - 1));
+  std::string s;
+  for (int i = 0; i < len; ++i) {
+    s += alphanum[dist(*gen)];
+  }
+  return s;
+}
+
+void AppendEdges(bson_t *doc, const char *key,
+                 const std::vector<int64_t> &ids, int64_t timestamp) {
+  bson_t array;
+  bson_t entry;
+  const char *index_key;
+  char buf[16];
+  BSON_APPEND_ARRAY_BEGIN(doc, key, &array);
+  uint32_t idx = 0;
+  for (auto id : ids) {
+    bson_uint32_to_string(idx++, &index_key, buf, sizeof buf);
+    BSON_APPEND_DOCUMENT_BEGIN(&array, index_key, &entry);
+    BSON_APPEND_INT64(&entry, "user_id", id);
+    BSON_APPEND_INT64(&entry, "timestamp", timestamp);
+    bson_append_document_end(&array, &entry);
+  }
+  bson_append_array_end(doc, &array);
+}
+
+// Inserts the documents built by make_doc(user_id, doc) for user_ids in one
+// unordered bulk write. Duplicates of users loaded by a previous run are
+// reported but do not stop the load.
+template<class F>
+bool BulkInsert(mongoc_collection_t *collection,
+                const std::vector<int64_t> &user_ids, F make_doc) {
+  bson_t *opts = BCON_NEW("ordered", BCON_BOOL(false));
+  mongoc_bulk_operation_t *bulk =
+      mongoc_collection_create_bulk_operation_with_opts(collection, opts);
+  for (auto user_id : user_ids) {
+    bson_t *doc = bson_new();
+    make_doc(user_id, doc);
+    mongoc_bulk_operation_insert(bulk, doc);
+    bson_destroy(doc);
+  }
+  bson_t reply;
+  bson_error_t error;
+  bool ok = mongoc_bulk_operation_execute(bulk, &reply, &error);
+  if (!ok) {
+    LOG(error) << "Bulk insert into " << mongoc_collection_get_name(collection)
+               << " failed: " << error.message;
+  }
+  bson_destroy(&reply);
+  mongoc_bulk_operation_destroy(bulk);
+  bson_destroy(opts);
+  return ok;
+}
+
+void WriteZSets(Redis *redis, const Graph &graph,
+                const std::vector<int64_t> &user_ids, int64_t timestamp) {
+  auto pipe = redis->pipeline(false);
+  for (auto user_id : user_ids) {
+    for (int side = 0; side < 2; ++side) {
+      auto &ids = side ? graph.followees[user_id] : graph.followers[user_id];
+      if (ids.empty()) {
+        continue;
+      }
+      std::vector<std::pair<std::string, double>> members;
+      members.reserve(ids.size());
+      for (auto id : ids) {
+        members.emplace_back(std::to_string(id),
+                             static_cast<double>(timestamp));
+      }
+      pipe.zadd(std::to_string(user_id) +
+                    (side ? ":followees" : ":followers"),
+                members.begin(), members.end());
+    }
+  }
+  pipe.exec();
+}
+
+// Keys on different shards cannot share a pipeline, so the batch is split
+// into one pipeline per shard.
+void WriteZSets(RedisCluster *redis, const Graph &graph,
+                const std::vector<int64_t> &user_ids, int64_t timestamp) {
+  std::map<std::shared_ptr<ConnectionPool>, std::shared_ptr<Pipeline>>
+      pipe_map;
+  auto *shards_pool = redis->get_shards_pool();
+  for (auto user_id : user_ids) {
+    for (int side = 0; side < 2; ++side) {
+      auto &ids = side ? graph.followees[user_id] : graph.followers[user_id];
+      if (ids.empty()) {
+        continue;
+      }
+      std::vector<std::pair<std::string, double>> members;
+      members.reserve(ids.size());
+      for (auto id : ids) {
+        members.emplace_back(std::to_string(id),
+                             static_cast<double>(timestamp));
+      }
+      std::string key =
+          std::to_string(user_id) + (side ? ":followees" : ":followers");
+      auto conn = shards_pool->fetch(key);
+      auto pipe = pipe_map.find(conn);
+      if (pipe == pipe_map.end()) {
+        pipe = pipe_map
+                   .emplace(conn, std::make_shared<Pipeline>(
+                                      redis->pipeline(key, false)))
+                   .first;
+      }
+      pipe->second->zadd(key, members.begin(), members.end());
+    }
+  }
+  for (auto &it : pipe_map) {
+    it.second->exec();
+  }
+}
+
+struct LoadOptions {
+  int num_threads;
+  int batch_size;
+  bool load_users;
+  bool load_redis;
+};
+
+// Loads the users with user_id % num_threads == thread_idx.
+template<class R>
+void LoadPartition(int thread_idx, const LoadOptions &options,
+                   const Graph &graph, int64_t timestamp,
+                   mongoc_client_pool_t *user_mongodb_pool,
+                   mongoc_client_pool_t *social_graph_mongodb_pool, R *redis,
+                   std::atomic<int64_t> *loaded, std::atomic<bool> *failed) {
+  mongoc_client_t *user_client = mongoc_client_pool_pop(user_mongodb_pool);
+  mongoc_client_t *social_graph_client =
+      mongoc_client_pool_pop(social_graph_mongodb_pool);
+  auto user_collection =
+      mongoc_client_get_collection(user_client, "user", "user");
+  auto social_graph_collection = mongoc_client_get_collection(
+      social_graph_client, "social-graph", "social-graph");
+  std::mt19937 gen(std::random_device{}());
+
+  auto make_user = [&](int64_t user_id, bson_t *doc) {
+    std::string id = std::to_string(user_id);
+    std::string salt = GenRandomString(&gen, 32);
+    BSON_APPEND_INT64(doc, "user_id", user_id);
+    BSON_APPEND_UTF8(doc, "first_name", ("first_name_" + id).c_str());
+    BSON_APPEND_UTF8(doc, "last_name", ("last_name_" + id).c_str());
+    BSON_APPEND_UTF8(doc, "username", ("username_" + id).c_str());
+    BSON_APPEND_UTF8(doc, "salt", salt.c_str());
+    BSON_APPEND_UTF8(
+        doc, "password",
+        picosha2::hash256_hex_string("password_" + id + salt).c_str());
+  };
+  auto make_social_graph = [&](int64_t user_id, bson_t *doc) {
+    BSON_APPEND_INT64(doc, "user_id", user_id);
+    AppendEdges(doc, "followers", graph.followers[user_id], timestamp);
+    AppendEdges(doc, "followees", graph.followees[user_id], timestamp);
+  };
+
+  std::vector<int64_t> batch;
+  batch.reserve(options.batch_size);
+  for (int64_t user_id = thread_idx; user_id < graph.num_nodes;
+       user_id += options.num_threads) {
+    batch.emplace_back(user_id);
+    if (static_cast<int>(batch.size()) < options.batch_size &&
+        user_id + options.num_threads < graph.num_nodes) {
+      continue;
+    }
+    bool ok = BulkInsert(social_graph_collection, batch, make_social_graph);
+    if (options.load_users) {
+      ok = BulkInsert(user_collection, batch, make_user) && ok;
+    }
+    if (options.load_redis) {
+      try {
+        WriteZSets(redis, graph, batch, timestamp);
+      } catch (const Error &err) {
+        LOG(error) << err.what();
+        ok = false;
+      }
+    }
+    if (!ok) {
+      failed->store(true);
+    }
+    loaded->fetch_add(batch.size());
+    batch.clear();
+  }
+
+  mongoc_collection_destroy(social_graph_collection);
+  mongoc_collection_destroy(user_collection);
+  mongoc_client_pool_push(social_graph_mongodb_pool, social_graph_client);
+  mongoc_client_pool_push(user_mongodb_pool, user_client);
+}
+
+template<class R>
+bool Load(const LoadOptions &options, const Graph &graph,
+          mongoc_client_pool_t *user_mongodb_pool,
+          mongoc_client_pool_t *social_graph_mongodb_pool, R *redis) {
+  int64_t timestamp =
+      duration_cast<milliseconds>(system_clock::now().time_since_epoch())
+          .count();
+  std::atomic<int64_t> loaded(0);
+  std::atomic<bool> failed(false);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < options.num_threads; ++i) {
+    threads.emplace_back(LoadPartition<R>, i, std::cref(options),
+                         std::cref(graph), timestamp, user_mongodb_pool,
+                         social_graph_mongodb_pool, redis, &loaded, &failed);
+  }
+  while (loaded.load() < graph.num_nodes && !failed.load()) {
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    LOG(info) << "Loaded " << loaded.load() << " / " << graph.num_nodes
+              << " users";
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  return !failed.load();
+}
+
+}  // namespace
+
+void sigintHandler(int sig) { exit(EXIT_SUCCESS); }
+
+int main(int argc, char *argv[]) {
+  signal(SIGINT, sigintHandler);
+  init_logger();
+
+  namespace po = boost::program_options;
+  po::options_description desc("Options");
+  desc.add_options()("help", "produce help message")(
+      "graph", po::value<std::string>()->default_value("socfb-Reed98"),
+      "Graph name (socfb-Reed98, ego-twitter or soc-twitter-follows-mun)")(
+      "datasets",
+      po::value<std::string>()->default_value("datasets/social-graph"),
+      "Directory of the social graph datasets")(
+      "threads", po::value<int>()->default_value(8),
+      "Number of loader threads")(
+      "batch-size", po::value<int>()->default_value(1000),
+      "Users per bulk insert and Redis pipeline")(
+      "users", po::value<bool>()->default_value(true),
+      "Create the user accounts")(
+      "redis", po::value<bool>()->default_value(true),
+      "Fill the social-graph Redis ZSets")(
+      "redis-cluster",
+      po::value<bool>()->default_value(false)->implicit_value(true),
+      "Enable redis cluster mode");
+
+  po::variables_map vm;
+  po::store(po::parse_command_line(argc, argv, desc), vm);
+  po::notify(vm);
+
+  if (vm.count("help")) {
+    std::cout << desc << "\n";
+    return 0;
+  }
+
+  LoadOptions options;
+  options.num_threads = std::max(1, vm["threads"].as<int>());
+  options.batch_size = std::max(1, vm["batch-size"].as<int>());
+  options.load_users = vm["users"].as<bool>();
+  options.load_redis = vm["redis"].as<bool>();
+  std::string graph_name = vm["graph"].as<std::string>();
+  std::string prefix =
+      vm["datasets"].as<std::string>() + "/" + graph_name + "/" + graph_name;
+
+  json config_json;
+  if (load_config_file("config/service-config.json", &config_json) != 0) {
+    exit(EXIT_FAILURE);
+  }
+  int redis_cluster_config_flag =
+      config_json["social-graph-redis"]["use_cluster"];
+  int redis_replica_config_flag =
+      config_json["social-graph-redis"]["use_replica"];
+
+  auto start = steady_clock::now();
+  Graph graph;
+  if (!ReadNodes(prefix + ".nodes", &graph.num_nodes) ||
+      !ReadEdges(prefix + ".edges", &graph)) {
+    return EXIT_FAILURE;
+  }
+  double read_secs =
+      duration_cast<milliseconds>(steady_clock::now() - start).count() / 1e3;
+  LOG(info) << "Read " << graph.num_edges << " edges of " << graph.num_nodes
+            << " users in " << read_secs << " s";
+
+  mongoc_client_pool_t *user_mongodb_pool = init_mongodb_client_pool(
+      config_json, "user", options.num_threads);
+  mongoc_client_pool_t *social_graph_mongodb_pool = init_mongodb_client_pool(
+      config_json, "social-graph", options.num_threads);
+  if (user_mongodb_pool == nullptr || social_graph_mongodb_pool == nullptr) {
+    return EXIT_FAILURE;
+  }
+
+  bool ok;
+  auto load_start = steady_clock::now();
+  if (vm["redis-cluster"].as<bool>() || redis_cluster_config_flag) {
+    RedisCluster redis =
+        init_redis_cluster_client_pool(config_json, "social-graph");
+    ok = Load(options, graph, user_mongodb_pool, social_graph_mongodb_pool,
+              &redis);
+  } else if (redis_replica_config_flag) {
+    Redis redis = init_redis_replica_client_pool(config_json, "redis-primary");
+    ok = Load(options, graph, user_mongodb_pool, social_graph_mongodb_pool,
+              &redis);
+  } else {
+    Redis redis = init_redis_client_pool(config_json, "social-graph");
+    ok = Load(options, graph, user_mongodb_pool, social_graph_mongodb_pool,
+              &redis);
+  }
+  double load_secs =
+      duration_cast<milliseconds>(steady_clock::now() - load_start).count() /
+      1e3;
+  LOG(info) << "Loaded " << graph.num_edges << " edges of " << graph.num_nodes
+            << " users in " << load_secs << " s ("
+            << static_cast<int64_t>(graph.num_edges /
+                                    std::max(load_secs, 1e-3))
+            << " edges/s)";
+
+  mongoc_client_pool_destroy(social_graph_mongodb_pool);
+  mongoc_client_pool_destroy(user_mongodb_pool);
+  mongoc_cleanup();
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
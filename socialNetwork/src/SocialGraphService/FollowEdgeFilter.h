@@ -0,0 +1,141 @@
+#ifndef SOCIAL_NETWORK_MICROSERVICES_SRC_SOCIALGRAPHSERVICE_FOLLOWEDGEFILTER_H_
+#define SOCIAL_NETWORK_MICROSERVICES_SRC_SOCIALGRAPHSERVICE_FOLLOWEDGEFILTER_H_
+
+#include <bson/bson.h>
+#include <mongoc.h>
+
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <vector>
+
+#include "../logger.h"
+#include "../utils_bson.h"
+
+#define FOLLOW_EDGE_LOCK_STRIPES 256
+
+namespace social_network {
+
+// Bloom filter over the (follower, followee) edges of the social graph. A
+// negative answer means the edge does not exist, so Follow can push it
+// without the $not $elemMatch guard. Edges are never removed: an unfollowed
+// edge stays a false positive and simply takes the guarded path. Like the
+// graph index, it is only exact when a single social-graph-service instance
+// handles all the writes.
+class FollowEdgeFilter {
+ public:
+  FollowEdgeFilter(size_t capacity, double false_positive_rate);
+  bool Load(mongoc_client_pool_t *mongodb_client_pool);
+  // Records the edge and returns true if it was definitely absent before.
+  bool Insert(int64_t user_id, int64_t followee_id);
+  // Striped lock over edges. Follow holds it from Insert until its MongoDB
+  // write returns, so a concurrent Follow of the same edge takes the guarded
+  // path only once the first push is visible.
+  std::mutex &EdgeLock(int64_t user_id, int64_t followee_id);
+
+ private:
+  std::mutex _mtx;
+  std::mutex _edge_locks[FOLLOW_EDGE_LOCK_STRIPES];
+  std::vector<uint64_t> _bits;
+  uint64_t _num_bits;
+  int _num_hashes;
+
+  static uint64_t _Mix(uint64_t x);
+  static uint64_t _Hash(int64_t user_id, int64_t followee_id);
+};
+
+FollowEdgeFilter::FollowEdgeFilter(size_t capacity,
+                                   double false_positive_rate) {
+  double bits_per_edge =
+      -std::log(false_positive_rate) / (std::log(2.0) * std::log(2.0));
+  _num_bits = static_cast<uint64_t>(
+      std::ceil(bits_per_edge * std::max<size_t>(capacity, 1)));
+  _num_bits = std::max<uint64_t>((_num_bits + 63) / 64 * 64, 64);
+  _num_hashes = std::max(
+      1, static_cast<int>(std::round(bits_per_edge * std::log(2.0))));
+  _bits.assign(_num_bits / 64, 0);
+}
+
+// splitmix64 finalizer
+uint64_t FollowEdgeFilter::_Mix(uint64_t x) {
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  return x;
+}
+
+uint64_t FollowEdgeFilter::_Hash(int64_t user_id, int64_t followee_id) {
+  return _Mix(static_cast<uint64_t>(user_id) * 0x9e3779b97f4a7c15ULL ^
+              static_cast<uint64_t>(followee_id));
+}
+
+std::mutex &FollowEdgeFilter::EdgeLock(int64_t user_id, int64_t followee_id) {
+  return _edge_locks[_Hash(user_id, followee_id) % FOLLOW_EDGE_LOCK_STRIPES];
+}
+
+bool FollowEdgeFilter::Insert(int64_t user_id, int64_t followee_id) {
+  // Double hashing: probe i is h1 + i * h2.
+  uint64_t h1 = _Hash(user_id, followee_id);
+  uint64_t h2 = _Mix(h1) | 1;
+  bool added = false;
+  std::lock_guard<std::mutex> lock(_mtx);
+  for (int i = 0; i < _num_hashes; ++i) {
+    uint64_t bit = (h1 + i * h2) % _num_bits;
+    uint64_t mask = 1ULL << (bit & 63);
+    if (!(_bits[bit >> 6] & mask)) {
+      _bits[bit >> 6] |= mask;
+      added = true;
+    }
+  }
+  return added;
+}
+
+bool FollowEdgeFilter::Load(mongoc_client_pool_t *mongodb_client_pool) {
+  mongoc_client_t *mongodb_client = mongoc_client_pool_pop(mongodb_client_pool);
+  if (!mongodb_client) {
+    LOG(error) << "Failed to pop a client from MongoDB pool";
+    return false;
+  }
+  auto collection = mongoc_client_get_collection(
+      mongodb_client, "social-graph", "social-graph");
+  bson_t *query = bson_new();
+  bson_t *opts = BCON_NEW("projection", "{", "_id", BCON_BOOL(false),
+                          "user_id", BCON_BOOL(true), "followees",
+                          BCON_BOOL(true), "}");
+  mongoc_cursor_t *cursor =
+      mongoc_collection_find_with_opts(collection, query, opts, nullptr);
+
+  size_t edges = 0;
+  const bson_t *doc;
+  while (mongoc_cursor_next(cursor, &doc)) {
+    bson_iter_t iter;
+    if (!bson_iter_init_find(&iter, doc, "user_id")) {
+      continue;
+    }
+    int64_t user_id = bson_iter_as_int64(&iter);
+    edges += ForEachTimestampedId(doc, "followees", "user_id",
+                                  [&](int64_t followee_id, int64_t) {
+                                    Insert(user_id, followee_id);
+                                  });
+  }
+  bson_error_t error;
+  bool failed = mongoc_cursor_error(cursor, &error);
+  bson_destroy(opts);
+  bson_destroy(query);
+  mongoc_cursor_destroy(cursor);
+  mongoc_collection_destroy(collection);
+  mongoc_client_pool_push(mongodb_client_pool, mongodb_client);
+  if (failed) {
+    LOG(error) << "Failed to load the follow edge filter: " << error.message;
+    return false;
+  }
+  LOG(info) << "Loaded " << edges << " follow edges into a " << _num_bits / 8
+            << " bytes filter";
+  return true;
+}
+
+}  // namespace social_network
+
+#endif  // SOCIAL_NETWORK_MICROSERVICES_SRC_SOCIALGRAPHSERVICE_FOLLOWEDGEFILTER_H_
@@ -6,8 +6,11 @@
 #include <sw/redis++/redis++.h>
 
 #include <chrono>
+#include <cstring>
 #include <future>
 #include <iostream>
+#include <map>
+#include <mutex>
 #include <string>
 #include <thread>
 #include <vector>
@@ -15,9 +18,13 @@
 #include "../../gen-cpp/SocialGraphService.h"
 #include "../../gen-cpp/UserService.h"
 #include "../ClientPool.h"
+#include "../Executor.h"
 #include "../ThriftClient.h"
 #include "../logger.h"
 #include "../tracing.h"
+#include "../utils_bson.h"
+#include "FollowEdgeFilter.h"
+#include "SocialGraphIndex.h"
 
 using namespace sw::redis;
 
@@ -30,17 +37,26 @@ using std::chrono::system_clock;
 class SocialGraphHandler : public SocialGraphServiceIf {
  public:
   SocialGraphHandler(mongoc_client_pool_t *, Redis *,
-                     ClientPool<ThriftClient<UserServiceClient>> *);
+                     ClientPool<ThriftClient<UserServiceClient>> *,
+                     Executor *, SocialGraphIndex *, FollowEdgeFilter *);
   SocialGraphHandler(mongoc_client_pool_t *, Redis *, Redis *,
-      ClientPool<ThriftClient<UserServiceClient>>*);
+      ClientPool<ThriftClient<UserServiceClient>>*, Executor *,
+      SocialGraphIndex *, FollowEdgeFilter *);
   SocialGraphHandler(mongoc_client_pool_t *, RedisCluster *,
-                     ClientPool<ThriftClient<UserServiceClient>> *);
+                     ClientPool<ThriftClient<UserServiceClient>> *,
+                     Executor *, SocialGraphIndex *, FollowEdgeFilter *);
   ~SocialGraphHandler() override = default;
   bool IsRedisReplicationEnabled();
   void GetFollowers(std::vector<int64_t> &, int64_t, int64_t,
                     const std::map<std::string, std::string> &) override;
   void GetFollowees(std::vector<int64_t> &, int64_t, int64_t,
                     const std::map<std::string, std::string> &) override;
+  void GetFollowersBatch(std::map<int64_t, std::vector<int64_t>> &, int64_t,
+                         const std::vector<int64_t> &,
+                         const std::map<std::string, std::string> &) override;
+  void GetFolloweesBatch(std::map<int64_t, std::vector<int64_t>> &, int64_t,
+                         const std::vector<int64_t> &,
+                         const std::map<std::string, std::string> &) override;
   void Follow(int64_t, int64_t, int64_t,
               const std::map<std::string, std::string> &) override;
   void Unfollow(int64_t, int64_t, int64_t,
@@ -60,40 +76,71 @@ class SocialGraphHandler : public SocialGraphServiceIf {
   Redis *_redis_primary_client_pool;
   RedisCluster *_redis_cluster_client_pool;
   ClientPool<ThriftClient<UserServiceClient>> *_user_service_client_pool;
+  Executor *_executor;
+  // Answers GetFollowers/GetFollowees from memory when set, Redis and
+  // MongoDB are then only written to.
+  SocialGraphIndex *_graph_index;
+  // Lets Follow skip the duplicate edge check for edges known to be new.
+  FollowEdgeFilter *_edge_filter;
+
+  // Shared by GetFollowersBatch and GetFolloweesBatch, field is either
+  // "followers" or "followees".
+  void _GetBatch(std::map<int64_t, std::vector<int64_t>> *,
+                 const std::vector<int64_t> &, const char *field,
+                 const opentracing::SpanContext &);
+  // Applies the follower side and the followee side of an edge change in one
+  // bulk write. Takes ownership of the four documents.
+  void _UpdateEdges(bson_t *, bson_t *, bson_t *, bson_t *, const char *,
+                    const opentracing::SpanContext &);
 };
 
 SocialGraphHandler::SocialGraphHandler(
     mongoc_client_pool_t *mongodb_client_pool, Redis *redis_client_pool,
-    ClientPool<ThriftClient<UserServiceClient>> *user_service_client_pool) {
+    ClientPool<ThriftClient<UserServiceClient>> *user_service_client_pool,
+    Executor *executor, SocialGraphIndex *graph_index,
+    FollowEdgeFilter *edge_filter) {
   _mongodb_client_pool = mongodb_client_pool;
   _redis_client_pool = redis_client_pool;
   _redis_replica_client_pool = nullptr;
   _redis_primary_client_pool = nullptr;
   _redis_cluster_client_pool = nullptr;
   _user_service_client_pool = user_service_client_pool;
+  _executor = executor;
+  _graph_index = graph_index;
+  _edge_filter = edge_filter;
 }
 
 SocialGraphHandler::SocialGraphHandler(
     mongoc_client_pool_t* mongodb_client_pool, Redis* redis_replica_client_pool, Redis* redis_primary_client_pool,
-    ClientPool<ThriftClient<UserServiceClient>>* user_service_client_pool) {
+    ClientPool<ThriftClient<UserServiceClient>>* user_service_client_pool,
+    Executor* executor, SocialGraphIndex* graph_index,
+    FollowEdgeFilter* edge_filter) {
     _mongodb_client_pool = mongodb_client_pool;
     _redis_client_pool = nullptr;
     _redis_replica_client_pool = redis_replica_client_pool;
     _redis_primary_client_pool = redis_primary_client_pool;
     _redis_cluster_client_pool = nullptr;
     _user_service_client_pool = user_service_client_pool;
+    _executor = executor;
+    _graph_index = graph_index;
+  _edge_filter = edge_filter;
 }
 
 SocialGraphHandler::SocialGraphHandler(
     mongoc_client_pool_t *mongodb_client_pool,
     RedisCluster *redis_cluster_client_pool,
-    ClientPool<ThriftClient<UserServiceClient>> *user_service_client_pool) {
+    ClientPool<ThriftClient<UserServiceClient>> *user_service_client_pool,
+    Executor *executor, SocialGraphIndex *graph_index,
+    FollowEdgeFilter *edge_filter) {
   _mongodb_client_pool = mongodb_client_pool;
   _redis_client_pool = nullptr;
   _redis_replica_client_pool = nullptr;
   _redis_primary_client_pool = nullptr;
   _redis_cluster_client_pool = redis_cluster_client_pool;
   _user_service_client_pool = user_service_client_pool;
+  _executor = executor;
+  _graph_index = graph_index;
+  _edge_filter = edge_filter;
 }
 
 bool SocialGraphHandler::IsRedisReplicationEnabled() {
@@ -104,136 +151,16 @@ void SocialGraphHandler::Follow(
     int64_t req_id, int64_t user_id, int64_t followee_id,
     const std::map<std::string, std::string> &carrier) {
   // Initialize a span
-  TextMapReader reader(carrier);
   std::map<std::string, std::string> writer_text_map;
-  TextMapWriter writer(writer_text_map);
-  auto parent_span = opentracing::Tracer::Global()->Extract(reader);
-  auto span = opentracing::Tracer::Global()->StartSpan(
-      "follow_server", {opentracing::ChildOf(parent_span->get())});
-  opentracing::Tracer::Global()->Inject(span->context(), writer);
+  auto span = StartSpanFromCarrier("follow_server", carrier, &writer_text_map);
 
   int64_t timestamp =
       duration_cast<milliseconds>(system_clock::now().time_since_epoch())
           .count();
 
-  std::future<void> mongo_update_follower_future =
-      std::async(std::launch::async, [&]() {
-        mongoc_client_t *mongodb_client =
-            mongoc_client_pool_pop(_mongodb_client_pool);
-        if (!mongodb_client) {
-          ServiceException se;
-          se.errorCode = ErrorCode::SE_MONGODB_ERROR;
-          se.message = "Failed to pop a client from MongoDB pool";
-          throw se;
-        }
-        auto collection = mongoc_client_get_collection(
-            mongodb_client, "social-graph", "social-graph");
-        if (!collection) {
-          ServiceException se;
-          se.errorCode = ErrorCode::SE_MONGODB_ERROR;
-          se.message = "Failed to create collection social_graph from MongoDB";
-          mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
-          throw se;
-        }
-
-        // Update follower->followee edges
-        const bson_t *doc;
-        bson_t *search_not_exist = BCON_NEW(
-            "$and", "[", "{", "user_id", BCON_INT64(user_id), "}", "{",
-            "followees", "{", "$not", "{", "$elemMatch", "{", "user_id",
-            BCON_INT64(followee_id), "}", "}", "}", "}", "]");
-        bson_t *update = BCON_NEW("$push", "{", "followees", "{", "user_id",
-                                  BCON_INT64(followee_id), "timestamp",
-                                  BCON_INT64(timestamp), "}", "}");
-        bson_error_t error;
-        bson_t reply;
-        auto update_span = opentracing::Tracer::Global()->StartSpan(
-            "mongo_update_client", {opentracing::ChildOf(&span->context())});
-        bool updated = mongoc_collection_find_and_modify(
-            collection, search_not_exist, nullptr, update, nullptr, false,
-            false, true, &reply, &error);
-        if (!updated) {
-          LOG(error) << "Failed to update social graph for user " << user_id
-                     << " to MongoDB: " << error.message;
-          ServiceException se;
-          se.errorCode = ErrorCode::SE_MONGODB_ERROR;
-          se.message = error.message;
-          bson_destroy(&reply);
-          bson_destroy(update);
-          bson_destroy(search_not_exist);
-          mongoc_collection_destroy(collection);
-          mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
-          throw se;
-        }
-        update_span->Finish();
-        bson_destroy(&reply);
-        bson_destroy(update);
-        bson_destroy(search_not_exist);
-        mongoc_collection_destroy(collection);
-        mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
-      });
-
-  std::future<void> mongo_update_followee_future =
-      std::async(std::launch::async, [&]() {
-        mongoc_client_t *mongodb_client =
-            mongoc_client_pool_pop(_mongodb_client_pool);
-        if (!mongodb_client) {
-          ServiceException se;
-          se.errorCode = ErrorCode::SE_MONGODB_ERROR;
-          se.message = "Failed to pop a client from MongoDB pool";
-          throw se;
-        }
-        auto collection = mongoc_client_get_collection(
-            mongodb_client, "social-graph", "social-graph");
-        if (!collection) {
-          ServiceException se;
-          se.errorCode = ErrorCode::SE_MONGODB_ERROR;
-          se.message = "Failed to create collection social_graph from MongoDB";
-          mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
-          throw se;
-        }
-
-        // Update followee->follower edges
-        bson_t *search_not_exist =
-            BCON_NEW("$and", "[", "{", "user_id", BCON_INT64(followee_id), "}",
-                     "{", "followers", "{", "$not", "{", "$elemMatch", "{",
-                     "user_id", BCON_INT64(user_id), "}", "}", "}", "}", "]");
-        bson_t *update = BCON_NEW("$push", "{", "followers", "{", "user_id",
-                                  BCON_INT64(user_id), "timestamp",
-                                  BCON_INT64(timestamp), "}", "}");
-        bson_error_t error;
-        auto update_span = opentracing::Tracer::Global()->StartSpan(
-            "social_graph_mongo_update_client",
-            {opentracing::ChildOf(&span->context())});
-        bson_t reply;
-        bool updated = mongoc_collection_find_and_modify(
-            collection, search_not_exist, nullptr, update, nullptr, false,
-            false, true, &reply, &error);
-        if (!updated) {
-          LOG(error) << "Failed to update social graph for user " << followee_id
-                     << " to MongoDB: " << error.message;
-          ServiceException se;
-          se.errorCode = ErrorCode::SE_MONGODB_ERROR;
-          se.message = error.message;
-          bson_destroy(update);
-          bson_destroy(&reply);
-          bson_destroy(search_not_exist);
-          mongoc_collection_destroy(collection);
-          mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
-          throw se;
-        }
-        update_span->Finish();
-        bson_destroy(update);
-        bson_destroy(&reply);
-        bson_destroy(search_not_exist);
-        mongoc_collection_destroy(collection);
-        mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
-      });
-
-  std::future<void> redis_update_future = std::async(std::launch::async, [&]() {
-    auto redis_span = opentracing::Tracer::Global()->StartSpan(
-        "social_graph_redis_update_client",
-        {opentracing::ChildOf(&span->context())});
+  std::future<void> redis_update_future = _executor->Submit([&]() {
+    auto redis_span = StartChildSpan(
+        "social_graph_redis_update_client", span->context());
 
     {
       if (_redis_client_pool) {
@@ -286,15 +213,52 @@ void SocialGraphHandler::Follow(
     redis_span->Finish();
   });
 
+  // An edge the filter has never seen cannot be in the lists yet, so it is
+  // pushed without the $not $elemMatch guard. The edge lock keeps a
+  // concurrent Follow of the same edge from checking before the push lands.
+  std::unique_lock<std::mutex> edge_lock;
+  if (_edge_filter) {
+    edge_lock = std::unique_lock<std::mutex>(
+        _edge_filter->EdgeLock(user_id, followee_id));
+  }
+  bool new_edge = _edge_filter && _edge_filter->Insert(user_id, followee_id);
+  bson_t *follower_query;
+  bson_t *followee_query;
+  if (new_edge) {
+    follower_query = BCON_NEW("user_id", BCON_INT64(user_id));
+    followee_query = BCON_NEW("user_id", BCON_INT64(followee_id));
+  } else {
+    follower_query = BCON_NEW(
+        "$and", "[", "{", "user_id", BCON_INT64(user_id), "}", "{",
+        "followees", "{", "$not", "{", "$elemMatch", "{", "user_id",
+        BCON_INT64(followee_id), "}", "}", "}", "}", "]");
+    followee_query = BCON_NEW(
+        "$and", "[", "{", "user_id", BCON_INT64(followee_id), "}", "{",
+        "followers", "{", "$not", "{", "$elemMatch", "{", "user_id",
+        BCON_INT64(user_id), "}", "}", "}", "}", "]");
+  }
+  bson_t *follower_update =
+      BCON_NEW("$push", "{", "followees", "{", "user_id",
+               BCON_INT64(followee_id), "timestamp", BCON_INT64(timestamp),
+               "}", "}");
+  bson_t *followee_update =
+      BCON_NEW("$push", "{", "followers", "{", "user_id", BCON_INT64(user_id),
+               "timestamp", BCON_INT64(timestamp), "}", "}");
+
   try {
+    _UpdateEdges(follower_query, follower_update, followee_query,
+                 followee_update, "social_graph_mongo_update_client",
+                 span->context());
+    if (edge_lock.owns_lock()) {
+      edge_lock.unlock();
+    }
     redis_update_future.get();
-    mongo_update_follower_future.get();
-    mongo_update_followee_future.get();
   } catch (const std::exception &e) {
     LOG(warning) << e.what();
     throw;
-  } catch (...) {
-    throw;
+  }
+  if (_graph_index) {
+    _graph_index->Follow(user_id, followee_id);
   }
 
   span->Finish();
@@ -304,126 +268,13 @@ void SocialGraphHandler::Unfollow(
     int64_t req_id, int64_t user_id, int64_t followee_id,
     const std::map<std::string, std::string> &carrier) {
   // Initialize a span
-  TextMapReader reader(carrier);
   std::map<std::string, std::string> writer_text_map;
-  TextMapWriter writer(writer_text_map);
-  auto parent_span = opentracing::Tracer::Global()->Extract(reader);
-  auto span = opentracing::Tracer::Global()->StartSpan(
-      "unfollow_server", {opentracing::ChildOf(parent_span->get())});
-  opentracing::Tracer::Global()->Inject(span->context(), writer);
-
-  std::future<void> mongo_update_follower_future =
-      std::async(std::launch::async, [&]() {
-        mongoc_client_t *mongodb_client =
-            mongoc_client_pool_pop(_mongodb_client_pool);
-        if (!mongodb_client) {
-          ServiceException se;
-          se.errorCode = ErrorCode::SE_MONGODB_ERROR;
-          se.message = "Failed to pop a client from MongoDB pool";
-          throw se;
-        }
-        auto collection = mongoc_client_get_collection(
-            mongodb_client, "social-graph", "social-graph");
-        if (!collection) {
-          ServiceException se;
-          se.errorCode = ErrorCode::SE_MONGODB_ERROR;
-          se.message = "Failed to create collection social_graph from MongoDB";
-          mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
-          throw se;
-        }
-        bson_t *query = bson_new();
-
-        // Update follower->followee edges
-        BSON_APPEND_INT64(query, "user_id", user_id);
-        bson_t *update = BCON_NEW("$pull", "{", "followees", "{", "user_id",
-                                  BCON_INT64(followee_id), "}", "}");
-        bson_t reply;
-        bson_error_t error;
-        auto update_span = opentracing::Tracer::Global()->StartSpan(
-            "social_graph_mongo_delete_client",
-            {opentracing::ChildOf(&span->context())});
-        bool updated = mongoc_collection_find_and_modify(
-            collection, query, nullptr, update, nullptr, false, false, true,
-            &reply, &error);
-        if (!updated) {
-          LOG(error) << "Failed to delete social graph for user " << user_id
-                     << " to MongoDB: " << error.message;
-          ServiceException se;
-          se.errorCode = ErrorCode::SE_MONGODB_ERROR;
-          se.message = error.message;
-          bson_destroy(update);
-          bson_destroy(query);
-          bson_destroy(&reply);
-          mongoc_collection_destroy(collection);
-          mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
-          throw se;
-        }
-        update_span->Finish();
-        bson_destroy(update);
-        bson_destroy(query);
-        bson_destroy(&reply);
-        mongoc_collection_destroy(collection);
-        mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
-      });
-
-  std::future<void> mongo_update_followee_future =
-      std::async(std::launch::async, [&]() {
-        mongoc_client_t *mongodb_client =
-            mongoc_client_pool_pop(_mongodb_client_pool);
-        if (!mongodb_client) {
-          ServiceException se;
-          se.errorCode = ErrorCode::SE_MONGODB_ERROR;
-          se.message = "Failed to pop a client from MongoDB pool";
-          throw se;
-        }
-        auto collection = mongoc_client_get_collection(
-            mongodb_client, "social-graph", "social-graph");
-        if (!collection) {
-          ServiceException se;
-          se.errorCode = ErrorCode::SE_MONGODB_ERROR;
-          se.message = "Failed to create collection social_graph from MongoDB";
-          mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
-          throw se;
-        }
-        bson_t *query = bson_new();
-
-        // Update followee->follower edges
-        BSON_APPEND_INT64(query, "user_id", followee_id);
-        bson_t *update = BCON_NEW("$pull", "{", "followers", "{", "user_id",
-                                  BCON_INT64(user_id), "}", "}");
-        bson_t reply;
-        bson_error_t error;
-        auto update_span = opentracing::Tracer::Global()->StartSpan(
-            "social_graph_mongo_delete_client",
-            {opentracing::ChildOf(&span->context())});
-        bool updated = mongoc_collection_find_and_modify(
-            collection, query, nullptr, update, nullptr, false, false, true,
-            &reply, &error);
-        if (!updated) {
-          LOG(error) << "Failed to delete social graph for user " << followee_id
-                     << " to MongoDB: " << error.message;
-          ServiceException se;
-          se.errorCode = ErrorCode::SE_MONGODB_ERROR;
-          se.message = error.message;
-          bson_destroy(update);
-          bson_destroy(query);
-          bson_destroy(&reply);
-          mongoc_collection_destroy(collection);
-          mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
-          throw se;
-        }
-        update_span->Finish();
-        bson_destroy(update);
-        bson_destroy(query);
-        bson_destroy(&reply);
-        mongoc_collection_destroy(collection);
-        mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
-      });
+  auto span = StartSpanFromCarrier(
+      "unfollow_server", carrier, &writer_text_map);
 
-  std::future<void> redis_update_future = std::async(std::launch::async, [&]() {
-    auto redis_span = opentracing::Tracer::Global()->StartSpan(
-        "social_graph_redis_update_client",
-        {opentracing::ChildOf(&span->context())});
+  std::future<void> redis_update_future = _executor->Submit([&]() {
+    auto redis_span = StartChildSpan(
+        "social_graph_redis_update_client", span->context());
     {
       if (_redis_client_pool) {
         auto pipe = _redis_client_pool->pipeline(false);
@@ -471,32 +322,103 @@ void SocialGraphHandler::Unfollow(
     redis_span->Finish();
   });
 
-  try {
-    redis_update_future.get();
-    mongo_update_follower_future.get();
-    mongo_update_followee_future.get();
-  } catch (...) {
-    throw;
+  bson_t *follower_query = BCON_NEW("user_id", BCON_INT64(user_id));
+  bson_t *followee_query = BCON_NEW("user_id", BCON_INT64(followee_id));
+  bson_t *follower_update = BCON_NEW("$pull", "{", "followees", "{", "user_id",
+                                     BCON_INT64(followee_id), "}", "}");
+  bson_t *followee_update = BCON_NEW("$pull", "{", "followers", "{", "user_id",
+                                     BCON_INT64(user_id), "}", "}");
+
+  _UpdateEdges(follower_query, follower_update, followee_query,
+               followee_update, "social_graph_mongo_delete_client",
+               span->context());
+  redis_update_future.get();
+  if (_graph_index) {
+    _graph_index->Unfollow(user_id, followee_id);
   }
 
   span->Finish();
 }
 
+void SocialGraphHandler::_UpdateEdges(bson_t *follower_query,
+                                      bson_t *follower_update,
+                                      bson_t *followee_query,
+                                      bson_t *followee_update,
+                                      const char *span_name,
+                                      const opentracing::SpanContext &parent) {
+  auto destroy_docs = [&]() {
+    bson_destroy(follower_query);
+    bson_destroy(follower_update);
+    bson_destroy(followee_query);
+    bson_destroy(followee_update);
+  };
+  mongoc_client_t *mongodb_client =
+      mongoc_client_pool_pop(_mongodb_client_pool);
+  if (!mongodb_client) {
+    destroy_docs();
+    ServiceException se;
+    se.errorCode = ErrorCode::SE_MONGODB_ERROR;
+    se.message = "Failed to pop a client from MongoDB pool";
+    throw se;
+  }
+  auto collection = mongoc_client_get_collection(
+      mongodb_client, "social-graph", "social-graph");
+  if (!collection) {
+    destroy_docs();
+    ServiceException se;
+    se.errorCode = ErrorCode::SE_MONGODB_ERROR;
+    se.message = "Failed to create collection social_graph from MongoDB";
+    mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
+    throw se;
+  }
+
+  // Both sides of the edge go to the server in a single unordered bulk write.
+  bson_t *opts = BCON_NEW("ordered", BCON_BOOL(false));
+  mongoc_bulk_operation_t *bulk =
+      mongoc_collection_create_bulk_operation_with_opts(collection, opts);
+  bson_error_t error;
+  bson_t reply;
+  bool ok = mongoc_bulk_operation_update_one_with_opts(
+                bulk, follower_query, follower_update, nullptr, &error) &&
+      mongoc_bulk_operation_update_one_with_opts(
+                bulk, followee_query, followee_update, nullptr, &error);
+  auto update_span = StartChildSpan(span_name, parent);
+  if (ok) {
+    ok = mongoc_bulk_operation_execute(bulk, &reply, &error);
+    bson_destroy(&reply);
+  }
+  update_span->Finish();
+  mongoc_bulk_operation_destroy(bulk);
+  bson_destroy(opts);
+  destroy_docs();
+  mongoc_collection_destroy(collection);
+  mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
+  if (!ok) {
+    LOG(error) << "Failed to update social graph to MongoDB: "
+               << error.message;
+    ServiceException se;
+    se.errorCode = ErrorCode::SE_MONGODB_ERROR;
+    se.message = error.message;
+    throw se;
+  }
+}
+
 void SocialGraphHandler::GetFollowers(
     std::vector<int64_t> &_return, const int64_t req_id, const int64_t user_id,
     const std::map<std::string, std::string> &carrier) {
   // Initialize a span
-  TextMapReader reader(carrier);
   std::map<std::string, std::string> writer_text_map;
-  TextMapWriter writer(writer_text_map);
-  auto parent_span = opentracing::Tracer::Global()->Extract(reader);
-  auto span = opentracing::Tracer::Global()->StartSpan(
-      "get_followers_server", {opentracing::ChildOf(parent_span->get())});
-  opentracing::Tracer::Global()->Inject(span->context(), writer);
+  auto span = StartSpanFromCarrier(
+      "get_followers_server", carrier, &writer_text_map);
+
+  if (_graph_index) {
+    _graph_index->GetFollowers(user_id, &_return);
+    span->Finish();
+    return;
+  }
 
-  auto redis_span = opentracing::Tracer::Global()->StartSpan(
-      "social_graph_redis_get_client",
-      {opentracing::ChildOf(&span->context())});
+  auto redis_span = StartChildSpan(
+      "social_graph_redis_get_client", span->context());
 
   std::vector<std::string> followers_str;
   std::string key = std::to_string(user_id) + ":followers";
@@ -545,42 +467,21 @@ void SocialGraphHandler::GetFollowers(
     }
     bson_t *query = bson_new();
     BSON_APPEND_INT64(query, "user_id", user_id);
-    auto find_span = opentracing::Tracer::Global()->StartSpan(
-        "social_graph_mongo_find_client",
-        {opentracing::ChildOf(&span->context())});
+    auto find_span = StartChildSpan(
+        "social_graph_mongo_find_client", span->context());
     mongoc_cursor_t *cursor =
         mongoc_collection_find_with_opts(collection, query, nullptr, nullptr);
     const bson_t *doc;
     bool found = mongoc_cursor_next(cursor, &doc);
     if (found) {
-      bson_iter_t iter_0;
-      bson_iter_t iter_1;
-      bson_iter_t user_id_child;
-      bson_iter_t timestamp_child;
-      int index = 0;
-      std::unordered_map<std::string, double> redis_zset;
-      bson_iter_init(&iter_0, doc);
-      bson_iter_init(&iter_1, doc);
-
-      while (bson_iter_find_descendant(
-                 &iter_0,
-                 ("followers." + std::to_string(index) + ".user_id").c_str(),
-                 &user_id_child) &&
-             BSON_ITER_HOLDS_INT64(&user_id_child) &&
-             bson_iter_find_descendant(
-                 &iter_1,
-                 ("followers." + std::to_string(index) + ".timestamp").c_str(),
-                 &timestamp_child) &&
-             BSON_ITER_HOLDS_INT64(&timestamp_child)) {
-        auto iter_user_id = bson_iter_int64(&user_id_child);
-        auto iter_timestamp = bson_iter_int64(&timestamp_child);
-        _return.emplace_back(iter_user_id);
-        redis_zset.emplace(std::pair<std::string, double>(
-            std::to_string(iter_user_id), (double)iter_timestamp));
-        bson_iter_init(&iter_0, doc);
-        bson_iter_init(&iter_1, doc);
-        index++;
-      }
+      std::vector<std::pair<std::string, double>> redis_zset;
+      ForEachTimestampedId(
+          doc, "followers", "user_id",
+          [&](int64_t follower_id, int64_t timestamp) {
+            _return.emplace_back(follower_id);
+            redis_zset.emplace_back(std::to_string(follower_id),
+                                    static_cast<double>(timestamp));
+          });
       find_span->Finish();
       bson_destroy(query);
       mongoc_cursor_destroy(cursor);
@@ -589,9 +490,8 @@ void SocialGraphHandler::GetFollowers(
 
       // Update Redis
       std::string key = std::to_string(user_id) + ":followers";
-      auto redis_insert_span = opentracing::Tracer::Global()->StartSpan(
-          "social_graph_redis_insert_client",
-          {opentracing::ChildOf(&span->context())});
+      auto redis_insert_span = StartChildSpan(
+          "social_graph_redis_insert_client", span->context());
       try {
         if (_redis_client_pool) {
           _redis_client_pool->zadd(key, redis_zset.begin(), redis_zset.end());
@@ -624,17 +524,18 @@ void SocialGraphHandler::GetFollowees(
     std::vector<int64_t> &_return, const int64_t req_id, const int64_t user_id,
     const std::map<std::string, std::string> &carrier) {
   // Initialize a span
-  TextMapReader reader(carrier);
   std::map<std::string, std::string> writer_text_map;
-  TextMapWriter writer(writer_text_map);
-  auto parent_span = opentracing::Tracer::Global()->Extract(reader);
-  auto span = opentracing::Tracer::Global()->StartSpan(
-      "get_followees_server", {opentracing::ChildOf(parent_span->get())});
-  opentracing::Tracer::Global()->Inject(span->context(), writer);
+  auto span = StartSpanFromCarrier(
+      "get_followees_server", carrier, &writer_text_map);
+
+  if (_graph_index) {
+    _graph_index->GetFollowees(user_id, &_return);
+    span->Finish();
+    return;
+  }
 
-  auto redis_span = opentracing::Tracer::Global()->StartSpan(
-      "social_graph_redis_get_client",
-      {opentracing::ChildOf(&span->context())});
+  auto redis_span = StartChildSpan(
+      "social_graph_redis_get_client", span->context());
 
   std::vector<std::string> followees_str;
   std::string key = std::to_string(user_id) + ":followees";
@@ -684,9 +585,8 @@ void SocialGraphHandler::GetFollowees(
     }
     bson_t *query = bson_new();
     BSON_APPEND_INT64(query, "user_id", user_id);
-    auto find_span = opentracing::Tracer::Global()->StartSpan(
-        "social_graph_mongo_find_client",
-        {opentracing::ChildOf(&span->context())});
+    auto find_span = StartChildSpan(
+        "social_graph_mongo_find_client", span->context());
     mongoc_cursor_t *cursor =
         mongoc_collection_find_with_opts(collection, query, nullptr, nullptr);
     const bson_t *doc;
@@ -701,37 +601,14 @@ void SocialGraphHandler::GetFollowees(
       mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
       throw se;
     } else {
-      bson_iter_t iter_0;
-      bson_iter_t iter_1;
-      bson_iter_t user_id_child;
-      bson_iter_t timestamp_child;
-      int index = 0;
-
-      bson_iter_init(&iter_0, doc);
-      bson_iter_init(&iter_1, doc);
-
-      std::multimap<std::string, double> redis_zset;
-
-      while (bson_iter_find_descendant(
-                 &iter_0,
-                 ("followees." + std::to_string(index) + ".user_id").c_str(),
-                 &user_id_child) &&
-             BSON_ITER_HOLDS_INT64(&user_id_child) &&
-             bson_iter_find_descendant(
-                 &iter_1,
-                 ("followees." + std::to_string(index) + ".timestamp").c_str(),
-                 &timestamp_child) &&
-             BSON_ITER_HOLDS_INT64(&timestamp_child)) {
-        auto iter_user_id = bson_iter_int64(&user_id_child);
-        auto iter_timestamp = bson_iter_int64(&timestamp_child);
-        _return.emplace_back(iter_user_id);
-
-        redis_zset.emplace(std::pair<std::string, double>(
-            std::to_string(iter_user_id), (double)iter_timestamp));
-        bson_iter_init(&iter_0, doc);
-        bson_iter_init(&iter_1, doc);
-        index++;
-      }
+      std::vector<std::pair<std::string, double>> redis_zset;
+      ForEachTimestampedId(
+          doc, "followees", "user_id",
+          [&](int64_t followee_id, int64_t timestamp) {
+            _return.emplace_back(followee_id);
+            redis_zset.emplace_back(std::to_string(followee_id),
+                                    static_cast<double>(timestamp));
+          });
 
       find_span->Finish();
       bson_destroy(query);
@@ -741,9 +618,8 @@ void SocialGraphHandler::GetFollowees(
 
       // Update redis
       std::string key = std::to_string(user_id) + ":followees";
-      auto redis_insert_span = opentracing::Tracer::Global()->StartSpan(
-          "social_graph_redis_insert_client",
-          {opentracing::ChildOf(&span->context())});
+      auto redis_insert_span = StartChildSpan(
+          "social_graph_redis_insert_client", span->context());
       try {
         if (_redis_client_pool) {
           _redis_client_pool->zadd(key, redis_zset.begin(), redis_zset.end());
@@ -765,17 +641,272 @@ void SocialGraphHandler::GetFollowees(
   span->Finish();
 }
 
+void SocialGraphHandler::GetFollowersBatch(
+    std::map<int64_t, std::vector<int64_t>> &_return, const int64_t req_id,
+    const std::vector<int64_t> &user_ids,
+    const std::map<std::string, std::string> &carrier) {
+  // Initialize a span
+  std::map<std::string, std::string> writer_text_map;
+  auto span = StartSpanFromCarrier(
+      "get_followers_batch_server", carrier, &writer_text_map);
+
+  _GetBatch(&_return, user_ids, "followers", span->context());
+  span->Finish();
+}
+
+void SocialGraphHandler::GetFolloweesBatch(
+    std::map<int64_t, std::vector<int64_t>> &_return, const int64_t req_id,
+    const std::vector<int64_t> &user_ids,
+    const std::map<std::string, std::string> &carrier) {
+  // Initialize a span
+  std::map<std::string, std::string> writer_text_map;
+  auto span = StartSpanFromCarrier(
+      "get_followees_batch_server", carrier, &writer_text_map);
+
+  _GetBatch(&_return, user_ids, "followees", span->context());
+  span->Finish();
+}
+
+void SocialGraphHandler::_GetBatch(
+    std::map<int64_t, std::vector<int64_t>> *_return,
+    const std::vector<int64_t> &user_ids, const char *field,
+    const opentracing::SpanContext &parent) {
+  bool followers = std::strcmp(field, "followers") == 0;
+  // Every requested user gets an entry, empty if unknown.
+  for (auto user_id : user_ids) {
+    (*_return)[user_id];
+  }
+  if (_return->empty()) {
+    return;
+  }
+
+  if (_graph_index) {
+    for (auto &entry : *_return) {
+      if (followers) {
+        _graph_index->GetFollowers(entry.first, &entry.second);
+      } else {
+        _graph_index->GetFollowees(entry.first, &entry.second);
+      }
+    }
+    return;
+  }
+
+  std::string suffix = std::string(":") + field;
+  std::vector<int64_t> ids;
+  std::vector<std::string> keys;
+  ids.reserve(_return->size());
+  keys.reserve(_return->size());
+  for (auto &entry : *_return) {
+    ids.emplace_back(entry.first);
+    keys.emplace_back(std::to_string(entry.first) + suffix);
+  }
+
+  // Read every list from Redis in one round trip per server.
+  auto redis_span = StartChildSpan("social_graph_redis_get_client", parent);
+  std::vector<std::vector<std::string>> members(keys.size());
+  try {
+    if (_redis_client_pool || IsRedisReplicationEnabled()) {
+      Redis *redis = _redis_client_pool ? _redis_client_pool
+                                        : _redis_replica_client_pool;
+      auto pipe = redis->pipeline(false);
+      for (auto &key : keys) {
+        pipe.zrange(key, 0, -1);
+      }
+      auto replies = pipe.exec();
+      for (size_t i = 0; i < keys.size(); ++i) {
+        replies.get(i, std::back_inserter(members[i]));
+      }
+    } else {
+      // Group the keys by the shard that owns them, one pipeline per shard.
+      // Each pipeline remembers which keys it read to place its replies.
+      std::map<std::shared_ptr<ConnectionPool>,
+               std::pair<std::shared_ptr<Pipeline>, std::vector<size_t>>>
+          pipe_map;
+      auto *shards_pool = _redis_cluster_client_pool->get_shards_pool();
+      for (size_t i = 0; i < keys.size(); ++i) {
+        auto conn = shards_pool->fetch(keys[i]);
+        auto pipe = pipe_map.find(conn);
+        if (pipe == pipe_map.end()) {
+          auto new_pipe = std::make_shared<Pipeline>(
+              _redis_cluster_client_pool->pipeline(keys[i], false));
+          pipe = pipe_map
+                     .emplace(conn, std::make_pair(new_pipe,
+                                                   std::vector<size_t>()))
+                     .first;
+        }
+        pipe->second.first->zrange(keys[i], 0, -1);
+        pipe->second.second.emplace_back(i);
+      }
+      for (auto &it : pipe_map) {
+        auto replies = it.second.first->exec();
+        auto &indices = it.second.second;
+        for (size_t j = 0; j < indices.size(); ++j) {
+          replies.get(j, std::back_inserter(members[indices[j]]));
+        }
+      }
+    }
+  } catch (const Error &err) {
+    LOG(error) << err.what();
+    throw err;
+  }
+  redis_span->Finish();
+
+  std::vector<int64_t> missed;
+  for (size_t i = 0; i < ids.size(); ++i) {
+    if (members[i].empty()) {
+      missed.emplace_back(ids[i]);
+      continue;
+    }
+    auto &list = (*_return)[ids[i]];
+    list.reserve(members[i].size());
+    for (auto const &member : members[i]) {
+      list.emplace_back(std::stoul(member));
+    }
+  }
+  if (missed.empty()) {
+    return;
+  }
+
+  // Resolve all the misses with a single query on MongoDB.
+  mongoc_client_t *mongodb_client =
+      mongoc_client_pool_pop(_mongodb_client_pool);
+  if (!mongodb_client) {
+    ServiceException se;
+    se.errorCode = ErrorCode::SE_MONGODB_ERROR;
+    se.message = "Failed to pop a client from MongoDB pool";
+    throw se;
+  }
+  auto collection = mongoc_client_get_collection(
+      mongodb_client, "social-graph", "social-graph");
+  if (!collection) {
+    ServiceException se;
+    se.errorCode = ErrorCode::SE_MONGODB_ERROR;
+    se.message = "Failed to create collection social_graph from MongoDB";
+    mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
+    throw se;
+  }
+
+  bson_t *query = bson_new();
+  bson_t query_child;
+  bson_t query_user_id_list;
+  const char *key;
+  char buf[16];
+  BSON_APPEND_DOCUMENT_BEGIN(query, "user_id", &query_child);
+  BSON_APPEND_ARRAY_BEGIN(&query_child, "$in", &query_user_id_list);
+  uint32_t idx = 0;
+  for (auto user_id : missed) {
+    bson_uint32_to_string(idx, &key, buf, sizeof buf);
+    BSON_APPEND_INT64(&query_user_id_list, key, user_id);
+    idx++;
+  }
+  bson_append_array_end(&query_child, &query_user_id_list);
+  bson_append_document_end(query, &query_child);
+  bson_t *opts = BCON_NEW("projection", "{", "_id", BCON_BOOL(false),
+                          "user_id", BCON_BOOL(true), field, BCON_BOOL(true),
+                          "}");
+
+  auto find_span = StartChildSpan("social_graph_mongo_find_client", parent);
+  mongoc_cursor_t *cursor =
+      mongoc_collection_find_with_opts(collection, query, opts, nullptr);
+  std::map<int64_t, std::vector<std::pair<std::string, double>>> redis_zsets;
+  const bson_t *doc;
+  while (mongoc_cursor_next(cursor, &doc)) {
+    bson_iter_t iter;
+    if (!bson_iter_init_find(&iter, doc, "user_id")) {
+      continue;
+    }
+    int64_t user_id = bson_iter_as_int64(&iter);
+    auto entry = _return->find(user_id);
+    if (entry == _return->end()) {
+      continue;
+    }
+    auto &redis_zset = redis_zsets[user_id];
+    ForEachTimestampedId(doc, field, "user_id",
+                         [&](int64_t other_id, int64_t timestamp) {
+                           entry->second.emplace_back(other_id);
+                           redis_zset.emplace_back(
+                               std::to_string(other_id),
+                               static_cast<double>(timestamp));
+                         });
+  }
+  bson_error_t error;
+  bool failed = mongoc_cursor_error(cursor, &error);
+  find_span->Finish();
+  bson_destroy(opts);
+  bson_destroy(query);
+  mongoc_cursor_destroy(cursor);
+  mongoc_collection_destroy(collection);
+  mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
+  if (failed) {
+    LOG(error) << error.message;
+    ServiceException se;
+    se.errorCode = ErrorCode::SE_MONGODB_ERROR;
+    se.message = error.message;
+    throw se;
+  }
+  for (auto user_id : missed) {
+    if (redis_zsets.find(user_id) == redis_zsets.end()) {
+      LOG(warning) << "user_id: " << user_id << " not found";
+    }
+  }
+
+  // Update Redis with one pipeline per server, users with an empty list
+  // have nothing to cache.
+  auto redis_insert_span = StartChildSpan(
+      "social_graph_redis_insert_client", parent);
+  try {
+    if (_redis_client_pool || IsRedisReplicationEnabled()) {
+      Redis *redis = _redis_client_pool ? _redis_client_pool
+                                        : _redis_primary_client_pool;
+      auto pipe = redis->pipeline(false);
+      for (auto &redis_zset : redis_zsets) {
+        if (!redis_zset.second.empty()) {
+          pipe.zadd(std::to_string(redis_zset.first) + suffix,
+                    redis_zset.second.begin(), redis_zset.second.end());
+        }
+      }
+      pipe.exec();
+    } else {
+      // One pipeline per shard, as for the reads above.
+      std::map<std::shared_ptr<ConnectionPool>, std::shared_ptr<Pipeline>>
+          pipe_map;
+      auto *shards_pool = _redis_cluster_client_pool->get_shards_pool();
+      for (auto &redis_zset : redis_zsets) {
+        if (redis_zset.second.empty()) {
+          continue;
+        }
+        std::string key = std::to_string(redis_zset.first) + suffix;
+        auto conn = shards_pool->fetch(key);
+        auto pipe = pipe_map.find(conn);
+        if (pipe == pipe_map.end()) {
+          pipe = pipe_map
+                     .emplace(conn,
+                              std::make_shared<Pipeline>(
+                                  _redis_cluster_client_pool->pipeline(
+                                      key, false)))
+                     .first;
+        }
+        pipe->second->zadd(key, redis_zset.second.begin(),
+                           redis_zset.second.end());
+      }
+      for (auto &it : pipe_map) {
+        it.second->exec();
+      }
+    }
+  } catch (const Error &err) {
+    LOG(error) << err.what();
+    throw err;
+  }
+  redis_insert_span->Finish();
+}
+
 void SocialGraphHandler::InsertUser(
     int64_t req_id, int64_t user_id,
     const std::map<std::string, std::string> &carrier) {
   // Initialize a span
-  TextMapReader reader(carrier);
   std::map<std::string, std::string> writer_text_map;
-  TextMapWriter writer(writer_text_map);
-  auto parent_span = opentracing::Tracer::Global()->Extract(reader);
-  auto span = opentracing::Tracer::Global()->StartSpan(
-      "insert_user_server", {opentracing::ChildOf(parent_span->get())});
-  opentracing::Tracer::Global()->Inject(span->context(), writer);
+  auto span = StartSpanFromCarrier(
+      "insert_user_server", carrier, &writer_text_map);
 
   mongoc_client_t *mongodb_client =
       mongoc_client_pool_pop(_mongodb_client_pool);
@@ -798,9 +929,8 @@ void SocialGraphHandler::InsertUser(
   bson_t *new_doc = BCON_NEW("user_id", BCON_INT64(user_id), "followers", "[",
                              "]", "followees", "[", "]");
   bson_error_t error;
-  auto insert_span = opentracing::Tracer::Global()->StartSpan(
-      "social_graph_mongo_insert_client",
-      {opentracing::ChildOf(&span->context())});
+  auto insert_span = StartChildSpan(
+      "social_graph_mongo_insert_client", span->context());
   bool inserted = mongoc_collection_insert_one(collection, new_doc, nullptr,
                                                nullptr, &error);
   insert_span->Finish();
@@ -826,16 +956,11 @@ void SocialGraphHandler::FollowWithUsername(
     const std::string &followee_name,
     const std::map<std::string, std::string> &carrier) {
   // Initialize a span
-  TextMapReader reader(carrier);
   std::map<std::string, std::string> writer_text_map;
-  TextMapWriter writer(writer_text_map);
-  auto parent_span = opentracing::Tracer::Global()->Extract(reader);
-  auto span = opentracing::Tracer::Global()->StartSpan(
-      "follow_with_username_server",
-      {opentracing::ChildOf(parent_span->get())});
-  opentracing::Tracer::Global()->Inject(span->context(), writer);
-
-  std::future<int64_t> user_id_future = std::async(std::launch::async, [&]() {
+  auto span = StartSpanFromCarrier(
+      "follow_with_username_server", carrier, &writer_text_map);
+
+  std::future<int64_t> user_id_future = _executor->Submit([&]() {
     auto user_client_wrapper = _user_service_client_pool->Pop();
     if (!user_client_wrapper) {
       ServiceException se;
@@ -857,7 +982,7 @@ void SocialGraphHandler::FollowWithUsername(
   });
 
   std::future<int64_t> followee_id_future =
-      std::async(std::launch::async, [&]() {
+      _executor->Submit([&]() {
         auto user_client_wrapper = _user_service_client_pool->Pop();
         if (!user_client_wrapper) {
           ServiceException se;
@@ -900,16 +1025,11 @@ void SocialGraphHandler::UnfollowWithUsername(
     const std::string &followee_name,
     const std::map<std::string, std::string> &carrier) {
   // Initialize a span
-  TextMapReader reader(carrier);
   std::map<std::string, std::string> writer_text_map;
-  TextMapWriter writer(writer_text_map);
-  auto parent_span = opentracing::Tracer::Global()->Extract(reader);
-  auto span = opentracing::Tracer::Global()->StartSpan(
-      "unfollow_with_username_server",
-      {opentracing::ChildOf(parent_span->get())});
-  opentracing::Tracer::Global()->Inject(span->context(), writer);
-
-  std::future<int64_t> user_id_future = std::async(std::launch::async, [&]() {
+  auto span = StartSpanFromCarrier(
+      "unfollow_with_username_server", carrier, &writer_text_map);
+
+  std::future<int64_t> user_id_future = _executor->Submit([&]() {
     auto user_client_wrapper = _user_service_client_pool->Pop();
     if (!user_client_wrapper) {
       ServiceException se;
@@ -931,7 +1051,7 @@ void SocialGraphHandler::UnfollowWithUsername(
   });
 
   std::future<int64_t> followee_id_future =
-      std::async(std::launch::async, [&]() {
+      _executor->Submit([&]() {
         auto user_client_wrapper = _user_service_client_pool->Pop();
         if (!user_client_wrapper) {
           ServiceException se;
@@ -0,0 +1,283 @@
+#ifndef SOCIAL_NETWORK_MICROSERVICES_SRC_SOCIALGRAPHSERVICE_SOCIALGRAPHINDEX_H_
+#define SOCIAL_NETWORK_MICROSERVICES_SRC_SOCIALGRAPHSERVICE_SOCIALGRAPHINDEX_H_
+
+#include <bson/bson.h>
+#include <mongoc.h>
+
+#include <algorithm>
+#include <iterator>
+#include <mutex>
+#include <set>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../logger.h"
+#include "../utils_bson.h"
+
+namespace social_network {
+
+// One direction of the social graph (followers or followees) held in memory.
+// Each user's list is sorted by user id and stored as varint encoded gaps,
+// a few bytes per edge. The lists loaded at startup are packed back to back
+// in one buffer indexed by row offsets (CSR). Updates go to a small per-row
+// delta that is folded into a re-encoded copy of the row once it grows past
+// MAX_ROW_DELTA entries.
+class AdjacencyIndex {
+ public:
+  // Replaces the content of the index. Lists are consumed.
+  void Build(std::unordered_map<int64_t, std::vector<int64_t>> *lists);
+  // Sets *out to the sorted list of user_id, empty if unknown.
+  void Get(int64_t user_id, std::vector<int64_t> *out) const;
+  void Add(int64_t user_id, int64_t other_id);
+  void Remove(int64_t user_id, int64_t other_id);
+  size_t EdgeBytes() const;
+
+ private:
+  static const size_t MAX_ROW_DELTA = 64;
+
+  struct RowDelta {
+    std::set<int64_t> added;
+    std::set<int64_t> removed;
+  };
+
+  mutable std::shared_timed_mutex _mtx;
+  std::unordered_map<int64_t, uint32_t> _rows;
+  // Row i of the loaded graph is _data[_offsets[i], _offsets[i + 1]). Rows
+  // created later have no slice.
+  std::vector<uint64_t> _offsets;
+  std::string _data;
+  // Rows re-encoded since startup, they take precedence over their slice.
+  std::unordered_map<uint32_t, std::string> _rewritten;
+  std::unordered_map<uint32_t, RowDelta> _deltas;
+
+  static void _Encode(const std::vector<int64_t> &ids, std::string *out);
+  static void _Decode(const char *begin, const char *end,
+                      std::vector<int64_t> *out);
+  void _GetRow(uint32_t row, std::vector<int64_t> *out) const;
+  RowDelta *_MutableDelta(int64_t user_id);
+  void _MaybeCompact(int64_t user_id);
+};
+
+void AdjacencyIndex::_Encode(const std::vector<int64_t> &ids,
+                             std::string *out) {
+  uint64_t prev = 0;
+  for (auto id : ids) {
+    uint64_t gap = static_cast<uint64_t>(id) - prev;
+    prev = static_cast<uint64_t>(id);
+    while (gap >= 0x80) {
+      out->push_back(static_cast<char>((gap & 0x7F) | 0x80));
+      gap >>= 7;
+    }
+    out->push_back(static_cast<char>(gap));
+  }
+}
+
+void AdjacencyIndex::_Decode(const char *begin, const char *end,
+                             std::vector<int64_t> *out) {
+  uint64_t prev = 0;
+  const auto *p = reinterpret_cast<const uint8_t *>(begin);
+  const auto *last = reinterpret_cast<const uint8_t *>(end);
+  while (p < last) {
+    uint64_t gap = 0;
+    int shift = 0;
+    while (*p & 0x80) {
+      gap |= static_cast<uint64_t>(*p++ & 0x7F) << shift;
+      shift += 7;
+    }
+    gap |= static_cast<uint64_t>(*p++) << shift;
+    prev += gap;
+    out->emplace_back(static_cast<int64_t>(prev));
+  }
+}
+
+void AdjacencyIndex::Build(
+    std::unordered_map<int64_t, std::vector<int64_t>> *lists) {
+  std::unordered_map<int64_t, uint32_t> rows;
+  std::vector<uint64_t> offsets;
+  std::string data;
+  rows.reserve(lists->size());
+  offsets.reserve(lists->size() + 1);
+  offsets.emplace_back(0);
+  for (auto &list : *lists) {
+    auto &ids = list.second;
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    rows.emplace(list.first, static_cast<uint32_t>(rows.size()));
+    _Encode(ids, &data);
+    offsets.emplace_back(data.size());
+    std::vector<int64_t>().swap(ids);
+  }
+  data.shrink_to_fit();
+
+  std::unique_lock<std::shared_timed_mutex> lock(_mtx);
+  _rows.swap(rows);
+  _offsets.swap(offsets);
+  _data.swap(data);
+  _rewritten.clear();
+  _deltas.clear();
+}
+
+void AdjacencyIndex::_GetRow(uint32_t row, std::vector<int64_t> *out) const {
+  auto rewritten = _rewritten.find(row);
+  if (rewritten != _rewritten.end()) {
+    _Decode(rewritten->second.data(),
+            rewritten->second.data() + rewritten->second.size(), out);
+  } else if (row + 1 < _offsets.size()) {
+    _Decode(_data.data() + _offsets[row], _data.data() + _offsets[row + 1],
+            out);
+  }
+
+  auto delta = _deltas.find(row);
+  if (delta == _deltas.end()) {
+    return;
+  }
+  std::vector<int64_t> kept;
+  std::set_difference(out->begin(), out->end(), delta->second.removed.begin(),
+                      delta->second.removed.end(), std::back_inserter(kept));
+  out->clear();
+  std::set_union(kept.begin(), kept.end(), delta->second.added.begin(),
+                 delta->second.added.end(), std::back_inserter(*out));
+}
+
+void AdjacencyIndex::Get(int64_t user_id, std::vector<int64_t> *out) const {
+  out->clear();
+  std::shared_lock<std::shared_timed_mutex> lock(_mtx);
+  auto row = _rows.find(user_id);
+  if (row != _rows.end()) {
+    _GetRow(row->second, out);
+  }
+}
+
+AdjacencyIndex::RowDelta *AdjacencyIndex::_MutableDelta(int64_t user_id) {
+  auto row = _rows.emplace(user_id, static_cast<uint32_t>(_rows.size()));
+  return &_deltas[row.first->second];
+}
+
+void AdjacencyIndex::_MaybeCompact(int64_t user_id) {
+  uint32_t row = _rows[user_id];
+  auto &delta = _deltas[row];
+  if (delta.added.size() + delta.removed.size() <= MAX_ROW_DELTA) {
+    return;
+  }
+  std::vector<int64_t> ids;
+  _GetRow(row, &ids);
+  std::string encoded;
+  _Encode(ids, &encoded);
+  _rewritten[row].swap(encoded);
+  _deltas.erase(row);
+}
+
+void AdjacencyIndex::Add(int64_t user_id, int64_t other_id) {
+  std::unique_lock<std::shared_timed_mutex> lock(_mtx);
+  auto *delta = _MutableDelta(user_id);
+  delta->removed.erase(other_id);
+  delta->added.insert(other_id);
+  _MaybeCompact(user_id);
+}
+
+void AdjacencyIndex::Remove(int64_t user_id, int64_t other_id) {
+  std::unique_lock<std::shared_timed_mutex> lock(_mtx);
+  auto *delta = _MutableDelta(user_id);
+  delta->added.erase(other_id);
+  delta->removed.insert(other_id);
+  _MaybeCompact(user_id);
+}
+
+size_t AdjacencyIndex::EdgeBytes() const {
+  std::shared_lock<std::shared_timed_mutex> lock(_mtx);
+  size_t bytes = _data.size();
+  for (auto &row : _rewritten) {
+    bytes += row.second.size();
+  }
+  return bytes;
+}
+
+// Followers and followees of every user, loaded from the social-graph
+// MongoDB collection at startup and updated by Follow/Unfollow. It is only
+// coherent when a single social-graph-service instance handles all the
+// writes.
+class SocialGraphIndex {
+ public:
+  bool Load(mongoc_client_pool_t *mongodb_client_pool);
+  void GetFollowers(int64_t user_id, std::vector<int64_t> *out) const {
+    _followers.Get(user_id, out);
+  }
+  void GetFollowees(int64_t user_id, std::vector<int64_t> *out) const {
+    _followees.Get(user_id, out);
+  }
+  void Follow(int64_t user_id, int64_t followee_id) {
+    _followees.Add(user_id, followee_id);
+    _followers.Add(followee_id, user_id);
+  }
+  void Unfollow(int64_t user_id, int64_t followee_id) {
+    _followees.Remove(user_id, followee_id);
+    _followers.Remove(followee_id, user_id);
+  }
+
+ private:
+  AdjacencyIndex _followers;
+  AdjacencyIndex _followees;
+};
+
+bool SocialGraphIndex::Load(mongoc_client_pool_t *mongodb_client_pool) {
+  mongoc_client_t *mongodb_client = mongoc_client_pool_pop(mongodb_client_pool);
+  if (!mongodb_client) {
+    LOG(error) << "Failed to pop a client from MongoDB pool";
+    return false;
+  }
+  auto collection = mongoc_client_get_collection(
+      mongodb_client, "social-graph", "social-graph");
+  bson_t *query = bson_new();
+  bson_t *opts = BCON_NEW("projection", "{", "_id", BCON_BOOL(false),
+                          "user_id", BCON_BOOL(true), "followers",
+                          BCON_BOOL(true), "followees", BCON_BOOL(true), "}");
+  mongoc_cursor_t *cursor =
+      mongoc_collection_find_with_opts(collection, query, opts, nullptr);
+
+  std::unordered_map<int64_t, std::vector<int64_t>> followers;
+  std::unordered_map<int64_t, std::vector<int64_t>> followees;
+  size_t edges = 0;
+  const bson_t *doc;
+  while (mongoc_cursor_next(cursor, &doc)) {
+    bson_iter_t iter;
+    if (!bson_iter_init_find(&iter, doc, "user_id")) {
+      continue;
+    }
+    int64_t user_id = bson_iter_as_int64(&iter);
+    auto &user_followers = followers[user_id];
+    auto &user_followees = followees[user_id];
+    edges += ForEachTimestampedId(doc, "followers", "user_id",
+                                  [&](int64_t follower_id, int64_t) {
+                                    user_followers.emplace_back(follower_id);
+                                  });
+    ForEachTimestampedId(doc, "followees", "user_id",
+                         [&](int64_t followee_id, int64_t) {
+                           user_followees.emplace_back(followee_id);
+                         });
+  }
+  bson_error_t error;
+  bool failed = mongoc_cursor_error(cursor, &error);
+  bson_destroy(opts);
+  bson_destroy(query);
+  mongoc_cursor_destroy(cursor);
+  mongoc_collection_destroy(collection);
+  mongoc_client_pool_push(mongodb_client_pool, mongodb_client);
+  if (failed) {
+    LOG(error) << "Failed to load the social graph: " << error.message;
+    return false;
+  }
+
+  size_t users = followers.size();
+  _followers.Build(&followers);
+  _followees.Build(&followees);
+  LOG(info) << "Loaded " << edges << " follow edges of " << users
+            << " users, " << _followers.EdgeBytes() + _followees.EdgeBytes()
+            << " bytes";
+  return true;
+}
+
+}  // namespace social_network
+
+#endif  // SOCIAL_NETWORK_MICROSERVICES_SRC_SOCIALGRAPHSERVICE_SOCIALGRAPHINDEX_H_
@@ -1,8 +1,4 @@
 #include <signal.h>
-#include <thrift/protocol/TBinaryProtocol.h>
-#include <thrift/server/TThreadedServer.h>
-#include <thrift/transport/TBufferTransports.h>
-#include <thrift/transport/TServerSocket.h>
 
 #include <boost/program_options.hpp>
 
@@ -13,10 +9,6 @@
 #include "SocialGraphHandler.h"
 
 using json = nlohmann::json;
-using apache::thrift::protocol::TBinaryProtocolFactory;
-using apache::thrift::server::TThreadedServer;
-using apache::thrift::transport::TFramedTransportFactory;
-using apache::thrift::transport::TServerSocket;
 using namespace social_network;
 
 void sigintHandler(int sig) { exit(EXIT_SUCCESS); }
@@ -100,47 +92,78 @@ int main(int argc, char *argv[]) {
   }
   mongoc_client_pool_push(mongodb_client_pool, mongodb_client);
 
-  std::shared_ptr<TServerSocket> server_socket =
-      get_server_socket(config_json, "0.0.0.0", port);
+  int executor_threads =
+      config_json["social-graph-service"].value("executor_threads", 16);
+  int executor_max_pending =
+      config_json["social-graph-service"].value("executor_max_pending", 256);
+  Executor executor(executor_threads, executor_max_pending);
+
+  // Keeps the whole graph in memory and serves follower/followee lookups
+  // from it. Only for a single social-graph-service instance.
+  std::unique_ptr<SocialGraphIndex> graph_index;
+  if (config_json["social-graph-service"].value("graph_index", false)) {
+    graph_index.reset(new SocialGraphIndex());
+    if (!graph_index->Load(mongodb_client_pool)) {
+      return EXIT_FAILURE;
+    }
+  }
+
+  // Bloom filter of the existing follow edges, also only for a single
+  // instance.
+  std::unique_ptr<FollowEdgeFilter> edge_filter;
+  if (config_json["social-graph-service"].value("follow_edge_filter", false)) {
+    edge_filter.reset(new FollowEdgeFilter(
+        config_json["social-graph-service"].value("follow_edge_filter_capacity",
+                                                  10000000),
+        0.01));
+    if (!edge_filter->Load(mongodb_client_pool)) {
+      return EXIT_FAILURE;
+    }
+  }
 
   if (redis_cluster_flag || redis_cluster_config_flag) {
     RedisCluster redis_cluster_client_pool =
         init_redis_cluster_client_pool(config_json, "social-graph");
-    TThreadedServer server(
+    auto server = get_server(
+        config_json, "social-graph-service",
         std::make_shared<SocialGraphServiceProcessor>(
             std::make_shared<SocialGraphHandler>(mongodb_client_pool,
                                                  &redis_cluster_client_pool,
-                                                 &user_client_pool)),
-        server_socket, std::make_shared<TFramedTransportFactory>(),
-        std::make_shared<TBinaryProtocolFactory>());
+                                                 &user_client_pool,
+                                                 &executor,
+                                                 graph_index.get(),
+                                                 edge_filter.get())),
+        port);
     LOG(info) << "Starting the social-graph-service server with Redis Cluster support...";
-    server.serve();
+    server->serve();
   }
   
   else if (redis_replica_config_flag) {
       Redis redis_replica_client_pool = init_redis_replica_client_pool(config_json, "redis-replica");
       Redis redis_primary_client_pool = init_redis_replica_client_pool(config_json, "redis-primary");
 
-      TThreadedServer server(
+      auto server = get_server(
+          config_json, "social-graph-service",
           std::make_shared<SocialGraphServiceProcessor>(
               std::make_shared<SocialGraphHandler>(
-                  mongodb_client_pool, &redis_replica_client_pool, &redis_primary_client_pool, &user_client_pool)),
-          server_socket, std::make_shared<TFramedTransportFactory>(),
-          std::make_shared<TBinaryProtocolFactory>());
+                  mongodb_client_pool, &redis_replica_client_pool, &redis_primary_client_pool, &user_client_pool, &executor,
+                  graph_index.get(), edge_filter.get())),
+          port);
       LOG(info) << "Starting the social-graph-service server with Redis replica support";
-      server.serve();
+      server->serve();
   }
 
   else {
     Redis redis_client_pool =
         init_redis_client_pool(config_json, "social-graph");
-    TThreadedServer server(
+    auto server = get_server(
+        config_json, "social-graph-service",
         std::make_shared<SocialGraphServiceProcessor>(
             std::make_shared<SocialGraphHandler>(
-                mongodb_client_pool, &redis_client_pool, &user_client_pool)),
-        server_socket, std::make_shared<TFramedTransportFactory>(),
-        std::make_shared<TBinaryProtocolFactory>());
+                mongodb_client_pool, &redis_client_pool, &user_client_pool,
+                &executor, graph_index.get(), edge_filter.get())),
+        port);
     LOG(info) << "Starting the social-graph-service server ...";
-    server.serve();
+    server->serve();
   }
 }
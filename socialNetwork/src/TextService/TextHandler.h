@@ -3,16 +3,18 @@
 
 #include <future>
 #include <iostream>
-#include <regex>
 #include <string>
 
 #include "../../gen-cpp/TextService.h"
 #include "../../gen-cpp/UrlShortenService.h"
 #include "../../gen-cpp/UserMentionService.h"
 #include "../ClientPool.h"
+#include "../PendingReply.h"
+#include "../RpcElision.h"
 #include "../ThriftClient.h"
 #include "../logger.h"
 #include "../tracing.h"
+#include "TextScanner.h"
 
 namespace social_network {
 
@@ -22,18 +24,26 @@ class TextHandler : public TextServiceIf {
               ClientPool<ThriftClient<UserMentionServiceClient>> *);
   ~TextHandler() override = default;
 
+  std::vector<const ElidedRpcCounter *> GetElidedRpcCounters() const {
+    return {&_compose_urls_rpc, &_compose_user_mentions_rpc};
+  }
+
   void ComposeText(TextServiceReturn &_return, int64_t, const std::string &,
                    const std::map<std::string, std::string> &) override;
 
  private:
   ClientPool<ThriftClient<UrlShortenServiceClient>> *_url_client_pool;
   ClientPool<ThriftClient<UserMentionServiceClient>> *_user_mention_client_pool;
+  ElidedRpcCounter _compose_urls_rpc;
+  ElidedRpcCounter _compose_user_mentions_rpc;
 };
 
 TextHandler::TextHandler(
     ClientPool<ThriftClient<UrlShortenServiceClient>> *url_client_pool,
     ClientPool<ThriftClient<UserMentionServiceClient>>
-        *user_mention_client_pool) {
+        *user_mention_client_pool)
+    : _compose_urls_rpc("compose-urls"),
+      _compose_user_mentions_rpc("compose-user-mentions") {
   _url_client_pool = url_client_pool;
   _user_mention_client_pool = user_mention_client_pool;
 }
@@ -42,41 +52,39 @@ void TextHandler::ComposeText(
     TextServiceReturn &_return, int64_t req_id, const std::string &text,
     const std::map<std::string, std::string> &carrier) {
   // Initialize a span
-  TextMapReader reader(carrier);
   std::map<std::string, std::string> writer_text_map;
-  TextMapWriter writer(writer_text_map);
-  auto parent_span = opentracing::Tracer::Global()->Extract(reader);
-  auto span = opentracing::Tracer::Global()->StartSpan(
-      "compose_text_server", {opentracing::ChildOf(parent_span->get())});
-  opentracing::Tracer::Global()->Inject(span->context(), writer);
+  auto span = StartSpanFromCarrier(
+      "compose_text_server", carrier, &writer_text_map);
+
+  std::vector<TextToken> mention_tokens;
+  std::vector<TextToken> url_tokens;
+  TextScanner::Scan(text, &mention_tokens, &url_tokens);
 
   std::vector<std::string> mention_usernames;
-  std::smatch m;
-  std::regex e("@[a-zA-Z0-9-_]+");
-  auto s = text;
-  while (std::regex_search(s, m, e)) {
-    auto user_mention = m.str();
-    user_mention = user_mention.substr(1, user_mention.length());
-    mention_usernames.emplace_back(user_mention);
-    s = m.suffix().str();
+  mention_usernames.reserve(mention_tokens.size());
+  for (auto &token : mention_tokens) {
+    mention_usernames.emplace_back(text, token.pos + 1, token.length - 1);
   }
 
   std::vector<std::string> urls;
-  e = "(http://|https://)([a-zA-Z0-9_!~*'().&=+$%-]+)";
-  s = text;
-  while (std::regex_search(s, m, e)) {
-    auto url = m.str();
-    urls.emplace_back(url);
-    s = m.suffix().str();
+  urls.reserve(url_tokens.size());
+  for (auto &token : url_tokens) {
+    urls.emplace_back(text, token.pos, token.length);
   }
 
-  auto shortened_urls_future = std::async(std::launch::async, [&]() {
-    auto url_span = opentracing::Tracer::Global()->StartSpan(
-        "compose_urls_client", {opentracing::ChildOf(&span->context())});
-
+  // Both requests are written from this thread and their replies are read
+  // afterwards, so neither call needs its own thread. A call with nothing to
+  // look up is answered locally.
+  std::future<std::vector<Url>> shortened_urls_future;
+  if (urls.empty()) {
+    shortened_urls_future =
+        LocalResult(&_compose_urls_rpc, std::vector<Url>());
+  } else {
+    _compose_urls_rpc.CountCall();
+    std::shared_ptr<opentracing::Span> url_span =
+        ShareSpan(StartChildSpan("compose_urls_client", span->context()));
     std::map<std::string, std::string> url_writer_text_map;
-    TextMapWriter url_writer(url_writer_text_map);
-    opentracing::Tracer::Global()->Inject(url_span->context(), url_writer);
+    InjectSpan(*url_span, &url_writer_text_map);
 
     auto url_client_wrapper = _url_client_pool->Pop();
     if (!url_client_wrapper) {
@@ -85,28 +93,34 @@ void TextHandler::ComposeText(
       se.message = "Failed to connect to url-shorten-service";
       throw se;
     }
-    std::vector<Url> _return_urls;
-    auto url_client = url_client_wrapper->GetClient();
     try {
-      url_client->ComposeUrls(_return_urls, req_id, urls, url_writer_text_map);
+      shortened_urls_future = SendRequest<std::vector<Url>>(
+          _url_client_pool, url_client_wrapper,
+          [&](UrlShortenServiceClient *url_client) {
+            url_client->send_ComposeUrls(req_id, urls, url_writer_text_map);
+          },
+          [url_span](UrlShortenServiceClient *url_client) {
+            std::vector<Url> _return_urls;
+            url_client->recv_ComposeUrls(_return_urls);
+            url_span->Finish();
+            return _return_urls;
+          });
     } catch (...) {
       LOG(error) << "Failed to upload urls to url-shorten-service";
-      _url_client_pool->Remove(url_client_wrapper);
       throw;
     }
-    _url_client_pool->Keepalive(url_client_wrapper);
-    return _return_urls;
-  });
-
-  auto user_mention_future = std::async(std::launch::async, [&]() {
-    auto user_mention_span = opentracing::Tracer::Global()->StartSpan(
-        "compose_user_mentions_client",
-        {opentracing::ChildOf(&span->context())});
+  }
 
+  std::future<std::vector<UserMention>> user_mention_future;
+  if (mention_usernames.empty()) {
+    user_mention_future =
+        LocalResult(&_compose_user_mentions_rpc, std::vector<UserMention>());
+  } else {
+    _compose_user_mentions_rpc.CountCall();
+    std::shared_ptr<opentracing::Span> user_mention_span = ShareSpan(
+        StartChildSpan("compose_user_mentions_client", span->context()));
     std::map<std::string, std::string> user_mention_writer_text_map;
-    TextMapWriter user_mention_writer(user_mention_writer_text_map);
-    opentracing::Tracer::Global()->Inject(user_mention_span->context(),
-                                          user_mention_writer);
+    InjectSpan(*user_mention_span, &user_mention_writer_text_map);
 
     auto user_mention_client_wrapper = _user_mention_client_pool->Pop();
     if (!user_mention_client_wrapper) {
@@ -115,21 +129,25 @@ void TextHandler::ComposeText(
       se.message = "Failed to connect to user-mention-service";
       throw se;
     }
-    std::vector<UserMention> _return_user_mentions;
-    auto user_mention_client = user_mention_client_wrapper->GetClient();
     try {
-      user_mention_client->ComposeUserMentions(_return_user_mentions, req_id,
-                                               mention_usernames,
-                                               user_mention_writer_text_map);
+      user_mention_future = SendRequest<std::vector<UserMention>>(
+          _user_mention_client_pool, user_mention_client_wrapper,
+          [&](UserMentionServiceClient *user_mention_client) {
+            user_mention_client->send_ComposeUserMentions(
+                req_id, mention_usernames, user_mention_writer_text_map);
+          },
+          [user_mention_span](UserMentionServiceClient *user_mention_client) {
+            std::vector<UserMention> _return_user_mentions;
+            user_mention_client->recv_ComposeUserMentions(
+                _return_user_mentions);
+            user_mention_span->Finish();
+            return _return_user_mentions;
+          });
     } catch (...) {
       LOG(error) << "Failed to upload user_mentions to user-mention-service";
-      _user_mention_client_pool->Remove(user_mention_client_wrapper);
       throw;
     }
-
-    _user_mention_client_pool->Keepalive(user_mention_client_wrapper);
-    return _return_user_mentions;
-  });
+  }
 
   std::vector<Url> target_urls;
   try {
@@ -149,15 +167,7 @@ void TextHandler::ComposeText(
 
   std::string updated_text;
   if (!urls.empty()) {
-    s = text;
-    int idx = 0;
-    while (std::regex_search(s, m, e)) {
-      auto url = m.str();
-      urls.emplace_back(url);
-      updated_text += m.prefix().str() + target_urls[idx].shortened_url;
-      s = m.suffix().str();
-      idx++;
-    }
+    updated_text = TextScanner::ReplaceUrls(text, url_tokens, target_urls);
   } else {
     updated_text = text;
   }
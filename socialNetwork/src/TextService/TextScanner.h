@@ -0,0 +1,145 @@
+#ifndef SOCIAL_NETWORK_MICROSERVICES_SRC_TEXTSERVICE_TEXTSCANNER_H_
+#define SOCIAL_NETWORK_MICROSERVICES_SRC_TEXTSERVICE_TEXTSCANNER_H_
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "../../gen-cpp/social_network_types.h"
+
+namespace social_network {
+
+// Position of a mention or URL in the scanned text. Mentions include the
+// leading '@'.
+struct TextToken {
+  size_t pos;
+  size_t length;
+};
+
+// Finds, in one pass and without copying the text, the same tokens as
+//   mentions: @[a-zA-Z0-9-_]+
+//   urls:     (http://|https://)([a-zA-Z0-9_!~*'().&=+$%-]+)
+// searched independently over the whole text, leftmost first.
+class TextScanner {
+ public:
+  static void Scan(const std::string &text, std::vector<TextToken> *mentions,
+                   std::vector<TextToken> *urls);
+  // Returns text with the i-th url replaced by shortened_urls[i].
+  static std::string ReplaceUrls(const std::string &text,
+                                 const std::vector<TextToken> &urls,
+                                 const std::vector<Url> &shortened_urls);
+
+ private:
+  enum : uint8_t { kMentionChar = 1, kUrlChar = 2 };
+  static const uint8_t *_CharClasses();
+  static size_t _NextCandidate(const char *data, size_t pos, size_t size);
+};
+
+const uint8_t *TextScanner::_CharClasses() {
+  static const struct Table {
+    uint8_t classes[256];
+    Table() : classes() {
+      for (int c = 0; c < 256; ++c) {
+        bool alnum = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+            (c >= '0' && c <= '9');
+        if (alnum || c == '-' || c == '_') {
+          classes[c] |= kMentionChar;
+        }
+        if (alnum || (c != 0 && std::strchr("_!~*'().&=+$%-", c))) {
+          classes[c] |= kUrlChar;
+        }
+      }
+    }
+  } table;
+  return table.classes;
+}
+
+// Returns the position of the next '@' or 'h' at or after pos, or size.
+// Eight bytes are tested at a time with the usual "has zero byte" trick.
+size_t TextScanner::_NextCandidate(const char *data, size_t pos,
+                                   size_t size) {
+  const uint64_t ones = 0x0101010101010101ULL;
+  const uint64_t highs = 0x8080808080808080ULL;
+  while (pos + 8 <= size) {
+    uint64_t word;
+    std::memcpy(&word, data + pos, 8);
+    uint64_t at = word ^ (ones * '@');
+    uint64_t h = word ^ (ones * 'h');
+    if (((at - ones) & ~at & highs) | ((h - ones) & ~h & highs)) {
+      break;
+    }
+    pos += 8;
+  }
+  while (pos < size && data[pos] != '@' && data[pos] != 'h') {
+    ++pos;
+  }
+  return pos;
+}
+
+void TextScanner::Scan(const std::string &text,
+                       std::vector<TextToken> *mentions,
+                       std::vector<TextToken> *urls) {
+  const uint8_t *classes = _CharClasses();
+  const char *data = text.data();
+  const size_t size = text.size();
+  // URLs cannot overlap, but a URL may start inside a mention (and the
+  // other way round is impossible since '@' is not a URL character).
+  size_t url_end = 0;
+  size_t pos = _NextCandidate(data, 0, size);
+  while (pos < size) {
+    if (data[pos] == '@') {
+      size_t end = pos + 1;
+      while (end < size &&
+             (classes[static_cast<uint8_t>(data[end])] & kMentionChar)) {
+        ++end;
+      }
+      if (end > pos + 1) {
+        mentions->push_back({pos, end - pos});
+      }
+    } else if (pos >= url_end && size - pos > 7 &&
+               std::memcmp(data + pos, "http", 4) == 0) {
+      size_t begin = pos + 4;
+      if (data[begin] == 's') {
+        ++begin;
+      }
+      if (size - begin > 3 && std::memcmp(data + begin, "://", 3) == 0) {
+        begin += 3;
+        size_t end = begin;
+        while (end < size &&
+               (classes[static_cast<uint8_t>(data[end])] & kUrlChar)) {
+          ++end;
+        }
+        if (end > begin) {
+          urls->push_back({pos, end - pos});
+          url_end = end;
+        }
+      }
+    }
+    pos = _NextCandidate(data, pos + 1, size);
+  }
+}
+
+std::string TextScanner::ReplaceUrls(const std::string &text,
+                                     const std::vector<TextToken> &urls,
+                                     const std::vector<Url> &shortened_urls) {
+  size_t length = text.size();
+  for (size_t i = 0; i < urls.size() && i < shortened_urls.size(); ++i) {
+    length += shortened_urls[i].shortened_url.size();
+    length -= urls[i].length;
+  }
+  std::string updated_text;
+  updated_text.reserve(length);
+  size_t pos = 0;
+  for (size_t i = 0; i < urls.size() && i < shortened_urls.size(); ++i) {
+    updated_text.append(text, pos, urls[i].pos - pos);
+    updated_text.append(shortened_urls[i].shortened_url);
+    pos = urls[i].pos + urls[i].length;
+  }
+  updated_text.append(text, pos, std::string::npos);
+  return updated_text;
+}
+
+}  // namespace social_network
+
+#endif  // SOCIAL_NETWORK_MICROSERVICES_SRC_TEXTSERVICE_TEXTSCANNER_H_
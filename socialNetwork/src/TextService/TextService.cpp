@@ -1,17 +1,9 @@
 #include <signal.h>
-#include <thrift/protocol/TBinaryProtocol.h>
-#include <thrift/server/TThreadedServer.h>
-#include <thrift/transport/TBufferTransports.h>
-#include <thrift/transport/TServerSocket.h>
 
 #include "../utils.h"
 #include "../utils_thrift.h"
 #include "TextHandler.h"
 
-using apache::thrift::protocol::TBinaryProtocolFactory;
-using apache::thrift::server::TThreadedServer;
-using apache::thrift::transport::TFramedTransportFactory;
-using apache::thrift::transport::TServerSocket;
 using namespace social_network;
 
 void sigintHandler(int sig) { exit(EXIT_SUCCESS); }
@@ -47,16 +39,22 @@ int main(int argc, char *argv[]) {
         "user-mention-service", user_mention_addr, user_mention_port, 0,
         user_mention_conns, user_mention_timeout, user_mention_keepalive, config_json);
 
-    std::shared_ptr<TServerSocket> server_socket = get_server_socket(config_json, "0.0.0.0", port);
-    TThreadedServer server(
-        std::make_shared<TextServiceProcessor>(std::make_shared<TextHandler>(
-            &url_client_pool, &user_mention_pool)),
-        server_socket,
-        std::make_shared<TFramedTransportFactory>(),
-        std::make_shared<TBinaryProtocolFactory>());
+    auto handler =
+        std::make_shared<TextHandler>(&url_client_pool, &user_mention_pool);
+    int elided_rpc_stats_interval_ms = config_json["text-service"].value(
+        "elided_rpc_stats_interval_ms", 0);
+    if (elided_rpc_stats_interval_ms > 0) {
+      start_elided_rpc_stats_logger("text-service",
+                                    handler->GetElidedRpcCounters(),
+                                    elided_rpc_stats_interval_ms);
+    }
+
+    auto server = get_server(
+        config_json, "text-service",
+        std::make_shared<TextServiceProcessor>(handler), port);
 
     LOG(info) << "Starting the text-service server...";
-    server.serve();
+    server->serve();
   } else
     exit(EXIT_FAILURE);
 }
@@ -5,7 +5,6 @@
 #include <thread>
 #include <iostream>
 #include <chrono>
-#include <boost/log/trivial.hpp>
 
 #include <thrift/protocol/TBinaryProtocol.h>
 #include <thrift/transport/TSocket.h>
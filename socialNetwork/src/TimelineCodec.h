@@ -0,0 +1,106 @@
+#ifndef SOCIAL_NETWORK_MICROSERVICES_SRC_TIMELINECODEC_H_
+#define SOCIAL_NETWORK_MICROSERVICES_SRC_TIMELINECODEC_H_
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace social_network {
+
+// Members of the timeline ZSets are post ids as 8 big-endian bytes rather
+// than decimal strings, which keeps small timelines within Redis' compact
+// listpack encoding and orders members with equal scores numerically.
+// Members written before are decimal strings. Post ids from UniqueIdService
+// always have more than 8 decimal digits, so the two never get confused.
+const size_t TIMELINE_MEMBER_SIZE = 8;
+
+// Home timelines of followers of accounts above the fan-out threshold do not
+// get their posts pushed. Those posts go to the author's pull timeline, and
+// the author is recorded in the pull author set.
+const char *const PULL_AUTHORS_KEY = "pull-authors";
+
+std::string PullTimelineKey(int64_t user_id) {
+  return "pull:" + std::to_string(user_id);
+}
+
+// Newest first (post_id, timestamp) entries of a timeline.
+using TimelineEntries = std::vector<std::pair<int64_t, double>>;
+
+std::string EncodeTimelineMember(int64_t post_id) {
+  uint64_t value = static_cast<uint64_t>(post_id);
+  std::string member(TIMELINE_MEMBER_SIZE, '\0');
+  for (size_t i = TIMELINE_MEMBER_SIZE; i-- > 0;) {
+    member[i] = static_cast<char>(value & 0xFF);
+    value >>= 8;
+  }
+  return member;
+}
+
+// The member a post had in a timeline written before the binary encoding.
+std::string LegacyTimelineMember(int64_t post_id) {
+  return std::to_string(post_id);
+}
+
+// Returns false for a member that is neither encoding.
+bool DecodeTimelineMember(const std::string &member, int64_t *post_id) {
+  if (member.size() != TIMELINE_MEMBER_SIZE) {
+    if (member.empty() || member[0] < '0' || member[0] > '9') {
+      return false;
+    }
+    char *end;
+    errno = 0;
+    unsigned long long value = std::strtoull(member.c_str(), &end, 10);
+    if (errno != 0 || end != member.c_str() + member.size()) {
+      return false;
+    }
+    *post_id = static_cast<int64_t>(value);
+    return true;
+  }
+  uint64_t value = 0;
+  for (size_t i = 0; i < TIMELINE_MEMBER_SIZE; ++i) {
+    value = (value << 8) | static_cast<uint8_t>(member[i]);
+  }
+  *post_id = static_cast<int64_t>(value);
+  return true;
+}
+
+// Appends the post ids of members to post_ids. Until a timeline is rewritten
+// it may hold a post both as a decimal and as a binary member, so ids that
+// are already in post_ids are skipped, as are members that do not decode.
+void DecodeTimelineMembers(const std::vector<std::string> &members,
+                           std::vector<int64_t> *post_ids) {
+  std::unordered_set<int64_t> seen(post_ids->begin(), post_ids->end());
+  post_ids->reserve(post_ids->size() + members.size());
+  for (auto &member : members) {
+    int64_t post_id;
+    if (DecodeTimelineMember(member, &post_id) &&
+        seen.insert(post_id).second) {
+      post_ids->emplace_back(post_id);
+    }
+  }
+}
+
+void DecodeTimelineEntries(
+    const std::vector<std::pair<std::string, double>> &members,
+    TimelineEntries *entries) {
+  std::unordered_set<int64_t> seen;
+  for (auto &entry : *entries) {
+    seen.insert(entry.first);
+  }
+  entries->reserve(entries->size() + members.size());
+  for (auto &member : members) {
+    int64_t post_id;
+    if (DecodeTimelineMember(member.first, &post_id) &&
+        seen.insert(post_id).second) {
+      entries->emplace_back(post_id, member.second);
+    }
+  }
+}
+
+}  // namespace social_network
+
+#endif  // SOCIAL_NETWORK_MICROSERVICES_SRC_TIMELINECODEC_H_
@@ -0,0 +1,116 @@
+// Measures the tracing work a handler does per RPC through the facade in
+// tracing.h: StartSpanFromCarrier for the handler span, then for each of
+// two downstream calls a StartChildSpan, an InjectSpan and the Finish of the
+// child, and finally the Finish of the handler span. Nothing else runs, so
+// the time per RPC is the overhead tracing adds to a handler.
+//
+// --mode unsampled feeds a carrier whose uber-trace-id has the sampled flag
+// clear; --mode sampled feeds a sampled one to a jaeger tracer with a const
+// sampler, so every span is created, injected and queued for reporting.
+// Built with -DENABLE_TRACING=OFF, every mode takes the no-op path.
+
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <string>
+
+#include <boost/program_options.hpp>
+
+#include "../logger.h"
+#include "../tracing.h"
+
+using namespace social_network;
+
+using std::chrono::steady_clock;
+
+namespace {
+
+// A jaeger tracer that samples every trace and reports to an agent that
+// need not be listening; spans are sent over UDP.
+void SetUpSamplingTracer() {
+#ifndef DISABLE_TRACING
+  auto config = jaegertracing::Config::parse(YAML::Load(
+      "disabled: false\n"
+      "reporter:\n"
+      "  logSpans: false\n"
+      "  localAgentHostPort: \"127.0.0.1:6831\"\n"
+      "  queueSize: 1000000\n"
+      "  bufferFlushInterval: 10\n"
+      "sampler:\n"
+      "  type: \"const\"\n"
+      "  param: 1\n"));
+  auto tracer = jaegertracing::Tracer::make(
+      "tracing-benchmark", config, jaegertracing::logging::nullLogger());
+  opentracing::Tracer::InitGlobal(
+      std::static_pointer_cast<opentracing::Tracer>(tracer));
+#endif
+}
+
+void HandleRpc(const std::map<std::string, std::string> &carrier) {
+  std::map<std::string, std::string> writer_text_map;
+  auto span = StartSpanFromCarrier("benchmark_server", carrier,
+                                   &writer_text_map);
+  for (int i = 0; i < 2; ++i) {
+    auto child_span = StartChildSpan("benchmark_client", span->context());
+    std::map<std::string, std::string> child_text_map;
+    InjectSpan(*child_span, &child_text_map);
+    child_span->Finish();
+  }
+  span->Finish();
+}
+
+double NanosPerRpc(const std::map<std::string, std::string> &carrier,
+                   int num_rpcs) {
+  auto start = steady_clock::now();
+  for (int i = 0; i < num_rpcs; ++i) {
+    HandleRpc(carrier);
+  }
+  return std::chrono::duration<double, std::nano>(steady_clock::now() -
+                                                  start).count() /
+      num_rpcs;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  namespace po = boost::program_options;
+  po::options_description desc("Options");
+  desc.add_options()
+      ("help", "produce help message")
+      ("mode", po::value<std::string>()->default_value("unsampled"),
+       "unsampled or sampled")
+      ("rpcs", po::value<int>()->default_value(1000000),
+       "number of RPCs to time")
+      ("warmup", po::value<int>()->default_value(10000),
+       "number of RPCs run before timing");
+  po::variables_map vm;
+  po::store(po::parse_command_line(argc, argv, desc), vm);
+  po::notify(vm);
+  if (vm.count("help")) {
+    std::cout << desc << std::endl;
+    return 0;
+  }
+
+  init_logger();
+  std::string mode = vm["mode"].as<std::string>();
+  std::map<std::string, std::string> carrier;
+  if (mode == "unsampled") {
+    carrier[TRACE_CONTEXT_HEADER] = "5ad3e1c1f0e1e1a2:1f2e3d4c5b6a7988:0:0";
+  } else if (mode == "sampled") {
+    carrier[TRACE_CONTEXT_HEADER] = "5ad3e1c1f0e1e1a2:1f2e3d4c5b6a7988:0:1";
+    SetUpSamplingTracer();
+  } else {
+    LOG(error) << "Unknown mode " << mode;
+    return 1;
+  }
+
+  NanosPerRpc(carrier, vm["warmup"].as<int>());
+  double nanos = NanosPerRpc(carrier, vm["rpcs"].as<int>());
+#ifdef DISABLE_TRACING
+  mode = "disabled";
+#endif
+  printf("%s: %.0f ns per RPC (1 handler span, 2 client spans)\n",
+         mode.c_str(), nanos);
+  opentracing::Tracer::Global()->Close();
+  return 0;
+}
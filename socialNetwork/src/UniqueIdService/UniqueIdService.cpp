@@ -5,26 +5,21 @@
  * |0| 11 bit machine ID |      40-bit timestamp         | 12-bit counter |
  * ------------------------------------------------------------------------
  *
- * 11-bit machine Id code by hasing the MAC address
+ * 11-bit machine Id code by hasing the MAC address, or assigned through the
+ * worker_id_* config keys (see WorkerId.h)
  * 40-bit UNIX timestamp in millisecond precision with custom epoch
- * 12 bit counter which increases monotonically on single process
+ * 12 bit counter which increases monotonically on single process; it
+ * carries into the timestamp when it overflows or when the clock goes back
  *
  */
 
 #include <signal.h>
-#include <thrift/protocol/TBinaryProtocol.h>
-#include <thrift/server/TThreadedServer.h>
-#include <thrift/transport/TBufferTransports.h>
-#include <thrift/transport/TServerSocket.h>
 
+#include "../WorkerId.h"
 #include "../utils.h"
 #include "../utils_thrift.h"
 #include "UniqueIdHandler.h"
 
-using apache::thrift::protocol::TBinaryProtocolFactory;
-using apache::thrift::server::TThreadedServer;
-using apache::thrift::transport::TFramedTransportFactory;
-using apache::thrift::transport::TServerSocket;
 using namespace social_network;
 
 void sigintHandler(int sig) { exit(EXIT_SUCCESS); }
@@ -40,23 +35,17 @@ int main(int argc, char *argv[]) {
   }
 
   int port = config_json["unique-id-service"]["port"];
-  std::string netif = config_json["unique-id-service"]["netif"];
-
-  std::string machine_id = GetMachineId(netif);
+  std::string machine_id = GetWorkerId(config_json, "unique-id-service");
   if (machine_id == "") {
     exit(EXIT_FAILURE);
   }
   LOG(info) << "machine_id = " << machine_id;
 
-  std::mutex thread_lock;
-  std::shared_ptr<TServerSocket> server_socket = get_server_socket(config_json, "0.0.0.0", port);
-  TThreadedServer server(
+  auto server = get_server(
+      config_json, "unique-id-service",
       std::make_shared<UniqueIdServiceProcessor>(
-          std::make_shared<UniqueIdHandler>(&thread_lock, machine_id)),
-      server_socket,
-      std::make_shared<TFramedTransportFactory>(),
-      std::make_shared<TBinaryProtocolFactory>());
+          std::make_shared<UniqueIdHandler>(machine_id)), port);
 
   LOG(info) << "Starting the unique-id-service server ...";
-  server.serve();
+  server->serve();
 }
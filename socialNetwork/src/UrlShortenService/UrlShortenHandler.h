@@ -3,7 +3,11 @@
 
 #include <random>
 #include <chrono>
+#include <cstring>
 #include <future>
+#include <map>
+#include <string>
+#include <vector>
 
 #include <mongoc.h>
 #include <libmemcached/memcached.h>
@@ -12,8 +16,10 @@
 
 #include "../../gen-cpp/UrlShortenService.h"
 #include "../../gen-cpp/social_network_types.h"
+#include "../Executor.h"
 #include "../logger.h"
 #include "../tracing.h"
+#include "../utils_bson.h"
 
 #define HOSTNAME "http://short-url/"
 
@@ -21,7 +27,7 @@ namespace social_network {
 
 class UrlShortenHandler : public UrlShortenServiceIf {
  public:
-  UrlShortenHandler(memcached_pool_st *, mongoc_client_pool_t *, std::mutex *);
+  UrlShortenHandler(memcached_pool_st *, mongoc_client_pool_t *, Executor *);
   ~UrlShortenHandler() override = default;
 
   void ComposeUrls(std::vector<Url> &, int64_t,
@@ -33,38 +39,158 @@ class UrlShortenHandler : public UrlShortenServiceIf {
                        const std::map<std::string, std::string> &) override ;
 
  private:
+  static const int SHORT_CODE_LENGTH = 10;
+  static const int MAX_INSERT_ATTEMPTS = 4;
+
   memcached_pool_st *_memcached_client_pool;
   mongoc_client_pool_t *_mongodb_client_pool;
-  static std::mt19937 _generator;
-  std::uniform_int_distribution<int> _distribution;
-  std::string _GenRandomStr(int length);
-  std::mutex *_thread_lock;
-};
+  Executor *_executor;
 
-std::mt19937 UrlShortenHandler::_generator = std::mt19937(std::chrono::duration_cast<std::chrono::milliseconds>(
-          std::chrono::system_clock::now().time_since_epoch()).count() % 0xffffffff);
+  static std::string _GenRandomStr(int length);
+  void _InsertUrls(std::vector<Url> *urls,
+                   const opentracing::SpanContext &parent);
+  void _GetMemcachedUrls(const std::vector<std::string> &shortened_urls,
+                         std::map<std::string, std::string> *expanded_urls,
+                         const opentracing::SpanContext &parent);
+  void _GetMongoUrls(const std::vector<std::string> &shortened_urls,
+                     std::map<std::string, std::string> *expanded_urls,
+                     const opentracing::SpanContext &parent);
+  void _SetMemcachedUrls(const std::map<std::string, std::string> &urls,
+                         const opentracing::SpanContext &parent);
+};
 
 UrlShortenHandler::UrlShortenHandler(
     memcached_pool_st *memcached_client_pool,
     mongoc_client_pool_t *mongodb_client_pool,
-    std::mutex *thread_lock) {
+    Executor *executor) {
   _memcached_client_pool = memcached_client_pool;
   _mongodb_client_pool = mongodb_client_pool;
-  _thread_lock = thread_lock;
-  _distribution = std::uniform_int_distribution<int>(0, 61);
+  _executor = executor;
 }
 
+// Each server thread draws from its own generator, so no lock is needed.
+// A code is one uniform draw below 62^length written in base 62.
 std::string UrlShortenHandler::_GenRandomStr(int length) {
   const char char_map[] = "abcdefghijklmnopqrstuvwxyzABCDEF"
                     "GHIJKLMNOPQRSTUVWXYZ0123456789";
-  std::string return_str;
-  _thread_lock->lock();
+  thread_local std::mt19937_64 generator(
+      (static_cast<uint64_t>(std::random_device()()) << 32) ^
+      std::random_device()());
+  uint64_t range = 1;
   for (int i = 0; i < length; ++i) {
-    return_str.append(1, char_map[_distribution(_generator)]);
+    range *= 62;
+  }
+  std::uniform_int_distribution<uint64_t> distribution(0, range - 1);
+  uint64_t value = distribution(generator);
+  std::string return_str(length, char_map[0]);
+  for (int i = length - 1; i >= 0; --i) {
+    return_str[i] = char_map[value % 62];
+    value /= 62;
   }
-  _thread_lock->unlock();
   return return_str;
 }
+
+// Inserts the urls in one bulk write. shortened_url has a unique index, so
+// a code that collides with an existing one is rejected by MongoDB and
+// replaced by a fresh one before retrying the rejected documents.
+void UrlShortenHandler::_InsertUrls(std::vector<Url> *urls,
+                                    const opentracing::SpanContext &parent) {
+  mongoc_client_t *mongodb_client = mongoc_client_pool_pop(
+      _mongodb_client_pool);
+  if (!mongodb_client) {
+    ServiceException se;
+    se.errorCode = ErrorCode::SE_MONGODB_ERROR;
+    se.message = "Failed to pop a client from MongoDB pool";
+    throw se;
+  }
+  auto collection = mongoc_client_get_collection(
+      mongodb_client, "url-shorten", "url-shorten");
+  if (!collection) {
+    ServiceException se;
+    se.errorCode = ErrorCode::SE_MONGODB_ERROR;
+    se.message = "Failed to create collection user from DB user";
+    mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
+    throw se;
+  }
+
+  auto mongo_span = StartChildSpan("url_mongo_insert_client", parent);
+
+  std::vector<size_t> pending(urls->size());
+  for (size_t i = 0; i < pending.size(); ++i) {
+    pending[i] = i;
+  }
+  bson_error_t error;
+  bool ret = false;
+  bool duplicates_only = false;
+  for (int attempt = 0; attempt < MAX_INSERT_ATTEMPTS && !pending.empty();
+       ++attempt) {
+    bson_t *opts = BCON_NEW("ordered", BCON_BOOL(false));
+    mongoc_bulk_operation_t *bulk =
+        mongoc_collection_create_bulk_operation_with_opts(collection, opts);
+    for (auto i : pending) {
+      bson_t *doc = bson_new();
+      BSON_APPEND_UTF8(doc, "shortened_url",
+                       (*urls)[i].shortened_url.c_str());
+      BSON_APPEND_UTF8(doc, "expanded_url", (*urls)[i].expanded_url.c_str());
+      mongoc_bulk_operation_insert(bulk, doc);
+      bson_destroy(doc);
+    }
+    bson_t reply;
+    ret = mongoc_bulk_operation_execute(bulk, &reply, &error);
+
+    // Collect the documents rejected as duplicate keys.
+    std::vector<size_t> rejected;
+    duplicates_only = !ret;
+    bson_iter_t iter;
+    bson_iter_t errors_iter;
+    if (!ret && bson_iter_init_find(&iter, &reply, "writeErrors") &&
+        BSON_ITER_HOLDS_ARRAY(&iter) &&
+        bson_iter_recurse(&iter, &errors_iter)) {
+      while (bson_iter_next(&errors_iter)) {
+        bson_iter_t error_iter;
+        int32_t index = -1;
+        int32_t code = 0;
+        if (BSON_ITER_HOLDS_DOCUMENT(&errors_iter) &&
+            bson_iter_recurse(&errors_iter, &error_iter)) {
+          while (bson_iter_next(&error_iter)) {
+            if (std::strcmp(bson_iter_key(&error_iter), "index") == 0) {
+              index = static_cast<int32_t>(bson_iter_as_int64(&error_iter));
+            } else if (std::strcmp(bson_iter_key(&error_iter), "code") == 0) {
+              code = static_cast<int32_t>(bson_iter_as_int64(&error_iter));
+            }
+          }
+        }
+        if (code != 11000 || index < 0 ||
+            index >= static_cast<int32_t>(pending.size())) {
+          duplicates_only = false;
+          break;
+        }
+        rejected.emplace_back(pending[index]);
+      }
+    }
+    bson_destroy(&reply);
+    mongoc_bulk_operation_destroy(bulk);
+    bson_destroy(opts);
+    if (ret || !duplicates_only || rejected.empty()) {
+      break;
+    }
+    for (auto i : rejected) {
+      (*urls)[i].shortened_url = HOSTNAME + _GenRandomStr(SHORT_CODE_LENGTH);
+    }
+    pending.swap(rejected);
+  }
+  mongo_span->Finish();
+  mongoc_collection_destroy(collection);
+  mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
+  if (!ret) {
+    LOG(error) << "MongoDB error: "<< error.message;
+    ServiceException se;
+    se.errorCode = ErrorCode::SE_MONGODB_ERROR;
+    se.message = "Failed to insert urls to MongoDB";
+    throw se;
+  }
+}
+
 void UrlShortenHandler::ComposeUrls(
     std::vector<Url> &_return,
     int64_t req_id,
@@ -72,14 +198,9 @@ void UrlShortenHandler::ComposeUrls(
     const std::map<std::string, std::string> &carrier) {
 
   // Initialize a span
-  TextMapReader reader(carrier);
   std::map<std::string, std::string> writer_text_map;
-  TextMapWriter writer(writer_text_map);
-  auto parent_span = opentracing::Tracer::Global()->Extract(reader);
-  auto span = opentracing::Tracer::Global()->StartSpan(
-      "compose_urls_server",
-      { opentracing::ChildOf(parent_span->get()) });
-  opentracing::Tracer::Global()->Inject(span->context(), writer);
+  auto span = StartSpanFromCarrier(
+      "compose_urls_server", carrier, &writer_text_map);
 
   std::vector<Url> target_urls;
   std::future<void> mongo_future;
@@ -89,67 +210,12 @@ void UrlShortenHandler::ComposeUrls(
       Url new_target_url;
       new_target_url.expanded_url = url;
       new_target_url.shortened_url = HOSTNAME +
-          _GenRandomStr(10);
+          _GenRandomStr(SHORT_CODE_LENGTH);
       target_urls.emplace_back(new_target_url);
     }
 
-    mongo_future = std::async(
-        std::launch::async, [&](){
-          mongoc_client_t *mongodb_client = mongoc_client_pool_pop(
-              _mongodb_client_pool);
-          if (!mongodb_client) {
-            ServiceException se;
-            se.errorCode = ErrorCode::SE_MONGODB_ERROR;
-            se.message = "Failed to pop a client from MongoDB pool";
-            throw se;
-          }
-          auto collection = mongoc_client_get_collection(
-              mongodb_client, "url-shorten", "url-shorten");
-          if (!collection) {
-            ServiceException se;
-            se.errorCode = ErrorCode::SE_MONGODB_ERROR;
-            se.message = "Failed to create collection user from DB user";
-            mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
-            throw se;
-          }
-
-          auto mongo_span = opentracing::Tracer::Global()->StartSpan(
-              "url_mongo_insert_client",
-              { opentracing::ChildOf(&span->context()) });
-
-          mongoc_bulk_operation_t *bulk;
-          bson_t *doc;
-          bson_error_t error;
-          bson_t reply;
-          bool ret;
-          bulk = mongoc_collection_create_bulk_operation_with_opts(
-              collection, nullptr);
-          for (auto &url : target_urls) {
-            doc = bson_new();
-            BSON_APPEND_UTF8(doc, "shortened_url", url.shortened_url.c_str());
-            BSON_APPEND_UTF8(doc, "expanded_url", url.expanded_url.c_str());
-            mongoc_bulk_operation_insert (bulk, doc);
-            bson_destroy(doc);
-          }
-          ret = mongoc_bulk_operation_execute (bulk, &reply, &error);
-          if (!ret) {
-            LOG(error) << "MongoDB error: "<< error.message;
-            ServiceException se;
-            se.errorCode = ErrorCode::SE_MONGODB_ERROR;
-            se.message = "Failed to insert urls to MongoDB";
-            bson_destroy (&reply);
-            mongoc_bulk_operation_destroy(bulk);
-            mongoc_collection_destroy(collection);
-            mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
-            throw se;
-          }
-          bson_destroy (&reply);
-          mongoc_bulk_operation_destroy(bulk);
-          mongoc_collection_destroy(collection);
-          mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
-          mongo_span->Finish();
-        });
-
+    mongo_future = _executor->Submit(
+        [&](){ _InsertUrls(&target_urls, span->context()); });
   }
 
   if (!urls.empty()) {
@@ -166,13 +232,217 @@ void UrlShortenHandler::ComposeUrls(
 
 }
 
+void UrlShortenHandler::_GetMemcachedUrls(
+    const std::vector<std::string> &shortened_urls,
+    std::map<std::string, std::string> *expanded_urls,
+    const opentracing::SpanContext &parent) {
+  memcached_return_t rc;
+  auto client = memcached_pool_pop(_memcached_client_pool, true, &rc);
+  if (!client) {
+    ServiceException se;
+    se.errorCode = ErrorCode::SE_MEMCACHED_ERROR;
+    se.message = "Failed to pop a client from memcached pool";
+    throw se;
+  }
+
+  std::vector<const char *> keys;
+  std::vector<size_t> key_sizes;
+  for (auto &shortened_url : shortened_urls) {
+    keys.emplace_back(shortened_url.c_str());
+    key_sizes.emplace_back(shortened_url.length());
+  }
+
+  auto get_span = StartChildSpan("url_mmc_mget_client", parent);
+  rc = memcached_mget(client, keys.data(), key_sizes.data(), keys.size());
+  if (rc != MEMCACHED_SUCCESS) {
+    LOG(error) << "Cannot get shortened urls: "
+               << memcached_strerror(client, rc);
+    ServiceException se;
+    se.errorCode = ErrorCode::SE_MEMCACHED_ERROR;
+    se.message = memcached_strerror(client, rc);
+    memcached_pool_push(_memcached_client_pool, client);
+    get_span->Finish();
+    throw se;
+  }
+
+  char return_key[MEMCACHED_MAX_KEY];
+  size_t return_key_length;
+  char *return_value;
+  size_t return_value_length;
+  uint32_t flags;
+  while (true) {
+    return_value = memcached_fetch(client, return_key, &return_key_length,
+                                   &return_value_length, &flags, &rc);
+    if (return_value == nullptr) {
+      break;
+    }
+    if (rc != MEMCACHED_SUCCESS) {
+      free(return_value);
+      memcached_quit(client);
+      memcached_pool_push(_memcached_client_pool, client);
+      LOG(error) << "Cannot get shortened urls";
+      ServiceException se;
+      se.errorCode = ErrorCode::SE_MEMCACHED_ERROR;
+      se.message = "Cannot get shortened urls";
+      get_span->Finish();
+      throw se;
+    }
+    (*expanded_urls)[std::string(return_key, return_key_length)] =
+        std::string(return_value, return_value_length);
+    free(return_value);
+  }
+  memcached_quit(client);
+  memcached_pool_push(_memcached_client_pool, client);
+  get_span->Finish();
+}
+
+void UrlShortenHandler::_GetMongoUrls(
+    const std::vector<std::string> &shortened_urls,
+    std::map<std::string, std::string> *expanded_urls,
+    const opentracing::SpanContext &parent) {
+  mongoc_client_t *mongodb_client = mongoc_client_pool_pop(
+      _mongodb_client_pool);
+  if (!mongodb_client) {
+    ServiceException se;
+    se.errorCode = ErrorCode::SE_MONGODB_ERROR;
+    se.message = "Failed to pop a client from MongoDB pool";
+    throw se;
+  }
+  auto collection = mongoc_client_get_collection(
+      mongodb_client, "url-shorten", "url-shorten");
+  if (!collection) {
+    ServiceException se;
+    se.errorCode = ErrorCode::SE_MONGODB_ERROR;
+    se.message = "Failed to create collection url-shorten from MongoDB";
+    mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
+    throw se;
+  }
+
+  bson_t *query = bson_new();
+  bson_t query_child;
+  bson_t query_url_list;
+  const char *key;
+  char buf[16];
+  BSON_APPEND_DOCUMENT_BEGIN(query, "shortened_url", &query_child);
+  BSON_APPEND_ARRAY_BEGIN(&query_child, "$in", &query_url_list);
+  uint32_t idx = 0;
+  for (auto &shortened_url : shortened_urls) {
+    bson_uint32_to_string(idx, &key, buf, sizeof buf);
+    BSON_APPEND_UTF8(&query_url_list, key, shortened_url.c_str());
+    idx++;
+  }
+  bson_append_array_end(&query_child, &query_url_list);
+  bson_append_document_end(query, &query_child);
+  bson_t *opts = BCON_NEW("projection", "{", "_id", BCON_BOOL(false),
+                          "shortened_url", BCON_BOOL(true), "expanded_url",
+                          BCON_BOOL(true), "}");
+
+  auto find_span = StartChildSpan("url_mongo_find_client", parent);
+  mongoc_cursor_t *cursor =
+      mongoc_collection_find_with_opts(collection, query, opts, nullptr);
+  const bson_t *doc;
+  while (mongoc_cursor_next(cursor, &doc)) {
+    Url url;
+    bson_iter_t iter;
+    if (bson_iter_init(&iter, doc) && BsonUrlFromIter(&iter, &url)) {
+      (*expanded_urls)[url.shortened_url] = url.expanded_url;
+    }
+  }
+  bson_error_t error;
+  bool failed = mongoc_cursor_error(cursor, &error);
+  find_span->Finish();
+  bson_destroy(opts);
+  bson_destroy(query);
+  mongoc_cursor_destroy(cursor);
+  mongoc_collection_destroy(collection);
+  mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
+  if (failed) {
+    LOG(error) << error.message;
+    ServiceException se;
+    se.errorCode = ErrorCode::SE_MONGODB_ERROR;
+    se.message = error.message;
+    throw se;
+  }
+}
+
+void UrlShortenHandler::_SetMemcachedUrls(
+    const std::map<std::string, std::string> &urls,
+    const opentracing::SpanContext &parent) {
+  memcached_return_t rc;
+  auto client = memcached_pool_pop(_memcached_client_pool, true, &rc);
+  if (!client) {
+    LOG(warning) << "Failed to pop a client from memcached pool";
+    return;
+  }
+  auto set_span = StartChildSpan("url_mmc_set_client", parent);
+  for (auto &url : urls) {
+    rc = memcached_set(client, url.first.c_str(), url.first.length(),
+                       url.second.c_str(), url.second.length(),
+                       static_cast<time_t>(0), static_cast<uint32_t>(0));
+    if (rc != MEMCACHED_SUCCESS) {
+      LOG(warning) << "Failed to set " << url.first << " to Memcached: "
+                   << memcached_strerror(client, rc);
+    }
+  }
+  set_span->Finish();
+  memcached_pool_push(_memcached_client_pool, client);
+}
+
+// Accepts either full shortened urls or their codes and returns the
+// expanded urls in the same order, with an empty string for unknown ones.
 void UrlShortenHandler::GetExtendedUrls(
     std::vector<std::string> &_return,
     int64_t req_id,
     const std::vector<std::string> &shortened_id,
     const std::map<std::string, std::string> &carrier) {
 
-  // TODO: Implement GetExtendedUrls
+  // Initialize a span
+  std::map<std::string, std::string> writer_text_map;
+  auto span = StartSpanFromCarrier(
+      "get_extended_urls_server", carrier, &writer_text_map);
+
+  std::vector<std::string> shortened_urls;
+  shortened_urls.reserve(shortened_id.size());
+  for (auto &id : shortened_id) {
+    if (id.compare(0, std::strlen(HOSTNAME), HOSTNAME) == 0) {
+      shortened_urls.emplace_back(id);
+    } else {
+      shortened_urls.emplace_back(HOSTNAME + id);
+    }
+  }
+  if (shortened_urls.empty()) {
+    span->Finish();
+    return;
+  }
+
+  std::map<std::string, std::string> expanded_urls;
+  _GetMemcachedUrls(shortened_urls, &expanded_urls, span->context());
+
+  std::vector<std::string> urls_not_cached;
+  for (auto &shortened_url : shortened_urls) {
+    if (expanded_urls.find(shortened_url) == expanded_urls.end()) {
+      urls_not_cached.emplace_back(shortened_url);
+    }
+  }
+  if (!urls_not_cached.empty()) {
+    std::map<std::string, std::string> mongo_urls;
+    _GetMongoUrls(urls_not_cached, &mongo_urls, span->context());
+    if (!mongo_urls.empty()) {
+      _SetMemcachedUrls(mongo_urls, span->context());
+      expanded_urls.insert(mongo_urls.begin(), mongo_urls.end());
+    }
+  }
+
+  _return.reserve(shortened_urls.size());
+  for (auto &shortened_url : shortened_urls) {
+    auto expanded_url = expanded_urls.find(shortened_url);
+    if (expanded_url != expanded_urls.end()) {
+      _return.emplace_back(expanded_url->second);
+    } else {
+      _return.emplace_back();
+    }
+  }
+  span->Finish();
 }
 
 }
@@ -1,8 +1,4 @@
 #include <signal.h>
-#include <thrift/protocol/TBinaryProtocol.h>
-#include <thrift/server/TThreadedServer.h>
-#include <thrift/transport/TBufferTransports.h>
-#include <thrift/transport/TServerSocket.h>
 
 #include "../utils.h"
 #include "../utils_memcached.h"
@@ -11,10 +7,6 @@
 #include "UrlShortenHandler.h"
 #include "nlohmann/json.hpp"
 
-using apache::thrift::protocol::TBinaryProtocolFactory;
-using apache::thrift::server::TThreadedServer;
-using apache::thrift::transport::TFramedTransportFactory;
-using apache::thrift::transport::TServerSocket;
 using namespace social_network;
 
 static memcached_pool_st* memcached_client_pool;
@@ -68,16 +60,19 @@ int main(int argc, char* argv[]) {
   }
   mongoc_client_pool_push(mongodb_client_pool, mongodb_client);
 
-  std::mutex thread_lock;
-  std::shared_ptr<TServerSocket> server_socket = get_server_socket(config_json, "0.0.0.0", port);
-  TThreadedServer server(
+  int executor_threads =
+      config_json["url-shorten-service"].value("executor_threads", 16);
+  int executor_max_pending =
+      config_json["url-shorten-service"].value("executor_max_pending", 256);
+  Executor executor(executor_threads, executor_max_pending);
+
+  auto server = get_server(
+      config_json, "url-shorten-service",
       std::make_shared<UrlShortenServiceProcessor>(
           std::make_shared<UrlShortenHandler>(
-              memcached_client_pool, mongodb_client_pool, &thread_lock)),
-      server_socket,
-      std::make_shared<TFramedTransportFactory>(),
-      std::make_shared<TBinaryProtocolFactory>());
+              memcached_client_pool, mongodb_client_pool, &executor)),
+      port);
 
   LOG(info) << "Starting the url-shorten-service server...";
-  server.serve();
+  server->serve();
 }
\ No newline at end of file
@@ -0,0 +1,140 @@
+#ifndef SOCIAL_NETWORK_MICROSERVICES_SRC_USERMENTIONSERVICE_MISSINGUSERNAMEFILTER_H_
+#define SOCIAL_NETWORK_MICROSERVICES_SRC_USERMENTIONSERVICE_MISSINGUSERNAMEFILTER_H_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace social_network {
+
+// Bloom filter of usernames that MongoDB did not find, so that mentions of
+// misspelled or nonexistent handles stop reaching the database. Since such a
+// name can be registered later, the filter keeps two generations and clears
+// the older one every ttl_ms: a name is remembered for between ttl_ms and
+// 2 * ttl_ms. Bits are set and read with relaxed atomics; a race with a
+// rotation can only lose a name, which costs one extra MongoDB lookup.
+class MissingUsernameFilter {
+ public:
+  MissingUsernameFilter(size_t capacity, double false_positive_rate,
+                        int ttl_ms);
+
+  bool MayContain(const std::string &username);
+  void Insert(const std::string &username);
+
+ private:
+  std::unique_ptr<std::atomic<uint64_t>[]> _generations[2];
+  uint64_t _num_words;
+  uint64_t _num_bits;
+  int _num_hashes;
+  int _ttl_ms;
+  std::atomic<uint64_t> _current;
+  std::atomic<int64_t> _rotated_ms;
+
+  void _MaybeRotate();
+  bool _Test(const std::atomic<uint64_t> *bits, uint64_t h1,
+             uint64_t h2) const;
+  static void _Hash(const std::string &username, uint64_t *h1, uint64_t *h2);
+  static uint64_t _Mix(uint64_t x);
+  static int64_t _NowMs();
+};
+
+MissingUsernameFilter::MissingUsernameFilter(size_t capacity,
+                                             double false_positive_rate,
+                                             int ttl_ms) {
+  double bits_per_name =
+      -std::log(false_positive_rate) / (std::log(2.0) * std::log(2.0));
+  _num_words = std::max<uint64_t>(
+      static_cast<uint64_t>(std::ceil(
+          bits_per_name * std::max<size_t>(capacity, 1) / 64)), 1);
+  _num_bits = _num_words * 64;
+  _num_hashes = std::max(
+      1, static_cast<int>(std::round(bits_per_name * std::log(2.0))));
+  _ttl_ms = ttl_ms;
+  for (auto &bits : _generations) {
+    bits.reset(new std::atomic<uint64_t>[_num_words]);
+    for (uint64_t i = 0; i < _num_words; ++i) {
+      bits[i].store(0, std::memory_order_relaxed);
+    }
+  }
+  _current.store(0);
+  _rotated_ms.store(_NowMs());
+}
+
+int64_t MissingUsernameFilter::_NowMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// splitmix64 finalizer
+uint64_t MissingUsernameFilter::_Mix(uint64_t x) {
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  return x;
+}
+
+void MissingUsernameFilter::_Hash(const std::string &username, uint64_t *h1,
+                                  uint64_t *h2) {
+  // Double hashing: probe i is h1 + i * h2.
+  *h1 = _Mix(std::hash<std::string>()(username));
+  *h2 = _Mix(*h1) | 1;
+}
+
+void MissingUsernameFilter::_MaybeRotate() {
+  if (_ttl_ms <= 0) {
+    return;
+  }
+  int64_t now_ms = _NowMs();
+  int64_t rotated_ms = _rotated_ms.load(std::memory_order_relaxed);
+  if (now_ms - rotated_ms < _ttl_ms ||
+      !_rotated_ms.compare_exchange_strong(rotated_ms, now_ms)) {
+    return;
+  }
+  // The older generation becomes the current one once cleared.
+  uint64_t next = _current.load() ^ 1;
+  std::atomic<uint64_t> *bits = _generations[next].get();
+  for (uint64_t i = 0; i < _num_words; ++i) {
+    bits[i].store(0, std::memory_order_relaxed);
+  }
+  _current.store(next);
+}
+
+bool MissingUsernameFilter::_Test(const std::atomic<uint64_t> *bits,
+                                  uint64_t h1, uint64_t h2) const {
+  for (int i = 0; i < _num_hashes; ++i) {
+    uint64_t bit = (h1 + i * h2) % _num_bits;
+    if (!(bits[bit >> 6].load(std::memory_order_relaxed) &
+          (1ULL << (bit & 63)))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool MissingUsernameFilter::MayContain(const std::string &username) {
+  _MaybeRotate();
+  uint64_t h1, h2;
+  _Hash(username, &h1, &h2);
+  return _Test(_generations[0].get(), h1, h2) ||
+      _Test(_generations[1].get(), h1, h2);
+}
+
+void MissingUsernameFilter::Insert(const std::string &username) {
+  uint64_t h1, h2;
+  _Hash(username, &h1, &h2);
+  std::atomic<uint64_t> *bits = _generations[_current.load()].get();
+  for (int i = 0; i < _num_hashes; ++i) {
+    uint64_t bit = (h1 + i * h2) % _num_bits;
+    bits[bit >> 6].fetch_or(1ULL << (bit & 63), std::memory_order_relaxed);
+  }
+}
+
+}  // namespace social_network
+
+#endif  // SOCIAL_NETWORK_MICROSERVICES_SRC_USERMENTIONSERVICE_MISSINGUSERNAMEFILTER_H_
@@ -6,18 +6,28 @@
 #include <libmemcached/util.h>
 #include <mongoc.h>
 
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
 #include "../../gen-cpp/UserMentionService.h"
 #include "../../gen-cpp/social_network_types.h"
 #include "../ClientPool.h"
+#include "../LocalCache.h"
 #include "../logger.h"
 #include "../tracing.h"
 #include "../utils.h"
+#include "../utils_bson.h"
+#include "MissingUsernameFilter.h"
 
 namespace social_network {
 
 class UserMentionHandler : public UserMentionServiceIf {
  public:
-  UserMentionHandler(memcached_pool_st *, mongoc_client_pool_t *);
+  UserMentionHandler(memcached_pool_st *, mongoc_client_pool_t *,
+                     LocalCache<std::string, int64_t> *,
+                     MissingUsernameFilter *);
   ~UserMentionHandler() override = default;
 
   void ComposeUserMentions(std::vector<UserMention> &_return, int64_t,
@@ -27,207 +37,311 @@ class UserMentionHandler : public UserMentionServiceIf {
  private:
   memcached_pool_st *_memcached_client_pool;
   mongoc_client_pool_t *_mongodb_client_pool;
+  LocalCache<std::string, int64_t> *_user_id_cache;
+  MissingUsernameFilter *_missing_filter;
+
+  // Both fill user_ids[i] for the usernames[i] they find, and only look up
+  // the ones still at -1 (unresolved; -2 marks known missing names).
+  void _GetMemcachedUserIds(int64_t req_id,
+                            const std::vector<const std::string *> &usernames,
+                            std::vector<int64_t> *user_ids,
+                            const opentracing::SpanContext &parent);
+  void _GetMongoUserIds(const std::vector<const std::string *> &usernames,
+                        std::vector<int64_t> *user_ids,
+                        const opentracing::SpanContext &parent);
 };
 
 UserMentionHandler::UserMentionHandler(
     memcached_pool_st *memcached_client_pool,
-    mongoc_client_pool_t *mongodb_client_pool) {
+    mongoc_client_pool_t *mongodb_client_pool,
+    LocalCache<std::string, int64_t> *user_id_cache,
+    MissingUsernameFilter *missing_filter) {
   _memcached_client_pool = memcached_client_pool;
   _mongodb_client_pool = mongodb_client_pool;
+  _user_id_cache = user_id_cache;
+  _missing_filter = missing_filter;
 }
 
+// Usernames are resolved from the in-process cache, then memcached, then
+// MongoDB. Names that MongoDB did not find are recorded in the missing
+// username filter and skip MongoDB while they stay there. The filter is only
+// consulted after memcached, so that its false positives can only hide users
+// that are in neither cache.
 void UserMentionHandler::ComposeUserMentions(
     std::vector<UserMention> &_return, int64_t req_id,
     const std::vector<std::string> &usernames,
     const std::map<std::string, std::string> &carrier) {
   // Initialize a span
-  TextMapReader reader(carrier);
   std::map<std::string, std::string> writer_text_map;
-  TextMapWriter writer(writer_text_map);
-  auto parent_span = opentracing::Tracer::Global()->Extract(reader);
-  auto span = opentracing::Tracer::Global()->StartSpan(
-      "compose_user_mentions_server",
-      {opentracing::ChildOf(parent_span->get())});
-  opentracing::Tracer::Global()->Inject(span->context(), writer);
+  auto span = StartSpanFromCarrier(
+      "compose_user_mentions_server", carrier, &writer_text_map);
 
-  std::vector<UserMention> user_mentions;
-  if (!usernames.empty()) {
-    std::map<std::string, bool> usernames_not_cached;
+  // A post mentions a handful of users, so a linear scan dedups them
+  // without building a set.
+  std::vector<const std::string *> unique_usernames;
+  unique_usernames.reserve(usernames.size());
+  for (auto &username : usernames) {
+    bool seen = false;
+    for (auto unique_username : unique_usernames) {
+      if (*unique_username == username) {
+        seen = true;
+        break;
+      }
+    }
+    if (!seen) {
+      unique_usernames.emplace_back(&username);
+    }
+  }
 
-    for (auto &username : usernames) {
-      usernames_not_cached.emplace(std::make_pair(username, false));
+  std::vector<int64_t> user_ids(unique_usernames.size(), -1);
+  bool lookup = false;
+  for (size_t i = 0; i < unique_usernames.size(); ++i) {
+    if (_user_id_cache) {
+      auto cached_user_id = _user_id_cache->Get(*unique_usernames[i]);
+      if (cached_user_id) {
+        user_ids[i] = *cached_user_id;
+        continue;
+      }
     }
+    lookup = true;
+  }
+  if (lookup) {
+    _GetMemcachedUserIds(req_id, unique_usernames, &user_ids,
+                         span->context());
+    bool mongo_lookup = false;
+    for (size_t i = 0; i < unique_usernames.size(); ++i) {
+      if (user_ids[i] != -1) {
+        continue;
+      }
+      if (_missing_filter &&
+          _missing_filter->MayContain(*unique_usernames[i])) {
+        // Known to be missing, leave it out of the MongoDB query.
+        user_ids[i] = -2;
+      } else {
+        mongo_lookup = true;
+      }
+    }
+    if (mongo_lookup) {
+      // Throws if the query fails, so only names MongoDB did not find are
+      // recorded as missing.
+      _GetMongoUserIds(unique_usernames, &user_ids, span->context());
+      for (size_t i = 0; i < unique_usernames.size(); ++i) {
+        if (user_ids[i] == -1 && _missing_filter) {
+          _missing_filter->Insert(*unique_usernames[i]);
+        }
+      }
+    }
+  }
 
-    // Find in Memcached
-    memcached_return_t rc;
-    auto client = memcached_pool_pop(_memcached_client_pool, true, &rc);
-    if (!client) {
-      ServiceException se;
-      se.errorCode = ErrorCode::SE_MEMCACHED_ERROR;
-      se.message = "Failed to pop a client from memcached pool";
-      throw se;
+  std::vector<UserMention> user_mentions;
+  for (size_t i = 0; i < unique_usernames.size(); ++i) {
+    if (user_ids[i] >= 0) {
+      UserMention new_user_mention;
+      new_user_mention.username = *unique_usernames[i];
+      new_user_mention.user_id = user_ids[i];
+      user_mentions.emplace_back(std::move(new_user_mention));
     }
+  }
 
-    char **keys;
-    size_t *key_sizes;
-    keys = new char *[usernames.size()];
-    key_sizes = new size_t[usernames.size()];
-    int idx = 0;
-    for (auto &username : usernames) {
-      std::string key_str = username + ":user_id";
-      keys[idx] = new char[key_str.length() + 1];
-      strcpy(keys[idx], key_str.c_str());
-      key_sizes[idx] = key_str.length();
-      idx++;
+  _return = std::move(user_mentions);
+  span->Finish();
+}
+
+void UserMentionHandler::_GetMemcachedUserIds(
+    int64_t req_id, const std::vector<const std::string *> &usernames,
+    std::vector<int64_t> *user_ids, const opentracing::SpanContext &parent) {
+  static const char kKeySuffix[] = ":user_id";
+  const size_t suffix_length = sizeof(kKeySuffix) - 1;
+
+  // All the keys are laid out in one buffer, which is sized up front so
+  // that the key pointers into it stay valid.
+  std::vector<size_t> pending;
+  size_t buffer_size = 0;
+  for (size_t i = 0; i < usernames.size(); ++i) {
+    if ((*user_ids)[i] == -1) {
+      pending.emplace_back(i);
+      buffer_size += usernames[i]->size() + suffix_length;
     }
+  }
+  std::string key_buffer;
+  key_buffer.reserve(buffer_size);
+  std::vector<const char *> keys;
+  std::vector<size_t> key_sizes;
+  keys.reserve(pending.size());
+  key_sizes.reserve(pending.size());
+  for (auto i : pending) {
+    size_t offset = key_buffer.size();
+    key_buffer.append(*usernames[i]);
+    key_buffer.append(kKeySuffix, suffix_length);
+    keys.emplace_back(key_buffer.data() + offset);
+    key_sizes.emplace_back(key_buffer.size() - offset);
+  }
 
-    auto get_span = opentracing::Tracer::Global()->StartSpan(
-        "compose_user_mentions_memcached_get_client",
-        {opentracing::ChildOf(&span->context())});
-    rc = memcached_mget(client, keys, key_sizes, usernames.size());
-    if (rc != MEMCACHED_SUCCESS) {
-      LOG(error) << "Cannot get usernames of request " << req_id << ": "
+  memcached_return_t rc;
+  auto client = memcached_pool_pop(_memcached_client_pool, true, &rc);
+  if (!client) {
+    ServiceException se;
+    se.errorCode = ErrorCode::SE_MEMCACHED_ERROR;
+    se.message = "Failed to pop a client from memcached pool";
+    throw se;
+  }
+
+  auto get_span = StartChildSpan(
+      "compose_user_mentions_memcached_get_client", parent);
+  rc = memcached_mget(client, keys.data(), key_sizes.data(), keys.size());
+  if (rc != MEMCACHED_SUCCESS) {
+    LOG(error) << "Cannot get usernames of request " << req_id << ": "
+               << memcached_strerror(client, rc);
+    ServiceException se;
+    se.errorCode = ErrorCode::SE_MEMCACHED_ERROR;
+    se.message = memcached_strerror(client, rc);
+    memcached_pool_push(_memcached_client_pool, client);
+    get_span->Finish();
+    throw se;
+  }
+
+  char return_key[MEMCACHED_MAX_KEY];
+  size_t return_key_length;
+  char *return_value;
+  size_t return_value_length;
+  uint32_t flags;
+
+  while (true) {
+    return_value = memcached_fetch(client, return_key, &return_key_length,
+                                   &return_value_length, &flags, &rc);
+    if (return_value == nullptr) {
+      LOG(debug) << "Memcached mget finished "
                  << memcached_strerror(client, rc);
+      break;
+    }
+    if (rc != MEMCACHED_SUCCESS) {
+      free(return_value);
+      memcached_quit(client);
+      memcached_pool_push(_memcached_client_pool, client);
+      LOG(error) << "Cannot get components of request " << req_id;
       ServiceException se;
       se.errorCode = ErrorCode::SE_MEMCACHED_ERROR;
-      se.message = memcached_strerror(client, rc);
-      memcached_pool_push(_memcached_client_pool, client);
+      se.message =
+          "Cannot get usernames of request " + std::to_string(req_id);
       get_span->Finish();
       throw se;
     }
-
-    char return_key[MEMCACHED_MAX_KEY];
-    size_t return_key_length;
-    char *return_value;
-    size_t return_value_length;
-    uint32_t flags;
-
-    while (true) {
-      return_value = memcached_fetch(client, return_key, &return_key_length,
-                                     &return_value_length, &flags, &rc);
-      if (return_value == nullptr) {
-        LOG(debug) << "Memcached mget finished "
-                   << memcached_strerror(client, rc);
+    for (size_t k = 0; k < keys.size(); ++k) {
+      if (key_sizes[k] == return_key_length &&
+          std::memcmp(keys[k], return_key, return_key_length) == 0) {
+        // libmemcached terminates the value it returns.
+        int64_t user_id = std::strtoll(return_value, nullptr, 10);
+        (*user_ids)[pending[k]] = user_id;
+        if (_user_id_cache) {
+          _user_id_cache->Put(
+              *usernames[pending[k]], std::make_shared<const int64_t>(user_id),
+              usernames[pending[k]]->size() + sizeof(int64_t));
+        }
         break;
       }
-      if (rc != MEMCACHED_SUCCESS) {
-        free(return_value);
-        memcached_quit(client);
-        memcached_pool_push(_memcached_client_pool, client);
-        LOG(error) << "Cannot get components of request " << req_id;
-        ServiceException se;
-        se.errorCode = ErrorCode::SE_MEMCACHED_ERROR;
-        se.message =
-            "Cannot get usernames of request " + std::to_string(req_id);
-        get_span->Finish();
-        throw se;
-      }
-      UserMention new_user_mention;
-      std::string username(return_key, return_key + return_key_length);
-      username =
-          username.substr(0, username.length() - std::strlen(":user_id"));
-      new_user_mention.username = username;
-      new_user_mention.user_id = std::stoul(
-          std::string(return_value, return_value + return_value_length));
-      user_mentions.emplace_back(new_user_mention);
-      usernames_not_cached.erase(username);
-      free(return_value);
     }
-    memcached_quit(client);
-    memcached_pool_push(_memcached_client_pool, client);
-    get_span->Finish();
-    for (int i = 0; i < usernames.size(); ++i) {
-      delete keys[i];
+    free(return_value);
+  }
+  memcached_quit(client);
+  memcached_pool_push(_memcached_client_pool, client);
+  get_span->Finish();
+}
+
+void UserMentionHandler::_GetMongoUserIds(
+    const std::vector<const std::string *> &usernames,
+    std::vector<int64_t> *user_ids, const opentracing::SpanContext &parent) {
+  mongoc_client_t *mongodb_client =
+      mongoc_client_pool_pop(_mongodb_client_pool);
+  if (!mongodb_client) {
+    ServiceException se;
+    se.errorCode = ErrorCode::SE_MONGODB_ERROR;
+    se.message = "Failed to pop a client from MongoDB pool";
+    throw se;
+  }
+
+  auto collection =
+      mongoc_client_get_collection(mongodb_client, "user", "user");
+  if (!collection) {
+    ServiceException se;
+    se.errorCode = ErrorCode::SE_MONGODB_ERROR;
+    se.message = "Failed to create collection user from DB user";
+    mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
+    throw se;
+  }
+
+  bson_t *query = bson_new();
+  bson_t query_child_0;
+  bson_t query_username_list;
+  const char *key;
+  uint32_t idx = 0;
+  char buf[16];
+
+  BSON_APPEND_DOCUMENT_BEGIN(query, "username", &query_child_0);
+  BSON_APPEND_ARRAY_BEGIN(&query_child_0, "$in", &query_username_list);
+  for (size_t i = 0; i < usernames.size(); ++i) {
+    if ((*user_ids)[i] == -1) {
+      bson_uint32_to_string(idx, &key, buf, sizeof buf);
+      BSON_APPEND_UTF8(&query_username_list, key, usernames[i]->c_str());
+      idx++;
     }
-    delete[] keys;
-    delete[] key_sizes;
-
-    // Find the rest in MongoDB
-    if (!usernames_not_cached.empty()) {
-      mongoc_client_t *mongodb_client =
-          mongoc_client_pool_pop(_mongodb_client_pool);
-      if (!mongodb_client) {
-        ServiceException se;
-        se.errorCode = ErrorCode::SE_MONGODB_ERROR;
-        se.message = "Failed to pop a client from MongoDB pool";
-        throw se;
-      }
+  }
+  bson_append_array_end(&query_child_0, &query_username_list);
+  bson_append_document_end(query, &query_child_0);
+  bson_t *opts = BCON_NEW("projection", "{", "_id", BCON_BOOL(false),
+                          "username", BCON_BOOL(true), "user_id",
+                          BCON_BOOL(true), "}");
 
-      auto collection =
-          mongoc_client_get_collection(mongodb_client, "user", "user");
-      if (!collection) {
-        ServiceException se;
-        se.errorCode = ErrorCode::SE_MONGODB_ERROR;
-        se.message = "Failed to create collection user from DB user";
-        mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
-        throw se;
-      }
+  auto find_span = StartChildSpan(
+      "compose_user_mentions_mongo_find_client", parent);
+  mongoc_cursor_t *cursor =
+      mongoc_collection_find_with_opts(collection, query, opts, nullptr);
+  const bson_t *doc;
 
-      bson_t *query = bson_new();
-      bson_t query_child_0;
-      bson_t query_username_list;
-      const char *key;
-      idx = 0;
-      char buf[16];
-
-      BSON_APPEND_DOCUMENT_BEGIN(query, "username", &query_child_0);
-      BSON_APPEND_ARRAY_BEGIN(&query_child_0, "$in", &query_username_list);
-      for (auto &item : usernames_not_cached) {
-        bson_uint32_to_string(idx, &key, buf, sizeof buf);
-        BSON_APPEND_UTF8(&query_username_list, key, item.first.c_str());
-        idx++;
-      }
-      bson_append_array_end(&query_child_0, &query_username_list);
-      bson_append_document_end(query, &query_child_0);
-
-      auto find_span = opentracing::Tracer::Global()->StartSpan(
-          "compose_user_mentions_mongo_find_client",
-          {opentracing::ChildOf(&span->context())});
-      mongoc_cursor_t *cursor =
-          mongoc_collection_find_with_opts(collection, query, nullptr, nullptr);
-      const bson_t *doc;
-
-      while (mongoc_cursor_next(cursor, &doc)) {
-        bson_iter_t iter;
-        UserMention new_user_mention;
-        if (bson_iter_init_find(&iter, doc, "user_id")) {
-          new_user_mention.user_id = bson_iter_value(&iter)->value.v_int64;
-        } else {
-          ServiceException se;
-          se.errorCode = ErrorCode::SE_MONGODB_ERROR;
-          se.message = "Attribute of MongoDB item is not complete";
-          bson_destroy(query);
-          mongoc_cursor_destroy(cursor);
-          mongoc_collection_destroy(collection);
-          mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
-          find_span->Finish();
-          throw se;
-        }
-        if (bson_iter_init_find(&iter, doc, "username")) {
-          new_user_mention.username = bson_iter_value(&iter)->value.v_utf8.str;
-        } else {
-          ServiceException se;
-          se.errorCode = ErrorCode::SE_MONGODB_ERROR;
-          se.message = "Attribute of MongoDB item is not complete";
-          bson_destroy(query);
-          mongoc_cursor_destroy(cursor);
-          mongoc_collection_destroy(collection);
-          mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
-          find_span->Finish();
-          throw se;
-        }
-        user_mentions.emplace_back(new_user_mention);
-      }
+  while (mongoc_cursor_next(cursor, &doc)) {
+    UserMention new_user_mention;
+    if (!BsonToUserMention(doc, &new_user_mention)) {
+      ServiceException se;
+      se.errorCode = ErrorCode::SE_MONGODB_ERROR;
+      se.message = "Attribute of MongoDB item is not complete";
+      bson_destroy(opts);
       bson_destroy(query);
       mongoc_cursor_destroy(cursor);
       mongoc_collection_destroy(collection);
       mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
       find_span->Finish();
+      throw se;
+    }
+    for (size_t i = 0; i < usernames.size(); ++i) {
+      if (*usernames[i] == new_user_mention.username) {
+        (*user_ids)[i] = new_user_mention.user_id;
+        if (_user_id_cache) {
+          _user_id_cache->Put(
+              *usernames[i],
+              std::make_shared<const int64_t>(new_user_mention.user_id),
+              usernames[i]->size() + sizeof(int64_t));
+        }
+        break;
+      }
     }
   }
-
-  _return = user_mentions;
-  span->Finish();
+  // A failed query ends the cursor early, which must not be mistaken for
+  // the remaining names being missing.
+  bson_error_t error;
+  bool failed = mongoc_cursor_error(cursor, &error);
+  bson_destroy(opts);
+  bson_destroy(query);
+  mongoc_cursor_destroy(cursor);
+  mongoc_collection_destroy(collection);
+  mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
+  find_span->Finish();
+  if (failed) {
+    LOG(error) << "Failed to find user ids of mentioned usernames from "
+               << "MongoDB: " << error.message;
+    ServiceException se;
+    se.errorCode = ErrorCode::SE_MONGODB_ERROR;
+    se.message = error.message;
+    throw se;
+  }
 }
 
 }  // namespace social_network
@@ -1,8 +1,4 @@
 #include <signal.h>
-#include <thrift/protocol/TBinaryProtocol.h>
-#include <thrift/server/TThreadedServer.h>
-#include <thrift/transport/TBufferTransports.h>
-#include <thrift/transport/TServerSocket.h>
 
 #include "../utils.h"
 #include "../utils_memcached.h"
@@ -11,10 +7,6 @@
 #include "UserMentionHandler.h"
 #include "nlohmann/json.hpp"
 
-using apache::thrift::protocol::TBinaryProtocolFactory;
-using apache::thrift::server::TThreadedServer;
-using apache::thrift::transport::TFramedTransportFactory;
-using apache::thrift::transport::TServerSocket;
 using namespace social_network;
 
 static memcached_pool_st* memcached_client_pool;
@@ -56,15 +48,49 @@ int main(int argc, char* argv[]) {
     return EXIT_FAILURE;
   }
 
-  std::shared_ptr<TServerSocket> server_socket = get_server_socket(config_json, "0.0.0.0", port);
+  // In-process username -> user_id cache in front of memcached, disabled
+  // when its size is 0. User ids never change, so entries need no expiry.
+  const json &service_json = config_json["user-mention-service"];
+  int local_cache_size_mb = service_json.value("local_cache_size_mb", 0);
+  int local_cache_shards = service_json.value("local_cache_shards", 16);
+  int local_cache_ttl_ms = service_json.value("local_cache_ttl_ms", 0);
+  int local_cache_stats_interval_ms =
+      service_json.value("local_cache_stats_interval_ms", 0);
+  std::unique_ptr<LocalCache<std::string, int64_t>> user_id_cache;
+  if (local_cache_size_mb > 0) {
+    user_id_cache.reset(new LocalCache<std::string, int64_t>(
+        static_cast<size_t>(local_cache_size_mb) << 20, local_cache_shards,
+        local_cache_ttl_ms));
+    if (local_cache_stats_interval_ms > 0) {
+      start_local_cache_stats_logger("user-mention", user_id_cache.get(),
+                                     local_cache_stats_interval_ms);
+    }
+    LOG(info) << "Using a " << local_cache_size_mb
+              << " MB in-process user id cache";
+  }
+
+  // Filter of usernames known not to exist, disabled when its capacity is 0.
+  int missing_filter_capacity =
+      service_json.value("missing_username_filter_capacity", 0);
+  double missing_filter_fp_rate =
+      service_json.value("missing_username_filter_fp_rate", 0.001);
+  int missing_filter_ttl_ms =
+      service_json.value("missing_username_filter_ttl_ms", 60000);
+  std::unique_ptr<MissingUsernameFilter> missing_filter;
+  if (missing_filter_capacity > 0) {
+    missing_filter.reset(new MissingUsernameFilter(
+        missing_filter_capacity, missing_filter_fp_rate,
+        missing_filter_ttl_ms));
+  }
 
-  TThreadedServer server(std::make_shared<UserMentionServiceProcessor>(
-                             std::make_shared<UserMentionHandler>(
-                                 memcached_client_pool, mongodb_client_pool)),
-                         server_socket,
-                         std::make_shared<TFramedTransportFactory>(),
-                         std::make_shared<TBinaryProtocolFactory>());
+  auto server = get_server(
+      config_json, "user-mention-service",
+      std::make_shared<UserMentionServiceProcessor>(
+          std::make_shared<UserMentionHandler>(
+              memcached_client_pool, mongodb_client_pool,
+              user_id_cache.get(), missing_filter.get())),
+      port);
 
   LOG(info) << "Starting the user-mention-service server...";
-  server.serve();
+  server->serve();
 }
\ No newline at end of file
@@ -18,6 +18,7 @@
 #include "../../gen-cpp/social_network_types.h"
 #include "../../third_party/PicoSHA2/picosha2.h"
 #include "../ClientPool.h"
+#include "../SingleFlight.h"
 #include "../ThriftClient.h"
 #include "../logger.h"
 #include "../tracing.h"
@@ -98,6 +99,10 @@ class UserHandler : public UserServiceIf {
   memcached_pool_st *_memcached_client_pool;
   mongoc_client_pool_t *_mongodb_client_pool;
   ClientPool<ThriftClient<SocialGraphServiceClient>> *_social_graph_client_pool;
+
+  // MongoDB lookups on memcached misses, keyed by username.
+  SingleFlight<std::string, int64_t> _user_id_flight;
+  SingleFlight<std::string, json> _login_flight;
 };
 
 UserHandler::UserHandler(std::mutex *thread_lock, const std::string &machine_id,
@@ -120,14 +125,9 @@ void UserHandler::RegisterUserWithId(
     const std::string &password, const int64_t user_id,
     const std::map<std::string, std::string> &carrier) {
   // Initialize a span
-  TextMapReader reader(carrier);
   std::map<std::string, std::string> writer_text_map;
-  TextMapWriter writer(writer_text_map);
-  auto parent_span = opentracing::Tracer::Global()->Extract(reader);
-  auto span = opentracing::Tracer::Global()->StartSpan(
-      "register_user_withid_server",
-      {opentracing::ChildOf(parent_span->get())});
-  opentracing::Tracer::Global()->Inject(span->context(), writer);
+  auto span = StartSpanFromCarrier(
+      "register_user_withid_server", carrier, &writer_text_map);
 
   // Store user info into mongodb
   mongoc_client_t *mongodb_client =
@@ -181,8 +181,8 @@ void UserHandler::RegisterUserWithId(
     BSON_APPEND_UTF8(new_doc, "password", password_hashed.c_str());
 
     bson_error_t error;
-    auto user_insert_span = opentracing::Tracer::Global()->StartSpan(
-        "user_mongo_insert_cilent", {opentracing::ChildOf(&span->context())});
+    auto user_insert_span = StartChildSpan(
+        "user_mongo_insert_cilent", span->context());
     if (!mongoc_collection_insert_one(collection, new_doc, nullptr, nullptr,
                                       &error)) {
       LOG(error) << "Failed to insert user " << username
@@ -235,13 +235,9 @@ void UserHandler::RegisterUser(
     const std::string &password,
     const std::map<std::string, std::string> &carrier) {
   // Initialize a span
-  TextMapReader reader(carrier);
   std::map<std::string, std::string> writer_text_map;
-  TextMapWriter writer(writer_text_map);
-  auto parent_span = opentracing::Tracer::Global()->Extract(reader);
-  auto span = opentracing::Tracer::Global()->StartSpan(
-      "register_user_server", {opentracing::ChildOf(parent_span->get())});
-  opentracing::Tracer::Global()->Inject(span->context(), writer);
+  auto span = StartSpanFromCarrier(
+      "register_user_server", carrier, &writer_text_map);
 
   // Compose user_id
   _thread_lock->lock();
@@ -328,8 +324,8 @@ void UserHandler::RegisterUser(
     std::string password_hashed = picosha2::hash256_hex_string(password + salt);
     BSON_APPEND_UTF8(new_doc, "password", password_hashed.c_str());
 
-    auto user_insert_span = opentracing::Tracer::Global()->StartSpan(
-        "user_mongo_insert_client", {opentracing::ChildOf(&span->context())});
+    auto user_insert_span = StartChildSpan(
+        "user_mongo_insert_client", span->context());
     if (!mongoc_collection_insert_one(collection, new_doc, nullptr, nullptr,
                                       &error)) {
       LOG(error) << "Failed to insert user " << username
@@ -380,13 +376,9 @@ void UserHandler::RegisterUser(
 void UserHandler::ComposeCreatorWithUsername(
     Creator &_return, const int64_t req_id, const std::string &username,
     const std::map<std::string, std::string> &carrier) {
-  TextMapReader reader(carrier);
   std::map<std::string, std::string> writer_text_map;
-  TextMapWriter writer(writer_text_map);
-  auto parent_span = opentracing::Tracer::Global()->Extract(reader);
-  auto span = opentracing::Tracer::Global()->StartSpan(
-      "compose_creator_server", {opentracing::ChildOf(parent_span->get())});
-  opentracing::Tracer::Global()->Inject(span->context(), writer);
+  auto span = StartSpanFromCarrier(
+      "compose_creator_server", carrier, &writer_text_map);
 
   size_t user_id_size;
   uint32_t memcached_flags;
@@ -394,10 +386,9 @@ void UserHandler::ComposeCreatorWithUsername(
   memcached_return_t memcached_rc;
   memcached_st *memcached_client =
       memcached_pool_pop(_memcached_client_pool, true, &memcached_rc);
-  char *user_id_mmc;
+  char *user_id_mmc = nullptr;
   if (memcached_client) {
-    auto id_get_span = opentracing::Tracer::Global()->StartSpan(
-        "user_mmc_get_client", {opentracing::ChildOf(&span->context())});
+    auto id_get_span = StartChildSpan("user_mmc_get_client", span->context());
     user_id_mmc =
         memcached_get(memcached_client, (username + ":user_id").c_str(),
                       (username + ":user_id").length(), &user_id_size,
@@ -424,81 +415,89 @@ void UserHandler::ComposeCreatorWithUsername(
     free(user_id_mmc);
   }
 
-  // If not cached in memcached
+  // If not cached in memcached. Concurrent misses of the same username wait
+  // for a single MongoDB lookup.
   else {
     LOG(debug) << "user_id not cached in Memcached";
-    mongoc_client_t *mongodb_client =
-        mongoc_client_pool_pop(_mongodb_client_pool);
-    if (!mongodb_client) {
-      ServiceException se;
-      se.errorCode = ErrorCode::SE_MONGODB_ERROR;
-      se.message = "Failed to pop a client from MongoDB pool";
-      throw se;
-    }
-    auto collection =
-        mongoc_client_get_collection(mongodb_client, "user", "user");
-    if (!collection) {
-      ServiceException se;
-      se.errorCode = ErrorCode::SE_MONGODB_ERROR;
-      se.message = "Failed to create collection user from DB user";
-      throw se;
-    }
-    bson_t *query = bson_new();
-    BSON_APPEND_UTF8(query, "username", username.c_str());
-
-    auto find_span = opentracing::Tracer::Global()->StartSpan(
-        "user_mongo_find_client", {opentracing::ChildOf(&span->context())});
-    mongoc_cursor_t *cursor =
-        mongoc_collection_find_with_opts(collection, query, nullptr, nullptr);
-    const bson_t *doc;
-    bool found = mongoc_cursor_next(cursor, &doc);
-    find_span->Finish();
-    if (!found) {
-      bson_error_t error;
-      if (mongoc_cursor_error(cursor, &error)) {
-        LOG(error) << error.message;
-        bson_destroy(query);
-        mongoc_cursor_destroy(cursor);
-        mongoc_collection_destroy(collection);
-        mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
+    bool leader;
+    user_id = _user_id_flight.Do(username, [&]() -> int64_t {
+      int64_t mongo_user_id = -1;
+      mongoc_client_t *mongodb_client =
+          mongoc_client_pool_pop(_mongodb_client_pool);
+      if (!mongodb_client) {
         ServiceException se;
         se.errorCode = ErrorCode::SE_MONGODB_ERROR;
-        se.message = error.message;
+        se.message = "Failed to pop a client from MongoDB pool";
         throw se;
-      } else {
-        LOG(warning) << "User: " << username << " doesn't exist in MongoDB";
-        bson_destroy(query);
-        mongoc_cursor_destroy(cursor);
-        mongoc_collection_destroy(collection);
-        mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
+      }
+      auto collection =
+          mongoc_client_get_collection(mongodb_client, "user", "user");
+      if (!collection) {
         ServiceException se;
-        se.errorCode = ErrorCode::SE_THRIFT_HANDLER_ERROR;
-        se.message = "User: " + username + " is not registered";
+        se.errorCode = ErrorCode::SE_MONGODB_ERROR;
+        se.message = "Failed to create collection user from DB user";
         throw se;
       }
-    } else {
-      LOG(debug) << "User: " << username << " found in MongoDB";
-      bson_iter_t iter;
-      if (bson_iter_init_find(&iter, doc, "user_id")) {
-        user_id = bson_iter_value(&iter)->value.v_int64;
+      bson_t *query = bson_new();
+      BSON_APPEND_UTF8(query, "username", username.c_str());
+
+      auto find_span = StartChildSpan(
+          "user_mongo_find_client", span->context());
+      mongoc_cursor_t *cursor =
+          mongoc_collection_find_with_opts(collection, query, nullptr, nullptr);
+      const bson_t *doc;
+      bool found = mongoc_cursor_next(cursor, &doc);
+      find_span->Finish();
+      if (!found) {
+        bson_error_t error;
+        if (mongoc_cursor_error(cursor, &error)) {
+          LOG(error) << error.message;
+          bson_destroy(query);
+          mongoc_cursor_destroy(cursor);
+          mongoc_collection_destroy(collection);
+          mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
+          ServiceException se;
+          se.errorCode = ErrorCode::SE_MONGODB_ERROR;
+          se.message = error.message;
+          throw se;
+        } else {
+          LOG(warning) << "User: " << username << " doesn't exist in MongoDB";
+          bson_destroy(query);
+          mongoc_cursor_destroy(cursor);
+          mongoc_collection_destroy(collection);
+          mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
+          ServiceException se;
+          se.errorCode = ErrorCode::SE_THRIFT_HANDLER_ERROR;
+          se.message = "User: " + username + " is not registered";
+          throw se;
+        }
       } else {
-        LOG(error) << "user_id attribute of user " << username
-                   << " was not found in the User object";
-        bson_destroy(query);
-        mongoc_cursor_destroy(cursor);
-        mongoc_collection_destroy(collection);
-        mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
-        ServiceException se;
-        se.errorCode = ErrorCode::SE_THRIFT_HANDLER_ERROR;
-        se.message = "user_id attribute of user: " + username +
-                     " was not found in the User object";
-        throw se;
+        LOG(debug) << "User: " << username << " found in MongoDB";
+        bson_iter_t iter;
+        if (bson_iter_init_find(&iter, doc, "user_id")) {
+          mongo_user_id = bson_iter_value(&iter)->value.v_int64;
+        } else {
+          LOG(error) << "user_id attribute of user " << username
+                     << " was not found in the User object";
+          bson_destroy(query);
+          mongoc_cursor_destroy(cursor);
+          mongoc_collection_destroy(collection);
+          mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
+          ServiceException se;
+          se.errorCode = ErrorCode::SE_THRIFT_HANDLER_ERROR;
+          se.message = "user_id attribute of user: " + username +
+                       " was not found in the User object";
+          throw se;
+        }
       }
-    }
-    bson_destroy(query);
-    mongoc_cursor_destroy(cursor);
-    mongoc_collection_destroy(collection);
-    mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
+      bson_destroy(query);
+      mongoc_cursor_destroy(cursor);
+      mongoc_collection_destroy(collection);
+      mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
+      return mongo_user_id;
+    }, &leader);
+    // Only the caller that ran the lookup writes it back to memcached.
+    cached = !leader;
   }
 
   Creator creator;
@@ -513,8 +512,7 @@ void UserHandler::ComposeCreatorWithUsername(
       memcached_pool_pop(_memcached_client_pool, true, &memcached_rc);
   if (memcached_client) {
     if (user_id != -1 && !cached) {
-      auto id_set_span = opentracing::Tracer::Global()->StartSpan(
-          "user_mmc_set_cilent", {opentracing::ChildOf(&span->context())});
+      auto id_set_span = StartChildSpan("user_mmc_set_cilent", span->context());
       std::string user_id_str = std::to_string(user_id);
       memcached_rc =
           memcached_set(memcached_client, (username + ":user_id").c_str(),
@@ -539,13 +537,9 @@ void UserHandler::ComposeCreatorWithUserId(
     Creator &_return, int64_t req_id, int64_t user_id,
     const std::string &username,
     const std::map<std::string, std::string> &carrier) {
-  TextMapReader reader(carrier);
   std::map<std::string, std::string> writer_text_map;
-  TextMapWriter writer(writer_text_map);
-  auto parent_span = opentracing::Tracer::Global()->Extract(reader);
-  auto span = opentracing::Tracer::Global()->StartSpan(
-      "compose_creator_server", {opentracing::ChildOf(parent_span->get())});
-  opentracing::Tracer::Global()->Inject(span->context(), writer);
+  auto span = StartSpanFromCarrier(
+      "compose_creator_server", carrier, &writer_text_map);
 
   Creator creator;
   creator.username = username;
@@ -560,13 +554,8 @@ void UserHandler::Login(std::string &_return, int64_t req_id,
                         const std::string &username,
                         const std::string &password,
                         const std::map<std::string, std::string> &carrier) {
-  TextMapReader reader(carrier);
   std::map<std::string, std::string> writer_text_map;
-  TextMapWriter writer(writer_text_map);
-  auto parent_span = opentracing::Tracer::Global()->Extract(reader);
-  auto span = opentracing::Tracer::Global()->StartSpan(
-      "login_server", {opentracing::ChildOf(parent_span->get())});
-  opentracing::Tracer::Global()->Inject(span->context(), writer);
+  auto span = StartSpanFromCarrier("login_server", carrier, &writer_text_map);
 
   size_t login_size;
   uint32_t memcached_flags;
@@ -574,12 +563,12 @@ void UserHandler::Login(std::string &_return, int64_t req_id,
   memcached_return_t memcached_rc;
   memcached_st *memcached_client =
       memcached_pool_pop(_memcached_client_pool, true, &memcached_rc);
-  char *login_mmc;
+  char *login_mmc = nullptr;
   if (!memcached_client) {
     LOG(warning) << "Failed to pop a client from memcached pool";
   } else {
-    auto get_login_span = opentracing::Tracer::Global()->StartSpan(
-        "user_mmc_get_client", {opentracing::ChildOf(&span->context())});
+    auto get_login_span = StartChildSpan(
+        "user_mmc_get_client", span->context());
     login_mmc = memcached_get(memcached_client, (username + ":login").c_str(),
                               (username + ":login").length(), &login_size,
                               &memcached_flags, &memcached_rc);
@@ -609,89 +598,100 @@ void UserHandler::Login(std::string &_return, int64_t req_id,
   }
 
   else {
-    // If not cached in memcached
+    // If not cached in memcached. Concurrent misses of the same username
+    // wait for a single MongoDB lookup.
     LOG(debug) << "Username: " << username << " NOT cached in Memcached";
+    bool leader;
+    login_json = _login_flight.Do(username, [&]() -> json {
+      json mongo_login_json;
 
-    mongoc_client_t *mongodb_client =
-        mongoc_client_pool_pop(_mongodb_client_pool);
-    if (!mongodb_client) {
-      ServiceException se;
-      se.errorCode = ErrorCode::SE_MONGODB_ERROR;
-      se.message = "Failed to pop a client from MongoDB pool";
-      throw se;
-    }
-    auto collection =
-        mongoc_client_get_collection(mongodb_client, "user", "user");
-    if (!collection) {
-      ServiceException se;
-      se.errorCode = ErrorCode::SE_MONGODB_ERROR;
-      se.message = "Failed to create collection user from DB user";
-      throw se;
-    }
-    bson_t *query = bson_new();
-    BSON_APPEND_UTF8(query, "username", username.c_str());
+      mongoc_client_t *mongodb_client =
+          mongoc_client_pool_pop(_mongodb_client_pool);
+      if (!mongodb_client) {
+        ServiceException se;
+        se.errorCode = ErrorCode::SE_MONGODB_ERROR;
+        se.message = "Failed to pop a client from MongoDB pool";
+        throw se;
+      }
+      auto collection =
+          mongoc_client_get_collection(mongodb_client, "user", "user");
+      if (!collection) {
+        ServiceException se;
+        se.errorCode = ErrorCode::SE_MONGODB_ERROR;
+        se.message = "Failed to create collection user from DB user";
+        throw se;
+      }
+      bson_t *query = bson_new();
+      BSON_APPEND_UTF8(query, "username", username.c_str());
 
-    auto find_span = opentracing::Tracer::Global()->StartSpan(
-        "user_mongo_find_client", {opentracing::ChildOf(&span->context())});
-    mongoc_cursor_t *cursor =
-        mongoc_collection_find_with_opts(collection, query, nullptr, nullptr);
-    const bson_t *doc;
-    bool found = mongoc_cursor_next(cursor, &doc);
-    find_span->Finish();
+      auto find_span = StartChildSpan(
+          "user_mongo_find_client", span->context());
+      mongoc_cursor_t *cursor =
+          mongoc_collection_find_with_opts(collection, query, nullptr, nullptr);
+      const bson_t *doc;
+      bool found = mongoc_cursor_next(cursor, &doc);
+      find_span->Finish();
 
-    bson_error_t error;
-    if (mongoc_cursor_error(cursor, &error)) {
-      LOG(error) << error.message;
-      bson_destroy(query);
-      mongoc_cursor_destroy(cursor);
-      mongoc_collection_destroy(collection);
-      mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
-      ServiceException se;
-      se.errorCode = ErrorCode::SE_MONGODB_ERROR;
-      se.message = error.message;
-      throw se;
-    }
+      bson_error_t error;
+      if (mongoc_cursor_error(cursor, &error)) {
+        LOG(error) << error.message;
+        bson_destroy(query);
+        mongoc_cursor_destroy(cursor);
+        mongoc_collection_destroy(collection);
+        mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
+        ServiceException se;
+        se.errorCode = ErrorCode::SE_MONGODB_ERROR;
+        se.message = error.message;
+        throw se;
+      }
 
-    if (!found) {
-      LOG(warning) << "User: " << username << " doesn't exist in MongoDB";
-      bson_destroy(query);
-      mongoc_cursor_destroy(cursor);
-      mongoc_collection_destroy(collection);
-      mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
-      ServiceException se;
-      se.errorCode = ErrorCode::SE_UNAUTHORIZED;
-      se.message = "User: " + username + " is not registered";
-      throw se;
-    } else {
-      LOG(debug) << "Username: " << username << " found in MongoDB";
-      bson_iter_t iter_password;
-      bson_iter_t iter_salt;
-      bson_iter_t iter_user_id;
-      if (bson_iter_init_find(&iter_password, doc, "password") &&
-          bson_iter_init_find(&iter_salt, doc, "salt") &&
-          bson_iter_init_find(&iter_user_id, doc, "user_id")) {
-        password_stored = bson_iter_value(&iter_password)->value.v_utf8.str;
-        salt_stored = bson_iter_value(&iter_salt)->value.v_utf8.str;
-        user_id_stored = bson_iter_value(&iter_user_id)->value.v_int64;
-        login_json["password"] = password_stored;
-        login_json["salt"] = salt_stored;
-        login_json["user_id"] = user_id_stored;
-      } else {
-        LOG(error) << "user: " << username << " entry is NOT complete";
+      if (!found) {
+        LOG(warning) << "User: " << username << " doesn't exist in MongoDB";
         bson_destroy(query);
         mongoc_cursor_destroy(cursor);
         mongoc_collection_destroy(collection);
         mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
         ServiceException se;
-        se.errorCode = ErrorCode::SE_THRIFT_HANDLER_ERROR;
-        se.message = "user: " + username + " entry is NOT complete";
+        se.errorCode = ErrorCode::SE_UNAUTHORIZED;
+        se.message = "User: " + username + " is not registered";
         throw se;
+      } else {
+        LOG(debug) << "Username: " << username << " found in MongoDB";
+        bson_iter_t iter_password;
+        bson_iter_t iter_salt;
+        bson_iter_t iter_user_id;
+        if (bson_iter_init_find(&iter_password, doc, "password") &&
+            bson_iter_init_find(&iter_salt, doc, "salt") &&
+            bson_iter_init_find(&iter_user_id, doc, "user_id")) {
+          mongo_login_json["password"] =
+              bson_iter_value(&iter_password)->value.v_utf8.str;
+          mongo_login_json["salt"] =
+              bson_iter_value(&iter_salt)->value.v_utf8.str;
+          mongo_login_json["user_id"] =
+              bson_iter_value(&iter_user_id)->value.v_int64;
+        } else {
+          LOG(error) << "user: " << username << " entry is NOT complete";
+          bson_destroy(query);
+          mongoc_cursor_destroy(cursor);
+          mongoc_collection_destroy(collection);
+          mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
+          ServiceException se;
+          se.errorCode = ErrorCode::SE_THRIFT_HANDLER_ERROR;
+          se.message = "user: " + username + " entry is NOT complete";
+          throw se;
+        }
+        bson_destroy(query);
+        mongoc_cursor_destroy(cursor);
+        mongoc_collection_destroy(collection);
+        mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
       }
-      bson_destroy(query);
-      mongoc_cursor_destroy(cursor);
-      mongoc_collection_destroy(collection);
-      mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
-    }
+      return mongo_login_json;
+    }, &leader);
+    password_stored = login_json["password"];
+    salt_stored = login_json["salt"];
+    user_id_stored = login_json["user_id"];
+    // Only the caller that ran the lookup writes it back to memcached.
+    cached = !leader;
   }
 
   if (user_id_stored != -1 && !salt_stored.empty() &&
@@ -728,8 +728,8 @@ void UserHandler::Login(std::string &_return, int64_t req_id,
     if (!memcached_client) {
       LOG(warning) << "Failed to pop a client from memcached pool";
     } else {
-      auto set_login_span = opentracing::Tracer::Global()->StartSpan(
-          "user_mmc_set_client", {opentracing::ChildOf(&span->context())});
+      auto set_login_span = StartChildSpan(
+          "user_mmc_set_client", span->context());
       std::string login_str = login_json.dump();
       memcached_rc =
           memcached_set(memcached_client, (username + ":login").c_str(),
@@ -749,13 +749,9 @@ void UserHandler::Login(std::string &_return, int64_t req_id,
 int64_t UserHandler::GetUserId(
     int64_t req_id, const std::string &username,
     const std::map<std::string, std::string> &carrier) {
-  TextMapReader reader(carrier);
   std::map<std::string, std::string> writer_text_map;
-  TextMapWriter writer(writer_text_map);
-  auto parent_span = opentracing::Tracer::Global()->Extract(reader);
-  auto span = opentracing::Tracer::Global()->StartSpan(
-      "get_user_id_server", {opentracing::ChildOf(parent_span->get())});
-  opentracing::Tracer::Global()->Inject(span->context(), writer);
+  auto span = StartSpanFromCarrier(
+      "get_user_id_server", carrier, &writer_text_map);
 
   size_t user_id_size;
   uint32_t memcached_flags;
@@ -763,11 +759,10 @@ int64_t UserHandler::GetUserId(
   memcached_return_t memcached_rc;
   memcached_st *memcached_client =
       memcached_pool_pop(_memcached_client_pool, true, &memcached_rc);
-  char *user_id_mmc;
+  char *user_id_mmc = nullptr;
   if (memcached_client) {
-    auto id_get_span = opentracing::Tracer::Global()->StartSpan(
-        "user_mmc_get_user_id_client",
-        {opentracing::ChildOf(&span->context())});
+    auto id_get_span = StartChildSpan(
+        "user_mmc_get_user_id_client", span->context());
     user_id_mmc =
         memcached_get(memcached_client, (username + ":user_id").c_str(),
                       (username + ":user_id").length(), &user_id_size,
@@ -814,8 +809,7 @@ int64_t UserHandler::GetUserId(
     bson_t *query = bson_new();
     BSON_APPEND_UTF8(query, "username", username.c_str());
 
-    auto find_span = opentracing::Tracer::Global()->StartSpan(
-        "user_mongo_find_client", {opentracing::ChildOf(&span->context())});
+    auto find_span = StartChildSpan("user_mongo_find_client", span->context());
     mongoc_cursor_t *cursor =
         mongoc_collection_find_with_opts(collection, query, nullptr, nullptr);
     const bson_t *doc;
@@ -876,8 +870,8 @@ int64_t UserHandler::GetUserId(
       LOG(warning) << "Failed to pop a client from memcached pool";
     } else {
       std::string user_id_str = std::to_string(user_id);
-      auto set_login_span = opentracing::Tracer::Global()->StartSpan(
-          "user_mmc_set_client", {opentracing::ChildOf(&span->context())});
+      auto set_login_span = StartChildSpan(
+          "user_mmc_set_client", span->context());
       memcached_rc =
           memcached_set(memcached_client, (username + ":user_id").c_str(),
                         (username + ":user_id").length(), user_id_str.c_str(),
@@ -896,52 +890,6 @@ int64_t UserHandler::GetUserId(
   return user_id;
 }
 
-/*
- * The following code which obtaines machine ID from machine's MAC address was
- * inspired from https://stackoverflow.com/a/16859693.
- *
- * MAC address is obtained from /sys/class/net/<netif>/address
- */
-u_int16_t HashMacAddressPid(const std::string &mac) {
-  u_int16_t hash = 0;
-  std::string mac_pid = mac + std::to_string(getpid());
-  for (unsigned int i = 0; i < mac_pid.size(); i++) {
-    hash += (mac[i] << ((i & 1) * 8));
-  }
-  return hash;
-}
-
-std::string GetMachineId(std::string &netif) {
-  std::string mac_hash;
-
-  std::string mac_addr_filename = "/sys/class/net/" + netif + "/address";
-  std::ifstream mac_addr_file;
-  mac_addr_file.open(mac_addr_filename);
-  if (!mac_addr_file) {
-    LOG(fatal) << "Cannot read MAC address from net interface " << netif;
-    return "";
-  }
-  std::string mac;
-  mac_addr_file >> mac;
-  if (mac == "") {
-    LOG(fatal) << "Cannot read MAC address from net interface " << netif;
-    return "";
-  }
-  mac_addr_file.close();
-
-  LOG(info) << "MAC address = " << mac;
-
-  std::stringstream stream;
-  stream << std::hex << HashMacAddressPid(mac);
-  mac_hash = stream.str();
-
-  if (mac_hash.size() > 3) {
-    mac_hash.erase(0, mac_hash.size() - 3);
-  } else if (mac_hash.size() < 3) {
-    mac_hash = std::string(3 - mac_hash.size(), '0') + mac_hash;
-  }
-  return mac_hash;
-}
 }  // namespace social_network
 
 #endif  // SOCIAL_NETWORK_MICROSERVICES_USERHANDLER_H
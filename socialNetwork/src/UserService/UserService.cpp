@@ -1,19 +1,12 @@
 #include <signal.h>
-#include <thrift/protocol/TBinaryProtocol.h>
-#include <thrift/server/TThreadedServer.h>
-#include <thrift/transport/TBufferTransports.h>
-#include <thrift/transport/TServerSocket.h>
 
+#include "../WorkerId.h"
 #include "../utils.h"
 #include "../utils_memcached.h"
 #include "../utils_mongodb.h"
 #include "../utils_thrift.h"
 #include "UserHandler.h"
 
-using apache::thrift::protocol::TBinaryProtocolFactory;
-using apache::thrift::server::TThreadedServer;
-using apache::thrift::transport::TFramedTransportFactory;
-using apache::thrift::transport::TServerSocket;
 using namespace social_network;
 
 void sigintHandler(int sig) { exit(EXIT_SUCCESS); }
@@ -55,8 +48,7 @@ int main(int argc, char *argv[]) {
     return EXIT_FAILURE;
   }
 
-  std::string netif = config_json["user-service"]["netif"];
-  std::string machine_id = GetMachineId(netif);
+  std::string machine_id = GetWorkerId(config_json, "user-service");
   if (machine_id == "") {
     exit(EXIT_FAILURE);
   }
@@ -82,15 +74,13 @@ int main(int argc, char *argv[]) {
     }
   }
   mongoc_client_pool_push(mongodb_client_pool, mongodb_client);
-  std::shared_ptr<TServerSocket> server_socket = get_server_socket(config_json, "0.0.0.0", port);
 
-  TThreadedServer server(
+  auto server = get_server(
+      config_json, "user-service",
       std::make_shared<UserServiceProcessor>(std::make_shared<UserHandler>(
           &thread_lock, machine_id, secret, memcached_client_pool,
           mongodb_client_pool, &social_graph_client_pool)),
-      server_socket,
-      std::make_shared<TFramedTransportFactory>(),
-      std::make_shared<TBinaryProtocolFactory>());
+      port);
   LOG(info) << "Starting the user-service server ...";
-  server.serve();
+  server->serve();
 }
\ No newline at end of file
@@ -8,13 +8,17 @@
 #include <future>
 #include <iostream>
 #include <string>
+#include <unordered_set>
 
 #include "../../gen-cpp/PostStorageService.h"
 #include "../../gen-cpp/UserTimelineService.h"
 #include "../ClientPool.h"
+#include "../Executor.h"
 #include "../ThriftClient.h"
+#include "../TimelineCodec.h"
 #include "../logger.h"
 #include "../tracing.h"
+#include "../utils_bson.h"
 
 using namespace sw::redis;
 
@@ -23,13 +27,15 @@ namespace social_network {
 class UserTimelineHandler : public UserTimelineServiceIf {
  public:
   UserTimelineHandler(Redis *, mongoc_client_pool_t *,
-                      ClientPool<ThriftClient<PostStorageServiceClient>> *);
+                      ClientPool<ThriftClient<PostStorageServiceClient>> *,
+                      Executor *, int);
 
   UserTimelineHandler(Redis *, Redis *, mongoc_client_pool_t *,
-      ClientPool<ThriftClient<PostStorageServiceClient>> *);
+      ClientPool<ThriftClient<PostStorageServiceClient>> *, Executor *, int);
 
   UserTimelineHandler(RedisCluster *, mongoc_client_pool_t *,
-                      ClientPool<ThriftClient<PostStorageServiceClient>> *);
+                      ClientPool<ThriftClient<PostStorageServiceClient>> *,
+                      Executor *, int);
   ~UserTimelineHandler() override = default;
 
   bool IsRedisReplicationEnabled();
@@ -48,56 +54,86 @@ class UserTimelineHandler : public UserTimelineServiceIf {
   RedisCluster *_redis_cluster_client_pool;
   mongoc_client_pool_t *_mongodb_client_pool;
   ClientPool<ThriftClient<PostStorageServiceClient>> *_post_client_pool;
+  Executor *_executor;
+  // Number of newest posts kept in each timeline ZSet, 0 for no limit. Older
+  // posts are read from MongoDB.
+  int _max_timeline_length;
+
+  void _AddToTimeline(Pipeline pipe, const std::string &key,
+                      const std::unordered_map<std::string, double> &members,
+                      const std::vector<std::string> &legacy_members = {});
 };
 
 UserTimelineHandler::UserTimelineHandler(
     Redis *redis_pool, mongoc_client_pool_t *mongodb_pool,
-    ClientPool<ThriftClient<PostStorageServiceClient>> *post_client_pool) {
+    ClientPool<ThriftClient<PostStorageServiceClient>> *post_client_pool,
+    Executor *executor, int max_timeline_length) {
   _redis_client_pool = redis_pool;
   _redis_replica_pool = nullptr;
   _redis_primary_pool = nullptr;
   _redis_cluster_client_pool = nullptr;
   _mongodb_client_pool = mongodb_pool;
   _post_client_pool = post_client_pool;
+  _executor = executor;
+  _max_timeline_length = max_timeline_length;
 }
 
 UserTimelineHandler::UserTimelineHandler(
     Redis* redis_replica_pool, Redis* redis_primary_pool, mongoc_client_pool_t* mongodb_pool,
-    ClientPool<ThriftClient<PostStorageServiceClient>>* post_client_pool) {
+    ClientPool<ThriftClient<PostStorageServiceClient>>* post_client_pool,
+    Executor* executor, int max_timeline_length) {
     _redis_client_pool = nullptr;
     _redis_replica_pool = redis_replica_pool;
     _redis_primary_pool = redis_primary_pool;
     _redis_cluster_client_pool = nullptr;
     _mongodb_client_pool = mongodb_pool;
     _post_client_pool = post_client_pool;
+    _executor = executor;
+    _max_timeline_length = max_timeline_length;
 }
 
 UserTimelineHandler::UserTimelineHandler(
     RedisCluster *redis_pool, mongoc_client_pool_t *mongodb_pool,
-    ClientPool<ThriftClient<PostStorageServiceClient>> *post_client_pool) {
+    ClientPool<ThriftClient<PostStorageServiceClient>> *post_client_pool,
+    Executor *executor, int max_timeline_length) {
   _redis_cluster_client_pool = redis_pool;
   _redis_replica_pool = nullptr;
   _redis_primary_pool = nullptr;
   _redis_client_pool = nullptr;
   _mongodb_client_pool = mongodb_pool;
   _post_client_pool = post_client_pool;
+  _executor = executor;
+  _max_timeline_length = max_timeline_length;
 }
 
 bool UserTimelineHandler::IsRedisReplicationEnabled() {
     return (_redis_primary_pool || _redis_replica_pool);
 }
 
+// Adds members to a timeline and trims it in a single round trip. The
+// decimal members of the same posts, if the ZSet was written before the
+// binary encoding, are removed first so that no post is listed twice.
+void UserTimelineHandler::_AddToTimeline(
+    Pipeline pipe, const std::string &key,
+    const std::unordered_map<std::string, double> &members,
+    const std::vector<std::string> &legacy_members) {
+  if (!legacy_members.empty()) {
+    pipe.zrem(key, legacy_members.begin(), legacy_members.end());
+  }
+  pipe.zadd(key, members.begin(), members.end(), UpdateType::NOT_EXIST);
+  if (_max_timeline_length > 0) {
+    pipe.zremrangebyrank(key, 0, -_max_timeline_length - 1);
+  }
+  pipe.exec();
+}
+
 void UserTimelineHandler::WriteUserTimeline(
     int64_t req_id, int64_t post_id, int64_t user_id, int64_t timestamp,
     const std::map<std::string, std::string> &carrier) {
   // Initialize a span
-  TextMapReader reader(carrier);
   std::map<std::string, std::string> writer_text_map;
-  TextMapWriter writer(writer_text_map);
-  auto parent_span = opentracing::Tracer::Global()->Extract(reader);
-  auto span = opentracing::Tracer::Global()->StartSpan(
-      "write_user_timeline_server", {opentracing::ChildOf(parent_span->get())});
-  opentracing::Tracer::Global()->Inject(span->context(), writer);
+  auto span = StartSpanFromCarrier(
+      "write_user_timeline_server", carrier, &writer_text_map);
 
   mongoc_client_t *mongodb_client =
       mongoc_client_pool_pop(_mongodb_client_pool);
@@ -125,9 +161,8 @@ void UserTimelineHandler::WriteUserTimeline(
                "]", "$position", BCON_INT32(0), "}", "}");
   bson_error_t error;
   bson_t reply;
-  auto update_span = opentracing::Tracer::Global()->StartSpan(
-      "write_user_timeline_mongo_insert_client",
-      {opentracing::ChildOf(&span->context())});
+  auto update_span = StartChildSpan(
+      "write_user_timeline_mongo_insert_client", span->context());
   bool updated = mongoc_collection_find_and_modify(collection, query, nullptr,
                                                    update, nullptr, false, true,
                                                    true, &reply, &error);
@@ -160,20 +195,22 @@ void UserTimelineHandler::WriteUserTimeline(
   mongoc_client_pool_push(_mongodb_client_pool, mongodb_client);
 
   // Update user's timeline in redis
-  auto redis_span = opentracing::Tracer::Global()->StartSpan(
-      "write_user_timeline_redis_update_client",
-      {opentracing::ChildOf(&span->context())});
+  auto redis_span = StartChildSpan(
+      "write_user_timeline_redis_update_client", span->context());
+  std::string user_id_str = std::to_string(user_id);
+  std::unordered_map<std::string, double> members = {
+      {EncodeTimelineMember(post_id), static_cast<double>(timestamp)}};
   try {
     if (_redis_client_pool)
-      _redis_client_pool->zadd(std::to_string(user_id), std::to_string(post_id),
-                              timestamp, UpdateType::NOT_EXIST);
+      _AddToTimeline(_redis_client_pool->pipeline(false), user_id_str,
+                     members);
     else if (IsRedisReplicationEnabled()) {
-        _redis_primary_pool->zadd(std::to_string(user_id), std::to_string(post_id),
-                              timestamp, UpdateType::NOT_EXIST);
+        _AddToTimeline(_redis_primary_pool->pipeline(false), user_id_str,
+                       members);
     }
     else
-      _redis_cluster_client_pool->zadd(std::to_string(user_id), std::to_string(post_id),
-                              timestamp, UpdateType::NOT_EXIST);
+      _AddToTimeline(_redis_cluster_client_pool->pipeline(user_id_str, false),
+                     user_id_str, members);
 
   } catch (const Error &err) {
     LOG(error) << err.what();
@@ -187,21 +224,16 @@ void UserTimelineHandler::ReadUserTimeline(
     std::vector<Post> &_return, int64_t req_id, int64_t user_id, int start,
     int stop, const std::map<std::string, std::string> &carrier) {
   // Initialize a span
-  TextMapReader reader(carrier);
   std::map<std::string, std::string> writer_text_map;
-  TextMapWriter writer(writer_text_map);
-  auto parent_span = opentracing::Tracer::Global()->Extract(reader);
-  auto span = opentracing::Tracer::Global()->StartSpan(
-      "read_user_timeline_server", {opentracing::ChildOf(parent_span->get())});
-  opentracing::Tracer::Global()->Inject(span->context(), writer);
+  auto span = StartSpanFromCarrier(
+      "read_user_timeline_server", carrier, &writer_text_map);
 
   if (stop <= start || start < 0) {
     return;
   }
 
-  auto redis_span = opentracing::Tracer::Global()->StartSpan(
-      "read_user_timeline_redis_find_client",
-      {opentracing::ChildOf(&span->context())});
+  auto redis_span = StartChildSpan(
+      "read_user_timeline_redis_find_client", span->context());
 
   std::vector<std::string> post_ids_str;
   try {
@@ -222,13 +254,12 @@ void UserTimelineHandler::ReadUserTimeline(
   redis_span->Finish();
 
   std::vector<int64_t> post_ids;
-  for (auto &post_id_str : post_ids_str) {
-    post_ids.emplace_back(std::stoul(post_id_str));
-  }
+  DecodeTimelineMembers(post_ids_str, &post_ids);
 
   // find in mongodb
   int mongo_start = start + post_ids.size();
   std::unordered_map<std::string, double> redis_update_map;
+  std::vector<std::string> legacy_members;
   if (mongo_start < stop) {
     // Instead find post_ids from mongodb
     mongoc_client_t *mongodb_client =
@@ -252,46 +283,34 @@ void UserTimelineHandler::ReadUserTimeline(
     bson_t *opts = BCON_NEW("projection", "{", "posts", "{", "$slice", "[",
                             BCON_INT32(0), BCON_INT32(stop), "]", "}", "}");
 
-    auto find_span = opentracing::Tracer::Global()->StartSpan(
-        "user_timeline_mongo_find_client",
-        {opentracing::ChildOf(&span->context())});
+    auto find_span = StartChildSpan(
+        "user_timeline_mongo_find_client", span->context());
     mongoc_cursor_t *cursor =
         mongoc_collection_find_with_opts(collection, query, opts, nullptr);
     find_span->Finish();
     const bson_t *doc;
     bool found = mongoc_cursor_next(cursor, &doc);
     if (found) {
-      bson_iter_t iter_0;
-      bson_iter_t iter_1;
-      bson_iter_t post_id_child;
-      bson_iter_t timestamp_child;
+      // In mixed workload condition, post may composed between redis and
+      // mongo read, mongodb index will shift and duplicate post_id occurs
+      std::unordered_set<int64_t> seen_post_ids(post_ids.begin(),
+                                                post_ids.end());
       int idx = 0;
-      bson_iter_init(&iter_0, doc);
-      bson_iter_init(&iter_1, doc);
-      while (bson_iter_find_descendant(
-                 &iter_0, ("posts." + std::to_string(idx) + ".post_id").c_str(),
-                 &post_id_child) &&
-             BSON_ITER_HOLDS_INT64(&post_id_child) &&
-             bson_iter_find_descendant(
-                 &iter_1,
-                 ("posts." + std::to_string(idx) + ".timestamp").c_str(),
-                 &timestamp_child) &&
-             BSON_ITER_HOLDS_INT64(&timestamp_child)) {
-        auto curr_post_id = bson_iter_int64(&post_id_child);
-        auto curr_timestamp = bson_iter_int64(&timestamp_child);
-        if (idx >= mongo_start) {
-          //In mixed workload condition, post may composed between redis and mongo read
-          //mongodb index will shift and duplicate post_id occurs
-          if ( std::find(post_ids.begin(), post_ids.end(), curr_post_id) == post_ids.end() ) {
-            post_ids.emplace_back(curr_post_id);
-          }
-        }
-        redis_update_map.insert(std::make_pair(std::to_string(curr_post_id),
-                                               (double)curr_timestamp));
-        bson_iter_init(&iter_0, doc);
-        bson_iter_init(&iter_1, doc);
-        idx++;
-      }
+      ForEachTimestampedId(
+          doc, "posts", "post_id",
+          [&](int64_t curr_post_id, int64_t curr_timestamp) {
+            if (idx >= mongo_start &&
+                seen_post_ids.insert(curr_post_id).second) {
+              post_ids.emplace_back(curr_post_id);
+            }
+            // Only refill the part of the timeline the ZSet may hold.
+            if (_max_timeline_length <= 0 || idx < _max_timeline_length) {
+              redis_update_map.insert(std::make_pair(
+                  EncodeTimelineMember(curr_post_id), (double)curr_timestamp));
+              legacy_members.emplace_back(LegacyTimelineMember(curr_post_id));
+            }
+            idx++;
+          });
     }
     bson_destroy(opts);
     bson_destroy(query);
@@ -301,7 +320,7 @@ void UserTimelineHandler::ReadUserTimeline(
   }
 
   std::future<std::vector<Post>> post_future =
-      std::async(std::launch::async, [&]() {
+      _executor->Submit([&]() {
         auto post_client_wrapper = _post_client_pool->Pop();
         if (!post_client_wrapper) {
           ServiceException se;
@@ -324,23 +343,21 @@ void UserTimelineHandler::ReadUserTimeline(
       });
 
   if (redis_update_map.size() > 0) {
-    auto redis_update_span = opentracing::Tracer::Global()->StartSpan(
-        "user_timeline_redis_update_client",
-        {opentracing::ChildOf(&span->context())});
+    auto redis_update_span = StartChildSpan(
+        "user_timeline_redis_update_client", span->context());
+    std::string user_id_str = std::to_string(user_id);
     try {
       if (_redis_client_pool)
-        _redis_client_pool->zadd(std::to_string(user_id),
-                               redis_update_map.begin(),
-                               redis_update_map.end());
+        _AddToTimeline(_redis_client_pool->pipeline(false), user_id_str,
+                       redis_update_map, legacy_members);
       else if (IsRedisReplicationEnabled()) {
-          _redis_primary_pool->zadd(std::to_string(user_id),
-              redis_update_map.begin(),
-              redis_update_map.end());
+          _AddToTimeline(_redis_primary_pool->pipeline(false), user_id_str,
+                         redis_update_map, legacy_members);
       }
       else
-        _redis_cluster_client_pool->zadd(std::to_string(user_id),
-                               redis_update_map.begin(),
-                               redis_update_map.end());
+        _AddToTimeline(
+            _redis_cluster_client_pool->pipeline(user_id_str, false),
+            user_id_str, redis_update_map, legacy_members);
 
     } catch (const Error &err) {
       LOG(error) << err.what();
@@ -1,8 +1,4 @@
 #include <signal.h>
-#include <thrift/protocol/TBinaryProtocol.h>
-#include <thrift/server/TThreadedServer.h>
-#include <thrift/transport/TBufferTransports.h>
-#include <thrift/transport/TServerSocket.h>
 
 #include <boost/program_options.hpp>
 
@@ -16,10 +12,6 @@
 #include "../utils_thrift.h"
 #include "UserTimelineHandler.h"
 
-using apache::thrift::protocol::TBinaryProtocolFactory;
-using apache::thrift::server::TThreadedServer;
-using apache::thrift::transport::TFramedTransportFactory;
-using apache::thrift::transport::TServerSocket;
 using namespace social_network;
 
 void sigintHandler(int sig) { exit(EXIT_SUCCESS); }
@@ -105,47 +97,58 @@ int main(int argc, char *argv[]) {
     }
   }
   mongoc_client_pool_push(mongodb_client_pool, mongodb_client);
-  std::shared_ptr<TServerSocket> server_socket =
-      get_server_socket(config_json, "0.0.0.0", port);
+
+  int executor_threads =
+      config_json["user-timeline-service"].value("executor_threads", 16);
+  int executor_max_pending =
+      config_json["user-timeline-service"].value("executor_max_pending", 256);
+  Executor executor(executor_threads, executor_max_pending);
+
+  // Timeline ZSets keep their newest max_timeline_length posts, 0 keeps all.
+  int max_timeline_length =
+      config_json["user-timeline-service"].value("max_timeline_length", 0);
 
   if (redis_cluster_flag || redis_cluster_config_flag) {
     RedisCluster redis_client_pool =
         init_redis_cluster_client_pool(config_json, "user-timeline");
-    TThreadedServer server(std::make_shared<UserTimelineServiceProcessor>(
-                               std::make_shared<UserTimelineHandler>(
-                                   &redis_client_pool, mongodb_client_pool,
-                                   &post_storage_client_pool)),
-                           server_socket,
-                           std::make_shared<TFramedTransportFactory>(),
-                           std::make_shared<TBinaryProtocolFactory>());
+    auto server = get_server(
+        config_json, "user-timeline-service",
+        std::make_shared<UserTimelineServiceProcessor>(
+            std::make_shared<UserTimelineHandler>(
+                &redis_client_pool, mongodb_client_pool,
+                &post_storage_client_pool, &executor,
+                max_timeline_length)),
+        port);
     LOG(info) << "Starting the user-timeline-service server with Redis Cluster support...";
-    server.serve();
+    server->serve();
   }
   else if (redis_replica_config_flag) {
       Redis redis_replica_client_pool = init_redis_replica_client_pool(config_json, "redis-replica");
       Redis redis_primary_client_pool = init_redis_replica_client_pool(config_json, "redis-primary");
-      TThreadedServer server(std::make_shared<UserTimelineServiceProcessor>(
-          std::make_shared<UserTimelineHandler>(
-              &redis_replica_client_pool, &redis_primary_client_pool, mongodb_client_pool,
-              &post_storage_client_pool)),
-          server_socket,
-          std::make_shared<TFramedTransportFactory>(),
-          std::make_shared<TBinaryProtocolFactory>());
+      auto server = get_server(
+          config_json, "user-timeline-service",
+          std::make_shared<UserTimelineServiceProcessor>(
+              std::make_shared<UserTimelineHandler>(
+                  &redis_replica_client_pool, &redis_primary_client_pool, mongodb_client_pool,
+                  &post_storage_client_pool, &executor,
+                  max_timeline_length)),
+          port);
       LOG(info) << "Starting the user-timeline-service server with replicated Redis support...";
-      server.serve();
+      server->serve();
 
   }
   else {
     Redis redis_client_pool =
         init_redis_client_pool(config_json, "user-timeline");
-    TThreadedServer server(std::make_shared<UserTimelineServiceProcessor>(
-                               std::make_shared<UserTimelineHandler>(
-                                   &redis_client_pool, mongodb_client_pool,
-                                   &post_storage_client_pool)),
-                           server_socket,
-                           std::make_shared<TFramedTransportFactory>(),
-                           std::make_shared<TBinaryProtocolFactory>());
+    auto server = get_server(
+        config_json, "user-timeline-service",
+        std::make_shared<UserTimelineServiceProcessor>(
+            std::make_shared<UserTimelineHandler>(
+                &redis_client_pool, mongodb_client_pool,
+                &post_storage_client_pool, &executor,
+                max_timeline_length)),
+        port);
     LOG(info) << "Starting the user-timeline-service server...";
-    server.serve();
+    server->serve();
   }
 }
\ No newline at end of file
@@ -0,0 +1,305 @@
+#ifndef SOCIAL_NETWORK_MICROSERVICES_WORKERID_H
+#define SOCIAL_NETWORK_MICROSERVICES_WORKERID_H
+
+#include <libmemcached/memcached.h>
+#include <libmemcached/util.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "logger.h"
+#include "utils.h"
+#include "utils_memcached.h"
+
+// Worker ids are the machine bits of the 64-bit ids composed by the
+// unique-id and user services.
+#define WORKER_ID_BITS 11
+#define NUM_WORKER_IDS (1 << WORKER_ID_BITS)
+
+namespace social_network {
+
+/*
+ * The following code which obtaines machine ID from machine's MAC address was
+ * inspired from https://stackoverflow.com/a/16859693.
+ *
+ * MAC address is obtained from /sys/class/net/<netif>/address
+ */
+u_int16_t HashMacAddressPid(const std::string &mac) {
+  u_int16_t hash = 0;
+  std::string mac_pid = mac + std::to_string(getpid());
+  for (unsigned int i = 0; i < mac_pid.size(); i++) {
+    hash += (mac_pid[i] << ((i & 1) * 8));
+  }
+  return hash;
+}
+
+std::string GetMachineId(std::string &netif) {
+  std::string mac_hash;
+
+  std::string mac_addr_filename = "/sys/class/net/" + netif + "/address";
+  std::ifstream mac_addr_file;
+  mac_addr_file.open(mac_addr_filename);
+  if (!mac_addr_file) {
+    LOG(fatal) << "Cannot read MAC address from net interface " << netif;
+    return "";
+  }
+  std::string mac;
+  mac_addr_file >> mac;
+  if (mac == "") {
+    LOG(fatal) << "Cannot read MAC address from net interface " << netif;
+    return "";
+  }
+  mac_addr_file.close();
+
+  LOG(info) << "MAC address = " << mac;
+
+  std::stringstream stream;
+  stream << std::hex << HashMacAddressPid(mac);
+  mac_hash = stream.str();
+
+  if (mac_hash.size() > 3) {
+    mac_hash.erase(0, mac_hash.size() - 3);
+  } else if (mac_hash.size() < 3) {
+    mac_hash = std::string(3 - mac_hash.size(), '0') + mac_hash;
+  }
+  return mac_hash;
+}
+
+// Lease on a worker id, held as a memcached key that expires after ttl_s
+// unless renewed. The key holds a token unique to this process, so that a
+// renewal can tell whether another process took the id over.
+class WorkerIdLease {
+ public:
+  WorkerIdLease(memcached_pool_st *memcached_client_pool,
+                const std::string &service_name, int ttl_s);
+
+  // Returns false if the id is held by another process or on error.
+  bool Acquire(int worker_id);
+  // Acquires the first free id, in a random order; returns -1 if none is
+  // free or memcached fails.
+  int AcquireAny();
+  // Renews the lease every ttl_s / 3 seconds and exits the process if it
+  // finds the id held by someone else.
+  void StartRenewal();
+
+ private:
+  memcached_pool_st *_memcached_client_pool;
+  std::string _service_name;
+  std::string _token;
+  int _ttl_s;
+  int _worker_id;
+
+  std::string _Key(int worker_id) const;
+  memcached_return_t _Add(int worker_id);
+};
+
+WorkerIdLease::WorkerIdLease(memcached_pool_st *memcached_client_pool,
+                             const std::string &service_name, int ttl_s) {
+  _memcached_client_pool = memcached_client_pool;
+  _service_name = service_name;
+  _ttl_s = std::max(ttl_s, 3);
+  _worker_id = -1;
+  char hostname[256] = "";
+  gethostname(hostname, sizeof(hostname) - 1);
+  std::stringstream token;
+  token << hostname << ":" << getpid() << ":" << std::hex
+        << std::random_device()();
+  _token = token.str();
+}
+
+std::string WorkerIdLease::_Key(int worker_id) const {
+  return "worker-id:" + _service_name + ":" + std::to_string(worker_id);
+}
+
+memcached_return_t WorkerIdLease::_Add(int worker_id) {
+  memcached_return_t rc;
+  auto client = memcached_pool_pop(_memcached_client_pool, true, &rc);
+  if (!client) {
+    LOG(error) << "Failed to pop a client from memcached pool";
+    return MEMCACHED_FAILURE;
+  }
+  std::string key = _Key(worker_id);
+  rc = memcached_add(client, key.c_str(), key.length(), _token.c_str(),
+                     _token.length(), static_cast<time_t>(_ttl_s), 0);
+  if (rc == MEMCACHED_SUCCESS) {
+    _worker_id = worker_id;
+  } else if (rc != MEMCACHED_NOTSTORED && rc != MEMCACHED_DATA_EXISTS) {
+    LOG(error) << "Cannot lease worker id " << worker_id << ": "
+               << memcached_strerror(client, rc);
+  }
+  memcached_pool_push(_memcached_client_pool, client);
+  return rc;
+}
+
+bool WorkerIdLease::Acquire(int worker_id) {
+  return _Add(worker_id) == MEMCACHED_SUCCESS;
+}
+
+int WorkerIdLease::AcquireAny() {
+  std::vector<int> worker_ids(NUM_WORKER_IDS);
+  for (int i = 0; i < NUM_WORKER_IDS; ++i) {
+    worker_ids[i] = i;
+  }
+  std::shuffle(worker_ids.begin(), worker_ids.end(),
+               std::mt19937(std::random_device()()));
+  for (auto worker_id : worker_ids) {
+    memcached_return_t rc = _Add(worker_id);
+    if (rc == MEMCACHED_SUCCESS) {
+      return worker_id;
+    }
+    if (rc != MEMCACHED_NOTSTORED && rc != MEMCACHED_DATA_EXISTS) {
+      break;
+    }
+  }
+  return -1;
+}
+
+void WorkerIdLease::StartRenewal() {
+  std::thread([this]() {
+    std::string key = _Key(_worker_id);
+    while (true) {
+      std::this_thread::sleep_for(std::chrono::seconds(_ttl_s / 3));
+      memcached_return_t rc;
+      auto client = memcached_pool_pop(_memcached_client_pool, true, &rc);
+      if (!client) {
+        LOG(warning) << "Failed to pop a client from memcached pool";
+        continue;
+      }
+      size_t value_length;
+      uint32_t flags;
+      char *value = memcached_get(client, key.c_str(), key.length(),
+                                  &value_length, &flags, &rc);
+      bool lost = false;
+      if (value) {
+        lost = std::string(value, value_length) != _token;
+        free(value);
+        if (!lost) {
+          rc = memcached_set(client, key.c_str(), key.length(),
+                             _token.c_str(), _token.length(),
+                             static_cast<time_t>(_ttl_s), 0);
+        }
+      } else if (rc == MEMCACHED_NOTFOUND) {
+        // The lease expired, most likely while memcached was unreachable.
+        rc = memcached_add(client, key.c_str(), key.length(), _token.c_str(),
+                           _token.length(), static_cast<time_t>(_ttl_s), 0);
+        lost = rc == MEMCACHED_NOTSTORED || rc == MEMCACHED_DATA_EXISTS;
+      }
+      if (!lost && rc != MEMCACHED_SUCCESS) {
+        LOG(warning) << "Cannot renew the lease on worker id " << _worker_id
+                     << ": " << memcached_strerror(client, rc);
+      }
+      memcached_pool_push(_memcached_client_pool, client);
+      if (lost) {
+        LOG(fatal) << "Worker id " << _worker_id
+                   << " is used by another process, exiting";
+        exit(EXIT_FAILURE);
+      }
+    }
+  }).detach();
+}
+
+// Returns the worker id of the service as the 3 hex digits expected by the
+// handlers, or "" after logging why it could not be assigned. The
+// worker_id_mode key of the service's config selects where it comes from:
+//   "mac":    hash of the MAC address of netif and the pid (the default)
+//   "config": the worker_id key
+//   "env":    the environment variable named by worker_id_env
+//   "lease":  the first free id leased from memcached
+// With worker_id_self_check, the ids of the other modes are leased as well,
+// so that two processes given the same id fail at startup instead of
+// composing colliding ids.
+std::string GetWorkerId(const json &config_json,
+                        const std::string &service_name) {
+  const json &service_json = config_json[service_name];
+  std::string mode = service_json.value("worker_id_mode", "mac");
+  bool self_check = service_json.value("worker_id_self_check", false);
+
+  std::unique_ptr<WorkerIdLease> lease;
+  if (mode == "lease" || self_check) {
+    std::string lease_memcached =
+        service_json.value("worker_id_lease_memcached", "user");
+    memcached_pool_st *memcached_client_pool =
+        init_memcached_client_pool(config_json, lease_memcached, 1, 2);
+    if (memcached_client_pool == nullptr) {
+      LOG(fatal) << "Cannot connect to " << lease_memcached
+                 << "-memcached to lease a worker id";
+      return "";
+    }
+    lease.reset(new WorkerIdLease(
+        memcached_client_pool, service_name,
+        service_json.value("worker_id_lease_ttl_s", 30)));
+  }
+
+  long worker_id = -1;
+  if (mode == "mac") {
+    std::string netif = service_json["netif"];
+    std::string machine_id = GetMachineId(netif);
+    if (machine_id == "") {
+      return "";
+    }
+    worker_id = std::stol(machine_id, nullptr, 16) % NUM_WORKER_IDS;
+  } else if (mode == "config") {
+    if (service_json.find("worker_id") == service_json.end() ||
+        !service_json["worker_id"].is_number_integer()) {
+      LOG(fatal) << "worker_id_mode is config but worker_id is not set";
+      return "";
+    }
+    worker_id = service_json["worker_id"].get<long>();
+  } else if (mode == "env") {
+    std::string env_name = service_json.value("worker_id_env", "WORKER_ID");
+    const char *env_value = std::getenv(env_name.c_str());
+    char *end = nullptr;
+    if (env_value) {
+      worker_id = std::strtol(env_value, &end, 10);
+    }
+    if (!env_value || end == env_value || *end != '\0') {
+      LOG(fatal) << "worker_id_mode is env but " << env_name
+                 << " is not set to a number";
+      return "";
+    }
+  } else if (mode == "lease") {
+    worker_id = lease->AcquireAny();
+    if (worker_id < 0) {
+      LOG(fatal) << "Cannot lease a worker id";
+      return "";
+    }
+  } else {
+    LOG(fatal) << "Unknown worker_id_mode: " << mode;
+    return "";
+  }
+
+  if (worker_id < 0 || worker_id >= NUM_WORKER_IDS) {
+    LOG(fatal) << "Worker id " << worker_id << " is out of range [0, "
+               << NUM_WORKER_IDS << ")";
+    return "";
+  }
+  if (lease) {
+    if (mode != "lease" && !lease->Acquire(worker_id)) {
+      LOG(fatal) << "Worker id " << worker_id
+                 << " is already used by another process";
+      return "";
+    }
+    lease->StartRenewal();
+    // The renewal thread keeps using the lease until the process exits.
+    lease.release();
+  }
+  LOG(info) << "Using worker id " << worker_id << " (" << mode << ")";
+
+  std::stringstream stream;
+  stream << std::hex << std::setw(3) << std::setfill('0') << worker_id;
+  return stream.str();
+}
+
+}  // namespace social_network
+
+#endif  // SOCIAL_NETWORK_MICROSERVICES_WORKERID_H
@@ -1,126 +1,370 @@
+#include <sw/redis++/redis++.h>
 
-#include <cpp_redis/cpp_redis>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
 #include <csignal>
+#include <deque>
+#include <map>
 #include <mutex>
 #include <set>
 #include <sstream>
 #include <thread>
+#include <unordered_map>
 
 #include "../../gen-cpp/SocialGraphService.h"
 #include "../../gen-cpp/social_network_types.h"
 #include "../AmqpLibeventHandler.h"
 #include "../ClientPool.h"
-#include "../RedisClient.h"
 #include "../ThriftClient.h"
+#include "../TimelineCodec.h"
 #include "../logger.h"
 #include "../tracing.h"
 #include "../utils.h"
+#include "../utils_redis.h"
 
+using namespace sw::redis;
 using namespace social_network;
 
-static std::exception_ptr _teptr;
-static ClientPool<RedisClient> *_redis_client_pool;
+// A post to fan out, as published by ComposePostService.
+struct HomeTimelineUpdate {
+  int64_t req_id;
+  int64_t post_id;
+  int64_t user_id;
+  int64_t timestamp;
+  std::vector<int64_t> user_mentions_id;
+  std::map<std::string, std::string> carrier;
+  // The message the update came from, to settle or republish it.
+  uint64_t delivery_tag;
+  uint32_t retries;
+  std::string body;
+};
+
+#define WRITE_HOME_TIMELINE_QUEUE "write-home-timeline"
+// Updates that failed max_retries times, or could not be parsed, are moved
+// here for inspection instead of being retried forever.
+#define WRITE_HOME_TIMELINE_DEAD_QUEUE "write-home-timeline-dead"
+// A worker that loses its RabbitMQ connection reconnects after a delay that
+// doubles from the min to the max while reconnects keep failing.
+#define WORKER_RECONNECT_MIN_BACKOFF_MS 100
+#define WORKER_RECONNECT_MAX_BACKOFF_MS 10000
+
+// Exactly one of the two is set.
+static Redis *_redis_client_pool;
+static RedisCluster *_redis_cluster_client_pool;
 static ClientPool<ThriftClient<SocialGraphServiceClient>>
     *_social_graph_client_pool;
+static int _fanout_follower_threshold;
+static int _max_timeline_length;
+static int _max_retries;
 
 void sigintHandler(int sig) { exit(EXIT_SUCCESS); }
 
-void OnReceivedWorker(const AMQP::Message &msg) {
+bool ParseUpdate(const AMQP::Message &msg, HomeTimelineUpdate *update) {
+  update->body.assign(msg.body(), msg.bodySize());
+  update->retries = msg.headers().get("x-retries");
   try {
-    json msg_json = json::parse(std::string(msg.body(), msg.bodySize()));
-
-    std::map<std::string, std::string> carrier;
+    json msg_json = json::parse(update->body);
+    update->req_id = msg_json["req_id"];
+    update->post_id = msg_json["post_id"];
+    update->user_id = msg_json["user_id"];
+    update->timestamp = msg_json["timestamp"];
+    update->user_mentions_id =
+        msg_json["user_mentions_id"].get<std::vector<int64_t>>();
     for (auto it = msg_json["carrier"].begin(); it != msg_json["carrier"].end();
          ++it) {
-      carrier.emplace(std::make_pair(it.key(), it.value()));
+      update->carrier.emplace(it.key(), it.value());
+    }
+  } catch (const std::exception &ex) {
+    LOG(error) << "Malformed home timeline update: " << ex.what();
+    return false;
+  }
+  return true;
+}
+
+void GetFollowers(const HomeTimelineUpdate &update,
+                  const opentracing::SpanContext &parent,
+                  std::vector<int64_t> *followers_id) {
+  auto followers_span = StartChildSpan("get_followers_client", parent);
+  std::map<std::string, std::string> writer_text_map;
+  InjectSpan(*followers_span, &writer_text_map);
+
+  auto social_graph_client_wrapper = _social_graph_client_pool->Pop();
+  if (!social_graph_client_wrapper) {
+    ServiceException se;
+    se.errorCode = ErrorCode::SE_THRIFT_CONN_ERROR;
+    se.message = "Failed to connect to social-graph-service";
+    throw se;
+  }
+  auto social_graph_client = social_graph_client_wrapper->GetClient();
+  try {
+    social_graph_client->GetFollowers(*followers_id, update.req_id,
+                                      update.user_id, writer_text_map);
+  } catch (...) {
+    LOG(error) << "Failed to get followers from social-network-service";
+    _social_graph_client_pool->Remove(social_graph_client_wrapper);
+    throw;
+  }
+  _social_graph_client_pool->Keepalive(social_graph_client_wrapper);
+  followers_span->Finish();
+}
+
+// Looks up the followers of the authors of all updates in one call.
+void GetFollowersBatch(const std::vector<HomeTimelineUpdate> &updates,
+                       const opentracing::SpanContext &parent,
+                       std::map<int64_t, std::vector<int64_t>> *followers) {
+  auto followers_span = StartChildSpan("get_followers_batch_client", parent);
+  std::map<std::string, std::string> writer_text_map;
+  InjectSpan(*followers_span, &writer_text_map);
+
+  std::vector<int64_t> user_ids;
+  for (auto &update : updates) {
+    user_ids.emplace_back(update.user_id);
+  }
+  auto social_graph_client_wrapper = _social_graph_client_pool->Pop();
+  if (!social_graph_client_wrapper) {
+    ServiceException se;
+    se.errorCode = ErrorCode::SE_THRIFT_CONN_ERROR;
+    se.message = "Failed to connect to social-graph-service";
+    throw se;
+  }
+  auto social_graph_client = social_graph_client_wrapper->GetClient();
+  try {
+    social_graph_client->GetFollowersBatch(*followers, updates.front().req_id,
+                                           user_ids, writer_text_map);
+  } catch (...) {
+    LOG(error) << "Failed to get followers from social-network-service";
+    _social_graph_client_pool->Remove(social_graph_client_wrapper);
+    throw;
+  }
+  _social_graph_client_pool->Keepalive(social_graph_client_wrapper);
+  followers_span->Finish();
+}
+
+using TimelineMembers =
+    std::unordered_map<std::string, std::vector<std::pair<std::string, double>>>;
+
+template <typename Pipe>
+void AddToTimeline(Pipe *pipe, const std::string &timeline_key,
+                   const std::vector<std::pair<std::string, double>> &members) {
+  pipe->zadd(timeline_key, members.begin(), members.end(),
+             UpdateType::NOT_EXIST);
+  if (_max_timeline_length > 0) {
+    pipe->zremrangebyrank(timeline_key, 0, -_max_timeline_length - 1);
+  }
+}
+
+void WriteTimelines(const std::set<std::string> &pull_authors,
+                    const TimelineMembers &timeline_members) {
+  // Register the authors before writing their pull timelines, so readers
+  // never miss a post that is only in a pull timeline.
+  if (!pull_authors.empty()) {
+    if (_redis_client_pool) {
+      _redis_client_pool->sadd(PULL_AUTHORS_KEY, pull_authors.begin(),
+                               pull_authors.end());
+    } else {
+      _redis_cluster_client_pool->sadd(PULL_AUTHORS_KEY, pull_authors.begin(),
+                                       pull_authors.end());
     }
+  }
 
-    // Jaeger tracing
-    TextMapReader span_reader(carrier);
-    auto parent_span = opentracing::Tracer::Global()->Extract(span_reader);
-    auto span = opentracing::Tracer::Global()->StartSpan(
-        "write_home_timeline_server",
-        {opentracing::ChildOf(parent_span->get())});
-
-    // Extract information from rabbitmq messages
-    int64_t user_id = msg_json["user_id"];
-    int64_t req_id = msg_json["req_id"];
-    int64_t post_id = msg_json["post_id"];
-    int64_t timestamp = msg_json["timestamp"];
-    std::vector<int64_t> user_mentions_id = msg_json["user_mentions_id"];
-
-    // Find followers of the user
-    auto followers_span = opentracing::Tracer::Global()->StartSpan(
-        "get_followers_client", {opentracing::ChildOf(&span->context())});
-    std::map<std::string, std::string> writer_text_map;
-    TextMapWriter writer(writer_text_map);
-    opentracing::Tracer::Global()->Inject(followers_span->context(), writer);
-
-    auto social_graph_client_wrapper = _social_graph_client_pool->Pop();
-    if (!social_graph_client_wrapper) {
-      ServiceException se;
-      se.errorCode = ErrorCode::SE_THRIFT_CONN_ERROR;
-      se.message = "Failed to connect to social-graph-service";
-      throw se;
+  if (_redis_client_pool) {
+    auto pipe = _redis_client_pool->pipeline(false);
+    for (auto &timeline : timeline_members) {
+      AddToTimeline(&pipe, timeline.first, timeline.second);
+    }
+    pipe.exec();
+  } else {
+    // One pipeline per shard, as in HomeTimelineHandler.
+    std::map<std::shared_ptr<ConnectionPool>, std::shared_ptr<Pipeline>>
+        pipe_map;
+    auto *shards_pool = _redis_cluster_client_pool->get_shards_pool();
+    for (auto &timeline : timeline_members) {
+      auto conn = shards_pool->fetch(timeline.first);
+      auto pipe = pipe_map.find(conn);
+      if (pipe == pipe_map.end()) {
+        pipe = pipe_map
+                   .emplace(conn, std::make_shared<Pipeline>(
+                                      _redis_cluster_client_pool->pipeline(
+                                          timeline.first, false)))
+                   .first;
+      }
+      AddToTimeline(pipe->second.get(), timeline.first, timeline.second);
+    }
+    for (auto &pipe : pipe_map) {
+      pipe.second->exec();
     }
-    auto social_graph_client = social_graph_client_wrapper->GetClient();
+  }
+}
+
+// Fans out a batch of updates: one GetFollowersBatch for the batch, then a
+// single multi-member ZADD per timeline. written[i] tells whether updates[i]
+// reached Redis. If the batch lookup fails, the followers are looked up per
+// update, so that one failing update does not hold back the others. ZADD NX
+// makes retrying an update harmless.
+void WriteBatch(const std::vector<HomeTimelineUpdate> &updates,
+                std::vector<bool> *written) {
+  std::vector<SpanPtr> spans;
+  std::set<std::string> pull_authors;
+  TimelineMembers timeline_members;
+  written->assign(updates.size(), false);
+
+  for (auto &update : updates) {
+    spans.emplace_back(StartSpanFromCarrier("write_home_timeline_server",
+                                            update.carrier, nullptr));
+  }
+  std::map<int64_t, std::vector<int64_t>> followers;
+  bool batched = true;
+  try {
+    GetFollowersBatch(updates, spans.front()->context(), &followers);
+  } catch (const std::exception &ex) {
+    LOG(warning) << "Failed to get the followers of " << updates.size()
+                 << " authors at once, retrying one by one: " << ex.what();
+    batched = false;
+  }
+
+  for (size_t i = 0; i < updates.size(); ++i) {
+    auto &update = updates[i];
     std::vector<int64_t> followers_id;
-    try {
-      social_graph_client->GetFollowers(followers_id, req_id, user_id,
-                                        writer_text_map);
-    } catch (...) {
-      LOG(error) << "Failed to get followers from social-network-service";
-      _social_graph_client_pool->Remove(social_graph_client_wrapper);
-      throw;
+    if (batched) {
+      followers_id = followers[update.user_id];
+    } else {
+      try {
+        GetFollowers(update, spans[i]->context(), &followers_id);
+      } catch (const std::exception &ex) {
+        LOG(error) << "Failed to get the followers of user " << update.user_id
+                   << ": " << ex.what();
+        continue;
+      }
     }
-    _social_graph_client_pool->Keepalive(social_graph_client_wrapper);
-    followers_span->Finish();
-
-    std::set<int64_t> followers_id_set(followers_id.begin(),
-                                       followers_id.end());
-    followers_id_set.insert(user_mentions_id.begin(), user_mentions_id.end());
-
-    // Update Redis ZSet
-    auto redis_span = opentracing::Tracer::Global()->StartSpan(
-        "write_home_timeline_redis_update_client",
-        {opentracing::ChildOf(&span->context())});
-    auto redis_client_wrapper = _redis_client_pool->Pop();
-    if (!redis_client_wrapper) {
-      ServiceException se;
-      se.errorCode = ErrorCode::SE_REDIS_ERROR;
-      se.message = "Cannot connect to Redis server";
-      throw se;
+
+    // Mentioned users are always pushed to, followers only if the author is
+    // below the fan-out threshold.
+    bool pull = _fanout_follower_threshold > 0 &&
+        followers_id.size() > static_cast<size_t>(_fanout_follower_threshold);
+    std::set<int64_t> followers_id_set(update.user_mentions_id.begin(),
+                                       update.user_mentions_id.end());
+    if (!pull) {
+      followers_id_set.insert(followers_id.begin(), followers_id.end());
     }
-    auto redis_client = redis_client_wrapper->GetClient();
-    std::vector<std::string> options{"NX"};
-    std::string post_id_str = std::to_string(post_id);
-    std::string timestamp_str = std::to_string(timestamp);
-    std::multimap<std::string, std::string> value = {
-        {timestamp_str, post_id_str}};
 
+    std::string post_member = EncodeTimelineMember(update.post_id);
+    double score = update.timestamp;
     for (auto &follower_id : followers_id_set) {
-      redis_client->zadd(std::to_string(follower_id), options, value);
+      timeline_members[std::to_string(follower_id)].emplace_back(post_member,
+                                                                 score);
+    }
+    if (pull) {
+      pull_authors.emplace(std::to_string(update.user_id));
+      timeline_members[PullTimelineKey(update.user_id)].emplace_back(
+          post_member, score);
     }
+    (*written)[i] = true;
+  }
 
-    redis_client->sync_commit();
-    redis_span->Finish();
-    _redis_client_pool->Keepalive(redis_client_wrapper);
-  } catch (...) {
-    LOG(error) << "OnReveived worker error";
-    throw;
+  auto redis_span = StartChildSpan(
+      "write_home_timeline_redis_update_client", spans.front()->context());
+  try {
+    WriteTimelines(pull_authors, timeline_members);
+  } catch (const std::exception &ex) {
+    LOG(error) << "Failed to write " << updates.size()
+               << " home timeline updates: " << ex.what();
+    written->assign(updates.size(), false);
+  }
+  redis_span->Finish();
+  for (auto &span : spans) {
+    span->Finish();
   }
 }
 
-void HeartbeatSend(AmqpLibeventHandler &handler,
-                   AMQP::TcpConnection &connection, int interval) {
-  while (handler.GetIsRunning()) {
-    LOG(debug) << "Heartbeat sent";
-    connection.heartbeat();
-    sleep(interval);
+// Writes batches on a thread of its own, so that the blocking Thrift and
+// Redis calls never stall the AMQP event loop and its heartbeats. The
+// results are collected by the event loop thread, the only one that may use
+// the channel.
+class BatchWriter {
+ public:
+  BatchWriter();
+  ~BatchWriter();
+
+  void Submit(std::vector<HomeTimelineUpdate> batch);
+  // Moves the updates of the batches written so far into done, each with
+  // whether it was written.
+  void Collect(std::vector<std::pair<HomeTimelineUpdate, bool>> *done);
+
+ private:
+  void _Run();
+
+  std::mutex _mtx;
+  std::condition_variable _cv;
+  std::deque<std::vector<HomeTimelineUpdate>> _pending;
+  std::vector<std::pair<HomeTimelineUpdate, bool>> _done;
+  bool _stopped;
+  std::thread _thread;
+};
+
+BatchWriter::BatchWriter() : _stopped(false) {
+  _thread = std::thread(&BatchWriter::_Run, this);
+}
+
+BatchWriter::~BatchWriter() {
+  {
+    std::lock_guard<std::mutex> lock(_mtx);
+    _stopped = true;
+  }
+  _cv.notify_one();
+  // Updates that are not settled yet are redelivered once the connection
+  // is closed.
+  _thread.join();
+}
+
+void BatchWriter::Submit(std::vector<HomeTimelineUpdate> batch) {
+  {
+    std::lock_guard<std::mutex> lock(_mtx);
+    _pending.emplace_back(std::move(batch));
+  }
+  _cv.notify_one();
+}
+
+void BatchWriter::Collect(
+    std::vector<std::pair<HomeTimelineUpdate, bool>> *done) {
+  std::lock_guard<std::mutex> lock(_mtx);
+  done->swap(_done);
+}
+
+void BatchWriter::_Run() {
+  while (true) {
+    std::vector<HomeTimelineUpdate> batch;
+    {
+      std::unique_lock<std::mutex> lock(_mtx);
+      _cv.wait(lock, [this]() { return _stopped || !_pending.empty(); });
+      if (_stopped) {
+        return;
+      }
+      batch = std::move(_pending.front());
+      _pending.pop_front();
+    }
+    std::vector<bool> written;
+    WriteBatch(batch, &written);
+    std::lock_guard<std::mutex> lock(_mtx);
+    for (size_t i = 0; i < batch.size(); ++i) {
+      _done.emplace_back(std::move(batch[i]), written[i]);
+    }
   }
 }
 
-void WorkerThread(std::string &addr, int port) {
+void Publish(AMQP::TcpChannel *channel, const char *queue,
+             const std::string &body, uint32_t retries) {
+  AMQP::Envelope envelope(body.data(), body.size());
+  envelope.setPersistent(true);
+  AMQP::Table headers;
+  headers.set("x-retries", AMQP::ULong(retries));
+  envelope.setHeaders(headers);
+  channel->publish("", queue, envelope);
+}
+
+// Consumes updates on one connection until it or its channel fails.
+void RunWorker(const std::string &addr, int port, int prefetch,
+               int batch_size, int batch_timeout_ms) {
   AmqpLibeventHandler handler;
   AMQP::TcpConnection connection(
       handler, AMQP::Address(addr, port, AMQP::Login("guest", "guest"), "/"));
@@ -129,25 +373,97 @@ void WorkerThread(std::string &addr, int port) {
     LOG(error) << "Channel error: " << message;
     handler.Stop();
   });
-  channel.declareQueue("write-home-timeline", AMQP::durable)
+  channel.setQos(prefetch);
+  channel.declareQueue(WRITE_HOME_TIMELINE_QUEUE, AMQP::durable)
       .onSuccess([&connection](const std::string &name, uint32_t messagecount,
                                uint32_t consumercount) {
         LOG(debug) << "Created queue: " << name;
       });
-  channel.consume("write-home-timeline", AMQP::noack)
-      .onReceived([](const AMQP::Message &msg, uint64_t tag, bool redelivered) {
-        LOG(debug) << "Received: " << std::string(msg.body(), msg.bodySize());
-        OnReceivedWorker(msg);
+  channel.declareQueue(WRITE_HOME_TIMELINE_DEAD_QUEUE, AMQP::durable);
+
+  // Each message is acked once its update is in Redis, or once it has been
+  // republished for a retry or moved to the dead queue, so a failing update
+  // never holds back the others. A crashed worker leaves its unacked
+  // messages in the queue for the others.
+  BatchWriter writer;
+  std::vector<HomeTimelineUpdate> batch;
+  auto flush = [&]() {
+    if (!batch.empty()) {
+      writer.Submit(std::move(batch));
+      batch.clear();
+    }
+  };
+  auto settle = [&]() {
+    std::vector<std::pair<HomeTimelineUpdate, bool>> done;
+    writer.Collect(&done);
+    for (auto &result : done) {
+      HomeTimelineUpdate &update = result.first;
+      if (!result.second) {
+        if (update.retries < static_cast<uint32_t>(_max_retries)) {
+          Publish(&channel, WRITE_HOME_TIMELINE_QUEUE, update.body,
+                  update.retries + 1);
+        } else {
+          LOG(error) << "Moving the home timeline update of post "
+                     << update.post_id << " to " WRITE_HOME_TIMELINE_DEAD_QUEUE
+                     << " after " << update.retries << " retries";
+          Publish(&channel, WRITE_HOME_TIMELINE_DEAD_QUEUE, update.body,
+                  update.retries);
+        }
+      }
+      channel.ack(update.delivery_tag);
+    }
+  };
+
+  channel.consume(WRITE_HOME_TIMELINE_QUEUE)
+      .onReceived([&](const AMQP::Message &msg, uint64_t tag,
+                      bool redelivered) {
+        HomeTimelineUpdate update;
+        if (!ParseUpdate(msg, &update)) {
+          // Redelivering it would fail the same way.
+          Publish(&channel, WRITE_HOME_TIMELINE_DEAD_QUEUE, update.body,
+                  update.retries);
+          channel.ack(tag);
+          return;
+        }
+        update.delivery_tag = tag;
+        batch.emplace_back(std::move(update));
+        if (batch.size() >= static_cast<size_t>(batch_size)) {
+          flush();
+        }
       });
 
-  std::thread heartbeat_thread(HeartbeatSend, std::ref(handler),
-                               std::ref(connection), 30);
-  heartbeat_thread.detach();
+  handler.AddTimer(batch_timeout_ms, [&]() {
+    flush();
+    settle();
+  });
+  handler.AddTimer(30000, [&connection]() {
+    LOG(debug) << "Heartbeat sent";
+    connection.heartbeat();
+  });
   handler.Start();
   LOG(debug) << "Closing connection.";
   connection.close();
 }
 
+void WorkerThread(std::string &addr, int port, int prefetch, int batch_size,
+                  int batch_timeout_ms) {
+  int backoff_ms = WORKER_RECONNECT_MIN_BACKOFF_MS;
+  while (true) {
+    auto start = std::chrono::steady_clock::now();
+    RunWorker(addr, port, prefetch, batch_size, batch_timeout_ms);
+    // A connection that stayed up longer than the max delay was healthy, so
+    // the next failure starts over from the min.
+    if (std::chrono::steady_clock::now() - start >
+        std::chrono::milliseconds(WORKER_RECONNECT_MAX_BACKOFF_MS)) {
+      backoff_ms = WORKER_RECONNECT_MIN_BACKOFF_MS;
+    }
+    LOG(warning) << "Lost the connection to " << addr << ":" << port
+                 << ", reconnecting in " << backoff_ms << " ms";
+    std::this_thread::sleep_for(std::chrono::milliseconds(backoff_ms));
+    backoff_ms = std::min(backoff_ms * 2, WORKER_RECONNECT_MAX_BACKOFF_MS);
+  }
+}
+
 int main(int argc, char *argv[]) {
   signal(SIGINT, sigintHandler);
   init_logger();
@@ -159,19 +475,36 @@ int main(int argc, char *argv[]) {
     exit(EXIT_FAILURE);
   }
 
-  int port = config_json["write-home-timeline-service"]["port"];
   int n_workers = config_json["write-home-timeline-service"]["workers"];
+  // Unacked messages per worker, bounds how much is redelivered after a
+  // worker failure.
+  int prefetch =
+      config_json["write-home-timeline-service"].value("prefetch", 256);
+  // A batch is written once it has batch_size updates or batch_timeout_ms
+  // after the previous write, whichever comes first.
+  int batch_size =
+      config_json["write-home-timeline-service"].value("batch_size", 64);
+  int batch_timeout_ms =
+      config_json["write-home-timeline-service"].value("batch_timeout_ms", 5);
+  // Attempts of a failed update after the first, before it is moved to the
+  // dead queue.
+  _max_retries =
+      config_json["write-home-timeline-service"].value("max_retries", 3);
+  if (batch_size > prefetch) {
+    LOG(warning) << "batch_size is above prefetch, batches are flushed by "
+                    "batch_timeout_ms only";
+  }
+
+  // Same timeline layout as home-timeline-service.
+  _fanout_follower_threshold = config_json["home-timeline-service"].value(
+      "fanout_follower_threshold", 0);
+  _max_timeline_length =
+      config_json["home-timeline-service"].value("max_timeline_length", 0);
 
   std::string rabbitmq_addr =
       config_json["write-home-timeline-rabbitmq"]["addr"];
   int rabbitmq_port = config_json["write-home-timeline-rabbitmq"]["port"];
 
-  std::string redis_addr = config_json["home-timeline-redis"]["addr"];
-  int redis_port = config_json["home-timeline-redis"]["port"];
-  int redis_conns = config_json["home-timeline-redis"]["connections"];
-  int redis_timeout = config_json["home-timeline-redis"]["timeout_ms"];
-  int redis_keepalive = config_json["home-timeline-redis"]["keepalive_ms"];
-
   std::string social_graph_service_addr =
       config_json["social-graph-service"]["addr"];
   int social_graph_service_port = config_json["social-graph-service"]["port"];
@@ -182,33 +515,36 @@ int main(int argc, char *argv[]) {
   int social_graph_service_keepalive =
       config_json["social-graph-service"]["keepalive_ms"];
 
-  ClientPool<RedisClient> redis_client_pool("redis", redis_addr, redis_port, 0,
-                                            redis_conns, redis_timeout,
-                                            redis_keepalive, config_json);
-
   ClientPool<ThriftClient<SocialGraphServiceClient>> social_graph_client_pool(
       "social-graph-service", social_graph_service_addr,
       social_graph_service_port, 0, social_graph_service_conns,
       social_graph_service_timeout, social_graph_service_keepalive, config_json);
-
-  _redis_client_pool = &redis_client_pool;
   _social_graph_client_pool = &social_graph_client_pool;
 
+  // Writes go to the primary when home-timeline-redis is replicated.
+  std::unique_ptr<Redis> redis_client_pool;
+  std::unique_ptr<RedisCluster> redis_cluster_client_pool;
+  if (config_json["home-timeline-redis"]["use_cluster"]) {
+    redis_cluster_client_pool.reset(new RedisCluster(
+        init_redis_cluster_client_pool(config_json, "home-timeline")));
+  } else if (config_json["home-timeline-redis"]["use_replica"]) {
+    redis_client_pool.reset(new Redis(
+        init_redis_replica_client_pool(config_json, "redis-primary")));
+  } else {
+    redis_client_pool.reset(
+        new Redis(init_redis_client_pool(config_json, "home-timeline")));
+  }
+  _redis_client_pool = redis_client_pool.get();
+  _redis_cluster_client_pool = redis_cluster_client_pool.get();
+
   std::unique_ptr<std::thread> threads_ptr[n_workers];
   for (auto &thread_ptr : threads_ptr) {
     thread_ptr = std::make_unique<std::thread>(
-        WorkerThread, std::ref(rabbitmq_addr), rabbitmq_port);
+        WorkerThread, std::ref(rabbitmq_addr), rabbitmq_port, prefetch,
+        batch_size, batch_timeout_ms);
   }
   for (auto &thread_ptr : threads_ptr) {
     thread_ptr->join();
-    if (_teptr) {
-      try {
-        std::rethrow_exception(_teptr);
-      } catch (const std::exception &ex) {
-        LOG(error) << "Thread exited with exception: " << ex.what();
-        exit(1);
-      }
-    }
   }
 
   return 0;
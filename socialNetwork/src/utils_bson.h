@@ -0,0 +1,237 @@
+#ifndef SOCIAL_NETWORK_MICROSERVICES_SRC_UTILS_BSON_H_
+#define SOCIAL_NETWORK_MICROSERVICES_SRC_UTILS_BSON_H_
+
+#include <bson/bson.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "../gen-cpp/social_network_types.h"
+
+namespace social_network {
+
+// Decoders from the documents written by the services straight into the
+// Thrift structs. Each walks the document once with a bson_iter_t and copies
+// strings directly out of the BSON buffer, instead of going through
+// bson_as_json() and a JSON DOM. They return false if the document is
+// malformed or lacks a required field.
+
+namespace bson_decode {
+
+void AssignUtf8(const bson_iter_t *iter, std::string *out) {
+  uint32_t length;
+  const char *str = bson_iter_utf8(iter, &length);
+  out->assign(str, length);
+}
+
+template<class T, class F>
+bool DecodeDocumentArray(const bson_iter_t *iter, std::vector<T> *out,
+                         F decode) {
+  bson_iter_t array_iter;
+  if (!BSON_ITER_HOLDS_ARRAY(iter) || !bson_iter_recurse(iter, &array_iter)) {
+    return false;
+  }
+  out->clear();
+  while (bson_iter_next(&array_iter)) {
+    bson_iter_t doc_iter;
+    if (!BSON_ITER_HOLDS_DOCUMENT(&array_iter) ||
+        !bson_iter_recurse(&array_iter, &doc_iter)) {
+      return false;
+    }
+    out->emplace_back();
+    if (!decode(&doc_iter, &out->back())) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace bson_decode
+
+// The Bson*FromIter functions take an iterator positioned before the first
+// field of a (sub)document, as set up by bson_iter_init or bson_iter_recurse.
+bool BsonUserMentionFromIter(bson_iter_t *iter, UserMention *user_mention) {
+  bool has_user_id = false;
+  bool has_username = false;
+  while (bson_iter_next(iter)) {
+    const char *key = bson_iter_key(iter);
+    if (std::strcmp(key, "user_id") == 0) {
+      user_mention->user_id = bson_iter_as_int64(iter);
+      has_user_id = true;
+    } else if (std::strcmp(key, "username") == 0 &&
+               BSON_ITER_HOLDS_UTF8(iter)) {
+      bson_decode::AssignUtf8(iter, &user_mention->username);
+      has_username = true;
+    }
+  }
+  return has_user_id && has_username;
+}
+
+bool BsonUrlFromIter(bson_iter_t *iter, Url *url) {
+  bool has_shortened_url = false;
+  bool has_expanded_url = false;
+  while (bson_iter_next(iter)) {
+    if (!BSON_ITER_HOLDS_UTF8(iter)) {
+      continue;
+    }
+    const char *key = bson_iter_key(iter);
+    if (std::strcmp(key, "shortened_url") == 0) {
+      bson_decode::AssignUtf8(iter, &url->shortened_url);
+      has_shortened_url = true;
+    } else if (std::strcmp(key, "expanded_url") == 0) {
+      bson_decode::AssignUtf8(iter, &url->expanded_url);
+      has_expanded_url = true;
+    }
+  }
+  return has_shortened_url && has_expanded_url;
+}
+
+bool BsonMediaFromIter(bson_iter_t *iter, Media *media) {
+  bool has_media_id = false;
+  bool has_media_type = false;
+  while (bson_iter_next(iter)) {
+    const char *key = bson_iter_key(iter);
+    if (std::strcmp(key, "media_id") == 0) {
+      media->media_id = bson_iter_as_int64(iter);
+      has_media_id = true;
+    } else if (std::strcmp(key, "media_type") == 0 &&
+               BSON_ITER_HOLDS_UTF8(iter)) {
+      bson_decode::AssignUtf8(iter, &media->media_type);
+      has_media_type = true;
+    }
+  }
+  return has_media_id && has_media_type;
+}
+
+bool BsonCreatorFromIter(bson_iter_t *iter, Creator *creator) {
+  bool has_user_id = false;
+  bool has_username = false;
+  while (bson_iter_next(iter)) {
+    const char *key = bson_iter_key(iter);
+    if (std::strcmp(key, "user_id") == 0) {
+      creator->user_id = bson_iter_as_int64(iter);
+      has_user_id = true;
+    } else if (std::strcmp(key, "username") == 0 &&
+               BSON_ITER_HOLDS_UTF8(iter)) {
+      bson_decode::AssignUtf8(iter, &creator->username);
+      has_username = true;
+    }
+  }
+  return has_user_id && has_username;
+}
+
+bool BsonPostFromIter(bson_iter_t *iter, Post *post) {
+  enum {
+    kPostId = 1 << 0,
+    kCreator = 1 << 1,
+    kReqId = 1 << 2,
+    kText = 1 << 3,
+    kTimestamp = 1 << 4,
+    kPostType = 1 << 5,
+    kRequired = (1 << 6) - 1
+  };
+  int found = 0;
+  bool ok = true;
+  while (ok && bson_iter_next(iter)) {
+    const char *key = bson_iter_key(iter);
+    if (std::strcmp(key, "post_id") == 0) {
+      post->post_id = bson_iter_as_int64(iter);
+      found |= kPostId;
+    } else if (std::strcmp(key, "timestamp") == 0) {
+      post->timestamp = bson_iter_as_int64(iter);
+      found |= kTimestamp;
+    } else if (std::strcmp(key, "req_id") == 0) {
+      post->req_id = bson_iter_as_int64(iter);
+      found |= kReqId;
+    } else if (std::strcmp(key, "post_type") == 0) {
+      post->post_type =
+          static_cast<PostType::type>(bson_iter_as_int64(iter));
+      found |= kPostType;
+    } else if (std::strcmp(key, "text") == 0) {
+      ok = BSON_ITER_HOLDS_UTF8(iter);
+      if (ok) {
+        bson_decode::AssignUtf8(iter, &post->text);
+        found |= kText;
+      }
+    } else if (std::strcmp(key, "creator") == 0) {
+      bson_iter_t child;
+      ok = BSON_ITER_HOLDS_DOCUMENT(iter) && bson_iter_recurse(iter, &child) &&
+          BsonCreatorFromIter(&child, &post->creator);
+      found |= kCreator;
+    } else if (std::strcmp(key, "user_mentions") == 0) {
+      ok = bson_decode::DecodeDocumentArray(iter, &post->user_mentions,
+                                            BsonUserMentionFromIter);
+    } else if (std::strcmp(key, "media") == 0) {
+      ok = bson_decode::DecodeDocumentArray(iter, &post->media,
+                                            BsonMediaFromIter);
+    } else if (std::strcmp(key, "urls") == 0) {
+      ok = bson_decode::DecodeDocumentArray(iter, &post->urls,
+                                            BsonUrlFromIter);
+    }
+  }
+  return ok && (found & kRequired) == kRequired;
+}
+
+// Walks the array field array_key of doc, made of {<id_key>, timestamp}
+// documents such as social-graph followers or user-timeline posts, in one
+// pass and calls callback(id, timestamp) for each entry in array order.
+// Stops at the first entry lacking either int64 field. Returns the number of
+// entries passed to callback.
+template<class F>
+int ForEachTimestampedId(const bson_t *doc, const char *array_key,
+                         const char *id_key, F callback) {
+  bson_iter_t iter;
+  bson_iter_t array_iter;
+  if (!bson_iter_init_find(&iter, doc, array_key) ||
+      !BSON_ITER_HOLDS_ARRAY(&iter) ||
+      !bson_iter_recurse(&iter, &array_iter)) {
+    return 0;
+  }
+  int count = 0;
+  while (bson_iter_next(&array_iter)) {
+    bson_iter_t entry_iter;
+    if (!BSON_ITER_HOLDS_DOCUMENT(&array_iter) ||
+        !bson_iter_recurse(&array_iter, &entry_iter)) {
+      break;
+    }
+    bool has_id = false;
+    bool has_timestamp = false;
+    int64_t id = 0;
+    int64_t timestamp = 0;
+    while (bson_iter_next(&entry_iter)) {
+      if (!BSON_ITER_HOLDS_INT64(&entry_iter)) {
+        continue;
+      }
+      const char *key = bson_iter_key(&entry_iter);
+      if (std::strcmp(key, id_key) == 0) {
+        id = bson_iter_int64(&entry_iter);
+        has_id = true;
+      } else if (std::strcmp(key, "timestamp") == 0) {
+        timestamp = bson_iter_int64(&entry_iter);
+        has_timestamp = true;
+      }
+    }
+    if (!has_id || !has_timestamp) {
+      break;
+    }
+    callback(id, timestamp);
+    count++;
+  }
+  return count;
+}
+
+bool BsonToUserMention(const bson_t *doc, UserMention *user_mention) {
+  bson_iter_t iter;
+  return bson_iter_init(&iter, doc) &&
+      BsonUserMentionFromIter(&iter, user_mention);
+}
+
+bool BsonToPost(const bson_t *doc, Post *post) {
+  bson_iter_t iter;
+  return bson_iter_init(&iter, doc) && BsonPostFromIter(&iter, post);
+}
+
+}  // namespace social_network
+
+#endif  // SOCIAL_NETWORK_MICROSERVICES_SRC_UTILS_BSON_H_
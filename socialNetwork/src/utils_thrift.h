@@ -2,13 +2,39 @@
 #define SOCIAL_NETWORK_MICROSERVICES_SRC_UTILS_THRIFT_H_
 
 #include <string>
+#include <thread>
+#include <chrono>
 #include <nlohmann/json.hpp>
+#include <thrift/TProcessor.h>
+#include <thrift/concurrency/PlatformThreadFactory.h>
+#include <thrift/concurrency/ThreadManager.h>
+#include <thrift/protocol/TBinaryProtocol.h>
+#include <thrift/server/TNonblockingServer.h>
+#include <thrift/server/TThreadPoolServer.h>
+#include <thrift/server/TThreadedServer.h>
+#include <thrift/transport/TBufferTransports.h>
+#include <thrift/transport/TNonblockingServerSocket.h>
+#include <thrift/transport/TNonblockingSSLServerSocket.h>
 #include <thrift/transport/TServerSocket.h>
 #include <thrift/transport/TSSLSocket.h>
 #include <thrift/transport/TSSLServerSocket.h>
 
+#include "logger.h"
+
 namespace social_network{
 using json = nlohmann::json;
+using apache::thrift::TProcessor;
+using apache::thrift::concurrency::PlatformThreadFactory;
+using apache::thrift::concurrency::ThreadManager;
+using apache::thrift::protocol::TBinaryProtocolFactory;
+using apache::thrift::server::TNonblockingServer;
+using apache::thrift::server::TServer;
+using apache::thrift::server::TThreadPoolServer;
+using apache::thrift::server::TThreadedServer;
+using apache::thrift::transport::TFramedTransportFactory;
+using apache::thrift::transport::TNonblockingServerSocket;
+using apache::thrift::transport::TNonblockingServerTransport;
+using apache::thrift::transport::TNonblockingSSLServerSocket;
 using apache::thrift::transport::TServerSocket;
 using apache::thrift::transport::TSSLServerSocket;
 using apache::thrift::transport::TSSLSocketFactory;
@@ -35,6 +61,100 @@ std::shared_ptr<TServerSocket> get_server_socket(const json &config_json, const
   return std::make_shared<TServerSocket>(address, port);
 };
 
+std::shared_ptr<TNonblockingServerTransport> get_nonblocking_server_socket(
+    const json &config_json, int port) {
+  bool ssl_enabled = config_json["ssl"]["enabled"];
+  if (ssl_enabled) {
+    std::string cert_path = config_json["ssl"]["serverCertPath"];
+    std::string key_path = config_json["ssl"]["serverKeyPath"];
+    std::string ciphers = config_json["ssl"]["ciphers"];
+
+    std::shared_ptr<TSSLSocketFactory> ssl_socket_factory;
+    ssl_socket_factory = std::make_shared<TSSLSocketFactory>();
+    ssl_socket_factory->loadCertificate(cert_path.c_str());
+    ssl_socket_factory->loadPrivateKey(key_path.c_str());
+    ssl_socket_factory->ciphers(ciphers);
+    return std::make_shared<TNonblockingSSLServerSocket>(port,
+                                                         ssl_socket_factory);
+  }
+  return std::make_shared<TNonblockingServerSocket>(port);
+}
+
+// Periodically logs queue depth and worker utilisation of a server's
+// ThreadManager so the worker pool can be sized.
+void start_server_stats_logger(const std::string &service_name,
+                               std::shared_ptr<ThreadManager> thread_manager,
+                               int interval_ms) {
+  std::thread([service_name, thread_manager, interval_ms]() {
+    while (true) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(interval_ms));
+      size_t workers = thread_manager->workerCount();
+      size_t idle = thread_manager->idleWorkerCount();
+      double utilisation =
+          workers > 0 ? static_cast<double>(workers - idle) / workers : 0;
+      LOG(info) << service_name << " server stats: workers=" << workers
+                << " idle=" << idle << " utilisation=" << utilisation
+                << " pending=" << thread_manager->pendingTaskCount()
+                << " total_tasks=" << thread_manager->totalTaskCount()
+                << " expired=" << thread_manager->expiredTaskCount();
+    }
+  }).detach();
+}
+
+// Builds the server for <service_name> according to its "server_mode" entry
+// in service-config.json:
+//   "threaded"    one thread per client connection (default)
+//   "thread_pool" fixed pool of "server_workers" threads, one connection per
+//                 worker at a time; suits callers that keep few connections
+//   "nonblocking" "server_io_threads" epoll (libevent) threads read requests
+//                 and queue them to "server_workers" threads, with at most
+//                 "server_max_pending" queued requests (0 = unbounded)
+// A positive "server_stats_interval_ms" logs the worker pool statistics.
+std::shared_ptr<TServer> get_server(
+    const json &config_json, const std::string &service_name,
+    const std::shared_ptr<TProcessor> &processor, int port) {
+  const json &service_json = config_json[service_name];
+  std::string mode = service_json.value("server_mode", std::string("threaded"));
+  int workers = service_json.value("server_workers", 64);
+  int io_threads = service_json.value("server_io_threads", 4);
+  int max_pending = service_json.value("server_max_pending", 0);
+  int stats_interval_ms = service_json.value("server_stats_interval_ms", 0);
+
+  if (mode == "threaded") {
+    return std::make_shared<TThreadedServer>(
+        processor, get_server_socket(config_json, "0.0.0.0", port),
+        std::make_shared<TFramedTransportFactory>(),
+        std::make_shared<TBinaryProtocolFactory>());
+  }
+
+  if (mode != "thread_pool" && mode != "nonblocking") {
+    LOG(fatal) << "Unknown server_mode " << mode << " for " << service_name;
+    exit(EXIT_FAILURE);
+  }
+
+  std::shared_ptr<ThreadManager> thread_manager =
+      ThreadManager::newSimpleThreadManager(workers, max_pending);
+  thread_manager->threadFactory(std::make_shared<PlatformThreadFactory>());
+  thread_manager->start();
+  if (stats_interval_ms > 0) {
+    start_server_stats_logger(service_name, thread_manager, stats_interval_ms);
+  }
+  LOG(info) << "Using " << mode << " server with " << workers << " workers";
+
+  if (mode == "thread_pool") {
+    return std::make_shared<TThreadPoolServer>(
+        processor, get_server_socket(config_json, "0.0.0.0", port),
+        std::make_shared<TFramedTransportFactory>(),
+        std::make_shared<TBinaryProtocolFactory>(), thread_manager);
+  }
+
+  auto server = std::make_shared<TNonblockingServer>(
+      processor, std::make_shared<TBinaryProtocolFactory>(),
+      get_nonblocking_server_socket(config_json, port), thread_manager);
+  server->setNumIOThreads(io_threads);
+  return server;
+}
+
 } //namespace social_network
 
 #endif //SOCIAL_NETWORK_MICROSERVICES_SRC_UTILS_THRIFT_H_
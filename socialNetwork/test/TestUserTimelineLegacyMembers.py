@@ -0,0 +1,96 @@
+import sys
+sys.path.append('../gen-py')
+
+import random
+import struct
+import time
+import uuid
+
+import redis
+from social_network import PostStorageService
+from social_network import UserTimelineService
+from social_network.ttypes import Creator
+from social_network.ttypes import Post
+from social_network.ttypes import PostType
+
+from thrift import Thrift
+from thrift.transport import TSocket
+from thrift.transport import TTransport
+from thrift.protocol import TBinaryProtocol
+
+# Run from a container attached to the deployment's network.
+POST_STORAGE_ADDR = ("post-storage-service", 9090)
+USER_TIMELINE_ADDR = ("user-timeline-service", 9090)
+USER_TIMELINE_REDIS_ADDR = ("user-timeline-redis", 6379)
+NUM_POSTS = 6
+NUM_LEGACY_POSTS = 3
+
+
+def open_client(service, addr):
+  socket = TSocket.TSocket(*addr)
+  transport = TTransport.TFramedTransport(socket)
+  protocol = TBinaryProtocol.TBinaryProtocol(transport)
+  transport.open()
+  return service.Client(protocol), transport
+
+
+def new_req_id():
+  return uuid.uuid4().int & 0x7FFFFFFFFFFFFFFF
+
+
+def main():
+  # A user timeline that was cached before members were stored as 8-byte
+  # binary post ids holds decimal members. Reading past the cached range
+  # refills the ZSet with binary members, which must not list a post twice.
+  post_client, post_transport = open_client(
+      PostStorageService, POST_STORAGE_ADDR)
+  timeline_client, timeline_transport = open_client(
+      UserTimelineService, USER_TIMELINE_ADDR)
+  redis_client = redis.Redis(*USER_TIMELINE_REDIS_ADDR)
+
+  user_id = random.randint(1 << 40, 1 << 50)
+  now = int(time.time() * 1000)
+  post_ids = []
+  for i in range(NUM_POSTS):
+    # Post ids from UniqueIdService have more than 8 decimal digits.
+    post_id = random.randint(1 << 52, 1 << 62)
+    post = Post(post_id=post_id,
+                creator=Creator(user_id=user_id, username="legacy_user"),
+                req_id=new_req_id(), text="legacy member post %d" % i,
+                user_mentions=[], media=[], urls=[], timestamp=now + i,
+                post_type=PostType.POST)
+    post_client.StorePost(new_req_id(), post, {})
+    timeline_client.WriteUserTimeline(
+        new_req_id(), post_id, user_id, now + i, {})
+    post_ids.append(post_id)
+  newest_first = list(reversed(post_ids))
+
+  # Leave only the newest posts in the ZSet, as decimal members.
+  key = str(user_id)
+  redis_client.delete(key)
+  redis_client.zadd(key, {str(post_id): now + post_ids.index(post_id)
+                          for post_id in newest_first[:NUM_LEGACY_POSTS]})
+
+  for _ in range(2):
+    posts = timeline_client.ReadUserTimeline(
+        new_req_id(), user_id, 0, NUM_POSTS, {})
+    read_ids = [post.post_id for post in posts]
+    # ReadPosts does not keep the order of the ids it is given.
+    assert sorted(read_ids) == sorted(post_ids), read_ids
+
+  members = redis_client.zrevrange(key, 0, -1)
+  assert len(members) == NUM_POSTS, members
+  assert all(len(member) == 8 for member in members), members
+  assert [struct.unpack(">q", member)[0] for member in members] == \
+      newest_first, members
+
+  post_transport.close()
+  timeline_transport.close()
+  print("ok")
+
+
+if __name__ == '__main__':
+  try:
+    main()
+  except Thrift.TException as tx:
+    print('%s' % tx.message)